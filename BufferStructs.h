@@ -1,10 +1,39 @@
 #pragma once
 #include <DirectXMath.h>
+#include "ShaderBufferStructs.h"
 
-struct VertexShaderExternalData
+// --------------------------------------------------------
+// Constant buffers shared by every shader, grouped by how
+// often they change.  The structs themselves (PerFrameData,
+// PerViewData, PerMaterialData and PerObjectData) are
+// generated from the cbuffers in ConstantBuffers.hlsli -
+// see ShaderBufferStructs.h.
+// --------------------------------------------------------
+
+// Registers the shared buffers are bound to, in every stage.
+// SimpleShader leaves anything from the first one up alone.
+#define CB_SLOT_PER_FRAME       10
+#define CB_SLOT_PER_VIEW        11
+#define CB_SLOT_PER_MATERIAL    12
+#define CB_SLOT_PER_OBJECT      13
+#define CB_SLOT_FIRST_SHARED    CB_SLOT_PER_FRAME
+
+// An entity's own tweaks to its shared material - the tint is
+// multiplied in and the UVs are transformed before the material's
+// scale and offset are applied
+struct InstanceParams
 {
     DirectX::XMFLOAT4 colorTint;
-    DirectX::XMFLOAT4X4 worldMatrix;
-    DirectX::XMFLOAT4X4 viewMatrix;
-    DirectX::XMFLOAT4X4 projectionMatrix;
+    DirectX::XMFLOAT2 uvScale;
+    DirectX::XMFLOAT2 uvOffset;
+};
+
+// Per-instance vertex data for instanced draws. No view in
+// here, so it only changes when the object moves or its
+// parameters change.
+struct PerInstanceData
+{
+    DirectX::XMFLOAT4X4 world;
+    DirectX::XMFLOAT4X4 worldInvTranspose;
+    InstanceParams instanceParams;
 };
\ No newline at end of file
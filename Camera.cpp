@@ -22,7 +22,9 @@ Camera::Camera(
     fieldOfView(fov),
     aspectRatio(aspectRatio),
     perspective(perspective),
-    orthoSize(orthoSize)
+    orthoSize(orthoSize),
+    nearClip(0.01f),
+    farClip(100.0f)
 {
     // Set up the transform
     transform.SetPosition(x, y, z);
@@ -91,22 +93,24 @@ void Camera::UpdateViewMatrix()
 
 void Camera::UpdateProjectionMatrix(float aspectRatio)
 {
+    this->aspectRatio = aspectRatio;
+
     XMMATRIX p;
     if (perspective) 
     {
         p = XMMatrixPerspectiveFovLH(
             fieldOfView,
             aspectRatio,
-            0.01f,       // Near clip plane distance
-            100.0f);     // Far clip plane distance
+            nearClip,    // Near clip plane distance
+            farClip);    // Far clip plane distance
     }
     else 
     {
         p = XMMatrixOrthographicLH(
             orthoSize,
             orthoSize,
-            0.01f,
-            100.0f);
+            nearClip,
+            farClip);
     }
 
     XMStoreFloat4x4(&projectionMatrix, p);
@@ -147,3 +151,18 @@ void Camera::SetOrthoSize(float size)
 {
     orthoSize = size;
 }
+
+float Camera::GetAspectRatio()
+{
+    return aspectRatio;
+}
+
+float Camera::GetNearClip()
+{
+    return nearClip;
+}
+
+float Camera::GetFarClip()
+{
+    return farClip;
+}
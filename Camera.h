@@ -37,6 +37,10 @@ public:
     float GetOrthoSize();
     void SetOrthoSize(float size);
 
+    float GetAspectRatio();
+    float GetNearClip();
+    float GetFarClip();
+
 private:
     
     // Camera matrices
@@ -53,5 +57,8 @@ private:
     bool perspective;
 
     float orthoSize;
+
+    float nearClip;
+    float farClip;
 };
 
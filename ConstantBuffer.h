@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstring>
+#include "SimpleShader.h"
+#include "RenderStateCache.h"
+
+// --------------------------------------------------------
+// A constant buffer filled from a single C++ struct and
+// shared between shaders, rather than owned by one of them.
+//
+// Update() skips the upload when the data hasn't changed,
+// so it's safe to call every time the buffer might need it.
+// Uploads count towards SimpleShader's byte stats.
+// --------------------------------------------------------
+template<typename T>
+class ConstantBuffer
+{
+public:
+    void Create(ID3D11Device* device)
+    {
+        static_assert(sizeof(T) % 16 == 0, "Constant buffers must be a multiple of 16 bytes");
+
+        D3D11_BUFFER_DESC desc = {};
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.ByteWidth = sizeof(T);
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf());
+        hasData = false;
+    }
+
+    void Update(ID3D11DeviceContext* context, const T& data)
+    {
+        if (hasData && memcmp(&lastData, &data, sizeof(T)) == 0)
+        {
+            ISimpleShader::BytesSkipped += sizeof(T);
+            return;
+        }
+
+        context->UpdateSubresource(buffer.Get(), 0, 0, &data, 0, 0);
+        ISimpleShader::BytesUploaded += sizeof(T);
+        lastData = data;
+        hasData = true;
+    }
+
+    // Binds to the vertex and pixel shader stages
+    void Bind(RenderStateCache& state, unsigned int slot)
+    {
+        state.SetConstantBuffer(RENDER_STAGE_VERTEX, slot, buffer.Get());
+        state.SetConstantBuffer(RENDER_STAGE_PIXEL, slot, buffer.Get());
+    }
+
+    ID3D11Buffer* Get() { return buffer.Get(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+    T lastData = {};
+    bool hasData = false;
+};
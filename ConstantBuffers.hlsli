@@ -0,0 +1,57 @@
+#ifndef __GGP_CONSTANT_BUFFERS__
+#define __GGP_CONSTANT_BUFFERS__
+
+//
+// SHARED CONSTANT BUFFERS-----------------------------------------------
+//
+
+// Constant buffers shared by every shader, grouped by how often they
+// change.  The application fills and binds these itself (see
+// BufferStructs.h for the C++ side, which must match), so shaders just
+// use whichever of the variables they need.
+
+// Set once per frame
+cbuffer PerFrame : register(b10)
+{
+	float totalTime;
+	float3 ambient;
+	float4 cascadeSplits;			// Far distance of each shadow cascade
+	float2 clusterScreenScale;
+	float clusterDepthScale;
+	float clusterDepthBias;
+	uint globalLightCount;
+	int cascadeCount;
+	float2 perFramePadding;
+};
+
+// Set once per view - the camera, or a shadow view while shadows are drawn
+cbuffer PerView : register(b11)
+{
+	matrix view;
+	matrix projection;
+	float3 cameraPos;
+	float perViewPadding0;
+	float3 cameraForward;
+	float perViewPadding1;
+};
+
+// Set when the material changes
+cbuffer PerMaterial : register(b12)
+{
+	float4 colorTint;
+	float2 uvScale;
+	float2 uvOffset;
+};
+
+// Set for every object drawn
+cbuffer PerObject : register(b13)
+{
+	matrix worldViewProjection;		// Already concatenated on the CPU
+	matrix world;
+	matrix worldInvTranspose;
+	float4 instanceColorTint;		// The entity's own parameters, on top of the material's
+	float2 instanceUvScale;
+	float2 instanceUvOffset;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "ConstantRing.h"
+#include <cstring>
+#include <cassert>
+
+// Bound ranges have to start on, and cover, whole blocks of 16 constants
+#define CONSTANT_RING_ALIGNMENT     256
+
+ConstantRing::ConstantRing(
+    Microsoft::WRL::ComPtr<ID3D11Device> device,
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+    unsigned int sizeInBytes) :
+    supported(false),
+    context(context),
+    allocator(sizeInBytes, CONSTANT_RING_ALIGNMENT),
+    needsDiscard(true),
+    discardCount(0),
+    bytesUploaded(0)
+{
+    // Binding part of a constant buffer and mapping one without
+    // discarding are both Direct3D 11.1 features
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+        !options.ConstantBufferOffsetting ||
+        !options.MapNoOverwriteOnDynamicConstantBuffer ||
+        FAILED(context.As(&context1)))
+    {
+        return;
+    }
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth = sizeInBytes;
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+        return;
+
+    D3D11_QUERY_DESC queryDesc = {};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    for (int i = 0; i < CONSTANT_RING_MAX_FRAMES; i++)
+    {
+        if (FAILED(device->CreateQuery(&queryDesc, frameQueries[i].GetAddressOf())))
+            return;
+    }
+
+    supported = true;
+}
+
+ConstantRing::~ConstantRing()
+{
+}
+
+void ConstantRing::BeginFrame()
+{
+    if (!supported)
+        return;
+
+    // Free up space from every frame the GPU has finished, oldest first
+    while (allocator.GetFramesInFlight() > 0 &&
+        IsFenceDone(allocator.GetOldestPendingFence(), D3D11_ASYNC_GETDATA_DONOTFLUSH))
+    {
+        allocator.Retire(allocator.GetOldestPendingFence());
+    }
+}
+
+void ConstantRing::EndFrame()
+{
+    if (!supported)
+        return;
+
+    // Out of queries - wait for the oldest frame so its query can be reused
+    while (allocator.GetFramesInFlight() >= CONSTANT_RING_MAX_FRAMES)
+    {
+        unsigned long long fence = allocator.GetOldestPendingFence();
+        while (!IsFenceDone(fence, 0)) {}
+        allocator.Retire(fence);
+    }
+
+    context->End(GetFenceQuery(allocator.EndFrame()));
+}
+
+bool ConstantRing::IsFenceDone(unsigned long long fence, UINT flags)
+{
+    // A query that fails (on a removed device, say) never finishes,
+    // so it counts as done rather than holding the ring up forever
+    BOOL done = FALSE;
+    HRESULT hr = context->GetData(GetFenceQuery(fence), &done, sizeof(done), flags);
+    return FAILED(hr) || (hr == S_OK && done);
+}
+
+void ConstantRing::Upload(RenderStateCache& state, const void* data, unsigned int size, unsigned int slot)
+{
+    if (!supported)
+        return;
+
+    // Out of room - the driver gives us fresh memory for a discard,
+    // so everything handed out so far can be forgotten
+    unsigned int offset = 0;
+    if (needsDiscard || !allocator.Allocate(size, offset))
+    {
+        allocator.Reset();
+        needsDiscard = true;
+        discardCount++;
+
+        // Still no room means it's bigger than the whole ring (or
+        // empty) - there's nowhere to write it
+        bool allocated = allocator.Allocate(size, offset);
+        assert(allocated && "Constant data doesn't fit in the ring");
+        if (!allocated)
+            return;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    if (FAILED(context->Map(buffer.Get(), 0, needsDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped)))
+        return;
+
+    memcpy((unsigned char*)mapped.pData + offset, data, size);
+    context->Unmap(buffer.Get(), 0);
+    needsDiscard = false;
+    bytesUploaded += size;
+
+    // Offsets and counts are in 16-byte constants
+    UINT firstConstant = offset / 16;
+    UINT constantCount = (size + CONSTANT_RING_ALIGNMENT - 1) / CONSTANT_RING_ALIGNMENT * CONSTANT_RING_ALIGNMENT / 16;
+    state.SetConstantBuffer(RENDER_STAGE_VERTEX, slot, buffer.Get(), firstConstant, constantCount);
+    state.SetConstantBuffer(RENDER_STAGE_PIXEL, slot, buffer.Get(), firstConstant, constantCount);
+}
+
+void ConstantRing::ResetStats()
+{
+    discardCount = 0;
+    bytesUploaded = 0;
+}
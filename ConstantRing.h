@@ -0,0 +1,68 @@
+#pragma once
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "ConstantRingAllocator.h"
+#include "RenderStateCache.h"
+
+// Frames that can be in flight before EndFrame() waits on the GPU
+#define CONSTANT_RING_MAX_FRAMES    4
+
+// --------------------------------------------------------
+// One big dynamic constant buffer that per-draw constants
+// are sub-allocated from, instead of updating a small
+// buffer over and over.
+//
+// Each upload maps the buffer with NO_OVERWRITE and binds
+// just its slice with VSSetConstantBuffers1/PSSetConstantBuffers1.
+// Space is reused once an event query shows the GPU has
+// finished the frame that used it, and when the ring fills up
+// it's mapped with DISCARD for a fresh block of memory.
+//
+// Needs Direct3D 11.1 constant buffer offsetting and
+// no-overwrite maps - check IsSupported() and fall back to
+// regular constant buffers if it's false.
+// --------------------------------------------------------
+class ConstantRing
+{
+public:
+    ConstantRing(
+        Microsoft::WRL::ComPtr<ID3D11Device> device,
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+        unsigned int sizeInBytes);
+    ~ConstantRing();
+
+    bool IsSupported() { return supported; }
+
+    // Call around each frame's uploads
+    void BeginFrame();
+    void EndFrame();
+
+    // Copies data into the ring and binds it to the given
+    // register in the vertex and pixel shader stages
+    void Upload(RenderStateCache& state, const void* data, unsigned int size, unsigned int slot);
+
+    // Stats since the last ResetStats()
+    unsigned int GetDiscardCount() { return discardCount; }
+    unsigned long long GetBytesUploaded() { return bytesUploaded; }
+    unsigned int GetUsedBytes() { return allocator.GetUsedBytes(); }
+    void ResetStats();
+
+private:
+    bool supported;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+    ConstantRingAllocator allocator;
+    bool needsDiscard;
+
+    // An event query per frame in flight, used as a fence. The
+    // allocator does the fence bookkeeping, these just tell it
+    // when fences have completed.
+    Microsoft::WRL::ComPtr<ID3D11Query> frameQueries[CONSTANT_RING_MAX_FRAMES];
+    ID3D11Query* GetFenceQuery(unsigned long long fence) { return frameQueries[fence % CONSTANT_RING_MAX_FRAMES].Get(); }
+    bool IsFenceDone(unsigned long long fence, UINT flags);
+
+    unsigned int discardCount;
+    unsigned long long bytesUploaded;
+};
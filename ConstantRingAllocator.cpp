@@ -0,0 +1,99 @@
+#include "ConstantRingAllocator.h"
+
+ConstantRingAllocator::ConstantRingAllocator(unsigned int capacity, unsigned int alignment) :
+    capacity(capacity),
+    alignment(alignment),
+    nextFence(1),
+    completedFence(0)
+{
+    Reset();
+}
+
+ConstantRingAllocator::~ConstantRingAllocator()
+{
+}
+
+bool ConstantRingAllocator::Allocate(unsigned int size, unsigned int& offset)
+{
+    unsigned int alignedSize = (size + alignment - 1) / alignment * alignment;
+    if (alignedSize == 0 || alignedSize > capacity)
+        return false;
+
+    // Nothing's in use, so start over from the beginning. Any frames
+    // still waiting to retire are empty and ended at the old head.
+    unsigned int used = GetUsedBytes();
+    if (used == 0)
+    {
+        head = 0;
+        tail = 0;
+        for (auto& frame : frames)
+            frame.Head = 0;
+    }
+
+    // Free space is either after the head (and, by wrapping, before
+    // the tail) or between the head and the tail
+    if (used == 0 || head > tail)
+    {
+        if (head + alignedSize <= capacity)
+        {
+            offset = head;
+        }
+        else if (alignedSize <= tail)
+        {
+            // Skip what's left at the end and start over at the beginning
+            totalAllocated += capacity - head;
+            offset = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Head has wrapped behind the tail (or the ring is full)
+        if (head + alignedSize > tail || used == capacity)
+            return false;
+
+        offset = head;
+    }
+
+    head = offset + alignedSize;
+    if (head == capacity)
+        head = 0;
+
+    totalAllocated += alignedSize;
+    return true;
+}
+
+unsigned long long ConstantRingAllocator::EndFrame()
+{
+    unsigned long long fence = nextFence++;
+    frames.push_back({ fence, head, totalAllocated });
+    return fence;
+}
+
+void ConstantRingAllocator::Retire(unsigned long long completed)
+{
+    // Fences can't complete before they're handed out
+    if (completed >= nextFence)
+        completed = nextFence - 1;
+    if (completed > completedFence)
+        completedFence = completed;
+
+    while (!frames.empty() && frames.front().Fence <= completedFence)
+    {
+        tail = frames.front().Head;
+        totalRetired = frames.front().TotalAllocated;
+        frames.pop_front();
+    }
+}
+
+void ConstantRingAllocator::Reset()
+{
+    head = 0;
+    tail = 0;
+    totalAllocated = 0;
+    totalRetired = 0;
+    frames.clear();
+}
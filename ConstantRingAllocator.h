@@ -0,0 +1,73 @@
+#pragma once
+#include <deque>
+
+// --------------------------------------------------------
+// Hands out space in a ring buffer for data that's written
+// once and read by the GPU later in the frame, like per-draw
+// constants.
+//
+// Allocations are grouped by frame. Each frame is given the
+// next fence value when it ends, and its space is only reused
+// once that fence has been reported as completed, so nothing
+// the GPU might still be reading is overwritten. Fences are
+// handed out and completed in order, starting at 1.
+//
+// When there's no room left, Allocate() fails and the caller
+// is expected to get fresh memory (Map with DISCARD) and
+// Reset() the ring.
+// --------------------------------------------------------
+class ConstantRingAllocator
+{
+public:
+    ConstantRingAllocator(unsigned int capacity, unsigned int alignment);
+    ~ConstantRingAllocator();
+
+    // Finds room for size bytes, rounded up to the alignment.
+    // Returns false if the ring is full.
+    bool Allocate(unsigned int size, unsigned int& offset);
+
+    // Ends the current frame and returns its fence - its allocations
+    // are freed once Retire() is called with that fence or a later one
+    unsigned long long EndFrame();
+
+    // Marks every fence up to completedFence as done and frees the
+    // space of their frames
+    void Retire(unsigned long long completedFence);
+
+    // Forgets every allocation, for when the memory behind the
+    // ring has been replaced. Fences still in flight are kept.
+    void Reset();
+
+    unsigned int GetCapacity() { return capacity; }
+    unsigned int GetUsedBytes() { return (unsigned int)(totalAllocated - totalRetired); }
+
+    // Oldest fence that hasn't completed yet, and how many ended
+    // frames are still waiting on their fence
+    unsigned long long GetOldestPendingFence() { return completedFence + 1; }
+    unsigned int GetFramesInFlight() { return (unsigned int)(nextFence - 1 - completedFence); }
+
+private:
+    unsigned int capacity;
+    unsigned int alignment;
+
+    // Next allocation goes at head, oldest data still in use is at tail
+    unsigned int head;
+    unsigned int tail;
+
+    // Fence the next frame gets, and the last one completed
+    unsigned long long nextFence;
+    unsigned long long completedFence;
+
+    // Running byte counts, including space skipped when wrapping
+    unsigned long long totalAllocated;
+    unsigned long long totalRetired;
+
+    // Where each unfinished frame ended
+    struct FrameEnd
+    {
+        unsigned long long Fence;
+        unsigned int Head;
+        unsigned long long TotalAllocated;
+    };
+    std::deque<FrameEnd> frames;
+};
@@ -0,0 +1,609 @@
+#include "DxbcReflection.h"
+#include <cctype>
+#include <cstring>
+
+// Chunk ids, as little endian four character codes
+#define DXBC_FOURCC(a, b, c, d) ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+#define DXBC_CONTAINER  DXBC_FOURCC('D', 'X', 'B', 'C')
+#define DXBC_RDEF       DXBC_FOURCC('R', 'D', 'E', 'F')
+#define DXBC_RD11       DXBC_FOURCC('R', 'D', '1', '1')
+#define DXBC_ISGN       DXBC_FOURCC('I', 'S', 'G', 'N')
+#define DXBC_ISG1       DXBC_FOURCC('I', 'S', 'G', '1')
+#define DXBC_OSGN       DXBC_FOURCC('O', 'S', 'G', 'N')
+#define DXBC_OSG5       DXBC_FOURCC('O', 'S', 'G', '5')
+#define DXBC_OSG1       DXBC_FOURCC('O', 'S', 'G', '1')
+#define DXBC_SHDR       DXBC_FOURCC('S', 'H', 'D', 'R')
+#define DXBC_SHEX       DXBC_FOURCC('S', 'H', 'E', 'X')
+
+// Container header: magic, 16 byte checksum, version, total size, chunk count
+#define DXBC_HEADER_SIZE        32
+
+// Sizes of the RDEF entries before shader model 5 added the RD11
+// header, which gives the sizes explicitly
+#define RDEF_HEADER_SIZE        28
+#define RDEF_BUFFER_SIZE        24
+#define RDEF_BINDING_SIZE       32
+#define RDEF_VARIABLE_SIZE      24
+#define RDEF_TYPE_SIZE          16
+#define RDEF_MEMBER_SIZE        12
+
+// Struct types can nest, but not this deep in anything sane
+#define RDEF_MAX_TYPE_DEPTH     16
+
+// D3D_NAME values D3DReflect gives pixel shader outputs that
+// the signature itself stores as undefined
+#define DXBC_NAME_TARGET                64
+#define DXBC_NAME_DEPTH                 65
+#define DXBC_NAME_COVERAGE              66
+#define DXBC_NAME_DEPTH_GREATER_EQUAL   67
+#define DXBC_NAME_DEPTH_LESS_EQUAL      68
+
+// Shader code opcodes needed while walking the instructions
+#define SHEX_OPCODE_CUSTOMDATA          53
+#define SHEX_OPCODE_DCL_THREAD_GROUP    155
+
+// Reads a little endian value, or fails if it's past the end
+static bool Read32(const unsigned char* data, unsigned int size, unsigned int offset, unsigned int& value)
+{
+    if (offset > size || size - offset < 4)
+        return false;
+
+    value =
+        (unsigned int)data[offset] |
+        ((unsigned int)data[offset + 1] << 8) |
+        ((unsigned int)data[offset + 2] << 16) |
+        ((unsigned int)data[offset + 3] << 24);
+    return true;
+}
+
+static bool Read16(const unsigned char* data, unsigned int size, unsigned int offset, unsigned int& value)
+{
+    if (offset > size || size - offset < 2)
+        return false;
+
+    value = (unsigned int)data[offset] | ((unsigned int)data[offset + 1] << 8);
+    return true;
+}
+
+// Checks a table of count entries at offset fits in the chunk,
+// before anything is allocated for it
+static bool FitsInChunk(unsigned int size, unsigned int offset, unsigned int count, unsigned int entrySize)
+{
+    return offset <= size && count <= (size - offset) / entrySize;
+}
+
+// Strings are null terminated and stored by offset from the chunk start
+static bool ReadString(const unsigned char* data, unsigned int size, unsigned int offset, std::string& value)
+{
+    if (offset >= size)
+        return false;
+
+    const void* end = memchr(data + offset, 0, size - offset);
+    if (!end)
+        return false;
+
+    value.assign((const char*)data + offset, (const char*)end);
+    return true;
+}
+
+// Semantic names aren't case sensitive
+static bool SameName(const std::string& name, const char* other)
+{
+    size_t i = 0;
+    for (; i < name.size() && other[i]; i++)
+    {
+        if (tolower((unsigned char)name[i]) != tolower((unsigned char)other[i]))
+            return false;
+    }
+    return i == name.size() && !other[i];
+}
+
+// What D3DReflect reports for an output the signature leaves undefined
+static unsigned int GetOutputSystemValue(const std::string& semanticName)
+{
+    if (SameName(semanticName, "SV_Target")) return DXBC_NAME_TARGET;
+    if (SameName(semanticName, "SV_Depth")) return DXBC_NAME_DEPTH;
+    if (SameName(semanticName, "SV_Coverage")) return DXBC_NAME_COVERAGE;
+    if (SameName(semanticName, "SV_DepthGreaterEqual")) return DXBC_NAME_DEPTH_GREATER_EQUAL;
+    if (SameName(semanticName, "SV_DepthLessEqual")) return DXBC_NAME_DEPTH_LESS_EQUAL;
+    return 0;
+}
+
+DxbcReflection::DxbcReflection()
+{
+    Clear();
+}
+
+DxbcReflection::~DxbcReflection()
+{
+}
+
+void DxbcReflection::Clear()
+{
+    shaderType = DXBC_SHADER_UNKNOWN;
+    majorVersion = 0;
+    minorVersion = 0;
+    threadGroupSize[0] = threadGroupSize[1] = threadGroupSize[2] = 0;
+
+    resourceBindings.clear();
+    constantBuffers.clear();
+    inputParameters.clear();
+    outputParameters.clear();
+}
+
+bool DxbcReflection::Parse(const void* data, size_t size)
+{
+    Clear();
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (!bytes || size < DXBC_HEADER_SIZE || size > 0xFFFFFFFFu)
+        return false;
+
+    unsigned int containerSize = (unsigned int)size;
+    unsigned int magic, totalSize, chunkCount;
+    if (!Read32(bytes, containerSize, 0, magic) || magic != DXBC_CONTAINER ||
+        !Read32(bytes, containerSize, 24, totalSize) || totalSize > containerSize ||
+        !Read32(bytes, containerSize, 28, chunkCount))
+    {
+        return false;
+    }
+
+    bool ok = true;
+    for (unsigned int c = 0; c < chunkCount && ok; c++)
+    {
+        unsigned int chunkOffset, fourcc, chunkSize;
+        if (!Read32(bytes, totalSize, DXBC_HEADER_SIZE + c * 4, chunkOffset) ||
+            !Read32(bytes, totalSize, chunkOffset, fourcc) ||
+            !Read32(bytes, totalSize, chunkOffset + 4, chunkSize) ||
+            chunkSize > totalSize - chunkOffset - 8)
+        {
+            ok = false;
+            break;
+        }
+
+        // Offsets inside a chunk are from the start of its data
+        const unsigned char* chunk = bytes + chunkOffset + 8;
+        switch (fourcc)
+        {
+        case DXBC_RDEF: ok = ParseResourceDefinitions(chunk, chunkSize); break;
+        case DXBC_ISGN: ok = ParseSignature(chunk, chunkSize, 24, false, inputParameters); break;
+        case DXBC_ISG1: ok = ParseSignature(chunk, chunkSize, 32, true, inputParameters); break;
+        case DXBC_OSGN: ok = ParseSignature(chunk, chunkSize, 24, false, outputParameters); break;
+        case DXBC_OSG5: ok = ParseSignature(chunk, chunkSize, 28, true, outputParameters); break;
+        case DXBC_OSG1: ok = ParseSignature(chunk, chunkSize, 32, true, outputParameters); break;
+        case DXBC_SHDR:
+        case DXBC_SHEX: ok = ParseShaderCode(chunk, chunkSize); break;
+        }
+    }
+
+    if (!ok)
+        Clear();
+
+    return ok;
+}
+
+bool DxbcReflection::ParseResourceDefinitions(const unsigned char* chunk, unsigned int size)
+{
+    unsigned int bufferCount, bufferOffset, bindingCount, bindingOffset;
+    if (!Read32(chunk, size, 0, bufferCount) ||
+        !Read32(chunk, size, 4, bufferOffset) ||
+        !Read32(chunk, size, 8, bindingCount) ||
+        !Read32(chunk, size, 12, bindingOffset))
+    {
+        return false;
+    }
+
+    // Shader model 5 says how big each kind of entry is, since
+    // they grew over time (5.1 added register spaces to bindings)
+    unsigned int bufferSize = RDEF_BUFFER_SIZE;
+    unsigned int bindingSize = RDEF_BINDING_SIZE;
+    unsigned int variableSize = RDEF_VARIABLE_SIZE;
+    unsigned int typeSize = RDEF_TYPE_SIZE;
+    unsigned int rd11;
+    if (Read32(chunk, size, RDEF_HEADER_SIZE, rd11) && rd11 == DXBC_RD11)
+    {
+        if (!Read32(chunk, size, RDEF_HEADER_SIZE + 8, bufferSize) ||
+            !Read32(chunk, size, RDEF_HEADER_SIZE + 12, bindingSize) ||
+            !Read32(chunk, size, RDEF_HEADER_SIZE + 16, variableSize) ||
+            !Read32(chunk, size, RDEF_HEADER_SIZE + 20, typeSize) ||
+            bufferSize < RDEF_BUFFER_SIZE || bindingSize < RDEF_BINDING_SIZE ||
+            variableSize < RDEF_VARIABLE_SIZE || typeSize < RDEF_TYPE_SIZE)
+        {
+            return false;
+        }
+    }
+
+    if (!FitsInChunk(size, bindingOffset, bindingCount, bindingSize) ||
+        !FitsInChunk(size, bufferOffset, bufferCount, bufferSize))
+    {
+        return false;
+    }
+
+    // Bound resources
+    resourceBindings.resize(bindingCount);
+    for (unsigned int i = 0; i < bindingCount; i++)
+    {
+        unsigned int entry = bindingOffset + i * bindingSize;
+        unsigned int nameOffset;
+        DxbcResourceBinding& binding = resourceBindings[i];
+        if (!Read32(chunk, size, entry, nameOffset) ||
+            !ReadString(chunk, size, nameOffset, binding.Name) ||
+            !Read32(chunk, size, entry + 4, binding.Type) ||
+            !Read32(chunk, size, entry + 8, binding.ReturnType) ||
+            !Read32(chunk, size, entry + 12, binding.Dimension) ||
+            !Read32(chunk, size, entry + 16, binding.NumSamples) ||
+            !Read32(chunk, size, entry + 20, binding.BindPoint) ||
+            !Read32(chunk, size, entry + 24, binding.BindCount) ||
+            !Read32(chunk, size, entry + 28, binding.Flags))
+        {
+            return false;
+        }
+    }
+
+    // Constant buffers and their variables
+    constantBuffers.resize(bufferCount);
+    for (unsigned int i = 0; i < bufferCount; i++)
+    {
+        unsigned int entry = bufferOffset + i * bufferSize;
+        unsigned int nameOffset, variableCount, variableOffset;
+        DxbcConstantBuffer& buffer = constantBuffers[i];
+        if (!Read32(chunk, size, entry, nameOffset) ||
+            !ReadString(chunk, size, nameOffset, buffer.Name) ||
+            !Read32(chunk, size, entry + 4, variableCount) ||
+            !Read32(chunk, size, entry + 8, variableOffset) ||
+            !Read32(chunk, size, entry + 12, buffer.Size) ||
+            !Read32(chunk, size, entry + 16, buffer.Flags) ||
+            !Read32(chunk, size, entry + 20, buffer.Type))
+        {
+            return false;
+        }
+
+        if (!FitsInChunk(size, variableOffset, variableCount, variableSize))
+            return false;
+
+        buffer.Variables.resize(variableCount);
+        for (unsigned int v = 0; v < variableCount; v++)
+        {
+            unsigned int variableEntry = variableOffset + v * variableSize;
+            unsigned int variableNameOffset, typeOffset;
+            DxbcVariable& variable = buffer.Variables[v];
+            if (!Read32(chunk, size, variableEntry, variableNameOffset) ||
+                !ReadString(chunk, size, variableNameOffset, variable.Name) ||
+                !Read32(chunk, size, variableEntry + 4, variable.StartOffset) ||
+                !Read32(chunk, size, variableEntry + 8, variable.Size) ||
+                !Read32(chunk, size, variableEntry + 12, variable.Flags) ||
+                !Read32(chunk, size, variableEntry + 16, typeOffset) ||
+                !ParseType(chunk, size, typeOffset, typeSize, 0, variable.Type))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool DxbcReflection::ParseType(const unsigned char* chunk, unsigned int size, unsigned int offset, unsigned int typeSize, unsigned int depth, DxbcType& type)
+{
+    if (depth > RDEF_MAX_TYPE_DEPTH)
+        return false;
+
+    unsigned int memberCount, memberOffset;
+    if (!Read16(chunk, size, offset, type.Class) ||
+        !Read16(chunk, size, offset + 2, type.Type) ||
+        !Read16(chunk, size, offset + 4, type.Rows) ||
+        !Read16(chunk, size, offset + 6, type.Columns) ||
+        !Read16(chunk, size, offset + 8, type.Elements) ||
+        !Read16(chunk, size, offset + 10, memberCount) ||
+        !Read32(chunk, size, offset + 12, memberOffset))
+    {
+        return false;
+    }
+
+    // Shader model 5 types end with their name
+    type.Name.clear();
+    unsigned int nameOffset;
+    if (typeSize >= RDEF_TYPE_SIZE + 20 &&
+        Read32(chunk, size, offset + RDEF_TYPE_SIZE + 16, nameOffset) &&
+        nameOffset != 0 &&
+        !ReadString(chunk, size, nameOffset, type.Name))
+    {
+        return false;
+    }
+
+    if (!FitsInChunk(size, memberOffset, memberCount, RDEF_MEMBER_SIZE))
+        return false;
+
+    type.Members.resize(memberCount);
+    for (unsigned int m = 0; m < memberCount; m++)
+    {
+        unsigned int entry = memberOffset + m * RDEF_MEMBER_SIZE;
+        unsigned int memberNameOffset, memberTypeOffset;
+        DxbcType::Member& member = type.Members[m];
+        if (!Read32(chunk, size, entry, memberNameOffset) ||
+            !ReadString(chunk, size, memberNameOffset, member.Name) ||
+            !Read32(chunk, size, entry + 4, memberTypeOffset) ||
+            !Read32(chunk, size, entry + 8, member.Offset) ||
+            !ParseType(chunk, size, memberTypeOffset, typeSize, depth + 1, member.Type))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DxbcReflection::ParseSignature(const unsigned char* chunk, unsigned int size, unsigned int elementSize, bool hasStream, std::vector<DxbcSignatureParameter>& parameters)
+{
+    unsigned int count;
+    if (!Read32(chunk, size, 0, count) || !FitsInChunk(size, 8, count, elementSize))
+        return false;
+
+    // Elements start after the count and a constant 8
+    parameters.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int entry = 8 + i * elementSize;
+        DxbcSignatureParameter& parameter = parameters[i];
+
+        // The newer layouts put the stream first
+        parameter.Stream = 0;
+        if (hasStream)
+        {
+            if (!Read32(chunk, size, entry, parameter.Stream))
+                return false;
+            entry += 4;
+        }
+
+        unsigned int nameOffset, masks;
+        if (!Read32(chunk, size, entry, nameOffset) ||
+            !ReadString(chunk, size, nameOffset, parameter.SemanticName) ||
+            !Read32(chunk, size, entry + 4, parameter.SemanticIndex) ||
+            !Read32(chunk, size, entry + 8, parameter.SystemValueType) ||
+            !Read32(chunk, size, entry + 12, parameter.ComponentType) ||
+            !Read32(chunk, size, entry + 16, parameter.Register) ||
+            !Read32(chunk, size, entry + 20, masks))
+        {
+            return false;
+        }
+
+        parameter.Mask = (unsigned char)(masks & 0xFF);
+        parameter.ReadWriteMask = (unsigned char)((masks >> 8) & 0xFF);
+
+        if (&parameters == &outputParameters && parameter.SystemValueType == 0)
+            parameter.SystemValueType = GetOutputSystemValue(parameter.SemanticName);
+    }
+
+    return true;
+}
+
+bool DxbcReflection::ParseShaderCode(const unsigned char* chunk, unsigned int size)
+{
+    // Version token, then the length of the code in dwords
+    unsigned int version, length;
+    if (!Read32(chunk, size, 0, version) ||
+        !Read32(chunk, size, 4, length) ||
+        length > size / 4)
+    {
+        return false;
+    }
+
+    shaderType = (DxbcShaderType)((version >> 16) & 0xFFFF);
+    majorVersion = (version >> 4) & 0xF;
+    minorVersion = version & 0xF;
+
+    // Walk the instructions looking for declarations we care
+    // about - they all come before the first real instruction,
+    // but walking everything keeps this simple
+    unsigned int position = 2;
+    while (position < length)
+    {
+        unsigned int token;
+        Read32(chunk, size, position * 4, token);
+
+        unsigned int opcode = token & 0x7FF;
+        unsigned int instructionLength = (token >> 24) & 0x7F;
+
+        // Custom data blocks (like immediate constant buffers)
+        // store their length in the next token instead
+        if (opcode == SHEX_OPCODE_CUSTOMDATA)
+        {
+            if (!Read32(chunk, size, (position + 1) * 4, instructionLength))
+                return false;
+        }
+
+        if (instructionLength == 0 || instructionLength > length - position)
+            return false;
+
+        if (opcode == SHEX_OPCODE_DCL_THREAD_GROUP && instructionLength >= 4)
+        {
+            Read32(chunk, size, (position + 1) * 4, threadGroupSize[0]);
+            Read32(chunk, size, (position + 2) * 4, threadGroupSize[1]);
+            Read32(chunk, size, (position + 3) * 4, threadGroupSize[2]);
+        }
+
+        position += instructionLength;
+    }
+
+    return true;
+}
+
+bool DxbcReflection::GetInputSignature(const void* data, size_t size, const unsigned char** signature, unsigned int* signatureSize)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (!bytes || size < DXBC_HEADER_SIZE || size > 0xFFFFFFFFu)
+        return false;
+
+    unsigned int containerSize = (unsigned int)size;
+    unsigned int magic, totalSize, chunkCount;
+    if (!Read32(bytes, containerSize, 0, magic) || magic != DXBC_CONTAINER ||
+        !Read32(bytes, containerSize, 24, totalSize) || totalSize > containerSize ||
+        !Read32(bytes, containerSize, 28, chunkCount))
+    {
+        return false;
+    }
+
+    for (unsigned int c = 0; c < chunkCount; c++)
+    {
+        unsigned int chunkOffset, fourcc, chunkSize;
+        if (!Read32(bytes, totalSize, DXBC_HEADER_SIZE + c * 4, chunkOffset) ||
+            !Read32(bytes, totalSize, chunkOffset, fourcc) ||
+            !Read32(bytes, totalSize, chunkOffset + 4, chunkSize) ||
+            chunkSize > totalSize - chunkOffset - 8)
+        {
+            return false;
+        }
+
+        if (fourcc == DXBC_ISGN || fourcc == DXBC_ISG1)
+        {
+            *signature = bytes + chunkOffset + 8;
+            *signatureSize = chunkSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+const DxbcResourceBinding* DxbcReflection::FindResourceBinding(const std::string& name)
+{
+    for (auto& binding : resourceBindings)
+    {
+        if (binding.Name == name)
+            return &binding;
+    }
+
+    return 0;
+}
+
+unsigned int DxbcReflection::GetThreadGroupSize(unsigned int* x, unsigned int* y, unsigned int* z)
+{
+    if (x) *x = threadGroupSize[0];
+    if (y) *y = threadGroupSize[1];
+    if (z) *z = threadGroupSize[2];
+    return threadGroupSize[0] * threadGroupSize[1] * threadGroupSize[2];
+}
+
+#ifdef _WIN32
+#include <d3dcompiler.h>
+#include <d3d11shader.h>
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "dxguid.lib")
+
+static void ReflectType(ID3D11ShaderReflectionType* reflectionType, DxbcType& type)
+{
+    D3D11_SHADER_TYPE_DESC typeDesc;
+    reflectionType->GetDesc(&typeDesc);
+    type.Class = typeDesc.Class;
+    type.Type = typeDesc.Type;
+    type.Rows = typeDesc.Rows;
+    type.Columns = typeDesc.Columns;
+    type.Elements = typeDesc.Elements;
+    type.Name = typeDesc.Name ? typeDesc.Name : "";
+
+    type.Members.resize(typeDesc.Members);
+    for (unsigned int m = 0; m < typeDesc.Members; m++)
+    {
+        ID3D11ShaderReflectionType* memberType = reflectionType->GetMemberTypeByIndex(m);
+        D3D11_SHADER_TYPE_DESC memberDesc;
+        memberType->GetDesc(&memberDesc);
+
+        DxbcType::Member& member = type.Members[m];
+        member.Name = reflectionType->GetMemberTypeName(m);
+        member.Offset = memberDesc.Offset;
+        ReflectType(memberType, member.Type);
+    }
+}
+
+static DxbcSignatureParameter ReflectParameter(const D3D11_SIGNATURE_PARAMETER_DESC& paramDesc)
+{
+    DxbcSignatureParameter parameter;
+    parameter.SemanticName = paramDesc.SemanticName;
+    parameter.SemanticIndex = paramDesc.SemanticIndex;
+    parameter.Register = paramDesc.Register;
+    parameter.SystemValueType = paramDesc.SystemValueType;
+    parameter.ComponentType = paramDesc.ComponentType;
+    parameter.Mask = paramDesc.Mask;
+    parameter.ReadWriteMask = paramDesc.ReadWriteMask;
+    parameter.Stream = paramDesc.Stream;
+    return parameter;
+}
+
+bool DxbcReflection::Reflect(const void* data, size_t size)
+{
+    Clear();
+
+    ID3D11ShaderReflection* reflection = 0;
+    if (FAILED(D3DReflect(data, size, IID_ID3D11ShaderReflection, (void**)&reflection)))
+        return false;
+
+    D3D11_SHADER_DESC shaderDesc;
+    reflection->GetDesc(&shaderDesc);
+    shaderType = (DxbcShaderType)D3D11_SHVER_GET_TYPE(shaderDesc.Version);
+    majorVersion = D3D11_SHVER_GET_MAJOR(shaderDesc.Version);
+    minorVersion = D3D11_SHVER_GET_MINOR(shaderDesc.Version);
+    if (shaderType == DXBC_SHADER_COMPUTE)
+        reflection->GetThreadGroupSize(&threadGroupSize[0], &threadGroupSize[1], &threadGroupSize[2]);
+
+    resourceBindings.resize(shaderDesc.BoundResources);
+    for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+    {
+        D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+        reflection->GetResourceBindingDesc(r, &bindDesc);
+
+        DxbcResourceBinding& binding = resourceBindings[r];
+        binding.Name = bindDesc.Name;
+        binding.Type = bindDesc.Type;
+        binding.ReturnType = bindDesc.ReturnType;
+        binding.Dimension = bindDesc.Dimension;
+        binding.NumSamples = bindDesc.NumSamples;
+        binding.BindPoint = bindDesc.BindPoint;
+        binding.BindCount = bindDesc.BindCount;
+        binding.Flags = bindDesc.uFlags;
+    }
+
+    constantBuffers.resize(shaderDesc.ConstantBuffers);
+    for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+    {
+        ID3D11ShaderReflectionConstantBuffer* cb = reflection->GetConstantBufferByIndex(b);
+        D3D11_SHADER_BUFFER_DESC bufferDesc;
+        cb->GetDesc(&bufferDesc);
+
+        DxbcConstantBuffer& buffer = constantBuffers[b];
+        buffer.Name = bufferDesc.Name;
+        buffer.Type = bufferDesc.Type;
+        buffer.Size = bufferDesc.Size;
+        buffer.Flags = bufferDesc.uFlags;
+
+        buffer.Variables.resize(bufferDesc.Variables);
+        for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+        {
+            ID3D11ShaderReflectionVariable* var = cb->GetVariableByIndex(v);
+            D3D11_SHADER_VARIABLE_DESC varDesc;
+            var->GetDesc(&varDesc);
+
+            DxbcVariable& variable = buffer.Variables[v];
+            variable.Name = varDesc.Name;
+            variable.StartOffset = varDesc.StartOffset;
+            variable.Size = varDesc.Size;
+            variable.Flags = varDesc.uFlags;
+            ReflectType(var->GetType(), variable.Type);
+        }
+    }
+
+    for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+    {
+        D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+        reflection->GetInputParameterDesc(i, &paramDesc);
+        inputParameters.push_back(ReflectParameter(paramDesc));
+    }
+    for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+    {
+        D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+        reflection->GetOutputParameterDesc(i, &paramDesc);
+        outputParameters.push_back(ReflectParameter(paramDesc));
+    }
+
+    reflection->Release();
+    return true;
+}
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <string>
+
+// Shader stages, as stored in the shader code's version token
+// (the same order as D3D11_SHADER_VERSION_TYPE)
+enum DxbcShaderType
+{
+    DXBC_SHADER_PIXEL,
+    DXBC_SHADER_VERTEX,
+    DXBC_SHADER_GEOMETRY,
+    DXBC_SHADER_HULL,
+    DXBC_SHADER_DOMAIN,
+    DXBC_SHADER_COMPUTE,
+    DXBC_SHADER_UNKNOWN = 0xFFFF
+};
+
+// Resource binding types - the values match D3D_SHADER_INPUT_TYPE
+#define DXBC_INPUT_CBUFFER                          0
+#define DXBC_INPUT_TBUFFER                          1
+#define DXBC_INPUT_TEXTURE                          2
+#define DXBC_INPUT_SAMPLER                          3
+#define DXBC_INPUT_UAV_RWTYPED                      4
+#define DXBC_INPUT_STRUCTURED                       5
+#define DXBC_INPUT_UAV_RWSTRUCTURED                 6
+#define DXBC_INPUT_BYTEADDRESS                      7
+#define DXBC_INPUT_UAV_RWBYTEADDRESS                8
+#define DXBC_INPUT_UAV_APPEND_STRUCTURED            9
+#define DXBC_INPUT_UAV_CONSUME_STRUCTURED           10
+#define DXBC_INPUT_UAV_RWSTRUCTURED_WITH_COUNTER    11
+
+// A texture, sampler, buffer or UAV bound to the shader,
+// laid out like D3D11_SHADER_INPUT_BIND_DESC
+struct DxbcResourceBinding
+{
+    std::string Name;
+    unsigned int Type;          // DXBC_INPUT_*
+    unsigned int ReturnType;    // D3D_RESOURCE_RETURN_TYPE
+    unsigned int Dimension;     // D3D_SRV_DIMENSION
+    unsigned int NumSamples;
+    unsigned int BindPoint;
+    unsigned int BindCount;
+    unsigned int Flags;
+};
+
+// The type of a constant buffer variable or struct member,
+// laid out like D3D11_SHADER_TYPE_DESC
+struct DxbcType
+{
+    unsigned int Class;         // D3D_SHADER_VARIABLE_CLASS
+    unsigned int Type;          // D3D_SHADER_VARIABLE_TYPE
+    unsigned int Rows;
+    unsigned int Columns;
+    unsigned int Elements;      // 0 if it isn't an array
+    std::string Name;           // Only stored by shader model 5 and up
+
+    struct Member;
+    std::vector<Member> Members;
+};
+
+struct DxbcType::Member
+{
+    std::string Name;
+    unsigned int Offset;        // From the start of the struct
+    DxbcType Type;
+};
+
+// A variable in a constant buffer, laid out like
+// D3D11_SHADER_VARIABLE_DESC
+struct DxbcVariable
+{
+    std::string Name;
+    unsigned int StartOffset;
+    unsigned int Size;
+    unsigned int Flags;         // D3D_SHADER_VARIABLE_FLAGS
+    DxbcType Type;
+};
+
+// A constant buffer, laid out like D3D11_SHADER_BUFFER_DESC
+struct DxbcConstantBuffer
+{
+    std::string Name;
+    unsigned int Type;          // D3D_CBUFFER_TYPE
+    unsigned int Size;
+    unsigned int Flags;
+    std::vector<DxbcVariable> Variables;
+};
+
+// One element of an input or output signature, laid out like
+// D3D11_SIGNATURE_PARAMETER_DESC
+struct DxbcSignatureParameter
+{
+    std::string SemanticName;
+    unsigned int SemanticIndex;
+    unsigned int Register;
+    unsigned int SystemValueType;   // D3D_NAME
+    unsigned int ComponentType;     // D3D_REGISTER_COMPONENT_TYPE
+    unsigned char Mask;
+    unsigned char ReadWriteMask;
+    unsigned int Stream;
+};
+
+// --------------------------------------------------------
+// Reads the reflection data straight out of compiled shader
+// code (a DXBC container, like a .cso file) without going
+// through D3DReflect, so it works anywhere - including
+// offline tools that don't run on Windows.
+//
+// Covers the chunks SimpleShader needs: RDEF for constant
+// buffers, variables and bound resources, ISGN/OSGN (and
+// their newer variants) for the signatures, and SHEX/SHDR
+// for the shader type, model and thread group size.
+//
+// On Windows, Reflect() fills in the same tables through
+// D3DReflect instead. SimpleShader uses that, and the parser
+// is checked against it by Tools/DxbcReflectionTest.
+// --------------------------------------------------------
+class DxbcReflection
+{
+public:
+    DxbcReflection();
+    ~DxbcReflection();
+
+    // Returns false if the data isn't a DXBC container or a
+    // chunk in it is broken, in which case nothing is kept
+    bool Parse(const void* data, size_t size);
+
+#ifdef _WIN32
+    // The same as Parse(), but asks D3DReflect
+    bool Reflect(const void* data, size_t size);
+#endif
+
+    DxbcShaderType GetShaderType() { return shaderType; }
+    unsigned int GetMajorVersion() { return majorVersion; }
+    unsigned int GetMinorVersion() { return minorVersion; }
+
+    // In the order D3DReflect returns them
+    const std::vector<DxbcResourceBinding>& GetResourceBindings() { return resourceBindings; }
+    const std::vector<DxbcConstantBuffer>& GetConstantBuffers() { return constantBuffers; }
+    const std::vector<DxbcSignatureParameter>& GetInputParameters() { return inputParameters; }
+    const std::vector<DxbcSignatureParameter>& GetOutputParameters() { return outputParameters; }
+
+    // Null if there's no resource with that name
+    const DxbcResourceBinding* FindResourceBinding(const std::string& name);
+
+    // Compute shaders only - returns the total thread count
+    unsigned int GetThreadGroupSize(unsigned int* x, unsigned int* y, unsigned int* z);
+
+    // The raw input signature chunk (ISGN or ISG1) of a container,
+    // without parsing the rest. Input layouts are only checked against
+    // this, so shaders with the same bytes here can share a layout.
+    static bool GetInputSignature(const void* data, size_t size, const unsigned char** signature, unsigned int* signatureSize);
+
+private:
+    DxbcShaderType shaderType;
+    unsigned int majorVersion;
+    unsigned int minorVersion;
+    unsigned int threadGroupSize[3];
+
+    std::vector<DxbcResourceBinding> resourceBindings;
+    std::vector<DxbcConstantBuffer> constantBuffers;
+    std::vector<DxbcSignatureParameter> inputParameters;
+    std::vector<DxbcSignatureParameter> outputParameters;
+
+    void Clear();
+    bool ParseResourceDefinitions(const unsigned char* chunk, unsigned int size);
+    bool ParseType(const unsigned char* chunk, unsigned int size, unsigned int offset, unsigned int typeSize, unsigned int depth, DxbcType& type);
+    bool ParseSignature(const unsigned char* chunk, unsigned int size, unsigned int elementSize, bool hasStream, std::vector<DxbcSignatureParameter>& parameters);
+    bool ParseShaderCode(const unsigned char* chunk, unsigned int size);
+};
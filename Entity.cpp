@@ -4,9 +4,10 @@ using namespace DirectX;
 
 // Creates a new entity with the given mesh
 Entity::Entity(std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> material)
-	: mesh(_mesh), material(material)
+	: mesh(_mesh), material(material), instanceParamsVersion(0), lastGeometryVersion(0), unmovedFrames(0), meshVersion(0), staticGeometry(false)
 {
 	transform = Transform();
+	instanceParams = { XMFLOAT4(1, 1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0) };
 }
 
 Entity::~Entity()
@@ -19,6 +20,12 @@ Mesh* Entity::GetMesh()
     return mesh.get();
 }
 
+void Entity::SetMesh(std::shared_ptr<Mesh> _mesh)
+{
+	mesh = _mesh;
+	meshVersion++;
+}
+
 // Returns a pointer to this Entity's transform
 Transform* Entity::GetTransform()
 {
@@ -30,10 +37,93 @@ Material* Entity::GetMaterial()
 	return material.get();
 }
 
-// Draws this Entity using its mesh and transform
-void Entity::Draw(Camera& camera, Camera& lightCamera, float totalTime)
+void Entity::SetMaterial(std::shared_ptr<Material> _material)
+{
+	material = _material;
+}
+
+Material* Entity::GetMaterial(unsigned int submesh)
+{
+	if (submesh < submeshMaterials.size() && submeshMaterials[submesh])
+		return submeshMaterials[submesh].get();
+	return material.get();
+}
+
+std::shared_ptr<Material> Entity::GetSubmeshMaterial(unsigned int submesh)
+{
+	if (submesh < submeshMaterials.size() && submeshMaterials[submesh])
+		return submeshMaterials[submesh];
+	return material;
+}
+
+void Entity::SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> submeshMaterial)
+{
+	if (submesh >= submeshMaterials.size())
+		submeshMaterials.resize(submesh + 1);
+	submeshMaterials[submesh] = submeshMaterial;
+}
+
+// Returns this Entity's own tint and UV transform
+const InstanceParams& Entity::GetInstanceParams()
+{
+	return instanceParams;
+}
+
+void Entity::SetInstanceParams(const InstanceParams& params)
+{
+	instanceParams = params;
+	instanceParamsVersion++;
+}
+
+// Goes up whenever the transform, the instance parameters or the mesh change
+unsigned int Entity::GetVersion()
+{
+	return transform.GetVersion() + instanceParamsVersion + meshVersion;
+}
+
+// Goes up whenever the transform or the mesh change
+unsigned int Entity::GetGeometryVersion()
+{
+	return transform.GetVersion() + meshVersion;
+}
+
+// Returns this Entity's mesh bounds in world space
+DirectX::BoundingSphere Entity::GetWorldBounds()
+{
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+
+	BoundingSphere worldBounds;
+	mesh->GetBounds().Transform(worldBounds, XMLoadFloat4x4(&world));
+	return worldBounds;
+}
+
+// Checks whether the transform or mesh changed since the last call - call once per frame
+void Entity::UpdateMotion()
+{
+	unsigned int version = GetGeometryVersion();
+	if (version != lastGeometryVersion)
+	{
+		lastGeometryVersion = version;
+		unmovedFrames = 0;
+	}
+	else if (unmovedFrames < STATIC_ENTITY_FRAMES)
+	{
+		unmovedFrames++;
+	}
+}
+
+// True once the entity has gone STATIC_ENTITY_FRAMES without moving
+bool Entity::IsStatic()
 {
-	material->PrepareForDraw(camera, totalTime, transform, lightCamera);
+	return unmovedFrames >= STATIC_ENTITY_FRAMES;
+}
 
-	mesh->Draw();
+void Entity::SetStaticGeometry(bool isStatic)
+{
+	staticGeometry = isStatic;
+}
+
+bool Entity::IsStaticGeometry()
+{
+	return staticGeometry;
 }
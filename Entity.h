@@ -4,6 +4,11 @@
 #include "Camera.h"
 #include "Material.h"
 #include <memory>
+#include <vector>
+
+// Entities that haven't moved for this many frames are
+// drawn into the cached static shadow layer
+#define STATIC_ENTITY_FRAMES    30
 
 class Entity
 {
@@ -14,15 +19,49 @@ public:
 
     // Returns a pointer to this Entity's Mesh
     Mesh* GetMesh();
+    void SetMesh(std::shared_ptr<Mesh> _mesh);
     // Returns a pointer to this Entity's transform
     Transform* GetTransform();
     // Returns a pointer to this Entity's material
     Material* GetMaterial();
-    // Draws this Entity using its mesh and transform
-    void Draw(Camera& camera, Camera& lightCamera, float totalTime = 0.0f);
+    void SetMaterial(std::shared_ptr<Material> _material);
+    // Each of the mesh's submeshes can have a material of its own -
+    // the ones that don't use the entity's
+    Material* GetMaterial(unsigned int submesh);
+    std::shared_ptr<Material> GetSubmeshMaterial(unsigned int submesh);
+    void SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> submeshMaterial);
+    // Returns this Entity's own tint and UV transform, applied on top
+    // of its material's so entities can share one Material
+    const InstanceParams& GetInstanceParams();
+    void SetInstanceParams(const InstanceParams& params);
+    // Goes up whenever the transform, the instance parameters or the mesh change
+    unsigned int GetVersion();
+    // Goes up whenever the transform or the mesh change - everything
+    // that decides what the entity covers, and so what its shadow is
+    unsigned int GetGeometryVersion();
+    // Returns this Entity's mesh bounds in world space
+    DirectX::BoundingSphere GetWorldBounds();
+
+    // Checks whether the transform or mesh changed since the last call - call once per frame
+    void UpdateMotion();
+    // True once the entity has gone STATIC_ENTITY_FRAMES without moving
+    bool IsStatic();
+
+    // Static geometry never moves on its own, so it can be merged
+    // into world-space batches with everything else near it that
+    // looks the same (see StaticBatcher)
+    void SetStaticGeometry(bool isStatic);
+    bool IsStaticGeometry();
 private:
     Transform transform;
+    InstanceParams instanceParams;
+    unsigned int instanceParamsVersion;
+    unsigned int lastGeometryVersion;
+    unsigned int unmovedFrames;
+    unsigned int meshVersion;
+    bool staticGeometry;
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Material> material;
+    std::vector<std::shared_ptr<Material>> submeshMaterials;
 };
 
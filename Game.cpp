@@ -1,11 +1,17 @@
 #include "Game.h"
 #include "Vertex.h"
 #include "Input.h"
+#include "LitShaderVariants.h"
 #include <vector>
 #include <cmath>
 #include <WICTextureLoader.h>
 #include <DDSTextureLoader.h>
 #include <iostream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cfloat>
+#include <map>
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -53,6 +59,8 @@ Game::~Game()
     // - If we weren't using smart pointers, we'd need
     //   to call Release() on each DirectX object created in Game
 
+    if (stateObjects)
+        stateObjects->PrintStats();
 }
 
 // --------------------------------------------------------
@@ -64,15 +72,32 @@ void Game::Init()
     // Helper methods for loading shaders, creating some basic
     // geometry to draw and some simple camera matrices.
     //  - You'll be expanding and/or replacing these later
+    renderState = std::make_unique<RenderStateCache>(context);
+    ISimpleShader::StateCache = renderState.get();
+    stateObjects = std::make_unique<StateObjectCache>(device);
+    ISimpleShader::ObjectCache = stateObjects.get();
+    InitConstantBuffers();
+    instanceBuffer.Create(device);
+    shadowInstanceBuffer.Create(device);
     LoadShaders();
     InitShadowMap();
     CreateMaterials();
     CreateBasicGeometry();
+    geometryPool->PrintStats();
+    staticBatcher = std::make_unique<StaticBatcher>(geometryPool);
+
+    // After the depth prepass the main pass only has to match the depth
+    // that's already there, so each pixel is shaded once
+    D3D11_DEPTH_STENCIL_DESC equalDepthDesc = {};
+    equalDepthDesc.DepthEnable = true;
+    equalDepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    equalDepthDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+    depthEqualState = stateObjects->GetDepthStencilState(equalDepthDesc);
 
     // Tell the input assembler stage of the pipeline what kind of
     // geometric primitives (points, lines or triangles) we want to draw.  
     // Essentially: "What kind of shape should the GPU draw with our data?"
-    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    renderState->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     // Camera once we have aspect ratio available
     camera = std::shared_ptr<Camera>(
@@ -86,18 +111,106 @@ void Game::Init()
             (float)width / height));    // Aspect
 
     // Create sky
-    skybox = std::make_shared<Sky>(cube, skyboxSrv, pixelShaderSky, vertexShaderSky, samplerState, device);
+    skybox = std::make_shared<Sky>(cube, skyboxSrv, pixelShaderSky, vertexShaderSky, samplerState, *stateObjects);
 
     CreateSampleLights();
+    InitLightBuffers();
+}
+
+// --------------------------------------------------------
+// Creates the constant buffers shared by every shader and
+// binds them once - nothing else uses their registers
+// --------------------------------------------------------
+void Game::InitConstantBuffers()
+{
+    // Keep SimpleShader from making its own copies of these
+    ISimpleShader::ExternalBufferSlotStart = CB_SLOT_FIRST_SHARED;
+
+    perFrameBuffer.Create(device.Get());
+    perViewBuffer.Create(device.Get());
+    perObjectBuffer.Create(device.Get());
+
+    perFrameBuffer.Bind(*renderState, CB_SLOT_PER_FRAME);
+    perViewBuffer.Bind(*renderState, CB_SLOT_PER_VIEW);
+    perObjectBuffer.Bind(*renderState, CB_SLOT_PER_OBJECT);
+
+    // Room for a few frames of per-object data for every entity
+    // and shadow view - it discards and starts over if it runs out
+    objectConstantRing = std::make_unique<ConstantRing>(device, context, 2 * 1024 * 1024);
+    useConstantRing = objectConstantRing->IsSupported();
+}
+
+// --------------------------------------------------------
+// Uploads and binds the per-object constants for a draw
+// --------------------------------------------------------
+void Game::SetObjectData(const PerObjectData& objectData)
+{
+    if (useConstantRing)
+        objectConstantRing->Upload(*renderState, &objectData, sizeof(objectData), CB_SLOT_PER_OBJECT);
+    else
+        perObjectBuffer.Update(context.Get(), objectData);
+}
+
+void Game::InitLightBuffers()
+{
+    // The cluster table never changes size, the light and
+    // index buffers grow as needed in UploadLights()
+    CreateStructuredBuffer(
+        sizeof(ClusterRange),
+        CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z,
+        lightClusterBuffer,
+        lightClusterBufferSRV);
+
+    lightClusters.UpdateFrustum(camera->GetFoV(), camera->GetAspectRatio(), camera->GetNearClip(), camera->GetFarClip());
+}
+
+// --------------------------------------------------------
+// Creates a dynamic structured buffer and an SRV for it
+// --------------------------------------------------------
+void Game::CreateStructuredBuffer(
+    unsigned int stride,
+    unsigned int count,
+    Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth = stride * count;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = stride;
+    buffer.Reset();
+    device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = count;
+    srv.Reset();
+    device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Overwrites the contents of a dynamic buffer
+// --------------------------------------------------------
+void Game::UpdateDynamicBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, const void* data, size_t size)
+{
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    if (FAILED(context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        return;
+
+    memcpy(mapped.pData, data, size);
+    context->Unmap(buffer.Get(), 0);
 }
 
 void Game::InitShadowMap() 
 {
-    // Shadow map init
-    shadowMapResolution = 1024;
+    // Shadow atlas init
     D3D11_TEXTURE2D_DESC shadowTexDesc = {};
-    shadowTexDesc.Width = shadowMapResolution;
-    shadowTexDesc.Height = shadowMapResolution;
+    shadowTexDesc.Width = shadowAtlas.GetAtlasSize();
+    shadowTexDesc.Height = shadowAtlas.GetAtlasSize();
     shadowTexDesc.MipLevels = 1;
     shadowTexDesc.ArraySize = 1;
     shadowTexDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -129,6 +242,23 @@ void Game::InitShadowMap()
     srvDesc.Texture2D.MostDetailedMip = 0;
     device->CreateShaderResourceView(shadowMapTex.Get(), &srvDesc, shadowMapSRV.GetAddressOf());
 
+    // A second atlas with the same layout holds each view's static
+    // casters, which only get redrawn when they or the light change
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> staticShadowMapTex;
+    device->CreateTexture2D(&shadowTexDesc, 0, staticShadowMapTex.GetAddressOf());
+    device->CreateDepthStencilView(staticShadowMapTex.Get(), &depthStencDesc, staticShadowMapDSV.GetAddressOf());
+    device->CreateShaderResourceView(staticShadowMapTex.Get(), &srvDesc, staticShadowMapSRV.GetAddressOf());
+
+    // Clearing and compositing tiles overwrites whatever depth is there
+    D3D11_DEPTH_STENCIL_DESC tileDepthDesc = {};
+    tileDepthDesc.DepthEnable = true;
+    tileDepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+    tileDepthDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+    shadowTileDepthState = stateObjects->GetDepthStencilState(tileDepthDesc);
+
+    // Where each view lives in the atlas, for the pixel shader
+    CreateStructuredBuffer(sizeof(ShadowView), MAX_SHADOW_VIEWS, shadowViewBuffer, shadowViewBufferSRV);
+
     // Create the shadow sampler
     D3D11_SAMPLER_DESC shadowSampDesc = {};
     shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR; // COMPARISON filter!
@@ -140,7 +270,7 @@ void Game::InitShadowMap()
     shadowSampDesc.BorderColor[1] = 1.0f;
     shadowSampDesc.BorderColor[2] = 1.0f;
     shadowSampDesc.BorderColor[3] = 1.0f;
-    device->CreateSamplerState(&shadowSampDesc, shadowSampler.GetAddressOf());
+    shadowSampler = stateObjects->GetSamplerState(shadowSampDesc);
 
     // Create a rasterizer state
     D3D11_RASTERIZER_DESC shadowRastDesc = {};
@@ -150,22 +280,7 @@ void Game::InitShadowMap()
     shadowRastDesc.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
     shadowRastDesc.DepthBiasClamp = 0.0f;
     shadowRastDesc.SlopeScaledDepthBias = 1.0f;
-    device->CreateRasterizerState(&shadowRastDesc, shadowMapRasterizerState.GetAddressOf());
-
-    // Light camera init
-    shadowMapCamera = std::make_shared<Camera>(
-        0,                      // x
-        10,                     // y
-        -10,                    // z
-        0,                      // move speed
-        0,                      // look speed
-        0,                      // fov
-        1,                      // aspect ratio
-        false,                  // perspective bool
-        shadowMapDimension,     // orthographic viewport height
-        DirectX::XM_PIDIV4,     // pitch
-        0,                      // yaw
-        0);                     // roll
+    shadowMapRasterizerState = stateObjects->GetRasterizerState(shadowRastDesc);
 }
 
 void Game::CreateSampleLights()
@@ -208,12 +323,60 @@ void Game::CreateSampleLights()
             10,             // Range
             0.5f);          // Intensity
 
+    // Shadow casting spot lights over the models
+    Light spotLight1 =
+        Light(
+            { -1, 3, 3 },           // Position
+            { 0, -1, 0 },           // Direction
+            { 1, 0.8f, 0.6f },      // Color
+            10,                     // Range
+            2.0f,                   // Intensity
+            16.0f,                  // Spot falloff
+            1);                     // Shadow casting
+
+    Light spotLight2 =
+        Light(
+            { 3, 3, -3 },           // Position
+            { 0, -1, 0.25f },       // Direction
+            { 0.6f, 0.8f, 1 },      // Color
+            10,                     // Range
+            2.0f,                   // Intensity
+            16.0f,                  // Spot falloff
+            1);                     // Shadow casting
+
     // Push all the lights
     lights.push_back(directionalLight1);
     lights.push_back(directionalLight2);
     lights.push_back(directionalLight3);
     lights.push_back(pointLight1);
     lights.push_back(pointLight2);
+    lights.push_back(spotLight1);
+    lights.push_back(spotLight2);
+
+    // Remember where the hand-placed lights end so the
+    // stress test lights can be removed again
+    sampleLightCount = lights.size();
+}
+
+// Scatters a bunch of small, randomly colored point lights
+// around the floor to stress the clustered lighting
+void Game::CreateManyLights(int count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> height(-1.4f, 2.0f);
+    std::uniform_real_distribution<float> range(0.5f, 1.5f);
+    std::uniform_real_distribution<float> color(0.2f, 1.0f);
+
+    for (int i = 0; i < count; i++)
+    {
+        lights.push_back(
+            Light(
+                { position(rng), height(rng), position(rng) },  // Position
+                { color(rng), color(rng), color(rng) },         // Color
+                range(rng),                                     // Range
+                1.0f));                                         // Intensity
+    }
 }
 
 void Game::CreateMaterials()
@@ -226,7 +389,26 @@ void Game::CreateMaterials()
     samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
     samplerDesc.MaxAnisotropy = 16;
     samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-    device->CreateSamplerState(&samplerDesc, samplerState.GetAddressOf());
+    samplerState = stateObjects->GetSamplerState(samplerDesc);
+
+    // The lit shaders always sample an albedo map, so materials without
+    // one get plain white instead - just their color tint shows
+    unsigned int whitePixel = 0xFFFFFFFF;
+    D3D11_TEXTURE2D_DESC whiteDesc = {};
+    whiteDesc.Width = 1;
+    whiteDesc.Height = 1;
+    whiteDesc.MipLevels = 1;
+    whiteDesc.ArraySize = 1;
+    whiteDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    whiteDesc.SampleDesc.Count = 1;
+    whiteDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    whiteDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA whiteData = {};
+    whiteData.pSysMem = &whitePixel;
+    whiteData.SysMemPitch = sizeof(whitePixel);
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> whiteTexture;
+    device->CreateTexture2D(&whiteDesc, &whiteData, whiteTexture.GetAddressOf());
+    device->CreateShaderResourceView(whiteTexture.Get(), 0, defaultAlbedoSRV.GetAddressOf());
 
     // Skybox srv
     CreateDDSTextureFromFile(device.Get(), GetFullPathTo_Wide(L"../../Assets/Textures/Sky/skybox.dds").c_str(), nullptr, skyboxSrv.GetAddressOf());
@@ -248,27 +430,135 @@ void Game::CreateMaterials()
     XMFLOAT4 white = { 1, 1, 1, 1 };
     for (auto& t : textureFiles)
     {
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tempAlbedo;
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tempNormal;
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tempMetalness;
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tempRoughness;
-        CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/PBR_Textures/" + t + L"_albedo.png").c_str(), nullptr, tempAlbedo.GetAddressOf());
-        CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/PBR_Textures/" + t + L"_normals.png").c_str(), nullptr, tempNormal.GetAddressOf());
-        CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/PBR_Textures/" + t + L"_metal.png").c_str(), nullptr, tempMetalness.GetAddressOf());
-        CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(L"../../Assets/PBR_Textures/" + t + L"_roughness.png").c_str(), nullptr, tempRoughness.GetAddressOf());
+        std::wstring path = GetFullPathTo_Wide(L"../../Assets/PBR_Textures/" + t);
+        materials.insert({ t, CreateLitMaterial(white, path + L"_albedo.png", path + L"_normals.png", path + L"_metal.png", path + L"_roughness.png") });
+    }
 
-        std::shared_ptr<Material> material = std::make_shared<Material>(white, pixelShaderSpecNormalReflShadow, vertexShaderNormalMapShadowMap);
-        material->AddTextureSRV("Albedo", tempAlbedo);
-        material->AddTextureSRV("NormalMap", tempNormal);
-        material->AddTextureSRV("MetalnessMap", tempMetalness);
-        material->AddTextureSRV("RoughnessMap", tempRoughness);
-        material->AddTextureSRV("SkyTexture", skyboxSrv);
-        material->AddTextureSRV("ShadowMap", shadowMapSRV);
-        material->AddSampler("BasicSampler", samplerState);
-        material->AddSampler("ShadowSampler", shadowSampler);
+    SelectShaderVariants(litLightBucket);
+}
 
-        materials.insert({ t, material });
+// --------------------------------------------------------
+// Makes a material for the lit shaders from its texture files
+// (full paths). Textures that are missing or aren't given are
+// left out, along with the shader features that need them -
+// except the albedo map, which falls back to plain white.
+// --------------------------------------------------------
+std::shared_ptr<Material> Game::CreateLitMaterial(
+    XMFLOAT4 colorTint,
+    const std::wstring& albedoFile,
+    const std::wstring& normalFile,
+    const std::wstring& metalnessFile,
+    const std::wstring& roughnessFile)
+{
+    auto loadTexture = [&](const std::wstring& file)
+    {
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+        if (!file.empty())
+            CreateWICTextureFromFile(device.Get(), context.Get(), file.c_str(), nullptr, srv.GetAddressOf());
+        return srv;
+    };
+
+    // Starts on the everything variant - SelectShaderVariants()
+    // narrows it down once the textures are known
+    std::shared_ptr<Material> material = std::make_shared<Material>(device, colorTint, litPixelShaders.back(), litVertexShaders[0]);
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> albedo = loadTexture(albedoFile);
+    material->AddTextureSRV("Albedo", albedo ? albedo : defaultAlbedoSRV);
+    material->AddTextureSRV("NormalMap", loadTexture(normalFile));
+    material->AddTextureSRV("MetalnessMap", loadTexture(metalnessFile));
+    material->AddTextureSRV("RoughnessMap", loadTexture(roughnessFile));
+    material->AddTextureSRV("SkyTexture", skyboxSrv);
+    material->AddTextureSRV("ShadowMap", shadowMapSRV);
+    material->AddSampler("BasicSampler", samplerState);
+    material->AddSampler("ShadowSampler", shadowSampler);
+    return material;
+}
+
+// --------------------------------------------------------
+// Gives each submesh of an entity's mesh the material its
+// OBJ group named, from the OBJ's material library. Groups
+// the library doesn't have (or OBJs without a library) keep
+// the entity's own material.
+// --------------------------------------------------------
+void Game::AssignLibraryMaterials(Entity& e)
+{
+    Mesh* mesh = e.GetMesh();
+    const std::string& libraryFile = mesh->GetMaterialLibrary();
+    if (libraryFile.empty())
+        return;
+
+    // Each library is only read once
+    auto library = materialLibraries.find(libraryFile);
+    if (library == materialLibraries.end())
+    {
+        library = materialLibraries.insert({ libraryFile, MaterialLibrary() }).first;
+        if (!library->second.Load(libraryFile))
+            printf("Material library %s not found, using the entity's material\n", libraryFile.c_str());
     }
+
+    bool created = false;
+    for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+    {
+        const MaterialLibraryEntry* entry = library->second.Find(mesh->GetSubmesh(i).MaterialName);
+        if (!entry)
+            continue;
+
+        // Shared by every entity using the same library material
+        std::string name = libraryFile + ":" + entry->Name;
+        std::wstring key(name.begin(), name.end());
+        auto material = materials.find(key);
+        if (material == materials.end())
+        {
+            auto widen = [](const std::string& s) { return std::wstring(s.begin(), s.end()); };
+            material = materials.insert({ key, CreateLitMaterial(
+                entry->DiffuseColor,
+                widen(entry->AlbedoMap),
+                widen(entry->NormalMap),
+                widen(entry->MetalnessMap),
+                widen(entry->RoughnessMap)) }).first;
+            created = true;
+        }
+
+        e.SetSubmeshMaterial(i, material->second);
+    }
+
+    // New materials need their shader variants picked
+    if (created)
+        SelectShaderVariants(litLightBucket);
+}
+
+// --------------------------------------------------------
+// Points every material at the tightest lit shader variants
+// for its features and the given number of directional lights
+// --------------------------------------------------------
+void Game::SelectShaderVariants(ShaderLightBucket lights)
+{
+    std::map<std::string, unsigned int> variantUse;
+    for (auto& m : materials)
+    {
+        Material* material = m.second.get();
+        unsigned int features = material->GetShaderFeatures();
+
+        int ps = litPixelVariants.Select(MakeShaderVariantKey(features, lights));
+        int vs = litVertexVariants.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_NONE));
+        int vsInstanced = litVertexVariants.Select(MakeShaderVariantKey(SHADER_FEATURE_INSTANCING, SHADER_LIGHTS_NONE));
+        if (ps < 0 || vs < 0 || vsInstanced < 0)
+            continue;
+
+        // Changing the pixel shader re-resolves the material's texture handles
+        if (material->GetPixelShader() != litPixelShaders[ps].get())
+            material->SetPixelShader(litPixelShaders[ps]);
+        material->SetVertexShader(litVertexShaders[vs]);
+        material->SetInstancedVertexShader(litVertexShaders[vsInstanced]);
+
+        variantUse[GetShaderVariantName("LitPS", litPixelVariants.GetKey(ps))]++;
+    }
+
+    litLightBucket = lights;
+
+    printf("Shader variants for light bucket %d:", (int)lights);
+    for (auto& use : variantUse)
+        printf("  %s x %u", use.first.c_str(), use.second);
+    printf("\n");
 }
 
 // --------------------------------------------------------
@@ -281,20 +571,47 @@ void Game::CreateMaterials()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
+    // Timed so startup with and without the reflection cache
+    // (the first run writes it) can be compared
+    auto start = std::chrono::high_resolution_clock::now();
+    unsigned int cacheHits = ISimpleShader::ReflectionCacheHits;
+    unsigned int cacheMisses = ISimpleShader::ReflectionCacheMisses;
+
     // Vertex shaders
     vertexShader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShader.cso").c_str());
-    vertexShaderNormalMap = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderNormalMap.cso").c_str());
-    vertexShaderNormalMapShadowMap = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderNormalMapShadow.cso").c_str());
     vertexShaderSky = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderSky.cso").c_str());
     shadowVS = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"ShadowMapVS.cso").c_str());
+    shadowInstancedVS = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"ShadowMapVSInstanced.cso").c_str());
+    shadowTileVS = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"ShadowTileVS.cso").c_str());
 
     // Pixel shaders
     pixelShaderSky = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSky.cso").c_str());
-    pixelShaderSpec = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSpecOnly.cso").c_str());
-    pixelShaderSpecAndNormal = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSpecAndNormal.cso").c_str());
-    pixelShaderSpecNormalRefl = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSpecNormalRefl.cso").c_str());
-    pixelShaderSpecNormalReflShadow = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSpecNormalReflShadow.cso").c_str());
     customPixelShader = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"CustomPS.cso").c_str());
+    shadowCopyPS = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"ShadowCopyPS.cso").c_str());
+
+    // Lit shader variants, each compiled from a LitPS_[X].hlsl or
+    // LitVS_[X].hlsl file named after its key
+    for (ShaderVariantKey key : litPixelShaderKeys)
+    {
+        std::string name = GetShaderVariantName("LitPS", key) + ".cso";
+        litPixelShaders.push_back(std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(std::wstring(name.begin(), name.end())).c_str()));
+        litPixelVariants.Add(key);
+    }
+    for (ShaderVariantKey key : litVertexShaderKeys)
+    {
+        std::string name = GetShaderVariantName("LitVS", key) + ".cso";
+        litVertexShaders.push_back(std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(std::wstring(name.begin(), name.end())).c_str()));
+        litVertexVariants.Add(key);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    cacheHits = ISimpleShader::ReflectionCacheHits - cacheHits;
+    cacheMisses = ISimpleShader::ReflectionCacheMisses - cacheMisses;
+    printf("Shaders: %u loaded in %.2fms (reflection: %u from cache, %u parsed)\n",
+        cacheHits + cacheMisses,
+        std::chrono::duration<double, std::milli>(end - start).count(),
+        cacheHits,
+        cacheMisses);
 }
 
 
@@ -304,6 +621,10 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
+    // Every mesh shares one vertex and one index buffer, which grow
+    // if the models don't fit
+    geometryPool = std::make_shared<GeometryPool>(device, context, (unsigned int)sizeof(Vertex), 1 << 18, 1 << 18, true);
+
     // Create some temporary variables to represent colors
     // - Not necessary, just makes things more readable
     XMFLOAT4 red = XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
@@ -351,8 +672,8 @@ void Game::CreateBasicGeometry()
     // Set up the tris for a pentagon
     unsigned int indicesPent[] = { 0, 5, 1, 1, 5, 2, 5, 3, 2, 5, 4, 3, 0, 4, 5 };
 
-    tri = std::make_shared<Mesh>(verticesTri, 3, indicesTri, 3, device, context);
-    pent = std::make_shared<Mesh>(verticesPent, 6, indicesPent, 15, device, context);
+    tri = std::make_shared<Mesh>(verticesTri, 3, indicesTri, 3, geometryPool);
+    pent = std::make_shared<Mesh>(verticesPent, 6, indicesPent, 15, geometryPool);
 
     // Create a circle and assign it to the circle field
     GenerateCircle(
@@ -361,19 +682,19 @@ void Game::CreateBasicGeometry()
         white,          // color
         0);             // x offset
 
-    cube = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> cylinder = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> helix = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> quad = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> floor = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> quad_double_sided = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad_double_sided.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> torus = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/torus.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> crate = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/crate2.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> retrotv = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/retrotv.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> r2d2 = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/r2d2.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> guitar = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/guitar.obj").c_str(), device, context);
-    std::shared_ptr<Mesh> retrotable = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/retrotable.obj").c_str(), device, context);
+    cube = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> cylinder = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> helix = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> quad = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> floor = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> quad_double_sided = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad_double_sided.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> torus = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/torus.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> crate = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/crate2.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> retrotv = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/retrotv.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> r2d2 = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/r2d2.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> guitar = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/guitar.obj").c_str(), geometryPool);
+    std::shared_ptr<Mesh> retrotable = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/retrotable.obj").c_str(), geometryPool);
 
     // Assign geometry and materials to some entities
     //
@@ -400,6 +721,10 @@ void Game::CreateBasicGeometry()
     entities[entities.size() - 1].GetTransform()->SetPosition(2.7f, -1.5f, -2.7f);
     entities.push_back(Entity(floor, materials[L"wood"])); 
 
+    // Props made of several OBJ groups get a material per group
+    for (Entity& e : entities)
+        AssignLibraryMaterials(e);
+
     entitiesAllSpheres.push_back(Entity(sphere, materials[L"bronze"]));
     entitiesAllSpheres.push_back(Entity(sphere, materials[L"cobblestone"]));
     entitiesAllSpheres.push_back(Entity(sphere, materials[L"floor"]));
@@ -415,13 +740,148 @@ void Game::CreateBasicGeometry()
         entitiesAllSpheres[i].GetTransform()->SetPosition(((float)(i - 3) * 3), 0, 0);
     }
 
-    // Scale the floor so it's nice and big to catch shadows
+    // Scale the floor so it's nice and big to catch shadows, tiling its
+    // texture on the floor alone rather than on its shared material
+    InstanceParams floorParams = entities[entities.size() - 1].GetInstanceParams();
+    floorParams.uvScale = XMFLOAT2(5, 5);
     entities[entities.size() - 1].GetTransform()->SetScale(10, 1, 10);
     entities[entities.size() - 1].GetTransform()->SetPosition(0, -1.5f, 0);
-    entities[entities.size() - 1].GetMaterial()->SetUvScale(5, 5);
+    entities[entities.size() - 1].SetInstanceParams(floorParams);
     entitiesAllSpheres[entitiesAllSpheres.size() - 1].GetTransform()->SetScale(10, 1, 10);
     entitiesAllSpheres[entitiesAllSpheres.size() - 1].GetTransform()->SetPosition(0, -1.5f, 0);
-    entitiesAllSpheres[entitiesAllSpheres.size() - 1].GetMaterial()->SetUvScale(5, 5);
+    entitiesAllSpheres[entitiesAllSpheres.size() - 1].SetInstanceParams(floorParams);
+
+    // The floors never move, so they're batched with any other static geometry
+    entities[entities.size() - 1].SetStaticGeometry(true);
+    entitiesAllSpheres[entitiesAllSpheres.size() - 1].SetStaticGeometry(true);
+}
+
+// --------------------------------------------------------
+// Fills a square grid with spheres, cycling through the
+// sphere materials, to stress instancing
+// --------------------------------------------------------
+void Game::CreateManySpheres(unsigned int count)
+{
+    unsigned int side = (unsigned int)std::ceil(std::sqrt((float)count));
+    float spacing = 1.5f;
+
+    entitiesManySpheres.reserve(count + 1);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        // Copies of the spheres scene's spheres, so same mesh and materials
+        entitiesManySpheres.push_back(entitiesAllSpheres[i % (entitiesAllSpheres.size() - 1)]);
+
+        Transform* transform = entitiesManySpheres.back().GetTransform();
+        transform->SetScale(0.5f, 0.5f, 0.5f);
+        transform->SetPosition(
+            ((float)(i % side) - side / 2.0f) * spacing,
+            -1.0f,
+            ((float)(i / side) - side / 2.0f) * spacing);
+
+        // A tint that varies across the grid, which doesn't stop
+        // spheres with the same material being drawn together
+        InstanceParams params = entitiesManySpheres.back().GetInstanceParams();
+        params.colorTint = XMFLOAT4(
+            0.5f + 0.5f * (float)(i % side) / side,
+            0.75f,
+            0.5f + 0.5f * (float)(i / side) / side,
+            1.0f);
+        entitiesManySpheres.back().SetInstanceParams(params);
+    }
+
+    // A floor big enough for all of them goes last, like the other scenes
+    // (keeping the same texture density as the regular one)
+    entitiesManySpheres.push_back(entitiesAllSpheres.back());
+    entitiesManySpheres.back().GetTransform()->SetScale(side * spacing / 2, 1, side * spacing / 2);
+    entitiesManySpheres.back().GetTransform()->SetPosition(0, -1.5f, 0);
+
+    InstanceParams floorParams = entitiesManySpheres.back().GetInstanceParams();
+    floorParams.uvScale = XMFLOAT2(side * spacing / 4, side * spacing / 4);
+    entitiesManySpheres.back().SetInstanceParams(floorParams);
+}
+
+// --------------------------------------------------------
+// Scatters copies of the other scenes' props over a square
+// grid, all of them static geometry, to show off batching
+// --------------------------------------------------------
+void Game::CreateManyProps(unsigned int count)
+{
+    unsigned int side = (unsigned int)std::ceil(std::sqrt((float)count));
+    float spacing = 3.0f;
+
+    // Everything but the floors, keeping their own scales and heights
+    std::vector<Entity*> props;
+    for (size_t i = 0; i < entities.size() - 1; i++)
+        props.push_back(&entities[i]);
+    for (size_t i = 0; i < entitiesAllSpheres.size() - 1; i++)
+        props.push_back(&entitiesAllSpheres[i]);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> angle(0, XM_2PI);
+
+    entitiesManyProps.reserve(count + 1);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        entitiesManyProps.push_back(*props[i % props.size()]);
+
+        Transform* transform = entitiesManyProps.back().GetTransform();
+        transform->SetPosition(
+            ((float)(i % side) - side / 2.0f) * spacing,
+            transform->GetPosition().y,
+            ((float)(i / side) - side / 2.0f) * spacing);
+        transform->Rotate(0, angle(random), 0);
+
+        entitiesManyProps.back().SetStaticGeometry(true);
+    }
+
+    // A floor to match, last like the other scenes (already static)
+    entitiesManyProps.push_back(entitiesAllSpheres.back());
+    entitiesManyProps.back().GetTransform()->SetScale(side * spacing / 2, 1, side * spacing / 2);
+    entitiesManyProps.back().GetTransform()->SetPosition(0, -1.5f, 0);
+
+    InstanceParams floorParams = entitiesManyProps.back().GetInstanceParams();
+    floorParams.uvScale = XMFLOAT2(side * spacing / 4, side * spacing / 4);
+    entitiesManyProps.back().SetInstanceParams(floorParams);
+}
+
+std::vector<Entity>& Game::GetActiveEntities()
+{
+    if (manyProps)
+        return entitiesManyProps;
+
+    if (manySpheres)
+        return entitiesManySpheres;
+
+    return spheresOnly ? entitiesAllSpheres : entities;
+}
+
+// --------------------------------------------------------
+// Fills drawEntities with what the frame draws: the scene's
+// static geometry as batches, if batching is on, plus all of
+// its other entities
+// --------------------------------------------------------
+void Game::GatherDrawEntities(std::vector<Entity>& entityList)
+{
+    drawEntities.clear();
+    if (!useStaticBatching)
+    {
+        for (Entity& e : entityList)
+            drawEntities.push_back(&e);
+        return;
+    }
+
+    // Only one scene is batched at a time - switching scenes
+    // batches the new one from scratch
+    if (staticBatcher->GetSourceList() != &entityList)
+        staticBatcher->Build(entityList);
+    staticBatcher->Update();
+
+    for (Entity& e : entityList)
+    {
+        if (!e.IsStaticGeometry())
+            drawEntities.push_back(&e);
+    }
+    staticBatcher->GetBatchEntities(drawEntities);
 }
 
 // --------------------------------------------------------
@@ -433,12 +893,17 @@ void Game::OnResize()
     // Handle base-level DX resize stuff
     DXCore::OnResize();
 
+    // That set the render target and viewport behind the state cache's back
+    if (renderState)
+        renderState->Invalidate();
+
     // Ensure we update the camera whenever the window resizes
     // Note: this could trigger before Init(), so ensure our ptr
     // is valid before calling UpdateProjectionMatrix()
     if (camera)
     {
         camera->UpdateProjectionMatrix((float)width / height);
+        lightClusters.UpdateFrustum(camera->GetFoV(), camera->GetAspectRatio(), camera->GetNearClip(), camera->GetFarClip());
     }
 }
 
@@ -451,20 +916,12 @@ void Game::Update(float deltaTime, float totalTime)
     if (Input::GetInstance().KeyDown(VK_ESCAPE))
         Quit();
 
-    // Move/scale/rotate entities every frame=
-    if (spheresOnly)
+    // Move/scale/rotate entities every frame - static geometry stays put
+    std::vector<Entity>& entityList = GetActiveEntities();
+    for (Entity& e : entityList)
     {
-        for (int i = 0; i < entitiesAllSpheres.size() - 1; i++)
-        {
-            UpdateEntity(entitiesAllSpheres[i], deltaTime, totalTime);
-        }
-    }
-    else
-    {
-        for (int i = 0; i < entities.size() - 1; i++)
-        {
-            UpdateEntity(entities[i], deltaTime, totalTime);
-        }
+        if (!e.IsStaticGeometry())
+            UpdateEntity(e, deltaTime, totalTime);
     }
 
     // Update the camera every frame
@@ -472,29 +929,276 @@ void Game::Update(float deltaTime, float totalTime)
 
     // Play with field of view
     float fov = camera->GetFoV();
-    bool shadowMapDimensionChanged = false;
     if (Input::GetInstance().KeyDown('O')) fov += 1.0f * deltaTime;
     if (Input::GetInstance().KeyDown('P')) fov -= 1.0f * deltaTime;
     if (Input::GetInstance().KeyPress('M')) moveEntities = !moveEntities;
     if (Input::GetInstance().KeyPress('U')) offsetUvs = !offsetUvs;
     if (Input::GetInstance().KeyPress('L')) spheresOnly = !spheresOnly;
-    if (Input::GetInstance().KeyDown('J')) 
+    if (Input::GetInstance().KeyPress('I')) useInstancing = !useInstancing;
+    if (Input::GetInstance().KeyPress('G'))
     {
-        shadowMapDimension -= 2 * deltaTime;
-        shadowMapDimensionChanged = true;
+        manySpheres = !manySpheres;
+        if (manySpheres && entitiesManySpheres.empty()) CreateManySpheres(100000);
     }
-    if (Input::GetInstance().KeyDown('K'))
+    if (Input::GetInstance().KeyPress('H'))
     {
-        shadowMapDimension += 2 * deltaTime;
-        shadowMapDimensionChanged = true;
+        manyProps = !manyProps;
+        if (manyProps && entitiesManyProps.empty()) CreateManyProps(400);
     }
-    if (shadowMapDimensionChanged)
+    if (Input::GetInstance().KeyPress('C')) useStaticBatching = !useStaticBatching;
+    if (Input::GetInstance().KeyPress('Z')) useDepthPrepass = !useDepthPrepass;
+    if (Input::GetInstance().KeyPress('X')) sortDepthPrepass = !sortDepthPrepass;
+    if (Input::GetInstance().KeyPress('N'))
     {
-        shadowMapCamera->SetOrthoSize(shadowMapDimension);
-        shadowMapCamera->UpdateProjectionMatrix(1);
+        manyLights = !manyLights;
+        lights.resize(sampleLightCount, lights[0]);
+        if (manyLights) CreateManyLights(1000);
+    }
+    if (Input::GetInstance().KeyPress('J')) shadowCascades.SetCascadeCount(shadowCascades.GetCascadeCount() - 1);
+    if (Input::GetInstance().KeyPress('K')) shadowCascades.SetCascadeCount(shadowCascades.GetCascadeCount() + 1);
+    if (Input::GetInstance().KeyPress('B')) RunShaderSetterBenchmark();
+    if (Input::GetInstance().KeyPress('R')) useConstantRing = !useConstantRing && objectConstantRing->IsSupported();
+    if (Input::GetInstance().KeyPress('F')) renderState->GetTracker().SetFilteringEnabled(!renderState->GetTracker().IsFilteringEnabled());
+    if (Input::GetInstance().KeyPress('T'))
+    {
+        // Cycle the shadow budget: none -> draw calls -> milliseconds
+        switch (shadowScheduler.GetBudgetMode())
+        {
+        case SHADOW_BUDGET_NONE: shadowScheduler.SetBudget(SHADOW_BUDGET_DRAW_CALLS, (float)shadowBudgetDrawCalls); break;
+        case SHADOW_BUDGET_DRAW_CALLS: shadowScheduler.SetBudget(SHADOW_BUDGET_MILLISECONDS, shadowBudgetMs); break;
+        default: shadowScheduler.SetBudget(SHADOW_BUDGET_NONE, 0); break;
+        }
     }
 
-    camera->SetFoV(fov);
+    if (fov != camera->GetFoV())
+    {
+        camera->SetFoV(fov);
+        lightClusters.UpdateFrustum(camera->GetFoV(), camera->GetAspectRatio(), camera->GetNearClip(), camera->GetFarClip());
+    }
+
+    ReportFrameStats(totalTime);
+}
+
+// --------------------------------------------------------
+// Prints per-frame averages to the console once per second
+// --------------------------------------------------------
+void Game::ReportFrameStats(float totalTime)
+{
+    statsFrameCount++;
+    if (totalTime - lastStatsTime < 1.0f)
+        return;
+
+    printf("Light binning: %.3fms (%zu lights, %zu indices)\n",
+        lightBinningMs / statsFrameCount,
+        lights.size(),
+        lightClusters.GetLightIndices().size());
+
+    printf("Shadow atlas: %zu views, %.1f casters drawn, %u tiles repacked\n",
+        shadowPasses.size(),
+        (double)shadowCasterDraws / statsFrameCount,
+        shadowTileRepacks);
+
+    printf("Shadow cache: %u views skipped, %u static layers reused, %u full redraws\n",
+        shadowViewsSkipped,
+        shadowStaticLayersReused,
+        shadowFullRedraws);
+
+    // How often each view was redrawn, to help tune the budget
+    const char* budgetNames[] = { "none", "draw calls", "ms" };
+    printf("Shadow updates (budget: %s %g, %u deferred):",
+        budgetNames[shadowScheduler.GetBudgetMode()],
+        shadowScheduler.GetBudgetLimit(),
+        shadowScheduler.GetDeferredCount());
+
+    std::vector<std::pair<unsigned int, unsigned int>> updateCounts(
+        shadowScheduler.GetUpdateCounts().begin(),
+        shadowScheduler.GetUpdateCounts().end());
+    std::sort(updateCounts.begin(), updateCounts.end());
+    for (auto& count : updateCounts)
+    {
+        unsigned int lightIndex = count.first / MAX_SHADOW_CASCADES;
+        if (lightIndex < lights.size() && lights[lightIndex].Type == LIGHT_TYPE_DIRECTIONAL)
+            printf("  light %u cascade %u: %u", lightIndex, count.first % MAX_SHADOW_CASCADES, count.second);
+        else
+            printf("  light %u: %u", lightIndex, count.second);
+    }
+    printf("\n");
+
+    // Constant buffer bytes that went to the GPU versus bytes left alone
+    // because they hadn't changed since the last upload
+    printf("Constant buffers: %.1fKB uploaded, %.1fKB skipped per frame\n",
+        ISimpleShader::BytesUploaded / 1024.0 / statsFrameCount,
+        ISimpleShader::BytesSkipped / 1024.0 / statsFrameCount);
+    ISimpleShader::BytesUploaded = 0;
+    ISimpleShader::BytesSkipped = 0;
+
+    printf("Object constants: %s, %.1fKB per frame, %u ring discards, %.1fKB of ring in use\n",
+        useConstantRing ? "ring buffer" : "UpdateSubresource",
+        objectConstantRing->GetBytesUploaded() / 1024.0 / statsFrameCount,
+        objectConstantRing->GetDiscardCount(),
+        objectConstantRing->GetUsedBytes() / 1024.0);
+    objectConstantRing->ResetStats();
+
+    printf("Render queue switches per frame, unsorted -> sorted: shaders %.1f -> %.1f, materials (SRVs) %.1f -> %.1f, meshes (VBs) %.1f -> %.1f\n",
+        (double)unsortedSwitches.Programs / statsFrameCount, (double)sortedSwitches.Programs / statsFrameCount,
+        (double)unsortedSwitches.Materials / statsFrameCount, (double)sortedSwitches.Materials / statsFrameCount,
+        (double)unsortedSwitches.Meshes / statsFrameCount, (double)sortedSwitches.Meshes / statsFrameCount);
+    unsortedSwitches = {};
+    sortedSwitches = {};
+
+    printf("Instancing %s: %.1f instanced draws covering %.0f instances, %.0f instances uploaded (%.0f for shadows) per frame\n",
+        useInstancing ? "on" : "off",
+        (double)instancedDraws / statsFrameCount,
+        (double)instancesDrawn / statsFrameCount,
+        (double)instanceBuffer.GetUploadedCount() / statsFrameCount,
+        (double)shadowInstanceBuffer.GetUploadedCount() / statsFrameCount);
+    instancedDraws = 0;
+    instancesDrawn = 0;
+    instanceBuffer.ResetStats();
+    shadowInstanceBuffer.ResetStats();
+
+    printf("Static batching %s: %u static entities in %u batches, %u batches rebuilt, %.1f main pass draw calls per frame\n",
+        useStaticBatching ? "on" : "off",
+        staticBatcher->GetSourceCount(),
+        staticBatcher->GetBatchCount(),
+        staticBatcher->GetRebuildCount(),
+        (double)mainPassDraws / statsFrameCount);
+    staticBatcher->ResetStats();
+    mainPassDraws = 0;
+
+    printf("Depth prepass %s: %.1f draws per frame, front-to-back sort %s (%.3fms)\n",
+        useDepthPrepass ? "on" : "off",
+        (double)prepassDraws / statsFrameCount,
+        sortDepthPrepass ? "on" : "off",
+        prepassSortMs / statsFrameCount);
+    prepassDraws = 0;
+    prepassSortMs = 0;
+
+    printf("Object matrices: %.0f per frame in %.3fms\n",
+        (double)objectMatrices.GetProcessedCount() / statsFrameCount,
+        objectMatrixMs / statsFrameCount);
+    objectMatrices.ResetStats();
+    objectMatrixMs = 0;
+
+    RenderStateTracker& tracker = renderState->GetTracker();
+    printf("State calls: %.0f issued, %.0f filtered per frame (filtering %s)\n",
+        (double)tracker.GetIssuedCount() / statsFrameCount,
+        (double)tracker.GetFilteredCount() / statsFrameCount,
+        tracker.IsFilteringEnabled() ? "on" : "off");
+    tracker.ResetStats();
+
+    shadowScheduler.ResetStats();
+    shadowCasterDraws = 0;
+    shadowTileRepacks = 0;
+    shadowViewsSkipped = 0;
+    shadowStaticLayersReused = 0;
+    shadowFullRedraws = 0;
+
+    lightBinningMs = 0;
+    statsFrameCount = 0;
+    lastStatsTime = totalTime;
+}
+
+// --------------------------------------------------------
+// Times 1M matrix sets through each way of naming a shader
+// variable, then material texture binding with and without
+// binding tables, and prints the results to the console
+// --------------------------------------------------------
+void Game::RunShaderSetterBenchmark()
+{
+    const int iterations = 1000000;
+    SimpleVertexShader* vs = vertexShader.get();
+    XMFLOAT4X4 matrix;
+    XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+
+    // Time a single way of setting the matrix
+    auto time = [&](const char* label, auto setMatrix)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            matrix._44 = (float)i;
+            setMatrix();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("  %-36s %8.2fms (%.1fns per call)\n", label, ms, ms * 1000000.0 / iterations);
+    };
+
+    printf("SetMatrix4x4 x %d:\n", iterations);
+
+    // What every call used to cost: a std::string built from the name
+    // (long enough to allocate) and an unordered_map lookup
+    const SimpleShaderVariable* var = vs->GetVariableInfo(SHADER_NAME("worldInvTranspose"));
+    if (!var)
+        return;
+
+    std::unordered_map<std::string, SimpleShaderVariable> oldTable;
+    oldTable["worldInvTranspose"] = *var;
+    std::vector<unsigned char> oldBuffer(vs->GetBufferSize(var->ConstantBufferIndex));
+    time("std::string + unordered_map (old)", [&]()
+    {
+        std::string name("worldInvTranspose");
+        auto it = oldTable.find(name);
+        if (it != oldTable.end())
+            memcpy(&oldBuffer[it->second.ByteOffset], &matrix, sizeof(matrix));
+    });
+
+    std::string name("worldInvTranspose");
+    time("std::string + sorted table", [&]() { vs->SetMatrix4x4(name, matrix); });
+    time("literal, hashed per call", [&]() { vs->SetMatrix4x4("worldInvTranspose", matrix); });
+    time("SHADER_NAME literal + sorted table", [&]() { vs->SetMatrix4x4(SHADER_NAME("worldInvTranspose"), matrix); });
+
+    SimpleShaderVariableHandle handle = vs->GetVariableHandle(SHADER_NAME("worldInvTranspose"));
+    time("handle", [&]() { vs->SetMatrix4x4(handle, matrix); });
+
+    // Filling the whole buffer - a handle per variable, or one copy
+    // of a struct generated from the shader
+    SimpleShaderVariableHandle worldHandle = vs->GetVariableHandle(SHADER_NAME("world"));
+    SimpleShaderVariableHandle viewHandle = vs->GetVariableHandle(SHADER_NAME("view"));
+    SimpleShaderVariableHandle projectionHandle = vs->GetVariableHandle(SHADER_NAME("projection"));
+    time("handles, whole buffer", [&]()
+    {
+        vs->SetMatrix4x4(worldHandle, matrix);
+        vs->SetMatrix4x4(handle, matrix);
+        vs->SetMatrix4x4(viewHandle, matrix);
+        vs->SetMatrix4x4(projectionHandle, matrix);
+    });
+
+    VertexShaderExternalData externalData = {};
+    time("SetBufferStruct, whole buffer", [&]()
+    {
+        externalData.world = matrix;
+        externalData.worldInvTranspose = matrix;
+        externalData.view = matrix;
+        externalData.projection = matrix;
+        vs->SetBufferStruct(externalData);
+    });
+
+    // Alternating between two materials, so every bind has real work
+    // to do for the textures the two don't share
+    if (materials.size() < 2)
+        return;
+
+    Material* materialPair[2] = { materials.begin()->second.get(), std::next(materials.begin())->second.get() };
+    const int bindIterations = iterations / 10;
+    auto timeBinds = [&](const char* label, auto bind)
+    {
+        unsigned int issuedBefore = renderState->GetTracker().GetIssuedCount();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < bindIterations; i++)
+            bind(materialPair[i & 1]);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("  %-36s %8.2fms (%.1fns per bind, %.1f calls)\n", label, ms, ms * 1000000.0 / bindIterations,
+            (double)(renderState->GetTracker().GetIssuedCount() - issuedBefore) / bindIterations);
+    };
+
+    printf("Material texture binds x %d:\n", bindIterations);
+    timeBinds("one call per texture and sampler", [&](Material* m) { m->BindTexturesPerSlot(*renderState); });
+    timeBinds("binding tables", [&](Material* m) { m->BindTextures(*renderState); });
 }
 
 void Game::UpdateEntity(Entity& e, float deltaTime, float totalTime)
@@ -510,8 +1214,11 @@ void Game::UpdateEntity(Entity& e, float deltaTime, float totalTime)
 
     if (offsetUvs)
     {
-        auto offset = e.GetMaterial()->GetUvOffset();
-        e.GetMaterial()->SetUvOffset(offset.x + deltaTime / 10, 0);
+        // The entity's own offset - materials are shared, so scrolling
+        // those would go faster the more entities use them
+        InstanceParams params = e.GetInstanceParams();
+        params.uvOffset.x += deltaTime / 10;
+        e.SetInstanceParams(params);
     }
 }
 
@@ -536,26 +1243,61 @@ void Game::Draw(float deltaTime, float totalTime)
     // Sun in skybox is yellow-red
     XMFLOAT3 ambientColor = XMFLOAT3(.15f, .125f, .075f);
 
-    // Draw entities
-    auto entityList = spheresOnly ? entitiesAllSpheres : entities;
+    // Reclaim ring space from frames the GPU is done with, or put
+    // the regular per-object buffer back if the ring isn't in use
+    objectConstantRing->BeginFrame();
+    if (!useConstantRing)
+        perObjectBuffer.Bind(*renderState, CB_SLOT_PER_OBJECT);
 
-    // Render the shadow map before the other objects
-    RenderShadowMap(entityList);
-    for (auto& e : entityList)
-    {
-        auto pixelShader = e.GetMaterial()->GetPixelShader();
-        pixelShader->SetFloat3("ambient", ambientColor);
-        // Set lights
-        pixelShader->SetData(
-            "lights",                               // Name of the variable in the shader 
-            &lights[0],                             // Address of the data to set the shader variable to
-            sizeof(Light) * (int)lights.size());    // The size of the data to set
+    // Draw entities, with static geometry merged into batches
+    GatherDrawEntities(GetActiveEntities());
 
-        e.Draw(*camera, *shadowMapCamera, totalTime);
-    }
+    // Render the shadow map before the other objects
+    RenderShadowMap(drawEntities);
+
+    // Bin and upload this frame's lights
+    UploadLights();
+
+    // Everything that's the same for the whole frame
+    PerFrameData frameData = {};
+    frameData.totalTime = totalTime;
+    frameData.ambient = ambientColor;
+    frameData.cascadeSplits = shadowCascades.GetSplitDistances();
+    frameData.clusterScreenScale = XMFLOAT2((float)CLUSTER_COUNT_X / width, (float)CLUSTER_COUNT_Y / height);
+    frameData.clusterDepthScale = lightClusters.GetDepthSliceScale();
+    frameData.clusterDepthBias = lightClusters.GetDepthSliceBias();
+    frameData.globalLightCount = lightClusters.GetGlobalLightCount();
+    frameData.cascadeCount = shadowCascades.GetCascadeCount();
+    perFrameBuffer.Update(context.Get(), frameData);
+
+    // The shadow passes used the per-view buffer, so switch it to the camera
+    PerViewData viewData = {};
+    viewData.view = camera->GetView();
+    viewData.projection = camera->GetProjection();
+    viewData.cameraPos = camera->GetTransform()->GetPosition();
+    viewData.cameraForward = camera->GetTransform()->GetForward();
+    perViewBuffer.Update(context.Get(), viewData);
+
+    // Rematch materials to shader variants if the number of
+    // directional lights moved to another bucket
+    ShaderLightBucket lightBucket = GetShaderLightBucket(lightClusters.GetGlobalLightCount());
+    if (lightBucket != litLightBucket)
+        SelectShaderVariants(lightBucket);
+
+    // Light and shadow view lists are at the same registers in every
+    // lit shader variant, and nothing else uses them, so bind them
+    // once through a variant that has all of them
+    SimplePixelShader* lightListShader = litPixelShaders[litPixelVariants.Select(MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_NONE))].get();
+    lightListShader->SetShaderResourceView(SHADER_NAME("Lights"), lightBufferSRV);
+    lightListShader->SetShaderResourceView(SHADER_NAME("LightClusters"), lightClusterBufferSRV);
+    lightListShader->SetShaderResourceView(SHADER_NAME("LightIndices"), lightIndexBufferSRV);
+    lightListShader->SetShaderResourceView(SHADER_NAME("ShadowViews"), shadowViewBufferSRV);
+
+    DrawRenderQueue(drawEntities);
 
     // Draw sky last!
-    skybox->Draw(context, camera.get());
+    skybox->Draw(*renderState);
+    objectConstantRing->EndFrame();
 
     // Present the back buffer to the user
     //  - Puts the final frame we're drawing into the window so the user can see it
@@ -564,7 +1306,7 @@ void Game::Draw(float deltaTime, float totalTime)
 
     // Due to the usage of a more sophisticated swap chain,
     // the render target must be re-bound after every call to Present()
-    context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+    renderState->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
 }
 
 
@@ -631,50 +1373,749 @@ void Game::GenerateCircle(float radius, int subdivisions, XMFLOAT4 color, float
     }
 
     // assign the circle mesh with these verts/indices
-    circle = std::make_shared<Mesh>(&outerVertices[0], (int)outerVertices.size(), &indices[0], (int)indices.size(), device, context);
+    circle = std::make_shared<Mesh>(&outerVertices[0], (int)outerVertices.size(), &indices[0], (int)indices.size(), geometryPool);
 }
 
-void Game::RenderShadowMap(std::vector<Entity> entityList)
+void Game::RenderShadowMap(const std::vector<Entity*>& entityList)
 {
-    
-    // Set null render target 
-    context->OMSetRenderTargets(0, 0, shadowMapDSV.Get());
-    // Clear shadow depth stencil view before drawing
-    context->ClearDepthStencilView(
-        shadowMapDSV.Get(),
-        D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-        1.0f,
-        0);
-    // Apply custom rasterizer state
-    context->RSSetState(shadowMapRasterizerState.Get());
+    UpdateShadowViews();
+
+    for (Entity* e : entityList)
+        e->UpdateMotion();
+
+    // Split each view's casters into static and moving ones, and let
+    // the cache work out how much of the view actually has to be redrawn
+    staticShadowCasters.clear();
+    staticShadowCasterStates.clear();
+    dynamicShadowCasters.clear();
+    shadowCandidates.clear();
+    shadowCache.BeginFrame();
+    for (auto& pass : shadowPasses)
+    {
+        pass.Update = SHADOW_UPDATE_NONE;
+
+        // Didn't fit in the atlas this frame
+        if (pass.Tile.Node < 0)
+            continue;
+
+        pass.StaticCasterStart = staticShadowCasters.size();
+        pass.DynamicCasterStart = dynamicShadowCasters.size();
+        for (Entity* e : entityList)
+        {
+            if (!IsShadowCasterVisible(pass, e->GetWorldBounds()))
+                continue;
+
+            if (e->IsStatic())
+            {
+                staticShadowCasters.push_back(e);
+                staticShadowCasterStates.push_back({ e, e->GetGeometryVersion() });
+            }
+            else
+            {
+                dynamicShadowCasters.push_back(e);
+            }
+        }
+        pass.StaticCasterCount = staticShadowCasters.size() - pass.StaticCasterStart;
+        pass.DynamicCasterCount = dynamicShadowCasters.size() - pass.DynamicCasterStart;
+
+        pass.Update = shadowCache.Check(
+            pass.Key,
+            pass.View,
+            pass.Projection,
+            pass.Tile,
+            GetStaticCasterStates(pass),
+            pass.StaticCasterCount,
+            pass.DynamicCasterCount > 0);
+
+        if (pass.Update == SHADOW_UPDATE_NONE)
+            continue;
+
+        ShadowViewCandidate candidate = {};
+        candidate.Key = pass.Key;
+        candidate.Coverage = pass.Coverage;
+        candidate.Distance = pass.Distance;
+        candidate.Moving = pass.DynamicCasterCount > 0;
+        candidate.Required = !shadowCache.HasContents(pass.Key, pass.Tile);
+        candidate.DrawCalls = (unsigned int)(pass.DynamicCasterCount +
+            (pass.Update == SHADOW_UPDATE_ALL ? pass.StaticCasterCount : 0));
+        shadowCandidates.push_back(candidate);
+    }
+
+    // Spread the views that need work over several frames if they
+    // don't fit in the budget - the rest keep their stale contents
+    shadowScheduler.Schedule(shadowCandidates);
+    size_t candidateIndex = 0;
+    for (auto& pass : shadowPasses)
+    {
+        if (pass.Update != SHADOW_UPDATE_NONE && !shadowCandidates[candidateIndex++].Scheduled)
+            pass.Update = SHADOW_UPDATE_NONE;
+    }
+
+    // Every caster of every view gets a slot, static casters first,
+    // in the same order as the caster lists
+    if (useInstancing)
+    {
+        shadowInstanceBuffer.Begin();
+        unsigned int slot;
+        for (Entity* caster : staticShadowCasters)
+            AddInstance(shadowInstanceBuffer, caster, slot);
+        for (Entity* caster : dynamicShadowCasters)
+            AddInstance(shadowInstanceBuffer, caster, slot);
+        shadowInstanceBuffer.Upload(context.Get());
+    }
 
-    // Create a viewport matching the shadow map resolution
     D3D11_VIEWPORT viewport = {};
-    viewport.TopLeftX = 0.0f;
-    viewport.TopLeftY = 0.0f;
-    viewport.Width = (float)shadowMapResolution;
-    viewport.Height = (float)shadowMapResolution;
     viewport.MinDepth = 0.0f;
     viewport.MaxDepth = 1.0f;
-    context->RSSetViewports(1, &viewport);
-    
-    // Set our shaders and draw with them
-    shadowVS->SetShader();
-    context->PSSetShader(0, 0, 0);
 
-    for (auto& e : entityList) 
+    auto drawStart = std::chrono::high_resolution_clock::now();
+    size_t drawsBefore = shadowCasterDraws;
+
+    // Redraw the static layers that changed. Every view is a tile of the
+    // same atlas, so there's only one target to set no matter how many
+    // lights cast shadows.
+    renderState->OMSetRenderTargets(0, 0, staticShadowMapDSV.Get());
+    for (auto& pass : shadowPasses)
     {
-        shadowVS->SetMatrix4x4("world", e.GetTransform()->GetWorldMatrix());
-        shadowVS->SetMatrix4x4("view", shadowMapCamera->GetView());
-        shadowVS->SetMatrix4x4("projection", shadowMapCamera->GetProjection());
-        shadowVS->CopyAllBufferData();
-        e.GetMesh()->Draw();
+        if (pass.Update != SHADOW_UPDATE_ALL)
+            continue;
+
+        // Create a viewport matching the view's tile
+        viewport.TopLeftX = (float)pass.Tile.X;
+        viewport.TopLeftY = (float)pass.Tile.Y;
+        viewport.Width = (float)pass.Tile.Size;
+        viewport.Height = (float)pass.Tile.Size;
+        renderState->RSSetViewport(viewport);
+
+        DrawShadowTile(false);
+        DrawShadowCasters(pass, staticShadowCasters, pass.StaticCasterStart, pass.StaticCasterCount, 0);
     }
 
-    // Put render target and rasterizer state back to normal
-    context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+    // Copy the static layer into the final atlas and draw the moving casters on top
+    renderState->OMSetRenderTargets(0, 0, shadowMapDSV.Get());
+    for (auto& pass : shadowPasses)
+    {
+        if (pass.Update == SHADOW_UPDATE_NONE)
+            continue;
+
+        viewport.TopLeftX = (float)pass.Tile.X;
+        viewport.TopLeftY = (float)pass.Tile.Y;
+        viewport.Width = (float)pass.Tile.Size;
+        viewport.Height = (float)pass.Tile.Size;
+        renderState->RSSetViewport(viewport);
+
+        DrawShadowTile(true);
+        DrawShadowCasters(pass, dynamicShadowCasters, pass.DynamicCasterStart, pass.DynamicCasterCount, (unsigned int)staticShadowCasters.size());
+    }
+
+    // The static layer becomes a depth target again next frame
+    renderState->SetShaderResource(RENDER_STAGE_PIXEL, 0, 0);
+
+    // Tell the scheduler what that cost so millisecond budgets stay accurate.
+    // This is CPU submission time only - the GPU cost isn't measured.
+    auto drawEnd = std::chrono::high_resolution_clock::now();
+    shadowScheduler.ReportFrameCost(
+        (unsigned int)(shadowCasterDraws - drawsBefore),
+        std::chrono::duration<double, std::milli>(drawEnd - drawStart).count());
+
+    // Remember what each drawn view now holds
+    for (auto& pass : shadowPasses)
+    {
+        if (pass.Update == SHADOW_UPDATE_NONE)
+            continue;
+
+        shadowCache.MarkDrawn(
+            pass.Key,
+            pass.View,
+            pass.Projection,
+            pass.Tile,
+            GetStaticCasterStates(pass),
+            pass.StaticCasterCount,
+            pass.DynamicCasterCount > 0,
+            pass.Update);
+    }
+    shadowCache.EndFrame();
+
+    shadowViewsSkipped += shadowCache.GetSkippedCount();
+    shadowStaticLayersReused += shadowCache.GetStaticReuseCount();
+    shadowFullRedraws += shadowCache.GetFullRedrawCount();
+
+    // Views that were pushed to a later frame have to be sampled
+    // with the matrices they were last drawn with
+    for (size_t i = 0; i < shadowPasses.size(); i++)
+    {
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 projection;
+        if (shadowPasses[i].Tile.Node >= 0 && shadowCache.GetDrawnMatrices(shadowPasses[i].Key, view, projection))
+            XMStoreFloat4x4(&shadowViews[i].ViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+    }
+
+    if (!shadowViews.empty())
+        UpdateDynamicBuffer(shadowViewBuffer, &shadowViews[0], sizeof(ShadowView) * shadowViews.size());
+
+    // Put render target and states back to normal
+    renderState->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+    viewport.TopLeftX = 0.0f;
+    viewport.TopLeftY = 0.0f;
     viewport.Width = (float)this->width;
     viewport.Height = (float)this->height;
-    context->RSSetViewports(1, &viewport);
-    context->RSSetState(0);
+    renderState->RSSetViewport(viewport);
+    renderState->RSSetState(0);
+    renderState->OMSetDepthStencilState(0, 0);
+}
+
+// --------------------------------------------------------
+// Draws the entities sorted by shader, material, mesh and
+// depth, only rebinding what changes from one to the next
+// --------------------------------------------------------
+void Game::DrawRenderQueue(const std::vector<Entity*>& entityList)
+{
+    XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
+    XMFLOAT3 cameraForward = camera->GetTransform()->GetForward();
+
+    // Every submesh is queued separately, since each can have its own material
+    queuedDraws.clear();
+    for (Entity* e : entityList)
+    {
+        Mesh* mesh = e->GetMesh();
+        for (unsigned int submesh = 0; submesh < mesh->GetSubmeshCount(); submesh++)
+            queuedDraws.push_back({ e, e->GetMaterial(submesh), mesh, submesh });
+    }
+
+    renderQueue.Clear();
+    for (unsigned int i = 0; i < queuedDraws.size(); i++)
+    {
+        QueuedDraw& draw = queuedDraws[i];
+        Material* material = draw.DrawMaterial;
+        bool instanced = useInstancing && material->GetInstancedVertexShader();
+
+        // Front to back - distance along the view direction is enough.
+        // Instanced draws skip this and keep their order from frame to
+        // frame, so their instance buffer slots don't get shuffled.
+        unsigned int depth = 0;
+        if (!instanced)
+        {
+            XMFLOAT3 pos = draw.Object->GetTransform()->GetPosition();
+            float viewDepth =
+                (pos.x - cameraPos.x) * cameraForward.x +
+                (pos.y - cameraPos.y) * cameraForward.y +
+                (pos.z - cameraPos.z) * cameraForward.z;
+            depth = RenderQueue::QuantizeDepth(viewDepth, camera->GetNearClip(), camera->GetFarClip());
+        }
+
+        SimpleVertexShader* vs = instanced ? material->GetInstancedVertexShader() : material->GetVertexShader();
+        renderQueue.Add(
+            RenderQueue::MakeKey(
+                RENDER_PASS_OPAQUE,
+                renderQueue.GetProgramId(vs, material->GetPixelShader()),
+                renderQueue.GetMaterialId(material),
+                renderQueue.GetMeshId(draw.DrawMesh),
+                depth),
+            i);
+    }
+
+    // Count what insertion order would have cost, for comparison
+    RenderQueueSwitches switches = renderQueue.CountSwitches();
+    unsortedSwitches.Programs += switches.Programs;
+    unsortedSwitches.Materials += switches.Materials;
+    unsortedSwitches.Meshes += switches.Meshes;
+
+    renderQueue.Sort();
+
+    switches = renderQueue.CountSwitches();
+    sortedSwitches.Programs += switches.Programs;
+    sortedSwitches.Materials += switches.Materials;
+    sortedSwitches.Meshes += switches.Meshes;
+
+    // Group runs of instanced draws with the same submesh and material
+    // into batches, and lay out their matrices in the instance buffer
+    auto& items = renderQueue.GetItems();
+    drawBatches.clear();
+    instanceBuffer.Begin();
+    for (size_t i = 0; i < items.size();)
+    {
+        QueuedDraw& draw = queuedDraws[items[i].Index];
+        DrawBatch batch = { i, 1, 0, 0, useInstancing && draw.DrawMaterial->GetInstancedVertexShader() };
+        if (batch.Instanced)
+        {
+            while (i + batch.Count < items.size())
+            {
+                QueuedDraw& next = queuedDraws[items[i + batch.Count].Index];
+                if (next.DrawMaterial != draw.DrawMaterial || next.DrawMesh != draw.DrawMesh || next.Submesh != draw.Submesh)
+                    break;
+                batch.Count++;
+            }
+
+            for (unsigned int j = 0; j < batch.Count; j++)
+            {
+                unsigned int slot;
+                AddInstance(instanceBuffer, queuedDraws[items[i + j].Index].Object, slot);
+                if (j == 0)
+                    batch.FirstInstance = slot;
+            }
+        }
+
+        drawBatches.push_back(batch);
+        i += batch.Count;
+    }
+    instanceBuffer.Upload(context.Get());
+    mainPassDraws += drawBatches.size();
+
+    // Everything that isn't instanced gets its final matrices up front
+    objectMatrixTransforms.clear();
+    objectMatrixParams.clear();
+    for (auto& batch : drawBatches)
+    {
+        if (!batch.Instanced)
+        {
+            batch.ObjectIndex = (unsigned int)objectMatrixTransforms.size();
+            Entity* e = queuedDraws[items[batch.FirstItem].Index].Object;
+            objectMatrixTransforms.push_back(e->GetTransform());
+            objectMatrixParams.push_back(&e->GetInstanceParams());
+        }
+    }
+    RunObjectMatrixStage(camera->GetView(), camera->GetProjection(), true);
+
+    // Lay down depth first, so the main pass only shades what's visible
+    if (useDepthPrepass)
+    {
+        DrawDepthPrepass();
+        renderState->OMSetDepthStencilState(depthEqualState.Get(), 0);
+    }
+
+    SimpleVertexShader* lastVertexShader = 0;
+    SimplePixelShader* lastPixelShader = 0;
+    Material* lastMaterial = 0;
+    Mesh* lastMesh = 0;
+    for (auto& batch : drawBatches)
+    {
+        QueuedDraw& draw = queuedDraws[items[batch.FirstItem].Index];
+        Material* material = draw.DrawMaterial;
+        Mesh* mesh = draw.DrawMesh;
+
+        SimpleVertexShader* vs = batch.Instanced ? material->GetInstancedVertexShader() : material->GetVertexShader();
+        if (vs != lastVertexShader || material->GetPixelShader() != lastPixelShader)
+        {
+            material->SetShaders(*renderState, batch.Instanced);
+            lastVertexShader = vs;
+            lastPixelShader = material->GetPixelShader();
+        }
+
+        if (material != lastMaterial)
+        {
+            material->BindResources(*renderState);
+            lastMaterial = material;
+        }
+
+        // Submeshes of the same mesh share its buffers
+        if (mesh != lastMesh)
+        {
+            mesh->SetBuffers(*renderState);
+            lastMesh = mesh;
+        }
+
+        if (batch.Instanced)
+        {
+            instanceBuffer.Bind(*renderState, 1);
+            mesh->DrawSubmeshInstanced(draw.Submesh, batch.Count, batch.FirstInstance);
+            instancedDraws++;
+            instancesDrawn += batch.Count;
+        }
+        else
+        {
+            SetObjectData(objectMatrices.Get(batch.ObjectIndex));
+            mesh->DrawSubmesh(draw.Submesh);
+        }
+    }
+
+    renderState->OMSetDepthStencilState(0, 0);
+}
+
+// --------------------------------------------------------
+// Draws this frame's main pass batches depth-only, through
+// the shadow vertex shaders and the position-only stream.
+// Each batch goes the same way it will in the main pass,
+// instanced or not, with the same matrices, so the depths
+// come out exactly equal.
+// --------------------------------------------------------
+void Game::DrawDepthPrepass()
+{
+    auto& items = renderQueue.GetItems();
+    prepassOrder.resize(drawBatches.size());
+    for (unsigned int i = 0; i < drawBatches.size(); i++)
+        prepassOrder[i] = i;
+
+    // Front to back by each batch's nearest point, so later draws
+    // fail the depth test early instead of being written over
+    if (sortDepthPrepass)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
+        XMFLOAT3 cameraForward = camera->GetTransform()->GetForward();
+
+        prepassDepths.resize(drawBatches.size());
+        for (unsigned int i = 0; i < drawBatches.size(); i++)
+        {
+            float nearest = FLT_MAX;
+            for (unsigned int j = 0; j < drawBatches[i].Count; j++)
+            {
+                BoundingSphere bounds = queuedDraws[items[drawBatches[i].FirstItem + j].Index].Object->GetWorldBounds();
+                float viewDepth =
+                    (bounds.Center.x - cameraPos.x) * cameraForward.x +
+                    (bounds.Center.y - cameraPos.y) * cameraForward.y +
+                    (bounds.Center.z - cameraPos.z) * cameraForward.z;
+                nearest = std::min(nearest, viewDepth - bounds.Radius);
+            }
+            prepassDepths[i] = nearest;
+        }
+
+        std::sort(prepassOrder.begin(), prepassOrder.end(),
+            [&](unsigned int a, unsigned int b) { return prepassDepths[a] < prepassDepths[b]; });
+
+        auto end = std::chrono::high_resolution_clock::now();
+        prepassSortMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    renderState->PSSetShader(0);
+    for (unsigned int index : prepassOrder)
+    {
+        DrawBatch& batch = drawBatches[index];
+        QueuedDraw& draw = queuedDraws[items[batch.FirstItem].Index];
+        if (batch.Instanced)
+        {
+            shadowInstancedVS->SetShader();
+            instanceBuffer.Bind(*renderState, 1);
+            draw.DrawMesh->SetBuffers(*renderState, shadowInstancedVS->GetPositionOnly());
+            draw.DrawMesh->DrawSubmeshInstanced(draw.Submesh, batch.Count, batch.FirstInstance);
+        }
+        else
+        {
+            shadowVS->SetShader();
+            SetObjectData(objectMatrices.Get(batch.ObjectIndex));
+            draw.DrawMesh->SetBuffers(*renderState, shadowVS->GetPositionOnly());
+            draw.DrawMesh->DrawSubmesh(draw.Submesh);
+        }
+    }
+    prepassDraws += prepassOrder.size();
+}
+
+// --------------------------------------------------------
+// Works out final matrices for everything in objectMatrixTransforms
+// as seen from the given view, timing it for the stats. Shadow
+// passes don't need the instance parameters.
+// --------------------------------------------------------
+void Game::RunObjectMatrixStage(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, bool withInstanceParams)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    objectMatrices.Run(
+        view,
+        projection,
+        objectMatrixTransforms.data(),
+        withInstanceParams ? objectMatrixParams.data() : 0,
+        (unsigned int)objectMatrixTransforms.size());
+    auto end = std::chrono::high_resolution_clock::now();
+    objectMatrixMs += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// --------------------------------------------------------
+// Gives an entity the next slot in an instance buffer, filling
+// in its matrices if the slot doesn't already have them
+// --------------------------------------------------------
+void Game::AddInstance(InstanceBuffer<PerInstanceData>& buffer, Entity* e, unsigned int& slot)
+{
+    PerInstanceData* data = buffer.Add(e, e->GetVersion(), slot);
+    if (data)
+    {
+        data->world = e->GetTransform()->GetWorldMatrix();
+        data->worldInvTranspose = e->GetTransform()->GetWorldInverseTransposeMatrix();
+        data->instanceParams = e->GetInstanceParams();
+    }
+}
+
+// --------------------------------------------------------
+// Draws a range of casters into the current shadow tile
+// --------------------------------------------------------
+void Game::DrawShadowCasters(const ShadowPass& pass, const std::vector<Entity*>& casters, size_t start, size_t count, unsigned int firstInstance)
+{
+    // The light's view goes in the per-view buffer while shadows are drawn
+    PerViewData viewData = {};
+    viewData.view = pass.View;
+    viewData.projection = pass.Projection;
+    perViewBuffer.Update(context.Get(), viewData);
+
+    // Depth only, with the shadow bias - mostly already set from the
+    // last view, in which case the state cache drops these
+    renderState->OMSetDepthStencilState(0, 0);
+    renderState->RSSetState(shadowMapRasterizerState.Get());
+    renderState->PSSetShader(0);
+
+    if (!useInstancing)
+    {
+        objectMatrixTransforms.clear();
+        for (size_t i = start; i < start + count; i++)
+            objectMatrixTransforms.push_back(casters[i]->GetTransform());
+        RunObjectMatrixStage(pass.View, pass.Projection, false);
+
+        shadowVS->SetShader();
+        bool positionOnly = shadowVS->GetPositionOnly();
+        for (size_t i = 0; i < count; i++)
+        {
+            SetObjectData(objectMatrices.Get((unsigned int)i));
+            casters[start + i]->GetMesh()->Draw(*renderState, positionOnly);
+        }
+
+        shadowCasterDraws += count;
+        return;
+    }
+
+    // Caster i's matrices are in slot firstInstance + i, so each run
+    // of casters sharing a mesh is a single instanced draw
+    shadowInstancedVS->SetShader();
+    shadowInstanceBuffer.Bind(*renderState, 1);
+    bool positionOnly = shadowInstancedVS->GetPositionOnly();
+    for (size_t i = start; i < start + count;)
+    {
+        Mesh* mesh = casters[i]->GetMesh();
+        size_t end = i + 1;
+        while (end < start + count && casters[end]->GetMesh() == mesh)
+            end++;
+
+        mesh->SetBuffers(*renderState, positionOnly);
+        mesh->DrawIndexedInstanced((unsigned int)(end - i), firstInstance + (unsigned int)i);
+        i = end;
+    }
+
+    shadowCasterDraws += count;
+}
+
+// --------------------------------------------------------
+// Overwrites the whole current shadow tile, either clearing it
+// or copying the view's static layer into it
+// --------------------------------------------------------
+void Game::DrawShadowTile(bool copyStaticLayer)
+{
+    renderState->OMSetDepthStencilState(shadowTileDepthState.Get(), 0);
+    renderState->RSSetState(0);
+
+    ShadowTileVSExternalData tileData = {};
+    tileData.depth = 1.0f;
+    shadowTileVS->SetBufferStruct(tileData);
+    shadowTileVS->CopyAllBufferData();
+    shadowTileVS->SetShader();
+
+    if (copyStaticLayer)
+    {
+        shadowCopyPS->SetShader();
+        shadowCopyPS->SetShaderResourceView(SHADER_NAME("StaticShadowMap"), staticShadowMapSRV);
+    }
+    else
+    {
+        renderState->PSSetShader(0);
+    }
+
+    context->Draw(3, 0);
+}
+
+// --------------------------------------------------------
+// Works out which shadow views this frame needs and packs
+// them into the atlas
+// --------------------------------------------------------
+void Game::UpdateShadowViews()
+{
+    shadowTileRequests.clear();
+    shadowPasses.clear();
+
+    XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+    XMVECTOR cameraPos = XMLoadFloat3(&cameraPosition);
+    float tanHalfFov = std::tan(camera->GetFoV() / 2);
+    bool cascadesUsed = false;
+
+    for (unsigned int i = 0; i < lights.size(); i++)
+    {
+        Light& light = lights[i];
+        light.ShadowIndex = -1;
+        if (!light.ShadowCasting)
+            continue;
+
+        if (light.Type == LIGHT_TYPE_DIRECTIONAL && !cascadesUsed)
+        {
+            // The first shadowed directional light is the sun and gets
+            // the cascades - they always come before any spot lights
+            int cascadeCount = shadowCascades.GetCascadeCount();
+            if (shadowPasses.size() + cascadeCount > MAX_SHADOW_VIEWS)
+                continue;
+
+            shadowCascades.Update(
+                camera->GetView(),
+                camera->GetFoV(),
+                camera->GetAspectRatio(),
+                camera->GetNearClip(),
+                camera->GetFarClip(),
+                light.Direction);
+            cascadesUsed = true;
+
+            light.ShadowIndex = (int)shadowPasses.size();
+            for (int c = 0; c < cascadeCount; c++)
+            {
+                const ShadowCascade& cascade = shadowCascades.GetCascade(c);
+
+                ShadowPass pass = {};
+                pass.LightIndex = i;
+                pass.Coverage = 1.0f / (1 + c);
+                pass.Distance = 0.0f;
+                pass.Cascade = c;
+                pass.View = cascade.View;
+                pass.Projection = cascade.Projection;
+                pass.Perspective = false;
+                pass.OrthoVolume = cascade.Volume;
+                AddShadowView(
+                    pass,
+                    i * MAX_SHADOW_CASCADES + c,
+                    shadowCascades.GetResolution(),
+                    2.0f + cascadeCount - c);
+            }
+        }
+        else if (light.Type == LIGHT_TYPE_SPOT)
+        {
+            if (shadowPasses.size() >= MAX_SHADOW_VIEWS)
+                continue;
+
+            // Tile size follows how much of the screen the light's range covers
+            XMVECTOR lightPos = XMLoadFloat3(&light.Position);
+            float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(lightPos, cameraPos)));
+            float coverage = 1.0f;
+            if (distance > light.Range)
+                coverage = min(light.Range / (distance * tanHalfFov), 1.0f);
+
+            // The spot's cone is where pow(cos(angle), falloff) drops to 1%
+            float coneAngle = std::acos(std::pow(0.01f, 1.0f / max(light.SpotFalloff, 1.0f)));
+            float fov = min(max(2 * coneAngle, 0.1f), XM_PI * 0.9f);
+
+            XMVECTOR lightDir = XMVector3Normalize(XMLoadFloat3(&light.Direction));
+            XMVECTOR up = std::fabs(XMVectorGetY(lightDir)) > 0.99f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+            XMMATRIX view = XMMatrixLookToLH(lightPos, lightDir, up);
+            XMMATRIX proj = XMMatrixPerspectiveFovLH(fov, 1.0f, 0.05f, light.Range);
+
+            ShadowPass pass = {};
+            pass.LightIndex = i;
+            pass.Coverage = coverage;
+            pass.Distance = distance;
+            pass.Cascade = -1;
+            XMStoreFloat4x4(&pass.View, view);
+            XMStoreFloat4x4(&pass.Projection, proj);
+            pass.Perspective = true;
+            BoundingFrustum frustum;
+            BoundingFrustum::CreateFromMatrix(frustum, proj);
+            frustum.Transform(pass.PerspectiveVolume, XMMatrixInverse(0, view));
+
+            light.ShadowIndex = (int)shadowPasses.size();
+            AddShadowView(
+                pass,
+                i * MAX_SHADOW_CASCADES,
+                (unsigned int)(coverage * maxSpotShadowSize),
+                coverage);
+        }
+    }
+
+    shadowAtlas.AssignTiles(shadowTileRequests);
+    shadowTileRepacks += shadowAtlas.GetLastRepackCount();
+
+    // Convert each tile to the UVs the pixel shader needs
+    float atlasSize = (float)shadowAtlas.GetAtlasSize();
+    float halfTexel = 0.5f / atlasSize;
+    shadowViews.resize(shadowPasses.size());
+    for (size_t i = 0; i < shadowPasses.size(); i++)
+    {
+        ShadowPass& pass = shadowPasses[i];
+        ShadowView& view = shadowViews[i];
+        const ShadowTileRequest& request = shadowTileRequests[i];
+
+        // Cascades were fit for the size they asked for - snap them
+        // to the texels of the tile they really got
+        if (request.Allocated && pass.Cascade >= 0)
+        {
+            shadowCascades.SetTileSize(pass.Cascade, request.Tile.Size);
+            const ShadowCascade& cascade = shadowCascades.GetCascade(pass.Cascade);
+            pass.Projection = cascade.Projection;
+            pass.OrthoVolume = cascade.Volume;
+        }
+
+        XMStoreFloat4x4(&view.ViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&pass.View), XMLoadFloat4x4(&pass.Projection)));
+
+        if (!request.Allocated)
+        {
+            pass.Tile = { -1, 0, 0, 0 };
+            view.AtlasRect = XMFLOAT4(0, 0, 0, 0);
+            view.AtlasBounds = XMFLOAT4(0, 0, 0, 0);
+            continue;
+        }
+
+        pass.Tile = request.Tile;
+        float x = pass.Tile.X / atlasSize;
+        float y = pass.Tile.Y / atlasSize;
+        float size = pass.Tile.Size / atlasSize;
+        view.AtlasRect = XMFLOAT4(x, y, size, size);
+        view.AtlasBounds = XMFLOAT4(x + halfTexel, y + halfTexel, x + size - halfTexel, y + size - halfTexel);
+    }
+}
+
+// --------------------------------------------------------
+// Queues a view up for a tile in the shadow atlas
+// --------------------------------------------------------
+void Game::AddShadowView(const ShadowPass& pass, unsigned int key, unsigned int size, float importance)
+{
+    ShadowTileRequest request = {};
+    request.Key = key;
+    request.Size = size;
+    request.Importance = importance;
+
+    shadowPasses.push_back(pass);
+    shadowPasses.back().Key = key;
+    shadowTileRequests.push_back(request);
+}
+
+// Static caster states for a pass, for the shadow cache
+const ShadowCasterState* Game::GetStaticCasterStates(const ShadowPass& pass)
+{
+    return pass.StaticCasterCount > 0 ? &staticShadowCasterStates[pass.StaticCasterStart] : 0;
+}
+
+bool Game::IsShadowCasterVisible(const ShadowPass& pass, const DirectX::BoundingSphere& casterBounds)
+{
+    return pass.Perspective ?
+        pass.PerspectiveVolume.Intersects(casterBounds) :
+        pass.OrthoVolume.Intersects(casterBounds);
+}
+
+// --------------------------------------------------------
+// Bins the lights into the camera's clusters and copies the
+// lights, cluster table and light index list to the GPU
+// --------------------------------------------------------
+void Game::UploadLights()
+{
+    auto binStart = std::chrono::high_resolution_clock::now();
+    lightClusters.AssignLights(&lights[0], (unsigned int)lights.size(), camera->GetView());
+    auto binEnd = std::chrono::high_resolution_clock::now();
+    lightBinningMs += std::chrono::duration<double, std::milli>(binEnd - binStart).count();
+
+    const std::vector<ClusterRange>& clusterRanges = lightClusters.GetClusterRanges();
+    const std::vector<unsigned int>& lightIndices = lightClusters.GetLightIndices();
+
+    // Grow the buffers if there's more data than last time
+    if (lights.size() > lightBufferCapacity)
+    {
+        lightBufferCapacity = max((unsigned int)lights.size(), lightBufferCapacity * 2);
+        CreateStructuredBuffer(sizeof(Light), lightBufferCapacity, lightBuffer, lightBufferSRV);
+    }
+
+    if (lightIndices.size() > lightIndexBufferCapacity || lightIndexBufferCapacity == 0)
+    {
+        lightIndexBufferCapacity = max(max((unsigned int)lightIndices.size(), lightIndexBufferCapacity * 2), 64u);
+        CreateStructuredBuffer(sizeof(unsigned int), lightIndexBufferCapacity, lightIndexBuffer, lightIndexBufferSRV);
+    }
+
+    UpdateDynamicBuffer(lightBuffer, &lights[0], sizeof(Light) * lights.size());
+    UpdateDynamicBuffer(lightClusterBuffer, &clusterRanges[0], sizeof(ClusterRange) * clusterRanges.size());
+    if (!lightIndices.empty())
+        UpdateDynamicBuffer(lightIndexBuffer, &lightIndices[0], sizeof(unsigned int) * lightIndices.size());
 }
@@ -11,8 +11,50 @@
 #include <vector>
 #include "Lights.h"
 #include "Sky.h"
+#include "LightClusters.h"
+#include "ShadowCascades.h"
+#include "ShadowAtlas.h"
+#include "ShadowCache.h"
+#include "ShadowScheduler.h"
+#include "ConstantBuffer.h"
+#include "ConstantRing.h"
+#include "RenderStateCache.h"
+#include "StateObjectCache.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
+#include "ObjectMatrixStage.h"
+#include "ShaderVariants.h"
+#include "StaticBatcher.h"
+#include "MaterialLibrary.h"
+#include "BufferStructs.h"
 #include <unordered_map>
 
+// A single view rendered into the shadow atlas
+struct ShadowPass
+{
+	unsigned int Key;
+	int LightIndex;
+	float Coverage;		// Rough fraction of the screen the view affects
+	float Distance;		// From the camera to the light, 0 for directional lights
+	int Cascade;		// Cascade the view draws, -1 for spot lights
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	ShadowAtlasTile Tile;
+
+	// World-space volume the view covers, for culling casters
+	bool Perspective;
+	DirectX::BoundingOrientedBox OrthoVolume;
+	DirectX::BoundingFrustum PerspectiveVolume;
+
+	// This frame's visible casters (ranges of Game's caster lists)
+	// and how much of the view has to be redrawn
+	size_t StaticCasterStart;
+	size_t StaticCasterCount;
+	size_t DynamicCasterStart;
+	size_t DynamicCasterCount;
+	ShadowCacheUpdate Update;
+};
+
 class Game 
 	: public DXCore
 {
@@ -33,34 +75,142 @@ private:
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
 	void CreateBasicGeometry();
+	void CreateManySpheres(unsigned int count);
+	void CreateManyProps(unsigned int count);
+	std::vector<Entity>& GetActiveEntities();
+	void GatherDrawEntities(std::vector<Entity>& entityList);
 	void CreateSampleLights();
+	void CreateManyLights(int count);
+	void InitLightBuffers();
+	void InitConstantBuffers();
+	void SetObjectData(const PerObjectData& objectData);
 	void InitShadowMap();
 	void CreateMaterials();
+	std::shared_ptr<Material> CreateLitMaterial(
+		DirectX::XMFLOAT4 colorTint,
+		const std::wstring& albedoFile,
+		const std::wstring& normalFile,
+		const std::wstring& metalnessFile,
+		const std::wstring& roughnessFile);
+	void AssignLibraryMaterials(Entity& e);
+	void SelectShaderVariants(ShaderLightBucket lights);
 	void GenerateCircle(float radius, int subdivisions, DirectX::XMFLOAT4 color, float xOffset);
-	void RenderShadowMap(std::vector<Entity> entityList);
+	void RenderShadowMap(const std::vector<Entity*>& entityList);
+	void DrawRenderQueue(const std::vector<Entity*>& entityList);
+	void DrawDepthPrepass();
+	void UpdateShadowViews();
+	void AddShadowView(const ShadowPass& pass, unsigned int key, unsigned int size, float importance);
+	bool IsShadowCasterVisible(const ShadowPass& pass, const DirectX::BoundingSphere& casterBounds);
+	const ShadowCasterState* GetStaticCasterStates(const ShadowPass& pass);
+	void DrawShadowCasters(const ShadowPass& pass, const std::vector<Entity*>& casters, size_t start, size_t count, unsigned int firstInstance);
+	void RunObjectMatrixStage(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, bool withInstanceParams);
+	void AddInstance(InstanceBuffer<PerInstanceData>& buffer, Entity* e, unsigned int& slot);
+	void DrawShadowTile(bool copyStaticLayer);
+	void UploadLights();
+	void ReportFrameStats(float totalTime);
+	void RunShaderSetterBenchmark();
 	
 	void UpdateEntity(Entity& e, float deltaTime, float totalTime);
 
+	// Buffer helpers
+	void CreateStructuredBuffer(
+		unsigned int stride,
+		unsigned int count,
+		Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	void UpdateDynamicBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, const void* data, size_t size);
+
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//    Component Object Model, which DirectX objects do
 	//  - More info here: https://github.com/Microsoft/DirectXTK/wiki/ComPtr
 	
 	// Shaders and shader-related constructs
-	std::shared_ptr<SimplePixelShader> pixelShaderSpec;
 	std::shared_ptr<SimplePixelShader> pixelShaderSky;
-	std::shared_ptr<SimplePixelShader> pixelShaderSpecAndNormal;
-	std::shared_ptr<SimplePixelShader> pixelShaderSpecNormalRefl;
-	std::shared_ptr<SimplePixelShader> pixelShaderSpecNormalReflShadow;
 	std::shared_ptr<SimplePixelShader> customPixelShader;
 
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimpleVertexShader> vertexShaderSky;
-	std::shared_ptr<SimpleVertexShader> vertexShaderNormalMap;
-	std::shared_ptr<SimpleVertexShader> vertexShaderNormalMapShadowMap;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> shadowInstancedVS;
+	std::shared_ptr<SimpleVertexShader> shadowTileVS;
+	std::shared_ptr<SimplePixelShader> shadowCopyPS;
+
+	// Every compiled variant of the lit shaders, in the same order
+	// as the keys in their selectors. Materials are matched to the
+	// tightest variant for their features and the frame's number
+	// of directional lights, and rematched when that changes.
+	std::vector<std::shared_ptr<SimplePixelShader>> litPixelShaders;
+	std::vector<std::shared_ptr<SimpleVertexShader>> litVertexShaders;
+	ShaderVariantSelector litPixelVariants;
+	ShaderVariantSelector litVertexVariants;
+	ShaderLightBucket litLightBucket = SHADER_LIGHTS_ANY;
+
+	// Everything that binds pipeline state goes through this, so
+	// redundant calls never reach the context
+	std::unique_ptr<RenderStateCache> renderState;
+
+	// Input layouts and state objects, one per distinct description
+	std::unique_ptr<StateObjectCache> stateObjects;
+
+	// The frame's entity draws, sorted to keep state changes down
+	RenderQueue renderQueue;
+
+	// Final matrices for each batch of non-instanced draws, worked out
+	// before drawing so shaders don't concatenate them per vertex
+	ObjectMatrixStage objectMatrices;
+	std::vector<Transform*> objectMatrixTransforms;
+	std::vector<const InstanceParams*> objectMatrixParams;
+	double objectMatrixMs = 0;
+
+	// Runs of queued draws sharing a mesh and material get drawn with
+	// one instanced call, with their matrices in a persistent buffer
+	struct DrawBatch
+	{
+		size_t FirstItem;
+		unsigned int Count;
+		unsigned int FirstInstance;
+		unsigned int ObjectIndex;	// In objectMatrices, when not instanced
+		bool Instanced;
+	};
+	std::vector<DrawBatch> drawBatches;
 
-	// Some sample meshes
+	// One per submesh of every entity drawn this frame, which is
+	// what the render queue's items refer to
+	struct QueuedDraw
+	{
+		Entity* Object;
+		Material* DrawMaterial;
+		Mesh* DrawMesh;
+		unsigned int Submesh;
+	};
+	std::vector<QueuedDraw> queuedDraws;
+
+	// Optional depth-only pass over the same batches before the main
+	// pass, which then only shades pixels whose depth matches exactly.
+	// Its draws can be sorted front to back, or left in queue order.
+	bool useDepthPrepass = false;
+	bool sortDepthPrepass = true;
+	std::vector<unsigned int> prepassOrder;
+	std::vector<float> prepassDepths;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthEqualState;
+	InstanceBuffer<PerInstanceData> instanceBuffer;
+	InstanceBuffer<PerInstanceData> shadowInstanceBuffer;
+	bool useInstancing = true;
+
+	// Constant buffers shared by every shader, by how often they change.
+	// Each material has its own per-material buffer.
+	ConstantBuffer<PerFrameData> perFrameBuffer;
+	ConstantBuffer<PerViewData> perViewBuffer;
+	ConstantBuffer<PerObjectData> perObjectBuffer;
+
+	// Per-object data goes through a dynamic ring buffer when the
+	// device supports it, otherwise through perObjectBuffer
+	std::unique_ptr<ConstantRing> objectConstantRing;
+	bool useConstantRing = true;
+
+	// Some sample meshes, all sharing the pool's buffers
+	std::shared_ptr<GeometryPool> geometryPool;
 	std::shared_ptr<Mesh> tri;
 	std::shared_ptr<Mesh> pent;
 	std::shared_ptr<Mesh> circle;
@@ -69,18 +219,57 @@ private:
 	// All the entities that will be drawn
 	std::vector<Entity> entities;
 	std::vector<Entity> entitiesAllSpheres;
+	std::vector<Entity> entitiesManySpheres;
+	std::vector<Entity> entitiesManyProps;
+
+	// Static geometry in the active scene, merged into world-space
+	// batches, and what's actually drawn this frame: the scene's other
+	// entities plus the batches, or every entity with batching off
+	std::unique_ptr<StaticBatcher> staticBatcher;
+	std::vector<Entity*> drawEntities;
+	bool useStaticBatching = true;
 
 	std::shared_ptr<Camera> camera;
 
 	// Lights
 	std::vector<Light> lights;
+	size_t sampleLightCount = 0;
+	bool manyLights = false;
+
+	// Clustered lighting - lights are binned on the CPU each frame and
+	// uploaded as structured buffers for the pixel shader
+	LightClusterGrid lightClusters;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightBufferSRV;
+	unsigned int lightBufferCapacity = 0;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightClusterBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightClusterBufferSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightIndexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightIndexBufferSRV;
+	unsigned int lightIndexBufferCapacity = 0;
+
+	// Stats printed to the console once per second
+	float lastStatsTime = 0;
+	int statsFrameCount = 0;
+	double lightBinningMs = 0;
+	RenderQueueSwitches unsortedSwitches = {};
+	RenderQueueSwitches sortedSwitches = {};
+	unsigned int instancedDraws = 0;
+	unsigned int instancesDrawn = 0;
+	size_t mainPassDraws = 0;
+	size_t prepassDraws = 0;
+	double prepassSortMs = 0;
 
 	// Materials
 	std::vector<std::wstring> textureFiles;
 	std::unordered_map<std::wstring, std::shared_ptr<Material>> materials;
+	std::unordered_map<std::string, MaterialLibrary> materialLibraries;
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 
+	// 1x1 white, for lit materials without an albedo map
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> defaultAlbedoSRV;
+
 	// Skybox things
 	std::shared_ptr<Sky> skybox;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyboxSrv;
@@ -88,13 +277,43 @@ private:
 	bool moveEntities = false;
 	bool offsetUvs = false;
 	bool spheresOnly = false;
+	bool manySpheres = false;
+	bool manyProps = false;
 
-	// Shadowmap variables
+	// Shadowmap variables - every shadow view is a tile in one atlas
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowMapDSV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowMapSRV;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowMapRasterizerState;
-	std::shared_ptr<Camera> shadowMapCamera;
-	int shadowMapResolution;
-	float shadowMapDimension = 10;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticShadowMapDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> staticShadowMapSRV;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> shadowTileDepthState;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> shadowViewBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowViewBufferSRV;
+	ShadowCascades shadowCascades;
+	ShadowAtlas shadowAtlas;
+	ShadowCache shadowCache;
+	ShadowScheduler shadowScheduler;
+	std::vector<ShadowViewCandidate> shadowCandidates;
+	unsigned int shadowBudgetDrawCalls = 16;
+	float shadowBudgetMs = 0.5f;
+	unsigned int maxSpotShadowSize = 1024;
+
+	// This frame's shadow views, in matching order
+	std::vector<ShadowTileRequest> shadowTileRequests;
+	std::vector<ShadowPass> shadowPasses;
+	std::vector<ShadowView> shadowViews;
+
+	// Culled caster lists, kept around between frames so culling doesn't allocate.
+	// Static casters and their states are in matching order.
+	std::vector<Entity*> staticShadowCasters;
+	std::vector<ShadowCasterState> staticShadowCasterStates;
+	std::vector<Entity*> dynamicShadowCasters;
+
+	// Shadow stats, reset once per second
+	size_t shadowCasterDraws = 0;
+	unsigned int shadowTileRepacks = 0;
+	unsigned int shadowViewsSkipped = 0;
+	unsigned int shadowStaticLayersReused = 0;
+	unsigned int shadowFullRedraws = 0;
 };
\ No newline at end of file
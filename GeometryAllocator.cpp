@@ -0,0 +1,144 @@
+#include "GeometryAllocator.h"
+#include <algorithm>
+#include <iterator>
+
+GeometryAllocator::GeometryAllocator(unsigned int capacity) :
+    capacity(capacity),
+    used(0)
+{
+    if (capacity > 0)
+        freeRanges[0] = capacity;
+}
+
+GeometryAllocator::~GeometryAllocator()
+{
+}
+
+unsigned int GeometryAllocator::Allocate(unsigned int count)
+{
+    // Smallest range that fits - the first one found wins ties,
+    // which keeps things towards the front
+    auto best = freeRanges.end();
+    for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range)
+    {
+        if (range->second >= count && (best == freeRanges.end() || range->second < best->second))
+        {
+            best = range;
+            if (range->second == count)
+                break;
+        }
+    }
+
+    // Nothing to allocate doesn't need a range
+    unsigned int offset = 0;
+    if (count > 0)
+    {
+        if (best == freeRanges.end())
+            return GEOMETRY_ALLOCATION_NONE;
+
+        // Take the front of the range and keep whatever's left
+        offset = best->first;
+        unsigned int remaining = best->second - count;
+        freeRanges.erase(best);
+        if (remaining > 0)
+            freeRanges[offset + count] = remaining;
+    }
+
+    unsigned int id;
+    if (!unusedIds.empty())
+    {
+        id = unusedIds.back();
+        unusedIds.pop_back();
+    }
+    else
+    {
+        id = (unsigned int)allocations.size();
+        allocations.push_back({});
+    }
+
+    allocations[id] = { offset, count, true };
+    used += count;
+    return id;
+}
+
+void GeometryAllocator::Free(unsigned int allocation)
+{
+    if (allocation >= allocations.size() || !allocations[allocation].Live)
+        return;
+
+    Allocation& freed = allocations[allocation];
+    if (freed.Count > 0)
+        AddFreeRange(freed.Offset, freed.Count);
+
+    used -= freed.Count;
+    freed.Live = false;
+    unusedIds.push_back(allocation);
+}
+
+void GeometryAllocator::AddFreeRange(unsigned int offset, unsigned int count)
+{
+    // Merge with the range after this one
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && next->first == offset + count)
+    {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+
+    // And the one before
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += count;
+            return;
+        }
+    }
+
+    freeRanges[offset] = count;
+}
+
+void GeometryAllocator::Defragment(std::vector<Move>& moves)
+{
+    moves.clear();
+    for (unsigned int i = 0; i < allocations.size(); i++)
+    {
+        if (allocations[i].Live && allocations[i].Count > 0)
+            moves.push_back({ i, allocations[i].Offset, 0, allocations[i].Count });
+    }
+
+    // Keeping the order means each move only ever goes towards
+    // the front, past space that's already been emptied
+    std::sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) { return a.From < b.From; });
+
+    unsigned int offset = 0;
+    for (Move& move : moves)
+    {
+        move.To = offset;
+        allocations[move.Allocation].Offset = offset;
+        offset += move.Count;
+    }
+
+    freeRanges.clear();
+    if (capacity > offset)
+        freeRanges[offset] = capacity - offset;
+}
+
+void GeometryAllocator::Grow(unsigned int newCapacity)
+{
+    if (newCapacity <= capacity)
+        return;
+
+    unsigned int oldCapacity = capacity;
+    capacity = newCapacity;
+    AddFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+unsigned int GeometryAllocator::GetLargestFreeRange()
+{
+    unsigned int largest = 0;
+    for (auto& range : freeRanges)
+        largest = std::max(largest, range.second);
+    return largest;
+}
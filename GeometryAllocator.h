@@ -0,0 +1,75 @@
+#pragma once
+#include <map>
+#include <vector>
+
+// Returned by Allocate() when there's no room
+#define GEOMETRY_ALLOCATION_NONE 0xFFFFFFFF
+
+// --------------------------------------------------------
+// Hands out ranges of a large vertex or index buffer, in
+// elements rather than bytes.
+//
+// Free space is kept as a list of ranges sorted by offset,
+// merged with its neighbours whenever something is freed.
+// Allocations take the smallest range they fit in, so big
+// ranges are saved for big meshes.
+//
+// Allocations are referred to by id rather than offset, so
+// Defragment() can pack them together and tell the caller
+// what to copy where without anyone holding a stale offset.
+// --------------------------------------------------------
+class GeometryAllocator
+{
+public:
+    GeometryAllocator(unsigned int capacity);
+    ~GeometryAllocator();
+
+    // Returns an allocation id, or GEOMETRY_ALLOCATION_NONE if no
+    // single free range is big enough (Defragment() or Grow() might help)
+    unsigned int Allocate(unsigned int count);
+    void Free(unsigned int allocation);
+
+    unsigned int GetOffset(unsigned int allocation) { return allocations[allocation].Offset; }
+    unsigned int GetCount(unsigned int allocation) { return allocations[allocation].Count; }
+
+    // Where an allocation's data has to be copied from and to
+    struct Move
+    {
+        unsigned int Allocation;
+        unsigned int From;
+        unsigned int To;
+        unsigned int Count;
+    };
+
+    // Packs every allocation to the front, keeping their order, so
+    // all the free space is one range at the end. Every allocation
+    // is listed, including the ones that stay put, so the moves can
+    // also be used to copy everything into a new buffer.
+    void Defragment(std::vector<Move>& moves);
+
+    // Adds space to the end - never shrinks
+    void Grow(unsigned int newCapacity);
+
+    unsigned int GetCapacity() { return capacity; }
+    unsigned int GetUsed() { return used; }
+    unsigned int GetFreeRangeCount() { return (unsigned int)freeRanges.size(); }
+    unsigned int GetLargestFreeRange();
+
+private:
+    unsigned int capacity;
+    unsigned int used;
+
+    // Offset -> count of every free range, never touching each other
+    std::map<unsigned int, unsigned int> freeRanges;
+
+    struct Allocation
+    {
+        unsigned int Offset;
+        unsigned int Count;
+        bool Live;
+    };
+    std::vector<Allocation> allocations;
+    std::vector<unsigned int> unusedIds;
+
+    void AddFreeRange(unsigned int offset, unsigned int count);
+};
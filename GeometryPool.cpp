@@ -0,0 +1,182 @@
+#include "GeometryPool.h"
+#include <algorithm>
+#include <cstring>
+#include <DirectXMath.h>
+#include <stdio.h>
+
+using namespace Microsoft::WRL;
+
+// Bytes per vertex in the position stream
+#define GEOMETRY_POSITION_STRIDE ((unsigned int)sizeof(DirectX::XMFLOAT3))
+
+GeometryPool::GeometryPool(
+    ComPtr<ID3D11Device> device,
+    ComPtr<ID3D11DeviceContext> context,
+    unsigned int vertexStride,
+    unsigned int vertexCapacity,
+    unsigned int indexCapacity,
+    bool positionStream) :
+    device(device),
+    context(context),
+    vertices(vertexCapacity, vertexStride, D3D11_BIND_VERTEX_BUFFER),
+    indices(indexCapacity, sizeof(unsigned int), D3D11_BIND_INDEX_BUFFER)
+{
+    CreateBuffer(vertices, vertexCapacity, vertices.Stride, vertices.Buffer);
+    CreateBuffer(indices, indexCapacity, indices.Stride, indices.Buffer);
+    if (positionStream)
+        CreateBuffer(vertices, vertexCapacity, GEOMETRY_POSITION_STRIDE, vertices.PositionBuffer);
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+bool GeometryPool::CreateBuffer(Stream& stream, unsigned int capacity, unsigned int stride, ComPtr<ID3D11Buffer>& buffer)
+{
+    // Default usage rather than immutable, so meshes can be copied in
+    // one at a time and moved around when the pool is repacked
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth = capacity * stride;
+    desc.BindFlags = stream.BindFlags;
+    return SUCCEEDED(device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf()));
+}
+
+bool GeometryPool::Add(const void* vertexData, unsigned int vertexCount, const unsigned int* indexData, unsigned int indexCount, GeometryPoolEntry& entry)
+{
+    entry.VertexAllocation = Allocate(vertices, vertexCount);
+    if (entry.VertexAllocation == GEOMETRY_ALLOCATION_NONE)
+        return false;
+
+    entry.IndexAllocation = Allocate(indices, indexCount);
+    if (entry.IndexAllocation == GEOMETRY_ALLOCATION_NONE)
+    {
+        Remove(entry);
+        return false;
+    }
+
+    // Indices stay relative to the mesh's own vertices - the base
+    // vertex is added when drawing
+    unsigned int baseVertex = GetBaseVertex(entry);
+    Upload(vertices.Buffer.Get(), vertices.Stride, baseVertex, vertexCount, vertexData);
+    Upload(indices.Buffer.Get(), indices.Stride, GetStartIndex(entry), indexCount, indexData);
+
+    // The position stream gets the first 12 bytes of every vertex
+    if (vertices.PositionBuffer)
+    {
+        std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+        const unsigned char* vertex = (const unsigned char*)vertexData;
+        for (unsigned int i = 0; i < vertexCount; i++, vertex += vertices.Stride)
+            memcpy(&positions[i], vertex, GEOMETRY_POSITION_STRIDE);
+        Upload(vertices.PositionBuffer.Get(), GEOMETRY_POSITION_STRIDE, baseVertex, vertexCount, positions.data());
+    }
+    return true;
+}
+
+void GeometryPool::Remove(GeometryPoolEntry& entry)
+{
+    if (entry.VertexAllocation != GEOMETRY_ALLOCATION_NONE)
+        vertices.Allocator.Free(entry.VertexAllocation);
+    if (entry.IndexAllocation != GEOMETRY_ALLOCATION_NONE)
+        indices.Allocator.Free(entry.IndexAllocation);
+
+    entry.VertexAllocation = GEOMETRY_ALLOCATION_NONE;
+    entry.IndexAllocation = GEOMETRY_ALLOCATION_NONE;
+}
+
+unsigned int GeometryPool::Allocate(Stream& stream, unsigned int count)
+{
+    unsigned int allocation = stream.Allocator.Allocate(count);
+    if (allocation != GEOMETRY_ALLOCATION_NONE)
+        return allocation;
+
+    // Enough space in total, just not in one piece
+    GeometryAllocator& allocator = stream.Allocator;
+    unsigned int capacity = allocator.GetCapacity();
+    if (capacity - allocator.GetUsed() >= count)
+    {
+        if (Repack(stream, capacity))
+            stream.Defragments++;
+    }
+    else
+    {
+        // Doubling keeps the number of moves down while loading
+        if (Repack(stream, std::max(capacity * 2, allocator.GetUsed() + count)))
+            stream.Grows++;
+    }
+
+    return allocator.Allocate(count);
+}
+
+bool GeometryPool::Repack(Stream& stream, unsigned int newCapacity)
+{
+    // Make the new buffers before touching the allocator, so running
+    // out of memory leaves everything where it was
+    ComPtr<ID3D11Buffer> newBuffer;
+    ComPtr<ID3D11Buffer> newPositionBuffer;
+    if (!CreateBuffer(stream, newCapacity, stream.Stride, newBuffer) ||
+        (stream.PositionBuffer && !CreateBuffer(stream, newCapacity, GEOMETRY_POSITION_STRIDE, newPositionBuffer)))
+        return false;
+
+    std::vector<GeometryAllocator::Move> moves;
+    stream.Allocator.Defragment(moves);
+    stream.Allocator.Grow(newCapacity);
+
+    CopyRanges(newBuffer.Get(), stream.Buffer.Get(), stream.Stride, moves);
+    stream.Buffer = newBuffer;
+    if (stream.PositionBuffer)
+    {
+        CopyRanges(newPositionBuffer.Get(), stream.PositionBuffer.Get(), GEOMETRY_POSITION_STRIDE, moves);
+        stream.PositionBuffer = newPositionBuffer;
+    }
+    return true;
+}
+
+void GeometryPool::CopyRanges(ID3D11Buffer* destination, ID3D11Buffer* source, unsigned int stride, const std::vector<GeometryAllocator::Move>& moves)
+{
+    // Copying into a fresh buffer means packed ranges never overlap
+    // the ones they came from
+    for (const GeometryAllocator::Move& move : moves)
+    {
+        D3D11_BOX box = {};
+        box.left = move.From * stride;
+        box.right = (move.From + move.Count) * stride;
+        box.bottom = 1;
+        box.back = 1;
+        context->CopySubresourceRegion(destination, 0, move.To * stride, 0, 0, source, 0, &box);
+    }
+}
+
+void GeometryPool::Upload(ID3D11Buffer* buffer, unsigned int stride, unsigned int offset, unsigned int count, const void* data)
+{
+    if (count == 0)
+        return;
+
+    D3D11_BOX box = {};
+    box.left = offset * stride;
+    box.right = (offset + count) * stride;
+    box.bottom = 1;
+    box.back = 1;
+    context->UpdateSubresource(buffer, 0, &box, data, 0, 0);
+}
+
+void GeometryPool::SetBuffers(RenderStateCache& state, bool positionOnly)
+{
+    if (positionOnly && vertices.PositionBuffer)
+        state.IASetVertexBuffer(0, vertices.PositionBuffer.Get(), GEOMETRY_POSITION_STRIDE, 0);
+    else
+        state.IASetVertexBuffer(0, vertices.Buffer.Get(), vertices.Stride, 0);
+    state.IASetIndexBuffer(indices.Buffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void GeometryPool::PrintStats()
+{
+    printf("Geometry pool: %u / %u vertices (%u free ranges), %u / %u indices (%u free ranges)\n",
+        vertices.Allocator.GetUsed(), vertices.Allocator.GetCapacity(), vertices.Allocator.GetFreeRangeCount(),
+        indices.Allocator.GetUsed(), indices.Allocator.GetCapacity(), indices.Allocator.GetFreeRangeCount());
+    if (vertices.PositionBuffer)
+        printf("  Positions also kept in their own stream for depth-only passes (%u bytes per vertex instead of %u)\n",
+            GEOMETRY_POSITION_STRIDE, vertices.Stride);
+    printf("  Repacked in place %u / %u times, moved to bigger buffers %u / %u times (vertices / indices)\n",
+        vertices.Defragments, indices.Defragments, vertices.Grows, indices.Grows);
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "GeometryAllocator.h"
+#include "RenderStateCache.h"
+#include <vector>
+
+// Where one mesh's vertices and indices live in a pool
+struct GeometryPoolEntry
+{
+    unsigned int VertexAllocation = GEOMETRY_ALLOCATION_NONE;
+    unsigned int IndexAllocation = GEOMETRY_ALLOCATION_NONE;
+};
+
+// --------------------------------------------------------
+// One large vertex buffer and one large index buffer shared
+// by every mesh with the same vertex format.
+//
+// Meshes are drawn with their start index and base vertex,
+// so the input assembler buffers stay bound from one mesh
+// to the next and the state cache drops the rebinds.
+//
+// Optionally, the positions are also kept in a stream of
+// their own, so depth-only passes can fetch 12 bytes per
+// vertex instead of the whole vertex. Positions have to be
+// the first member of the vertex format for this.
+//
+// When a mesh doesn't fit, the pool first packs what it
+// has together and, if that isn't enough, moves everything
+// into bigger buffers. Either way offsets change, so ask
+// for them at draw time rather than keeping them.
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+    GeometryPool(
+        Microsoft::WRL::ComPtr<ID3D11Device> device,
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+        unsigned int vertexStride,
+        unsigned int vertexCapacity,
+        unsigned int indexCapacity,
+        bool positionStream);
+    ~GeometryPool();
+
+    // Copies the geometry into the pool - returns false if the
+    // buffers couldn't be made big enough
+    bool Add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, GeometryPoolEntry& entry);
+    void Remove(GeometryPoolEntry& entry);
+
+    unsigned int GetBaseVertex(const GeometryPoolEntry& entry) { return vertices.Allocator.GetOffset(entry.VertexAllocation); }
+    unsigned int GetStartIndex(const GeometryPoolEntry& entry) { return indices.Allocator.GetOffset(entry.IndexAllocation); }
+
+    // Binds the shared buffers to input slot 0 and the index buffer.
+    // Position-only binds just the positions, if the pool has them -
+    // otherwise the whole vertex, which starts with the position anyway.
+    void SetBuffers(RenderStateCache& state, bool positionOnly = false);
+    bool HasPositionStream() { return vertices.PositionBuffer.Get() != 0; }
+
+    ID3D11DeviceContext* GetContext() { return context.Get(); }
+    Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vertices.Buffer; }
+    Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return indices.Buffer; }
+
+    // Sizes in elements, and how often the buffers were repacked
+    // in place or moved into bigger ones
+    void PrintStats();
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+    struct Stream
+    {
+        GeometryAllocator Allocator;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> PositionBuffer;   // Vertices only, when there's a position stream
+        unsigned int Stride;
+        unsigned int BindFlags;
+        unsigned int Defragments = 0;
+        unsigned int Grows = 0;
+
+        Stream(unsigned int capacity, unsigned int stride, unsigned int bindFlags) :
+            Allocator(capacity), Stride(stride), BindFlags(bindFlags) {}
+    };
+    Stream vertices;
+    Stream indices;
+
+    bool CreateBuffer(Stream& stream, unsigned int capacity, unsigned int stride, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer);
+    void CopyRanges(ID3D11Buffer* destination, ID3D11Buffer* source, unsigned int stride, const std::vector<GeometryAllocator::Move>& moves);
+    unsigned int Allocate(Stream& stream, unsigned int count);
+    bool Repack(Stream& stream, unsigned int newCapacity);
+    void Upload(ID3D11Buffer* buffer, unsigned int stride, unsigned int offset, unsigned int count, const void* data);
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "InstanceSlots.h"
+#include "RenderStateCache.h"
+
+// Past this many separate runs of changed instances it's cheaper
+// to upload everything from the first to the last in one go
+#define INSTANCE_BUFFER_MAX_RANGES  64
+
+// --------------------------------------------------------
+// A vertex buffer of per-instance data of type T that stays
+// around from frame to frame, so instances that haven't
+// changed don't have to be uploaded again.
+//
+// Each frame: Begin(), Add() every instance in drawing order
+// and fill in whatever Add() hands back, then Upload() once
+// before drawing. The buffer grows as needed.
+// --------------------------------------------------------
+template<typename T>
+class InstanceBuffer
+{
+public:
+    void Create(Microsoft::WRL::ComPtr<ID3D11Device> device)
+    {
+        this->device = device;
+    }
+
+    void Begin()
+    {
+        slots.Begin();
+    }
+
+    // Takes the next slot for an instance. Returns where to write its
+    // data, or null if the slot already holds this version of it.
+    T* Add(const void* instance, unsigned int version, unsigned int& slot)
+    {
+        bool dirty = slots.Add(instance, version, slot);
+        if (slot >= data.size())
+            data.resize(slot + 1);
+
+        return dirty ? &data[slot] : 0;
+    }
+
+    void Upload(ID3D11DeviceContext* context)
+    {
+        unsigned int count = slots.GetCount();
+        if (count == 0)
+            return;
+
+        // A new buffer starts out empty, so everything goes up
+        if (count > capacity)
+        {
+            capacity = count > capacity * 2 ? count : capacity * 2;
+
+            D3D11_BUFFER_DESC desc = {};
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            desc.ByteWidth = sizeof(T) * capacity;
+            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf());
+
+            UploadRange(context, 0, count);
+            return;
+        }
+
+        auto& ranges = slots.GetDirtyRanges();
+        if (ranges.size() > INSTANCE_BUFFER_MAX_RANGES)
+        {
+            UploadRange(context, ranges.front().First, ranges.back().First + ranges.back().Count - ranges.front().First);
+            return;
+        }
+
+        for (auto& range : ranges)
+            UploadRange(context, range.First, range.Count);
+    }
+
+    void Bind(RenderStateCache& state, unsigned int inputSlot)
+    {
+        state.IASetVertexBuffer(inputSlot, buffer.Get(), sizeof(T), 0);
+    }
+
+    // Instances sent to the GPU since the last ResetStats()
+    unsigned int GetUploadedCount() { return uploadedCount; }
+    void ResetStats() { uploadedCount = 0; }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+    unsigned int capacity = 0;
+
+    InstanceSlots slots;
+    std::vector<T> data;
+    unsigned int uploadedCount = 0;
+
+    void UploadRange(ID3D11DeviceContext* context, unsigned int first, unsigned int count)
+    {
+        D3D11_BOX box = {};
+        box.left = sizeof(T) * first;
+        box.right = sizeof(T) * (first + count);
+        box.bottom = 1;
+        box.back = 1;
+        context->UpdateSubresource(buffer.Get(), 0, &box, &data[first], 0, 0);
+        uploadedCount += count;
+    }
+};
@@ -0,0 +1,44 @@
+#include "InstanceSlots.h"
+
+InstanceSlots::InstanceSlots() :
+    count(0),
+    dirtyCount(0)
+{
+}
+
+InstanceSlots::~InstanceSlots()
+{
+}
+
+void InstanceSlots::Begin()
+{
+    count = 0;
+    dirtyCount = 0;
+    dirtyRanges.clear();
+}
+
+bool InstanceSlots::Add(const void* instance, unsigned int version, unsigned int& slot)
+{
+    slot = count++;
+
+    if (slot < slots.size() &&
+        slots[slot].Instance == instance &&
+        slots[slot].Version == version)
+    {
+        return false;
+    }
+
+    if (slot < slots.size())
+        slots[slot] = { instance, version };
+    else
+        slots.push_back({ instance, version });
+
+    // Extend the last run if this slot follows right after it
+    if (!dirtyRanges.empty() && dirtyRanges.back().First + dirtyRanges.back().Count == slot)
+        dirtyRanges.back().Count++;
+    else
+        dirtyRanges.push_back({ slot, 1 });
+
+    dirtyCount++;
+    return true;
+}
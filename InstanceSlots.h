@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+
+// A run of instance slots whose data has to be uploaded
+struct InstanceSlotRange
+{
+    unsigned int First;
+    unsigned int Count;
+};
+
+// --------------------------------------------------------
+// Works out which slots of an instance buffer need new data.
+//
+// Every frame the instances are added in drawing order, each
+// taking the next slot. A slot only needs uploading if it
+// now holds a different instance than last frame, or the
+// same instance at a newer version (its transform moved).
+// As long as the drawing order stays put, only the
+// instances that actually changed are uploaded.
+// --------------------------------------------------------
+class InstanceSlots
+{
+public:
+    InstanceSlots();
+    ~InstanceSlots();
+
+    // Starts laying out a new frame
+    void Begin();
+
+    // Takes the next slot for an instance. Returns true if the
+    // slot's data has to be written this frame.
+    bool Add(const void* instance, unsigned int version, unsigned int& slot);
+
+    // Slots that were written since Begin(), merged into runs
+    const std::vector<InstanceSlotRange>& GetDirtyRanges() { return dirtyRanges; }
+
+    unsigned int GetCount() { return count; }
+    unsigned int GetDirtyCount() { return dirtyCount; }
+
+private:
+    struct Slot
+    {
+        const void* Instance;
+        unsigned int Version;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<InstanceSlotRange> dirtyRanges;
+    unsigned int count;
+    unsigned int dirtyCount;
+};
@@ -0,0 +1,201 @@
+#include "LightClusters.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+LightClusterGrid::LightClusterGrid() :
+    tanHalfFovX(1),
+    tanHalfFovY(1),
+    nearClip(0.01f),
+    farClip(100.0f),
+    depthSliceScale(0),
+    depthSliceBias(0),
+    globalLightCount(0)
+{
+    unsigned int clusterCount = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+    clusterMin.resize(clusterCount);
+    clusterMax.resize(clusterCount);
+    clusterRanges.resize(clusterCount);
+}
+
+LightClusterGrid::~LightClusterGrid()
+{
+}
+
+void LightClusterGrid::UpdateFrustum(float fov, float aspectRatio, float nearClip, float farClip)
+{
+    this->nearClip = nearClip;
+    this->farClip = farClip;
+    tanHalfFovY = std::tan(fov / 2);
+    tanHalfFovX = tanHalfFovY * aspectRatio;
+
+    // Exponential slicing keeps clusters roughly cube shaped, so
+    // slice = log(z / near) / log(far / near) * sliceCount
+    float logDepthRange = std::log(farClip / nearClip);
+    depthSliceScale = CLUSTER_COUNT_Z / logDepthRange;
+    depthSliceBias = -CLUSTER_COUNT_Z * std::log(nearClip) / logDepthRange;
+
+    // Build the view-space AABB of every cluster. View-space x and y
+    // are linear in depth, so the extremes are always at the corners.
+    for (unsigned int z = 0; z < CLUSTER_COUNT_Z; z++)
+    {
+        float zNear = GetSliceDepth(z);
+        float zFar = GetSliceDepth(z + 1);
+
+        for (unsigned int y = 0; y < CLUSTER_COUNT_Y; y++)
+        {
+            // Tile rows start at the top of the screen
+            float ndcTop = 1.0f - 2.0f * y / CLUSTER_COUNT_Y;
+            float ndcBottom = ndcTop - 2.0f / CLUSTER_COUNT_Y;
+
+            for (unsigned int x = 0; x < CLUSTER_COUNT_X; x++)
+            {
+                float ndcLeft = -1.0f + 2.0f * x / CLUSTER_COUNT_X;
+                float ndcRight = ndcLeft + 2.0f / CLUSTER_COUNT_X;
+
+                float left = std::min(ndcLeft * zNear, ndcLeft * zFar) * tanHalfFovX;
+                float right = std::max(ndcRight * zNear, ndcRight * zFar) * tanHalfFovX;
+                float bottom = std::min(ndcBottom * zNear, ndcBottom * zFar) * tanHalfFovY;
+                float top = std::max(ndcTop * zNear, ndcTop * zFar) * tanHalfFovY;
+
+                unsigned int index = GetClusterIndex(x, y, z);
+                clusterMin[index] = XMFLOAT4(left, bottom, zNear, 0);
+                clusterMax[index] = XMFLOAT4(right, top, zFar, 0);
+            }
+        }
+    }
+}
+
+void LightClusterGrid::AssignLights(const Light* lights, unsigned int lightCount, const DirectX::XMFLOAT4X4& view)
+{
+    XMMATRIX viewMat = XMLoadFloat4x4(&view);
+
+    globalLightCount = 0;
+    lightIndices.clear();
+    pairClusters.clear();
+    pairLights.clear();
+
+    for (unsigned int i = 0; i < lightCount; i++)
+    {
+        const Light& light = lights[i];
+
+        // Directional lights hit everything, so they go at the
+        // front of the index list instead of into clusters
+        if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+        {
+            lightIndices.push_back(i);
+            globalLightCount++;
+            continue;
+        }
+
+        // Point and spot lights are both bounded by a sphere of their range
+        XMVECTOR center = XMVector3Transform(XMLoadFloat3(&light.Position), viewMat);
+        float radius = light.Range;
+        float cx = XMVectorGetX(center);
+        float cy = XMVectorGetY(center);
+        float cz = XMVectorGetZ(center);
+
+        // Completely in front of the near plane or beyond the far plane?
+        if (cz + radius < nearClip || cz - radius > farClip)
+            continue;
+
+        float zMin = std::max(cz - radius, nearClip);
+        float zMax = std::min(cz + radius, farClip);
+        int z0 = GetDepthSlice(zMin);
+        int z1 = GetDepthSlice(zMax);
+
+        // Project the corners of the sphere's view-space box to find
+        // a conservative range of screen tiles
+        float ndcMinX = std::min(
+            std::min((cx - radius) / zMin, (cx - radius) / zMax),
+            std::min((cx + radius) / zMin, (cx + radius) / zMax)) / tanHalfFovX;
+        float ndcMaxX = std::max(
+            std::max((cx - radius) / zMin, (cx - radius) / zMax),
+            std::max((cx + radius) / zMin, (cx + radius) / zMax)) / tanHalfFovX;
+        float ndcMinY = std::min(
+            std::min((cy - radius) / zMin, (cy - radius) / zMax),
+            std::min((cy + radius) / zMin, (cy + radius) / zMax)) / tanHalfFovY;
+        float ndcMaxY = std::max(
+            std::max((cy - radius) / zMin, (cy - radius) / zMax),
+            std::max((cy + radius) / zMin, (cy + radius) / zMax)) / tanHalfFovY;
+
+        // Off screen entirely?
+        if (ndcMaxX < -1 || ndcMinX > 1 || ndcMaxY < -1 || ndcMinY > 1)
+            continue;
+
+        int x0 = std::max((int)std::floor((ndcMinX + 1) * 0.5f * CLUSTER_COUNT_X), 0);
+        int x1 = std::min((int)std::floor((ndcMaxX + 1) * 0.5f * CLUSTER_COUNT_X), CLUSTER_COUNT_X - 1);
+        int y0 = std::max((int)std::floor((1 - ndcMaxY) * 0.5f * CLUSTER_COUNT_Y), 0);
+        int y1 = std::min((int)std::floor((1 - ndcMinY) * 0.5f * CLUSTER_COUNT_Y), CLUSTER_COUNT_Y - 1);
+
+        // Sphere vs. cluster AABB on the candidate clusters
+        XMVECTOR radiusSq = XMVectorReplicate(radius * radius);
+        for (int z = z0; z <= z1; z++)
+        {
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    unsigned int index = GetClusterIndex(x, y, z);
+                    XMVECTOR closest = XMVectorClamp(
+                        center,
+                        XMLoadFloat4(&clusterMin[index]),
+                        XMLoadFloat4(&clusterMax[index]));
+
+                    XMVECTOR distSq = XMVector3LengthSq(XMVectorSubtract(center, closest));
+                    if (XMVector3LessOrEqual(distSq, radiusSq))
+                    {
+                        pairClusters.push_back(index);
+                        pairLights.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+
+    // Counting sort of the pairs by cluster
+    for (auto& range : clusterRanges)
+    {
+        range.Offset = 0;
+        range.Count = 0;
+    }
+
+    for (auto cluster : pairClusters)
+        clusterRanges[cluster].Count++;
+
+    unsigned int offset = globalLightCount;
+    for (auto& range : clusterRanges)
+    {
+        range.Offset = offset;
+        offset += range.Count;
+        range.Count = 0; // Refilled below
+    }
+
+    lightIndices.resize(offset);
+    for (size_t p = 0; p < pairClusters.size(); p++)
+    {
+        ClusterRange& range = clusterRanges[pairClusters[p]];
+        lightIndices[range.Offset + range.Count] = pairLights[p];
+        range.Count++;
+    }
+}
+
+unsigned int LightClusterGrid::GetClusterIndex(unsigned int x, unsigned int y, unsigned int z)
+{
+    return x + y * CLUSTER_COUNT_X + z * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+}
+
+int LightClusterGrid::GetDepthSlice(float viewDepth)
+{
+    if (viewDepth <= nearClip)
+        return 0;
+
+    int slice = (int)std::floor(std::log(viewDepth) * depthSliceScale + depthSliceBias);
+    return std::min(std::max(slice, 0), CLUSTER_COUNT_Z - 1);
+}
+
+float LightClusterGrid::GetSliceDepth(int slice)
+{
+    return nearClip * std::pow(farClip / nearClip, (float)slice / CLUSTER_COUNT_Z);
+}
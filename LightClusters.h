@@ -0,0 +1,86 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+
+// Dimensions of the froxel grid - these must match the
+// CLUSTER_COUNT_[X] defines in ShaderIncludes.hlsli
+#define CLUSTER_COUNT_X     16
+#define CLUSTER_COUNT_Y     9
+#define CLUSTER_COUNT_Z     24
+
+// Where a single cluster's lights live in the light index list.
+// Matches the uint2 elements of the LightClusters buffer in the shader.
+struct ClusterRange
+{
+    unsigned int Offset;
+    unsigned int Count;
+};
+
+// --------------------------------------------------------
+// Bins point and spot lights into a 3D grid of view-space
+// froxels (screen tiles split into exponential depth slices).
+//
+// This is entirely CPU-side and does not touch Direct3D, so it
+// can be driven headless with any view/projection setup.
+//
+// Output layout of the light index list:
+//  - The first GetGlobalLightCount() entries are the lights that
+//    affect every pixel (directional lights)
+//  - After that, each cluster's lights are stored contiguously
+//    at ClusterRange::Offset
+// --------------------------------------------------------
+class LightClusterGrid
+{
+public:
+    LightClusterGrid();
+    ~LightClusterGrid();
+
+    // Rebuilds the view-space bounds of every cluster. Only needs to
+    // happen when the camera's projection changes.
+    void UpdateFrustum(float fov, float aspectRatio, float nearClip, float farClip);
+
+    // Assigns the given lights to clusters using the camera's view matrix
+    void AssignLights(const Light* lights, unsigned int lightCount, const DirectX::XMFLOAT4X4& view);
+
+    // Results of the last AssignLights() call
+    const std::vector<ClusterRange>& GetClusterRanges() { return clusterRanges; }
+    const std::vector<unsigned int>& GetLightIndices() { return lightIndices; }
+    unsigned int GetGlobalLightCount() { return globalLightCount; }
+
+    // Constants the pixel shader needs to find its cluster:
+    // slice = log(viewDepth) * scale + bias
+    float GetDepthSliceScale() { return depthSliceScale; }
+    float GetDepthSliceBias() { return depthSliceBias; }
+
+    // Helpers for locating clusters
+    static unsigned int GetClusterIndex(unsigned int x, unsigned int y, unsigned int z);
+    int GetDepthSlice(float viewDepth);
+
+private:
+    // Projection the cluster bounds were built from
+    float tanHalfFovX;
+    float tanHalfFovY;
+    float nearClip;
+    float farClip;
+
+    float depthSliceScale;
+    float depthSliceBias;
+
+    // View-space AABB of every cluster (w is unused)
+    std::vector<DirectX::XMFLOAT4> clusterMin;
+    std::vector<DirectX::XMFLOAT4> clusterMax;
+
+    // Final output
+    std::vector<ClusterRange> clusterRanges;
+    std::vector<unsigned int> lightIndices;
+    unsigned int globalLightCount;
+
+    // Scratch lists of (cluster, light) pairs, kept around
+    // between frames so binning doesn't allocate
+    std::vector<unsigned int> pairClusters;
+    std::vector<unsigned int> pairLights;
+
+    // Depth of the near plane of the given slice
+    float GetSliceDepth(int slice);
+};
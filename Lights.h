@@ -5,6 +5,9 @@
 #define LIGHT_TYPE_POINT			1
 #define LIGHT_TYPE_SPOT				2
 
+// Size of the shadow view buffer - cascades count as one view each
+#define MAX_SHADOW_VIEWS			64
+
 struct Light 
 {
 	int Type;						// Which kind of light? LIGHT_TYPE_[X]
@@ -15,7 +18,8 @@ struct Light
 	DirectX::XMFLOAT3 Color;		// All need a color
 	float SpotFalloff;				// Spot needs value to restrict cone
 	int ShadowCasting;				// Whether the light should cast shadows
-	DirectX::XMFLOAT2 Padding;		// Padding to hit 16-byte boundary
+	int ShadowIndex;				// First ShadowView in the atlas, -1 if none (set by Game)
+	float Padding;					// Padding to hit 16-byte boundary
 
 	// Creates a directional light with the given parameters
 	Light(
@@ -31,6 +35,7 @@ struct Light
 		Color(color),
 		SpotFalloff(),
 		ShadowCasting(shadowCasting),
+		ShadowIndex(-1),
 		Padding()
 	{
 	}
@@ -48,7 +53,39 @@ struct Light
 		Intensity(intensity),
 		Color(color),
 		SpotFalloff(),
+		ShadowCasting(),
+		ShadowIndex(-1),
 		Padding()
 	{
 	}
-};
\ No newline at end of file
+
+	// Creates a spot light with the given parameters
+	Light(
+		DirectX::XMFLOAT3 position,
+		DirectX::XMFLOAT3 direction,
+		DirectX::XMFLOAT3 color,
+		float range,
+		float intensity,
+		float spotFalloff,
+		int shadowCasting = 0) :
+		Type(LIGHT_TYPE_SPOT),
+		Direction(direction),
+		Range(range),
+		Position(position),
+		Intensity(intensity),
+		Color(color),
+		SpotFalloff(spotFalloff),
+		ShadowCasting(shadowCasting),
+		ShadowIndex(-1),
+		Padding()
+	{
+	}
+};
+// Where a single shadow view lives in the shadow atlas.
+// Matches the ShadowView struct in ShaderIncludes.hlsli.
+struct ShadowView
+{
+	DirectX::XMFLOAT4X4 ViewProjection;
+	DirectX::XMFLOAT4 AtlasRect;	// UV offset (xy) and scale (zw) of the tile, zero if it has none
+	DirectX::XMFLOAT4 AtlasBounds;	// Min (xy) and max (zw) UVs that keep filtering inside the tile
+};
@@ -0,0 +1,7 @@
+// Lit pixel shader variant - see LitPixelShader.hlsli
+// Normal mapping, sky reflections and shadows, with any number of directional lights
+#define FEATURE_NORMAL_MAP    1
+#define FEATURE_REFLECTION    1
+#define FEATURE_SHADOWS       1
+#define LIGHT_BUCKET          LIGHT_BUCKET_ANY
+#include "LitPixelShader.hlsli"
\ No newline at end of file
@@ -0,0 +1,7 @@
+// Lit pixel shader variant - see LitPixelShader.hlsli
+// Normal mapping and shadows, with up to LIGHT_BUCKET_FEW_MAX directional lights
+#define FEATURE_NORMAL_MAP    1
+#define FEATURE_REFLECTION    0
+#define FEATURE_SHADOWS       1
+#define LIGHT_BUCKET          LIGHT_BUCKET_FEW
+#include "LitPixelShader.hlsli"
\ No newline at end of file
@@ -0,0 +1,242 @@
+#ifndef __GGP_LIT_PIXEL_SHADER__
+#define __GGP_LIT_PIXEL_SHADER__
+
+// --------------------------------------------------------
+// Uber source for the lit pixel shaders.  Each variant is a
+// LitPS_[X].hlsl file that sets the keywords below and then
+// includes this - see ShaderVariants.h for the naming and how
+// a material's variant is picked.
+//
+// Anything a variant doesn't have is compiled out entirely,
+// so its pixels don't pay for it.
+// --------------------------------------------------------
+
+// Feature keywords - match SHADER_FEATURE_[X] in ShaderVariants.h
+#ifndef FEATURE_NORMAL_MAP
+#define FEATURE_NORMAL_MAP      0
+#endif
+#ifndef FEATURE_REFLECTION
+#define FEATURE_REFLECTION      0
+#endif
+#ifndef FEATURE_SHADOWS
+#define FEATURE_SHADOWS         0
+#endif
+
+// Directional light slots - match ShaderLightBucket
+#define LIGHT_BUCKET_NONE       0
+#define LIGHT_BUCKET_ONE        1
+#define LIGHT_BUCKET_FEW        2
+#define LIGHT_BUCKET_ANY        3
+#define LIGHT_BUCKET_FEW_MAX    4
+#ifndef LIGHT_BUCKET
+#define LIGHT_BUCKET            LIGHT_BUCKET_ANY
+#endif
+
+// How many directional lights the unrolled loop has room for
+#if LIGHT_BUCKET == LIGHT_BUCKET_ONE
+#define LIGHT_SLOTS             1
+#elif LIGHT_BUCKET == LIGHT_BUCKET_FEW
+#define LIGHT_SLOTS             LIGHT_BUCKET_FEW_MAX
+#endif
+
+#include "ShaderIncludes.hlsli"
+#include "ConstantBuffers.hlsli"
+
+Texture2D Albedo        	: register(t0);
+#if FEATURE_NORMAL_MAP
+Texture2D NormalMap 		: register(t1);
+#endif
+Texture2D RoughnessMap		: register(t2);
+Texture2D MetalnessMap		: register(t3);
+#if FEATURE_REFLECTION
+TextureCube SkyTexture      : register(t4);
+#endif
+#if FEATURE_SHADOWS
+Texture2D ShadowMap         : register(t5); // Atlas shared by every shadow view
+#endif
+SamplerState BasicSampler	: register(s0);
+#if FEATURE_SHADOWS
+SamplerComparisonState  ShadowSampler  : register(s1);
+#endif
+
+// Clustered lights - see LightClusters.h for the layout
+StructuredBuffer<Light> Lights          : register(t6);
+StructuredBuffer<uint2> LightClusters   : register(t7); // Offset, count
+StructuredBuffer<uint> LightIndices     : register(t8);
+
+#if FEATURE_SHADOWS
+// Where each shadowed light's view lives in the ShadowMap atlas
+StructuredBuffer<ShadowView> ShadowViews : register(t9);
+
+// --------------------------------------------------------
+// Samples a single view of the shadow atlas - 0 is fully
+// shadowed and 1 is fully lit
+// --------------------------------------------------------
+float SampleShadowAtlas(int viewIndex, float3 worldPosition)
+{
+    ShadowView view = ShadowViews[viewIndex];
+
+    // Views that didn't fit in the atlas are unshadowed
+    if (view.AtlasRect.z <= 0.0f)
+        return 1.0f;
+
+    float4 shadowMapPosition = mul(view.ViewProjection, float4(worldPosition, 1.0f));
+    if (shadowMapPosition.w <= 0.0f)
+        return 1.0f;
+
+    // Distance from light
+    float lightDepth = shadowMapPosition.z / shadowMapPosition.w;
+
+    // Adjust -1 to 1 to 0 to 1
+    float2 shadowUV = shadowMapPosition.xy / shadowMapPosition.w * 0.5f + 0.5f;
+    shadowUV.y = 1.0f - shadowUV.y; // Flip for sampling
+
+    // Anything outside of this view's tile belongs to another view
+    if (any(shadowUV < 0.0f) || any(shadowUV > 1.0f))
+        return 1.0f;
+
+    float2 atlasUV = clamp(view.AtlasRect.xy + shadowUV * view.AtlasRect.zw, view.AtlasBounds.xy, view.AtlasBounds.zw);
+    return ShadowMap.SampleCmpLevelZero(ShadowSampler, atlasUV, lightDepth);
+}
+#endif
+
+// --------------------------------------------------------
+// The entry point (main method) for our pixel shader
+// 
+// - Input is the data coming down the pipeline (defined by the struct)
+// - Output is a single color (float4)
+// - Has a special semantic (SV_TARGET), which means 
+//    "put the output of this into the current render target"
+// - Named "main" because that's the default the shader compiler looks for
+// --------------------------------------------------------
+float4 main(VertexToPixel_NormalMapShadowMap input) : SV_TARGET
+{
+    // Distance along the camera's view, for the light clusters
+    // and the shadow cascades
+    float viewDepth = dot(input.worldPosition - cameraPos, cameraForward);
+
+#if FEATURE_SHADOWS
+    //
+    // SHADOWING
+    //
+
+    // Pick the first cascade that reaches past this pixel
+    int cascade = 0;
+    [unroll]
+    for (int c = 0; c < MAX_SHADOW_CASCADES - 1; c++)
+    {
+        cascade += (viewDepth > cascadeSplits[c]) ? 1 : 0;
+    }
+    cascade = min(cascade, cascadeCount - 1);
+#endif
+
+    // Scale UV
+    input.uv = float2(input.uv.x * uvScale.x + uvOffset.x, input.uv.y * uvScale.y + uvOffset.y);
+
+    //
+    // NORMAL SAMPLING
+    // 
+
+    // Make sure input normal is normalized before using it for anything
+    input.normal = normalize(input.normal);
+
+#if FEATURE_NORMAL_MAP
+    input.tangent = normalize(input.tangent);
+    input.tangent = normalize(input.tangent - input.normal * dot(input.tangent, input.normal)); // Gram-Schmidt assumes T&N are normalized!
+    float3 B = cross(input.tangent, input.normal);
+    float3x3 TBN = float3x3(input.tangent, B, input.normal);
+
+    float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2.0f - 1.0f;
+    input.normal = mul(unpackedNormal, TBN);
+#endif
+
+    //
+    // ALBEDO SAMPLING
+    //
+
+    // Get surface color and roughness from texture
+    float3 surfaceColor = Albedo.Sample(BasicSampler, input.uv).rgb;
+    // Texture needs to be reverse-gamma-corrected since gamma correction happens later
+    surfaceColor = pow(surfaceColor, 2.2f);
+    surfaceColor *= colorTint * input.instanceTint;
+
+    //
+    // METALNESS/ROUGHNESS SAMPLING
+    //
+
+    float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
+    float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+
+    // Determine specular color based on metalness
+    float3 specColor = lerp(F0_NON_METAL.rrr, surfaceColor.rgb, metalness);
+
+    //
+    // LIGHT CALCULATIONS
+    //
+
+    // Lights that affect every pixel (directional) are at the front of the index list
+    float3 finalLightResult = (0.0f).rrr;
+#if LIGHT_BUCKET != LIGHT_BUCKET_NONE
+#if LIGHT_BUCKET == LIGHT_BUCKET_ANY
+    for (uint g = 0; g < globalLightCount; g++)
+#else
+    // Only as many slots as the bucket holds, unrolled
+    [unroll]
+    for (uint g = 0; g < LIGHT_SLOTS; g++)
+#endif
+    {
+#ifdef LIGHT_SLOTS
+        if (g >= globalLightCount)
+            break;
+#endif
+        Light light = Lights[LightIndices[g]];
+        float3 dirLightRes = DirLightPBR(light, input.normal, cameraPos, input.worldPosition, roughness, specColor, metalness, surfaceColor);
+#if FEATURE_SHADOWS
+        // Cascaded lights have one shadow view per cascade
+        dirLightRes *= light.ShadowIndex >= 0 ? SampleShadowAtlas(light.ShadowIndex + cascade, input.worldPosition) : 1.0f;
+#endif
+        finalLightResult += dirLightRes;
+    }
+#endif
+
+    // Only loop over the point and spot lights in this pixel's cluster
+    uint2 cluster = LightClusters[GetClusterIndex(input.screenPosition.xy, viewDepth, clusterScreenScale, clusterDepthScale, clusterDepthBias)];
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        Light light = Lights[LightIndices[cluster.x + i]];
+        if (light.Type == LIGHT_TYPE_POINT)
+        {
+            finalLightResult += PointLightPBR(light, input.normal, cameraPos, input.worldPosition, roughness, specColor, metalness, surfaceColor);
+        }
+        if (light.Type == LIGHT_TYPE_SPOT)
+        {
+            float3 spotLightRes = SpotLightPBR(light, input.normal, cameraPos, input.worldPosition, roughness, specColor, metalness, surfaceColor);
+#if FEATURE_SHADOWS
+            spotLightRes *= light.ShadowIndex >= 0 ? SampleShadowAtlas(light.ShadowIndex, input.worldPosition) : 1.0f;
+#endif
+            finalLightResult += spotLightRes;
+        }
+    }
+
+    float3 finalColor = finalLightResult + (surfaceColor.rgb * ambient);
+
+    //
+    // ENVIRONMENT MAP/GAMMA CALCULATIONS
+    //
+
+    // Gamma correct finalColor before lerping between it and the already gamma-correct sky sample
+    finalColor = pow(finalColor, 1.0f / 2.2f);
+
+#if FEATURE_REFLECTION
+    // Take care of skybox reflection
+    float3 dirFromCamera = normalize(input.worldPosition - cameraPos);
+    float3 skySample = SkyTexture.Sample(BasicSampler, reflect(dirFromCamera, input.normal)).rgb;
+
+    // Lerp between surface color up to this point and the sampled sky color based on fresnel term
+    finalColor = lerp(finalColor, skySample, SkyReflectionFresnel(F0_NON_METAL, input.normal, dirFromCamera));
+#endif
+
+    return float4(finalColor, 1);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include "ShaderVariants.h"
+
+// The lit shader variants that are compiled - these must match the
+// LitPS_[X].hlsl and LitVS_[X].hlsl files in the project.  Every
+// feature combination is there for a few directional lights. Any
+// number of them only comes with and without normal mapping, since
+// a material's normal map is the one feature that can't be supplied
+// by a bigger variant (see ShaderVariantSelector::Covers).
+//
+// The everything variant stays last - new lit materials start on it.
+static const ShaderVariantKey litPixelShaderKeys[] =
+{
+    MakeShaderVariantKey(0, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW),
+    MakeShaderVariantKey(SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY),
+    MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY),
+};
+
+static const ShaderVariantKey litVertexShaderKeys[] =
+{
+    MakeShaderVariantKey(0, SHADER_LIGHTS_NONE),
+    MakeShaderVariantKey(SHADER_FEATURE_INSTANCING, SHADER_LIGHTS_NONE),
+};
@@ -0,0 +1,4 @@
+// Lit vertex shader variant - see LitVertexShader.hlsli
+// Per-object matrices from the PerObject constant buffer
+#define FEATURE_INSTANCING      0
+#include "LitVertexShader.hlsli"
\ No newline at end of file
@@ -0,0 +1,4 @@
+// Lit vertex shader variant - see LitVertexShader.hlsli
+// Per-instance matrices from the instance buffer
+#define FEATURE_INSTANCING      1
+#include "LitVertexShader.hlsli"
\ No newline at end of file
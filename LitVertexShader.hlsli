@@ -0,0 +1,81 @@
+#ifndef __GGP_LIT_VERTEX_SHADER__
+#define __GGP_LIT_VERTEX_SHADER__
+
+// --------------------------------------------------------
+// Uber source for the vertex shaders that go with the lit
+// pixel shaders.  Each variant is a LitVS[_X].hlsl file that
+// sets the keywords below and then includes this.
+// --------------------------------------------------------
+
+// Feature keywords - match SHADER_FEATURE_[X] in ShaderVariants.h
+#ifndef FEATURE_INSTANCING
+#define FEATURE_INSTANCING      0
+#endif
+
+#include "ShaderIncludes.hlsli"
+#include "ConstantBuffers.hlsli"
+
+#if FEATURE_INSTANCING
+// --------------------------------------------------------
+// The world matrices and the entity's own parameters come
+// from the instance buffer instead of the per-object
+// constant buffer
+// --------------------------------------------------------
+VertexToPixel_NormalMapShadowMap main(VertexShaderInstanceInput input)
+{
+	VertexToPixel_NormalMapShadowMap output;
+
+	matrix instanceWorld = InstanceMatrix(input.world0, input.world1, input.world2, input.world3);
+	matrix instanceWorldInvTranspose = InstanceMatrix(input.worldInvTranspose0, input.worldInvTranspose1, input.worldInvTranspose2, input.worldInvTranspose3);
+
+	// Precise so the depth prepass (ShadowMapVSInstanced) gets exactly the same depth
+	precise float4 worldPosition = mul(instanceWorld, float4(input.localPosition, 1.0f));
+	precise float4 screenPosition = mul(projection, mul(view, worldPosition));
+	output.screenPosition = screenPosition;
+	output.uv = input.uv * input.uvScaleOffset.xy + input.uvScaleOffset.zw;
+	output.instanceTint = input.colorTint;
+
+	// Normal and tangent need the inverse transpose, same as without instancing
+	output.normal = mul((float3x3)instanceWorldInvTranspose, input.normal);
+	output.tangent = mul((float3x3)instanceWorldInvTranspose, input.tangent);
+	output.worldPosition = worldPosition.xyz;
+
+	return output;
+}
+#else
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// 
+// - Input is exactly one vertex worth of data (defined by a struct)
+// - Output is a single struct of data to pass down the pipeline
+// - Named "main" because that's the default the shader compiler looks for
+// --------------------------------------------------------
+VertexToPixel_NormalMapShadowMap main(VertexShaderInput input)
+{
+	// Set up output struct
+	VertexToPixel_NormalMapShadowMap output;
+
+	// The full world * view * projection was put together on the CPU.
+	// Precise so the depth prepass (ShadowMapVS) gets exactly the same depth.
+	precise float4 screenPosition = mul(worldViewProjection, float4(input.localPosition, 1.0f));
+	output.screenPosition = screenPosition;
+
+	// The entity's own UV transform - the material's comes after it in the pixel shader
+	output.uv = input.uv * instanceUvScale + instanceUvOffset;
+	output.instanceTint = instanceColorTint;
+
+	// Pass the normal and tangent through--need to transform appropriately
+	output.normal = mul((float3x3)worldInvTranspose, input.normal);
+	output.tangent = mul((float3x3)worldInvTranspose, input.tangent);
+
+	// Pass the world position through - the pixel shader uses it
+	// to find its position in the right shadow cascade
+	output.worldPosition = mul(world, float4(input.localPosition, 1.0f)).xyz;
+
+	// Whatever we return will make its way through the pipeline to the
+	// next programmable stage we're using (the pixel shader for now)
+	return output;
+}
+#endif
+
+#endif
\ No newline at end of file
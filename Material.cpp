@@ -1,13 +1,18 @@
 #include "Material.h"
+#include "ShaderVariants.h"
+#include <algorithm>
 
 Material::Material(
+    Microsoft::WRL::ComPtr<ID3D11Device> device,
     DirectX::XMFLOAT4 colorTint,
     std::shared_ptr<SimplePixelShader> pixelShader,
     std::shared_ptr<SimpleVertexShader> vertexShader,
     DirectX::XMFLOAT2 uvScale,
     DirectX::XMFLOAT2 uvOffset)
-    : colorTint(colorTint), pixelShader(pixelShader), vertexShader(vertexShader), uvScale(uvScale), uvOffset(uvOffset)
+    : colorTint(colorTint), pixelShader(pixelShader), vertexShader(vertexShader), uvScale(uvScale), uvOffset(uvOffset), bindingTablesDirty(true)
 {
+    materialBuffer.Create(device.Get());
+    UpdatePixelShaderHandles();
 }
 
 Material::~Material()
@@ -29,6 +34,11 @@ SimpleVertexShader* Material::GetVertexShader()
     return vertexShader.get();
 }
 
+SimpleVertexShader* Material::GetInstancedVertexShader()
+{
+    return instancedVertexShader.get();
+}
+
 DirectX::XMFLOAT2 Material::GetUvScale()
 {
     return uvScale;
@@ -47,6 +57,7 @@ void Material::SetColorTint(DirectX::XMFLOAT4 colorTint)
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> pShader)
 {
     pixelShader = std::shared_ptr<SimplePixelShader>(pShader);
+    UpdatePixelShaderHandles();
 }
 
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vShader)
@@ -54,6 +65,11 @@ void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vShader)
     vertexShader = std::shared_ptr<SimpleVertexShader>(vShader);
 }
 
+void Material::SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vShader)
+{
+    instancedVertexShader = vShader;
+}
+
 void Material::SetUvScale(float u, float v)
 {
     uvScale = { u, v };
@@ -66,35 +82,118 @@ void Material::SetUvOffset(float u, float v)
 
 void Material::AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
-    textureSRVs.insert({ shaderName, srv });
+    // First one added under a name wins
+    for (auto& t : textureSRVs)
+    {
+        if (t.Name == shaderName)
+            return;
+    }
+
+    textureSRVs.push_back({ shaderName, pixelShader->GetShaderResourceViewHandle(shaderName), srv });
+    bindingTablesDirty = true;
 }
 
 void Material::AddSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
-    samplers.insert({ shaderName, sampler });
+    for (auto& s : samplers)
+    {
+        if (s.Name == shaderName)
+            return;
+    }
+
+    samplers.push_back({ shaderName, pixelShader->GetSamplerHandle(shaderName), sampler });
+    bindingTablesDirty = true;
+}
+
+unsigned int Material::GetShaderFeatures()
+{
+    unsigned int features = 0;
+    for (auto& t : textureSRVs)
+    {
+        if (t.Resource)
+            features |= GetShaderFeatureForTexture(t.Name);
+    }
+    return features;
+}
+
+void Material::UpdatePixelShaderHandles()
+{
+    for (auto& t : textureSRVs) { t.Handle = pixelShader->GetShaderResourceViewHandle(t.Name); }
+    for (auto& s : samplers) { s.Handle = pixelShader->GetSamplerHandle(s.Name); }
+    bindingTablesDirty = true;
+}
+
+template<typename T> void Material::BakeBindingTable(
+    const std::vector<BoundResource<T>>& resources,
+    std::vector<BindingRun<T>>& table)
+{
+    // Only resources the shader actually uses, in register order
+    std::vector<const BoundResource<T>*> used;
+    for (auto& r : resources)
+    {
+        if (r.Handle.IsValid())
+            used.push_back(&r);
+    }
+    std::sort(used.begin(), used.end(),
+        [](const BoundResource<T>* a, const BoundResource<T>* b) { return a->Handle.BindIndex < b->Handle.BindIndex; });
+
+    table.clear();
+    for (auto r : used)
+    {
+        // Start a new run unless this register follows the last one
+        if (table.empty() || table.back().FirstSlot + table.back().Resources.size() != r->Handle.BindIndex)
+            table.push_back({ r->Handle.BindIndex, {} });
+
+        table.back().Resources.push_back(r->Resource.Get());
+    }
 }
 
-void Material::PrepareForDraw(Camera& camera, float totalTime, Transform& transform, Camera& lightCamera)
+void Material::PrepareForDraw(RenderStateCache& state)
 {
-    // Set vertex shader data
-    vertexShader->SetShader();
-    vertexShader->SetMatrix4x4("world", transform.GetWorldMatrix());
-    vertexShader->SetMatrix4x4("worldInvTranspose", transform.GetWorldInverseTransposeMatrix());
-    vertexShader->SetMatrix4x4("view", camera.GetView());
-    vertexShader->SetMatrix4x4("projection", camera.GetProjection());
-    vertexShader->SetMatrix4x4("lightProj", lightCamera.GetProjection());
-    vertexShader->SetMatrix4x4("lightView", lightCamera.GetView());
-    vertexShader->CopyAllBufferData();
+    SetShaders(state);
+    BindResources(state);
+}
 
-    // Set pixel shader data
+void Material::SetShaders(RenderStateCache& state, bool instanced)
+{
+    SimpleVertexShader* vs = instanced ? instancedVertexShader.get() : vertexShader.get();
+    vs->SetShader();
+    vs->CopyAllBufferData();
     pixelShader->SetShader();
-    pixelShader->SetFloat4("colorTint", colorTint);
-    pixelShader->SetFloat("totalTime", totalTime);
-    pixelShader->SetFloat3("cameraPos", camera.GetTransform()->GetPosition());
-    pixelShader->SetFloat2("uvScale", uvScale);
-    pixelShader->SetFloat2("uvOffset", uvOffset);
-    // Set up textures
-    for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first, t.second); }
-    for (auto& s : samplers) { pixelShader->SetSamplerState(s.first, s.second); }
     pixelShader->CopyAllBufferData();
 }
+
+void Material::BindResources(RenderStateCache& state)
+{
+    // Per-frame, per-view and per-object data is in the shared
+    // buffers, so this only has to cover the material itself
+    PerMaterialData materialData;
+    materialData.colorTint = colorTint;
+    materialData.uvScale = uvScale;
+    materialData.uvOffset = uvOffset;
+    materialBuffer.Update(state.GetContext(), materialData);
+    materialBuffer.Bind(state, CB_SLOT_PER_MATERIAL);
+
+    BindTextures(state);
+}
+
+void Material::BindTextures(RenderStateCache& state)
+{
+    if (bindingTablesDirty)
+    {
+        BakeBindingTable(textureSRVs, srvTable);
+        BakeBindingTable(samplers, samplerTable);
+        bindingTablesDirty = false;
+    }
+
+    for (auto& run : srvTable)
+        state.SetShaderResources(RENDER_STAGE_PIXEL, run.FirstSlot, (unsigned int)run.Resources.size(), run.Resources.data());
+    for (auto& run : samplerTable)
+        state.SetSamplers(RENDER_STAGE_PIXEL, run.FirstSlot, (unsigned int)run.Resources.size(), run.Resources.data());
+}
+
+void Material::BindTexturesPerSlot(RenderStateCache& state)
+{
+    for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.Handle, t.Resource.Get()); }
+    for (auto& s : samplers) { pixelShader->SetSamplerState(s.Handle, s.Resource.Get()); }
+}
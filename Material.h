@@ -3,14 +3,19 @@
 #include "SimpleShader.h"
 #include <memory>
 #include <d3d11.h>
-#include <unordered_map>
+#include <vector>
+#include <string>
 #include <wrl/client.h>
 #include "Camera.h"
+#include "ConstantBuffer.h"
+#include "BufferStructs.h"
+#include "RenderStateCache.h"
 
 class Material
 {
 public:
     Material(
+        Microsoft::WRL::ComPtr<ID3D11Device> device,
         DirectX::XMFLOAT4 colorTint,
         std::shared_ptr<SimplePixelShader> pixelShader,
         std::shared_ptr<SimpleVertexShader> vertexShader,
@@ -21,19 +26,39 @@ public:
     DirectX::XMFLOAT4* GetColorTint();
     SimplePixelShader* GetPixelShader();
     SimpleVertexShader* GetVertexShader();
+    SimpleVertexShader* GetInstancedVertexShader();
     DirectX::XMFLOAT2 GetUvScale();
     DirectX::XMFLOAT2 GetUvOffset();
 
     void SetColorTint(DirectX::XMFLOAT4 colorTint);
     void SetPixelShader(std::shared_ptr<SimplePixelShader> pShader);
     void SetVertexShader(std::shared_ptr<SimpleVertexShader> vShader);
+    void SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vShader);
     void SetUvScale(float u, float v);
     void SetUvOffset(float u, float v);
 
     void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr <ID3D11ShaderResourceView> srv);
     void AddSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
-    void PrepareForDraw(Camera& camera, float totalTime, Transform& transform, Camera& lightCamera);
+    // SHADER_FEATURE_[X] bits for the textures this material has,
+    // for picking the shader variant it needs
+    unsigned int GetShaderFeatures();
+
+    // Sets the shaders, textures and per-material constant buffer
+    void PrepareForDraw(RenderStateCache& state);
+
+    // The two halves of PrepareForDraw(), for when consecutive draws
+    // share shaders and only the material's own resources change
+    void SetShaders(RenderStateCache& state, bool instanced = false);
+    void BindResources(RenderStateCache& state);
+
+    // Binds the textures and samplers from the baked tables, one call
+    // per run of consecutive registers
+    void BindTextures(RenderStateCache& state);
+
+    // One call per texture and sampler instead - what binding used
+    // to cost, kept around for the benchmark
+    void BindTexturesPerSlot(RenderStateCache& state);
 
 private:
     DirectX::XMFLOAT4 colorTint;
@@ -41,9 +66,38 @@ private:
     DirectX::XMFLOAT2 uvOffset;
     std::shared_ptr<SimplePixelShader> pixelShader;
     std::shared_ptr<SimpleVertexShader> vertexShader;
+    std::shared_ptr<SimpleVertexShader> instancedVertexShader; // Optional, reads world matrices from an instance buffer
+
+    // Resources along with their handles in the current pixel shader
+    template<typename T> struct BoundResource
+    {
+        std::string Name;
+        SimpleShaderResourceHandle Handle;
+        Microsoft::WRL::ComPtr<T> Resource;
+    };
+    std::vector<BoundResource<ID3D11ShaderResourceView>> textureSRVs;
+    std::vector<BoundResource<ID3D11SamplerState>> samplers;
+
+    // The same resources laid out by register, split wherever a
+    // register is skipped so nothing in between gets overwritten.
+    // Baked on first use after the shader or resources change.
+    template<typename T> struct BindingRun
+    {
+        unsigned int FirstSlot;
+        std::vector<T*> Resources;
+    };
+    std::vector<BindingRun<ID3D11ShaderResourceView>> srvTable;
+    std::vector<BindingRun<ID3D11SamplerState>> samplerTable;
+    bool bindingTablesDirty;
+
+    template<typename T> static void BakeBindingTable(
+        const std::vector<BoundResource<T>>& resources,
+        std::vector<BindingRun<T>>& table);
+
+    // Tint and UV parameters, only uploaded when they change
+    ConstantBuffer<PerMaterialData> materialBuffer;
 
-    std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
-    std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+    void UpdatePixelShaderHandles();
 
     // Skybox only needed for some shaders
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySRV;
@@ -0,0 +1,93 @@
+#include "MaterialLibrary.h"
+#include <fstream>
+#include <sstream>
+
+MaterialLibrary::MaterialLibrary()
+{
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+}
+
+bool MaterialLibrary::Load(const std::string& file)
+{
+    entries.clear();
+
+    std::ifstream mtl(file);
+    if (!mtl.is_open())
+        return false;
+
+    // Texture names are relative to the MTL file
+    std::string directory = file.substr(0, file.find_last_of("/\\") + 1);
+
+    std::string line;
+    while (std::getline(mtl, line))
+    {
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword) || keyword[0] == '#')
+            continue;
+
+        if (keyword == "newmtl")
+        {
+            MaterialLibraryEntry entry = {};
+            tokens >> entry.Name;
+            entry.DiffuseColor = DirectX::XMFLOAT4(1, 1, 1, 1);
+            entries.push_back(entry);
+            continue;
+        }
+
+        // Anything before the first newmtl doesn't belong to a material
+        if (entries.empty())
+            continue;
+
+        MaterialLibraryEntry& entry = entries.back();
+        if (keyword == "Kd")
+        {
+            tokens >> entry.DiffuseColor.x >> entry.DiffuseColor.y >> entry.DiffuseColor.z;
+        }
+        else if (keyword == "d")
+        {
+            tokens >> entry.DiffuseColor.w;
+        }
+        else if (keyword == "Tr")
+        {
+            float transparency = 0;
+            tokens >> transparency;
+            entry.DiffuseColor.w = 1 - transparency;
+        }
+        else
+        {
+            std::string* map = 0;
+            if (keyword == "map_Kd")
+                map = &entry.AlbedoMap;
+            else if (keyword == "norm" || keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump")
+                map = &entry.NormalMap;
+            else if (keyword == "map_Pm")
+                map = &entry.MetalnessMap;
+            else if (keyword == "map_Pr")
+                map = &entry.RoughnessMap;
+
+            // The file name is the last thing on the line, after any options
+            std::string token;
+            std::string name;
+            while (map && tokens >> token)
+                name = token;
+            if (map && !name.empty())
+                *map = directory + name;
+        }
+    }
+
+    return true;
+}
+
+const MaterialLibraryEntry* MaterialLibrary::Find(const std::string& name)
+{
+    for (const MaterialLibraryEntry& entry : entries)
+    {
+        if (entry.Name == name)
+            return &entry;
+    }
+    return 0;
+}
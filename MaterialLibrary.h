@@ -0,0 +1,42 @@
+#pragma once
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+// One newmtl block of an MTL file. Texture paths are already
+// joined to the MTL file's directory.
+struct MaterialLibraryEntry
+{
+    std::string Name;
+    DirectX::XMFLOAT4 DiffuseColor;     // Kd, with d (or 1 - Tr) as alpha
+    std::string AlbedoMap;              // map_Kd
+    std::string NormalMap;              // norm, map_Bump or bump
+    std::string MetalnessMap;           // map_Pm, from the PBR extension
+    std::string RoughnessMap;           // map_Pr, from the PBR extension
+};
+
+// --------------------------------------------------------
+// Reads the materials from an MTL file, the material library
+// an OBJ names with mtllib, so each usemtl group of the OBJ
+// can be given a Material of its own.
+//
+// Only what the lit shaders can use is kept - the rest of
+// the file is skipped. Options in front of texture names
+// (-bm 1.0 and the like) are ignored.
+// --------------------------------------------------------
+class MaterialLibrary
+{
+public:
+    MaterialLibrary();
+    ~MaterialLibrary();
+
+    // Returns false if the file couldn't be opened
+    bool Load(const std::string& file);
+
+    // Returns null if the library doesn't have the material
+    const MaterialLibraryEntry* Find(const std::string& name);
+    const std::vector<MaterialLibraryEntry>& GetEntries() { return entries; }
+
+private:
+    std::vector<MaterialLibraryEntry> entries;
+};
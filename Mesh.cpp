@@ -1,6 +1,8 @@
 #include "Mesh.h"
 #include <vector>
 #include <fstream>
+#include <cstring>
+#include <cstdio>
 
 
 
@@ -9,14 +11,13 @@ Mesh::Mesh(
     int _numVerts,
     unsigned int* _indices,
     int _numIndices,
-    Microsoft::WRL::ComPtr<ID3D11Device> _device,
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext)
+    std::shared_ptr<GeometryPool> _pool)
 {
     CalculateTangents(_vertices, _numVerts, _indices, _numIndices);
-    InitializeBuffers(_vertices, _numVerts, _indices, _numIndices, _device, _deviceContext);
+    InitializeBuffers(_vertices, _numVerts, _indices, _numIndices, _pool);
 }
 
-Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext)
+Mesh::Mesh(const char* objFile, std::shared_ptr<GeometryPool> _pool)
 {
     // Author: Chris Cascioli
     // Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
@@ -44,6 +45,11 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
     int vertCounter = 0;			// Count of vertices
     int indexCounter = 0;			// Count of indices
     char chars[100];			// String for line reading
+    SubmeshGrouper groups;			// Which usemtl material each triangle uses
+
+    // Material libraries are named relative to the OBJ
+    std::string objPath(objFile);
+    std::string objDirectory = objPath.substr(0, objPath.find_last_of("/\\") + 1);
 
     // Still have data left?
     while (obj.good())
@@ -52,7 +58,20 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
         obj.getline(chars, 100);
 
         // Check the type of line
-        if (chars[0] == 'v' && chars[1] == 'n')
+        if (strncmp(chars, "mtllib ", 7) == 0)
+        {
+            char name[100];
+            if (sscanf_s(chars, "mtllib %99s", name, (unsigned int)sizeof(name)) == 1)
+                materialLibrary = objDirectory + name;
+        }
+        else if (strncmp(chars, "usemtl ", 7) == 0)
+        {
+            // Groups using the same material end up in one submesh
+            char name[100];
+            if (sscanf_s(chars, "usemtl %99s", name, (unsigned int)sizeof(name)) == 1)
+                groups.UseMaterial(name);
+        }
+        else if (chars[0] == 'v' && chars[1] == 'n')
         {
             // Read the 3 numbers directly into an XMFLOAT3
             DirectX::XMFLOAT3 norm;
@@ -186,6 +205,7 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
             indices.push_back(indexCounter); indexCounter += 1;
             indices.push_back(indexCounter); indexCounter += 1;
             indices.push_back(indexCounter); indexCounter += 1;
+            groups.AddTriangle();
 
             // Was there a 4th face?
             // - 12 numbers read means 4 faces WITH uv's
@@ -213,6 +233,7 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
                 indices.push_back(indexCounter); indexCounter += 1;
                 indices.push_back(indexCounter); indexCounter += 1;
                 indices.push_back(indexCounter); indexCounter += 1;
+                groups.AddTriangle();
             }
         }
     }
@@ -220,6 +241,10 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
     // Close the file and create the actual buffers
     obj.close();
 
+    // Put each material's triangles together, so every submesh is a
+    // single range of the one index buffer
+    groups.Group(indices, submeshes);
+
     // - At this point, "verts" is a vector of Vertex structs, and can be used
     //    directly to create a vertex buffer:  &verts[0] is the address of the first vert
     //
@@ -235,7 +260,7 @@ Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> _device, Mi
 
     CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
 
-    InitializeBuffers(&verts[0], vertCounter, &indices[0], indexCounter, _device, _deviceContext);
+    InitializeBuffers(&verts[0], vertCounter, &indices[0], indexCounter, _pool);
 }
 
 // --------------------------------------------------------
@@ -333,67 +358,49 @@ void Mesh::InitializeBuffers(
     int _numVerts,
     unsigned int* _indices,
     int _numIndices,
-    Microsoft::WRL::ComPtr<ID3D11Device> _device,
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext)
+    std::shared_ptr<GeometryPool> _pool)
 {
-    // Create the VERTEX BUFFER description -----------------------------------
-    // - The description is created on the stack because we only need
-    //    it to create the buffer.  The description is then useless.
-    D3D11_BUFFER_DESC vbd;
-    vbd.Usage = D3D11_USAGE_IMMUTABLE;
-    vbd.ByteWidth = sizeof(Vertex) * _numVerts; // 3 = number of vertices in the buffer
-    vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;   // Tells DirectX this is a vertex buffer
-    vbd.CPUAccessFlags = 0;
-    vbd.MiscFlags = 0;
-    vbd.StructureByteStride = 0;
-
-    // Create the proper struct to hold the initial vertex data
-    // - This is how we put the initial data into the buffer
-    D3D11_SUBRESOURCE_DATA initialVertexData;
-    initialVertexData.pSysMem = _vertices;
-
-    // Actually create the buffer with the initial data
-    // - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-    _device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
-
-    // Create the INDEX BUFFER description ------------------------------------
-    // - The description is created on the stack because we only need
-    //    it to create the buffer.  The description is then useless.
-    D3D11_BUFFER_DESC ibd;
-    ibd.Usage = D3D11_USAGE_IMMUTABLE;
-    ibd.ByteWidth = sizeof(unsigned int) * _numIndices;	// 3 = number of indices in the buffer
-    ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;			// Tells DirectX this is an index buffer
-    ibd.CPUAccessFlags = 0;
-    ibd.MiscFlags = 0;
-    ibd.StructureByteStride = 0;
-
-    // Create the proper struct to hold the initial index data
-    // - This is how we put the initial data into the buffer
-    D3D11_SUBRESOURCE_DATA initialIndexData;
-    initialIndexData.pSysMem = _indices;
-
-    // Actually create the buffer with the initial data
-    // - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-    _device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
-
-    // Assign _numIndices and _deviceContext to their respective 
+    // Copy the vertices and indices into the pool's shared buffers
+    // - Every mesh with this vertex format lives in the same pair of
+    //    buffers, so they stay bound from one mesh to the next
+    // - The indices are still relative to this mesh's first vertex;
+    //    the base vertex is added when drawing
+    pool = _pool;
+    inPool = pool->Add(_vertices, _numVerts, _indices, _numIndices, geometry);
+    if (!inPool)
+        printf("Mesh with %d vertices and %d indices didn't fit in the geometry pool, so it won't be drawn\n", _numVerts, _numIndices);
+
+    // Assign _numIndices and the context to their respective 
     // fields--they will be needed for drawing
     numIndices = _numIndices;
-    deviceContext = _deviceContext;
+    deviceContext = pool->GetContext();
+
+    // Save the bounds for culling
+    DirectX::BoundingSphere::CreateFromPoints(bounds, _numVerts, &_vertices[0].Position, sizeof(Vertex));
+
+    // Meshes made from raw vertices, or OBJs without usemtl, are all one submesh
+    if (submeshes.empty())
+        submeshes.push_back({ "", 0, (unsigned int)_numIndices });
+
+    // Keep the geometry around so it can be merged into static batches
+    vertices.assign(_vertices, _vertices + _numVerts);
+    indices.assign(_indices, _indices + _numIndices);
 }
 
 Mesh::~Mesh()
 {
-    // Since ComPtrs are being used, nothing needs to be done here
+    // Give the space back to the pool
+    if (pool)
+        pool->Remove(geometry);
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
-    return vertexBuffer;
+    return pool->GetVertexBuffer();
 }
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
 {
-    return indexBuffer;
+    return pool->GetIndexBuffer();
 }
 
 int Mesh::GetIndexCount()
@@ -401,19 +408,48 @@ int Mesh::GetIndexCount()
     return numIndices;
 }
 
-void Mesh::Draw()
+unsigned int Mesh::GetBaseVertex()
+{
+    return inPool ? pool->GetBaseVertex(geometry) : 0;
+}
+
+unsigned int Mesh::GetStartIndex()
+{
+    return inPool ? pool->GetStartIndex(geometry) : 0;
+}
+
+DirectX::BoundingSphere Mesh::GetBounds()
+{
+    return bounds;
+}
+
+void Mesh::Draw(RenderStateCache& state, bool positionOnly)
+{
+    SetBuffers(state, positionOnly);
+    DrawIndexed();
+}
+
+void Mesh::SetBuffers(RenderStateCache& state, bool positionOnly)
 {
+    if (!inPool)
+        return;
+
     // Set buffers in the input assembler
     //  - Do this ONCE PER OBJECT you're drawing, since each object might
     //    have different geometry.
     //  - for this demo, this step *could* simply be done once during Init(),
     //    but I'm doing it here because it's often done multiple times per frame
     //    in a larger application/game
-    UINT stride = sizeof(Vertex);
-    UINT offset = 0;
-    deviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-    deviceContext->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+    //  - Every mesh in the pool shares these buffers, so the state
+    //    cache skips them after the first mesh
+    //  - Depth-only shaders get just the positions, a quarter of the bytes
+    pool->SetBuffers(state, positionOnly);
+}
 
+void Mesh::DrawIndexed()
+{
+    if (!inPool)
+        return;
 
     // Finally do the actual drawing
     //  - Do this ONCE PER OBJECT you intend to draw
@@ -421,7 +457,33 @@ void Mesh::Draw()
     //  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
     //     vertices in the currently set VERTEX BUFFER
     deviceContext->DrawIndexed(
-        numIndices, // The number of indices to use (we could draw a subset if we wanted)
-        0,			// Offset to the first index we want to use
-        0);			// Offset to add to each index when looking up vertices
+        numIndices,         // The number of indices to use (we could draw a subset if we wanted)
+        GetStartIndex(),    // Offset to the first index we want to use - where this mesh starts in the pool
+        GetBaseVertex());   // Offset to add to each index when looking up vertices
+}
+
+void Mesh::DrawIndexedInstanced(unsigned int instanceCount, unsigned int firstInstance)
+{
+    if (!inPool)
+        return;
+
+    deviceContext->DrawIndexedInstanced(numIndices, instanceCount, GetStartIndex(), GetBaseVertex(), firstInstance);
+}
+
+void Mesh::DrawSubmesh(unsigned int submesh)
+{
+    if (!inPool)
+        return;
+
+    const MeshSubmesh& range = submeshes[submesh];
+    deviceContext->DrawIndexed(range.IndexCount, GetStartIndex() + range.StartIndex, GetBaseVertex());
+}
+
+void Mesh::DrawSubmeshInstanced(unsigned int submesh, unsigned int instanceCount, unsigned int firstInstance)
+{
+    if (!inPool)
+        return;
+
+    const MeshSubmesh& range = submeshes[submesh];
+    deviceContext->DrawIndexedInstanced(range.IndexCount, instanceCount, GetStartIndex() + range.StartIndex, GetBaseVertex(), firstInstance);
 }
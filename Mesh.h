@@ -1,44 +1,98 @@
 #pragma once
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <DirectXCollision.h>
 #include "Vertex.h"
+#include "RenderStateCache.h"
+#include "GeometryPool.h"
+#include "SubmeshGrouper.h"
+#include <memory>
+#include <string>
+#include <vector>
 
 class Mesh
 {
 public:
-    // Creates a mesh with the given information. This will create a vertex buffer and
-    // an index buffer, and it will save the deviceContext and numIndices for future use.
+    // Creates a mesh with the given information. The vertices and indices are copied
+    // into the pool's shared buffers, and it will save numIndices for future use.
     Mesh(
         Vertex* _vertices, 
         int _numVerts, 
         unsigned int* _indices, 
         int _numIndices, 
-        Microsoft::WRL::ComPtr<ID3D11Device> _device, 
-        Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext);
+        std::shared_ptr<GeometryPool> _pool);
 
-    // Accepts an obj file name and creates a mesh from the file
+    // Accepts an obj file name and creates a mesh from the file, with
+    // a submesh for each material its faces use
     Mesh(
         const char* objFile,
-        Microsoft::WRL::ComPtr<ID3D11Device> _device, 
-        Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext);
+        std::shared_ptr<GeometryPool> _pool);
 
     ~Mesh();
 
-    // Methods to retrieve the otherwise private vertex buffer, index buffer, and index count
+    // Owns a range of the pool, so it can't be copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // Methods to retrieve the pool's shared vertex and index buffers, and this mesh's index count
     Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
     Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
     int GetIndexCount();
 
-    // Handles the drawing of this mesh.
-    void Draw();
+    // Where this mesh starts in the shared buffers - these change
+    // when the pool is repacked, so don't hold on to them
+    //  - A mesh that didn't fit in the pool (or whose OBJ couldn't be
+    //    read) isn't in it at all - these are 0 and its draws do nothing
+    unsigned int GetBaseVertex();
+    unsigned int GetStartIndex();
+
+    // Returns a sphere around all of this mesh's vertices, in local space
+    DirectX::BoundingSphere GetBounds();
+
+    // Every mesh has at least one submesh, and between them they
+    // cover all of its indices, so drawing the whole mesh draws them all
+    unsigned int GetSubmeshCount() { return (unsigned int)submeshes.size(); }
+    const MeshSubmesh& GetSubmesh(unsigned int index) { return submeshes[index]; }
+
+    // The OBJ's mtllib file, joined to the OBJ's own directory, or
+    // empty if it didn't name one
+    const std::string& GetMaterialLibrary() { return materialLibrary; }
+
+    // A copy of the geometry kept on the CPU, for building static batches
+    const std::vector<Vertex>& GetVertices() { return vertices; }
+    const std::vector<unsigned int>& GetIndices() { return indices; }
+
+    // Handles the drawing of this mesh, binding its buffers through the state cache.
+    // Position-only binds just the positions, for shaders that don't read anything
+    // else (see SimpleVertexShader::GetPositionOnly())
+    void Draw(RenderStateCache& state, bool positionOnly = false);
+
+    // The two halves of Draw(), for drawing the same mesh several times in a row
+    void SetBuffers(RenderStateCache& state, bool positionOnly = false);
+    void DrawIndexed();
+
+    // Draws several copies of the mesh - the per-instance data has
+    // to be bound to input slot 1 along with the mesh's own buffers
+    void DrawIndexedInstanced(unsigned int instanceCount, unsigned int firstInstance);
+
+    // The same for a single submesh - the buffers are shared by every
+    // submesh, so they only need setting once for all of them
+    void DrawSubmesh(unsigned int submesh);
+    void DrawSubmeshInstanced(unsigned int submesh, unsigned int instanceCount, unsigned int firstInstance);
 
 private:
-    Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-    Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+    std::shared_ptr<GeometryPool> pool;
+    GeometryPoolEntry geometry;
+    bool inPool = false;
     int numIndices;
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+    DirectX::BoundingSphere bounds;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshSubmesh> submeshes;
+    std::string materialLibrary;
 
-    // must be called in the constructor before the d3d vert/index buffers are created
+    // must be called in the constructor before the vertices are copied into the pool
     void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
     void InitializeBuffers(
@@ -46,7 +100,6 @@ private:
         int _numVerts,
         unsigned int* _indices,
         int _numIndices,
-        Microsoft::WRL::ComPtr<ID3D11Device> _device,
-        Microsoft::WRL::ComPtr<ID3D11DeviceContext> _deviceContext);
+        std::shared_ptr<GeometryPool> _pool);
 };
 
@@ -0,0 +1,63 @@
+#include "ObjectMatrixStage.h"
+#include <thread>
+#include <algorithm>
+
+using namespace DirectX;
+
+ObjectMatrixStage::ObjectMatrixStage() :
+    count(0),
+    threadCount(std::max(1u, std::thread::hardware_concurrency())),
+    processedCount(0)
+{
+}
+
+ObjectMatrixStage::~ObjectMatrixStage()
+{
+}
+
+void ObjectMatrixStage::Run(
+    const XMFLOAT4X4& view,
+    const XMFLOAT4X4& projection,
+    Transform* const* transforms,
+    const InstanceParams* const* instanceParams,
+    unsigned int count)
+{
+    this->count = count;
+    processedCount += count;
+    if (objects.size() < count)
+        objects.resize(count);
+
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+    // Each thread takes a contiguous chunk of objects
+    unsigned int threads = count >= OBJECT_MATRIX_PARALLEL_THRESHOLD ? threadCount : 1;
+    unsigned int chunkSize = (count + threads - 1) / threads;
+
+    auto work = [&](unsigned int thread)
+    {
+        XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+        unsigned int end = std::min(count, (thread + 1) * chunkSize);
+        for (unsigned int i = thread * chunkSize; i < end; i++)
+        {
+            PerObjectData& object = objects[i];
+            object.world = transforms[i]->GetWorldMatrix();
+            object.worldInvTranspose = transforms[i]->GetWorldInverseTransposeMatrix();
+            XMStoreFloat4x4(&object.worldViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&object.world), vp));
+            if (instanceParams)
+            {
+                object.instanceColorTint = instanceParams[i]->colorTint;
+                object.instanceUvScale = instanceParams[i]->uvScale;
+                object.instanceUvOffset = instanceParams[i]->uvOffset;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < threads; t++)
+        workers.emplace_back(work, t);
+
+    work(0);
+    for (auto& worker : workers)
+        worker.join();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Transform.h"
+#include "BufferStructs.h"
+
+// Fewer objects than this are done on a single thread
+#define OBJECT_MATRIX_PARALLEL_THRESHOLD    8192
+
+// --------------------------------------------------------
+// Works out the final per-object matrices for a whole list
+// of objects in one go, so vertex shaders get world * view
+// * projection ready made instead of concatenating it for
+// every vertex.
+//
+// The view-projection matrix is loaded into SIMD registers
+// once per batch and each object is a single DirectXMath
+// matrix multiply, with big batches split across threads.
+// The results are packed in the same order as the input,
+// ready to copy straight into the per-object buffer.
+// --------------------------------------------------------
+class ObjectMatrixStage
+{
+public:
+    ObjectMatrixStage();
+    ~ObjectMatrixStage();
+
+    // Fills in matrices for each transform, in order. The view and
+    // projection are the camera's, or a shadow view's. Instance
+    // parameters are copied along if given, for passes that use them.
+    void Run(
+        const DirectX::XMFLOAT4X4& view,
+        const DirectX::XMFLOAT4X4& projection,
+        Transform* const* transforms,
+        const InstanceParams* const* instanceParams,
+        unsigned int count);
+
+    // Results of the last Run()
+    const PerObjectData& Get(unsigned int index) { return objects[index]; }
+    unsigned int GetCount() { return count; }
+
+    // Objects processed since the last ResetStats()
+    unsigned int GetProcessedCount() { return processedCount; }
+    void ResetStats() { processedCount = 0; }
+
+    // Threads used for batches over OBJECT_MATRIX_PARALLEL_THRESHOLD
+    void SetThreadCount(unsigned int threads) { threadCount = threads > 0 ? threads : 1; }
+
+private:
+    std::vector<PerObjectData> objects;
+    unsigned int count;
+    unsigned int threadCount;
+    unsigned int processedCount;
+};
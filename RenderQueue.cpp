@@ -0,0 +1,177 @@
+#include "RenderQueue.h"
+#include <thread>
+#include <algorithm>
+
+#define RENDER_KEY_DEPTH_SHIFT      0
+#define RENDER_KEY_MESH_SHIFT       (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT   (RENDER_KEY_MESH_SHIFT + RENDER_KEY_MESH_BITS)
+#define RENDER_KEY_PROGRAM_SHIFT    (RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT       (RENDER_KEY_PROGRAM_SHIFT + RENDER_KEY_PROGRAM_BITS)
+
+// One byte of the key per radix pass
+#define RADIX_BITS      8
+#define RADIX_BUCKETS   (1 << RADIX_BITS)
+
+static unsigned long long KeyField(unsigned int value, unsigned int bits, unsigned int shift)
+{
+    return ((unsigned long long)value & ((1ull << bits) - 1)) << shift;
+}
+
+static unsigned int GetKeyField(unsigned long long key, unsigned int bits, unsigned int shift)
+{
+    return (unsigned int)((key >> shift) & ((1ull << bits) - 1));
+}
+
+RenderQueue::RenderQueue() :
+    threadCount(std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+unsigned long long RenderQueue::MakeKey(unsigned int pass, unsigned int program, unsigned int material, unsigned int mesh, unsigned int depth)
+{
+    return
+        KeyField(pass, RENDER_KEY_PASS_BITS, RENDER_KEY_PASS_SHIFT) |
+        KeyField(program, RENDER_KEY_PROGRAM_BITS, RENDER_KEY_PROGRAM_SHIFT) |
+        KeyField(material, RENDER_KEY_MATERIAL_BITS, RENDER_KEY_MATERIAL_SHIFT) |
+        KeyField(mesh, RENDER_KEY_MESH_BITS, RENDER_KEY_MESH_SHIFT) |
+        KeyField(depth, RENDER_KEY_DEPTH_BITS, RENDER_KEY_DEPTH_SHIFT);
+}
+
+unsigned int RenderQueue::QuantizeDepth(float depth, float nearClip, float farClip)
+{
+    // Linear across the clip range - anything outside it is clamped
+    float t = (depth - nearClip) / (farClip - nearClip);
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    return (unsigned int)(t * ((1u << RENDER_KEY_DEPTH_BITS) - 1));
+}
+
+unsigned int RenderQueue::GetKeyPass(unsigned long long key) { return GetKeyField(key, RENDER_KEY_PASS_BITS, RENDER_KEY_PASS_SHIFT); }
+unsigned int RenderQueue::GetKeyProgram(unsigned long long key) { return GetKeyField(key, RENDER_KEY_PROGRAM_BITS, RENDER_KEY_PROGRAM_SHIFT); }
+unsigned int RenderQueue::GetKeyMaterial(unsigned long long key) { return GetKeyField(key, RENDER_KEY_MATERIAL_BITS, RENDER_KEY_MATERIAL_SHIFT); }
+unsigned int RenderQueue::GetKeyMesh(unsigned long long key) { return GetKeyField(key, RENDER_KEY_MESH_BITS, RENDER_KEY_MESH_SHIFT); }
+
+unsigned int RenderQueue::GetProgramId(const void* vertexShader, const void* pixelShader)
+{
+    auto result = programIds.insert({ { vertexShader, pixelShader }, (unsigned int)programIds.size() });
+    return result.first->second;
+}
+
+unsigned int RenderQueue::GetMaterialId(const void* material)
+{
+    auto result = materialIds.insert({ material, (unsigned int)materialIds.size() });
+    return result.first->second;
+}
+
+unsigned int RenderQueue::GetMeshId(const void* mesh)
+{
+    auto result = meshIds.insert({ mesh, (unsigned int)meshIds.size() });
+    return result.first->second;
+}
+
+void RenderQueue::Clear()
+{
+    items.clear();
+    programIds.clear();
+    materialIds.clear();
+    meshIds.clear();
+}
+
+void RenderQueue::Add(unsigned long long key, unsigned int index)
+{
+    items.push_back({ key, index });
+}
+
+void RenderQueue::Sort()
+{
+    if (items.size() < 2)
+        return;
+
+    // Bits that differ between any two keys - bytes without
+    // any don't change the order and can be skipped
+    unsigned long long varying = 0;
+    for (auto& item : items)
+        varying |= item.Key ^ items[0].Key;
+
+    unsigned int threads = items.size() >= RENDER_QUEUE_PARALLEL_THRESHOLD ? threadCount : 1;
+    scratch.resize(items.size());
+    for (unsigned int shift = 0; shift < 64; shift += RADIX_BITS)
+    {
+        if (((varying >> shift) & (RADIX_BUCKETS - 1)) == 0)
+            continue;
+
+        RadixPass(shift, threads);
+        items.swap(scratch);
+    }
+}
+
+void RenderQueue::RadixPass(unsigned int shift, unsigned int threads)
+{
+    // Each thread takes a contiguous chunk, so scattering chunks in
+    // order keeps the sort stable
+    unsigned int count = (unsigned int)items.size();
+    unsigned int chunkSize = (count + threads - 1) / threads;
+    histograms.assign(threads * RADIX_BUCKETS, 0);
+
+    auto countDigits = [&](unsigned int thread)
+    {
+        unsigned int* histogram = &histograms[thread * RADIX_BUCKETS];
+        unsigned int end = std::min(count, (thread + 1) * chunkSize);
+        for (unsigned int i = thread * chunkSize; i < end; i++)
+            histogram[(items[i].Key >> shift) & (RADIX_BUCKETS - 1)]++;
+    };
+
+    auto scatter = [&](unsigned int thread)
+    {
+        unsigned int* offsets = &histograms[thread * RADIX_BUCKETS];
+        unsigned int end = std::min(count, (thread + 1) * chunkSize);
+        for (unsigned int i = thread * chunkSize; i < end; i++)
+            scratch[offsets[(items[i].Key >> shift) & (RADIX_BUCKETS - 1)]++] = items[i];
+    };
+
+    auto runOnThreads = [&](auto&& work)
+    {
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++)
+            workers.emplace_back(work, t);
+
+        work(0);
+        for (auto& worker : workers)
+            worker.join();
+    };
+
+    runOnThreads(countDigits);
+
+    // Offsets go digit by digit, and by thread within each digit
+    unsigned int offset = 0;
+    for (unsigned int digit = 0; digit < RADIX_BUCKETS; digit++)
+    {
+        for (unsigned int t = 0; t < threads; t++)
+        {
+            unsigned int digitCount = histograms[t * RADIX_BUCKETS + digit];
+            histograms[t * RADIX_BUCKETS + digit] = offset;
+            offset += digitCount;
+        }
+    }
+
+    runOnThreads(scatter);
+}
+
+RenderQueueSwitches RenderQueue::CountSwitches()
+{
+    RenderQueueSwitches switches = {};
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        // The first item always has to bind everything
+        unsigned long long key = items[i].Key;
+        unsigned long long previous = i > 0 ? items[i - 1].Key : ~key;
+
+        if (GetKeyProgram(key) != GetKeyProgram(previous)) switches.Programs++;
+        if (GetKeyMaterial(key) != GetKeyMaterial(previous)) switches.Materials++;
+        if (GetKeyMesh(key) != GetKeyMesh(previous)) switches.Meshes++;
+    }
+    return switches;
+}
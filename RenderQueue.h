@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+// Which pass a queued draw belongs to - the most significant part
+// of the sort key, so passes never interleave
+enum RenderPass
+{
+    RENDER_PASS_OPAQUE,
+    RENDER_PASS_COUNT
+};
+
+// Sort key layout, most significant first:
+//  pass (4 bits) | program (10) | material (14) | mesh (14) | depth (22)
+// Ids past what their field holds wrap around, which only costs
+// some extra state changes.
+#define RENDER_KEY_PASS_BITS        4
+#define RENDER_KEY_PROGRAM_BITS     10
+#define RENDER_KEY_MATERIAL_BITS    14
+#define RENDER_KEY_MESH_BITS        14
+#define RENDER_KEY_DEPTH_BITS       22
+
+// Fewer items than this are sorted on a single thread
+#define RENDER_QUEUE_PARALLEL_THRESHOLD 16384
+
+// A draw waiting to be submitted, and where to find it
+struct RenderQueueItem
+{
+    unsigned long long Key;
+    unsigned int Index;
+};
+
+// How often consecutive items use a different program,
+// material or mesh - roughly shader, SRV and vertex buffer switches
+struct RenderQueueSwitches
+{
+    unsigned int Programs;
+    unsigned int Materials;
+    unsigned int Meshes;
+};
+
+// --------------------------------------------------------
+// Collects a frame's draws under 64-bit sort keys and puts
+// them in an order that keeps state changes to a minimum:
+// grouped by pass, then shader program, then material, then
+// mesh, and front to back within all of that.
+//
+// Keys are sorted with a stable LSD radix sort, spread over
+// several threads for big queues. Bytes that are the same in
+// every key are skipped, so small scenes only pay for the
+// bytes that actually vary.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+    RenderQueue();
+    ~RenderQueue();
+
+    // Key building
+    static unsigned long long MakeKey(unsigned int pass, unsigned int program, unsigned int material, unsigned int mesh, unsigned int depth);
+    static unsigned int QuantizeDepth(float depth, float nearClip, float farClip);
+    static unsigned int GetKeyPass(unsigned long long key);
+    static unsigned int GetKeyProgram(unsigned long long key);
+    static unsigned int GetKeyMaterial(unsigned long long key);
+    static unsigned int GetKeyMesh(unsigned long long key);
+
+    // Small ids for the objects that go in keys, handed out the first
+    // time each is seen after a Clear(). Clear() starts them over, so
+    // objects that come and go (like rebuilt static batches) don't
+    // pile up and push ids past what their key fields hold.
+    unsigned int GetProgramId(const void* vertexShader, const void* pixelShader);
+    unsigned int GetMaterialId(const void* material);
+    unsigned int GetMeshId(const void* mesh);
+
+    // Empties the queue and forgets every id
+    void Clear();
+    void Add(unsigned long long key, unsigned int index);
+    void Sort();
+    const std::vector<RenderQueueItem>& GetItems() { return items; }
+
+    // Switches between consecutive items in their current order
+    RenderQueueSwitches CountSwitches();
+
+    // Threads used for queues over RENDER_QUEUE_PARALLEL_THRESHOLD
+    void SetThreadCount(unsigned int threads) { threadCount = threads > 0 ? threads : 1; }
+
+private:
+    std::vector<RenderQueueItem> items;
+    std::vector<RenderQueueItem> scratch;
+    unsigned int threadCount;
+
+    std::map<std::pair<const void*, const void*>, unsigned int> programIds;
+    std::unordered_map<const void*, unsigned int> materialIds;
+    std::unordered_map<const void*, unsigned int> meshIds;
+
+    // Per-thread digit counts, turned into scatter offsets
+    std::vector<unsigned int> histograms;
+
+    void RadixPass(unsigned int shift, unsigned int threads);
+};
@@ -0,0 +1,203 @@
+#include "RenderStateCache.h"
+#include <cassert>
+
+RenderStateCache::RenderStateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+    context(context)
+{
+    // Only needed for ranged constant buffers, fine if it's missing
+    context.As(&context1);
+}
+
+RenderStateCache::~RenderStateCache()
+{
+}
+
+void RenderStateCache::VSSetShader(ID3D11VertexShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_VERTEX, shader))
+        context->VSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::HSSetShader(ID3D11HullShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_HULL, shader))
+        context->HSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::DSSetShader(ID3D11DomainShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_DOMAIN, shader))
+        context->DSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::GSSetShader(ID3D11GeometryShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_GEOMETRY, shader))
+        context->GSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::PSSetShader(ID3D11PixelShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_PIXEL, shader))
+        context->PSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::CSSetShader(ID3D11ComputeShader* shader)
+{
+    if (tracker.SetShader(RENDER_STAGE_COMPUTE, shader))
+        context->CSSetShader(shader, 0, 0);
+}
+
+void RenderStateCache::SetConstantBuffer(RenderStateStage stage, unsigned int slot, ID3D11Buffer* buffer)
+{
+    if (!tracker.SetConstantBuffer(stage, slot, buffer, 0, 0))
+        return;
+
+    switch (stage)
+    {
+    case RENDER_STAGE_VERTEX: context->VSSetConstantBuffers(slot, 1, &buffer); break;
+    case RENDER_STAGE_HULL: context->HSSetConstantBuffers(slot, 1, &buffer); break;
+    case RENDER_STAGE_DOMAIN: context->DSSetConstantBuffers(slot, 1, &buffer); break;
+    case RENDER_STAGE_GEOMETRY: context->GSSetConstantBuffers(slot, 1, &buffer); break;
+    case RENDER_STAGE_PIXEL: context->PSSetConstantBuffers(slot, 1, &buffer); break;
+    case RENDER_STAGE_COMPUTE: context->CSSetConstantBuffers(slot, 1, &buffer); break;
+    default: break;
+    }
+}
+
+void RenderStateCache::SetConstantBuffer(RenderStateStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+    // Without Direct3D 11.1 only a range at the start of the buffer can
+    // be bound, as the whole buffer. Callers have to check for 11.1
+    // support (see ConstantRing::IsSupported()) before using offsets.
+    if (!context1)
+    {
+        assert(firstConstant == 0 && "Constant buffer offsets need Direct3D 11.1");
+        SetConstantBuffer(stage, slot, buffer);
+        return;
+    }
+
+    if (!tracker.SetConstantBuffer(stage, slot, buffer, firstConstant, constantCount))
+        return;
+
+    UINT first = firstConstant;
+    UINT count = constantCount;
+    switch (stage)
+    {
+    case RENDER_STAGE_VERTEX: context1->VSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    case RENDER_STAGE_HULL: context1->HSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    case RENDER_STAGE_DOMAIN: context1->DSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    case RENDER_STAGE_GEOMETRY: context1->GSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    case RENDER_STAGE_PIXEL: context1->PSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    case RENDER_STAGE_COMPUTE: context1->CSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+    default: break;
+    }
+}
+
+void RenderStateCache::SetShaderResource(RenderStateStage stage, unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+    SetShaderResources(stage, slot, 1, &srv);
+}
+
+void RenderStateCache::SetSampler(RenderStateStage stage, unsigned int slot, ID3D11SamplerState* sampler)
+{
+    SetSamplers(stage, slot, 1, &sampler);
+}
+
+void RenderStateCache::SetShaderResources(RenderStateStage stage, unsigned int firstSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+    unsigned int slot = firstSlot;
+    if (!tracker.SetShaderResources(stage, slot, count, reinterpret_cast<const void* const*>(srvs)))
+        return;
+
+    srvs += slot - firstSlot;
+    switch (stage)
+    {
+    case RENDER_STAGE_VERTEX: context->VSSetShaderResources(slot, count, srvs); break;
+    case RENDER_STAGE_HULL: context->HSSetShaderResources(slot, count, srvs); break;
+    case RENDER_STAGE_DOMAIN: context->DSSetShaderResources(slot, count, srvs); break;
+    case RENDER_STAGE_GEOMETRY: context->GSSetShaderResources(slot, count, srvs); break;
+    case RENDER_STAGE_PIXEL: context->PSSetShaderResources(slot, count, srvs); break;
+    case RENDER_STAGE_COMPUTE: context->CSSetShaderResources(slot, count, srvs); break;
+    default: break;
+    }
+}
+
+void RenderStateCache::SetSamplers(RenderStateStage stage, unsigned int firstSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+    unsigned int slot = firstSlot;
+    if (!tracker.SetSamplers(stage, slot, count, reinterpret_cast<const void* const*>(samplers)))
+        return;
+
+    samplers += slot - firstSlot;
+    switch (stage)
+    {
+    case RENDER_STAGE_VERTEX: context->VSSetSamplers(slot, count, samplers); break;
+    case RENDER_STAGE_HULL: context->HSSetSamplers(slot, count, samplers); break;
+    case RENDER_STAGE_DOMAIN: context->DSSetSamplers(slot, count, samplers); break;
+    case RENDER_STAGE_GEOMETRY: context->GSSetSamplers(slot, count, samplers); break;
+    case RENDER_STAGE_PIXEL: context->PSSetSamplers(slot, count, samplers); break;
+    case RENDER_STAGE_COMPUTE: context->CSSetSamplers(slot, count, samplers); break;
+    default: break;
+    }
+}
+
+void RenderStateCache::IASetInputLayout(ID3D11InputLayout* layout)
+{
+    if (tracker.SetInputLayout(layout))
+        context->IASetInputLayout(layout);
+}
+
+void RenderStateCache::IASetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+{
+    if (!tracker.SetVertexBuffer(slot, buffer, stride, offset))
+        return;
+
+    UINT strides[] = { stride };
+    UINT offsets[] = { offset };
+    context->IASetVertexBuffers(slot, 1, &buffer, strides, offsets);
+}
+
+void RenderStateCache::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset)
+{
+    if (tracker.SetIndexBuffer(buffer, format, offset))
+        context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void RenderStateCache::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    if (tracker.SetPrimitiveTopology(topology))
+        context->IASetPrimitiveTopology(topology);
+}
+
+void RenderStateCache::RSSetState(ID3D11RasterizerState* state)
+{
+    if (tracker.SetRasterizerState(state))
+        context->RSSetState(state);
+}
+
+void RenderStateCache::RSSetViewport(const D3D11_VIEWPORT& viewport)
+{
+    if (tracker.SetViewport(viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth))
+        context->RSSetViewports(1, &viewport);
+}
+
+void RenderStateCache::OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+    if (tracker.SetDepthStencilState(state, stencilRef))
+        context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void RenderStateCache::OMSetBlendState(ID3D11BlendState* state, const float blendFactor[4], unsigned int sampleMask)
+{
+    if (tracker.SetBlendState(state, blendFactor, sampleMask))
+        context->OMSetBlendState(state, blendFactor, sampleMask);
+}
+
+void RenderStateCache::OMSetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv)
+{
+    // Not worth tracking, but anything that becomes an output is
+    // unbound from every SRV slot it was in
+    context->OMSetRenderTargets(count, rtvs, dsv);
+    tracker.InvalidateShaderResources();
+}
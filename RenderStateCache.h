@@ -0,0 +1,71 @@
+#pragma once
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "RenderStateTracker.h"
+
+// --------------------------------------------------------
+// Sits between the renderer and the device context and
+// drops calls that would bind what's already bound.
+//
+// Everything that binds shaders, constant buffers, SRVs,
+// samplers, input assembler buffers, rasterizer, depth and
+// blend states or the viewport should go through here, or
+// the cache has to be told with Invalidate(). Render target
+// changes are always passed through and forget the SRV
+// bindings, since Direct3D silently unbinds resources that
+// become outputs.
+// --------------------------------------------------------
+class RenderStateCache
+{
+public:
+    RenderStateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+    ~RenderStateCache();
+
+    ID3D11DeviceContext* GetContext() { return context.Get(); }
+    RenderStateTracker& GetTracker() { return tracker; }
+
+    // Shaders
+    void VSSetShader(ID3D11VertexShader* shader);
+    void HSSetShader(ID3D11HullShader* shader);
+    void DSSetShader(ID3D11DomainShader* shader);
+    void GSSetShader(ID3D11GeometryShader* shader);
+    void PSSetShader(ID3D11PixelShader* shader);
+    void CSSetShader(ID3D11ComputeShader* shader);
+
+    // Per-stage resources. The ranged constant buffer version takes
+    // its offset and count in 16-byte constants, and needs Direct3D
+    // 11.1 for anything but an offset of 0 - without it the whole
+    // buffer is bound instead.
+    void SetConstantBuffer(RenderStateStage stage, unsigned int slot, ID3D11Buffer* buffer);
+    void SetConstantBuffer(RenderStateStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
+    void SetShaderResource(RenderStateStage stage, unsigned int slot, ID3D11ShaderResourceView* srv);
+    void SetSampler(RenderStateStage stage, unsigned int slot, ID3D11SamplerState* sampler);
+
+    // A run of consecutive slots in a single call - only the part
+    // of the run that changed is actually bound
+    void SetShaderResources(RenderStateStage stage, unsigned int firstSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+    void SetSamplers(RenderStateStage stage, unsigned int firstSlot, unsigned int count, ID3D11SamplerState* const* samplers);
+
+    // Input assembler
+    void IASetInputLayout(ID3D11InputLayout* layout);
+    void IASetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+    void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset);
+    void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+    // Rasterizer and output merger
+    void RSSetState(ID3D11RasterizerState* state);
+    void RSSetViewport(const D3D11_VIEWPORT& viewport);
+    void OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+    void OMSetBlendState(ID3D11BlendState* state, const float blendFactor[4], unsigned int sampleMask);
+    void OMSetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView* dsv);
+
+    // For state changed directly on the context
+    void Invalidate() { tracker.Invalidate(); }
+    void InvalidateShaderResources() { tracker.InvalidateShaderResources(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+    RenderStateTracker tracker;
+};
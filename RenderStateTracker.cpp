@@ -0,0 +1,217 @@
+#include "RenderStateTracker.h"
+#include <cstring>
+
+RenderStateTracker::RenderStateTracker() :
+    filteringEnabled(true),
+    issuedCount(0),
+    filteredCount(0)
+{
+    Invalidate();
+}
+
+RenderStateTracker::~RenderStateTracker()
+{
+}
+
+bool RenderStateTracker::Set(Binding& binding, const void* object, const unsigned int* values, unsigned int valueCount)
+{
+    unsigned int newValues[6] = {};
+    if (valueCount > 0)
+        memcpy(newValues, values, sizeof(unsigned int) * valueCount);
+
+    bool same =
+        binding.Known &&
+        binding.Object == object &&
+        memcmp(binding.Values, newValues, sizeof(newValues)) == 0;
+
+    if (same && filteringEnabled)
+    {
+        filteredCount++;
+        return false;
+    }
+
+    binding.Object = object;
+    memcpy(binding.Values, newValues, sizeof(newValues));
+    binding.Known = true;
+    issuedCount++;
+    return true;
+}
+
+bool RenderStateTracker::SetUntracked()
+{
+    // Out of range slots are passed straight through
+    issuedCount++;
+    return true;
+}
+
+bool RenderStateTracker::SetShader(RenderStateStage stage, const void* shader)
+{
+    return Set(stages[stage].Shader, shader, 0, 0);
+}
+
+bool RenderStateTracker::SetConstantBuffer(RenderStateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+    if (slot >= RENDER_STATE_CONSTANT_BUFFER_SLOTS)
+        return SetUntracked();
+
+    // The same buffer at a different offset is a different binding
+    unsigned int values[] = { firstConstant, constantCount };
+    return Set(stages[stage].ConstantBuffers[slot], buffer, values, 2);
+}
+
+bool RenderStateTracker::SetShaderResource(RenderStateStage stage, unsigned int slot, const void* srv)
+{
+    if (slot >= RENDER_STATE_RESOURCE_SLOTS)
+        return SetUntracked();
+
+    return Set(stages[stage].Resources[slot], srv, 0, 0);
+}
+
+bool RenderStateTracker::SetSampler(RenderStateStage stage, unsigned int slot, const void* sampler)
+{
+    if (slot >= RENDER_STATE_SAMPLER_SLOTS)
+        return SetUntracked();
+
+    return Set(stages[stage].Samplers[slot], sampler, 0, 0);
+}
+
+bool RenderStateTracker::SetShaderResources(RenderStateStage stage, unsigned int& firstSlot, unsigned int& count, const void* const* srvs)
+{
+    return SetRange(stages[stage].Resources, RENDER_STATE_RESOURCE_SLOTS, firstSlot, count, srvs);
+}
+
+bool RenderStateTracker::SetSamplers(RenderStateStage stage, unsigned int& firstSlot, unsigned int& count, const void* const* samplers)
+{
+    return SetRange(stages[stage].Samplers, RENDER_STATE_SAMPLER_SLOTS, firstSlot, count, samplers);
+}
+
+bool RenderStateTracker::SetRange(Binding* bindings, unsigned int slotCount, unsigned int& firstSlot, unsigned int& count, const void* const* objects)
+{
+    if (count == 0)
+        return false;
+
+    if (firstSlot + count > slotCount)
+        return SetUntracked();
+
+    // First and last slot that differ from what's bound
+    unsigned int firstChanged = count;
+    unsigned int lastChanged = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Binding& binding = bindings[firstSlot + i];
+        bool same = binding.Known && binding.Object == objects[i];
+        if (same && filteringEnabled)
+            continue;
+
+        binding.Object = objects[i];
+        memset(binding.Values, 0, sizeof(binding.Values));
+        binding.Known = true;
+
+        if (firstChanged == count)
+            firstChanged = i;
+        lastChanged = i;
+    }
+
+    if (firstChanged == count)
+    {
+        filteredCount++;
+        return false;
+    }
+
+    firstSlot += firstChanged;
+    count = lastChanged - firstChanged + 1;
+    issuedCount++;
+    return true;
+}
+
+bool RenderStateTracker::SetInputLayout(const void* layout)
+{
+    return Set(inputLayout, layout, 0, 0);
+}
+
+bool RenderStateTracker::SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset)
+{
+    if (slot >= RENDER_STATE_VERTEX_BUFFER_SLOTS)
+        return SetUntracked();
+
+    unsigned int values[] = { stride, offset };
+    return Set(vertexBuffers[slot], buffer, values, 2);
+}
+
+bool RenderStateTracker::SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset)
+{
+    unsigned int values[] = { format, offset };
+    return Set(indexBuffer, buffer, values, 2);
+}
+
+bool RenderStateTracker::SetPrimitiveTopology(unsigned int topology)
+{
+    return Set(this->topology, 0, &topology, 1);
+}
+
+bool RenderStateTracker::SetRasterizerState(const void* state)
+{
+    return Set(rasterizerState, state, 0, 0);
+}
+
+bool RenderStateTracker::SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
+{
+    // Compared bit for bit, which is all that matters here
+    float floats[] = { x, y, width, height, minDepth, maxDepth };
+    unsigned int values[6];
+    memcpy(values, floats, sizeof(values));
+    return Set(viewport, 0, values, 6);
+}
+
+bool RenderStateTracker::SetDepthStencilState(const void* state, unsigned int stencilRef)
+{
+    return Set(depthStencilState, state, &stencilRef, 1);
+}
+
+bool RenderStateTracker::SetBlendState(const void* state, const float blendFactor[4], unsigned int sampleMask)
+{
+    // A null blend factor means all ones
+    float factor[4] = { 1, 1, 1, 1 };
+    if (blendFactor)
+        memcpy(factor, blendFactor, sizeof(factor));
+
+    unsigned int values[5];
+    memcpy(values, factor, sizeof(factor));
+    values[4] = sampleMask;
+    return Set(blendState, state, values, 5);
+}
+
+void RenderStateTracker::Invalidate()
+{
+    for (auto& stage : stages)
+    {
+        stage.Shader.Known = false;
+        for (auto& binding : stage.ConstantBuffers) binding.Known = false;
+        for (auto& binding : stage.Resources) binding.Known = false;
+        for (auto& binding : stage.Samplers) binding.Known = false;
+    }
+
+    for (auto& binding : vertexBuffers) binding.Known = false;
+    inputLayout.Known = false;
+    indexBuffer.Known = false;
+    topology.Known = false;
+    rasterizerState.Known = false;
+    viewport.Known = false;
+    depthStencilState.Known = false;
+    blendState.Known = false;
+}
+
+void RenderStateTracker::InvalidateShaderResources()
+{
+    for (auto& stage : stages)
+    {
+        for (auto& binding : stage.Resources)
+            binding.Known = false;
+    }
+}
+
+void RenderStateTracker::ResetStats()
+{
+    issuedCount = 0;
+    filteredCount = 0;
+}
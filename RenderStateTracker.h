@@ -0,0 +1,106 @@
+#pragma once
+
+// Shader stages the tracker keeps bindings for
+enum RenderStateStage
+{
+    RENDER_STAGE_VERTEX,
+    RENDER_STAGE_HULL,
+    RENDER_STAGE_DOMAIN,
+    RENDER_STAGE_GEOMETRY,
+    RENDER_STAGE_PIXEL,
+    RENDER_STAGE_COMPUTE,
+    RENDER_STAGE_COUNT
+};
+
+// Slots per stage, matching the Direct3D 11 limits
+#define RENDER_STATE_CONSTANT_BUFFER_SLOTS  14
+#define RENDER_STATE_RESOURCE_SLOTS         128
+#define RENDER_STATE_SAMPLER_SLOTS          16
+#define RENDER_STATE_VERTEX_BUFFER_SLOTS    32
+
+// --------------------------------------------------------
+// Shadows what's bound to the pipeline so redundant calls
+// can be dropped before they reach the device context.
+//
+// Every Set function records the new binding and returns
+// true only if it differs from the current one, meaning the
+// call actually has to be made. Objects are compared by
+// address and never dereferenced. Bindings start out
+// unknown, so the first call for each is always made.
+// --------------------------------------------------------
+class RenderStateTracker
+{
+public:
+    RenderStateTracker();
+    ~RenderStateTracker();
+
+    bool SetShader(RenderStateStage stage, const void* shader);
+    bool SetConstantBuffer(RenderStateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int constantCount);
+    bool SetShaderResource(RenderStateStage stage, unsigned int slot, const void* srv);
+    bool SetSampler(RenderStateStage stage, unsigned int slot, const void* sampler);
+
+    // Ranged versions, for binding a run of slots with one call. Every
+    // slot is recorded, and firstSlot and count are narrowed down to
+    // the slots that actually changed. Counts as one call either way.
+    bool SetShaderResources(RenderStateStage stage, unsigned int& firstSlot, unsigned int& count, const void* const* srvs);
+    bool SetSamplers(RenderStateStage stage, unsigned int& firstSlot, unsigned int& count, const void* const* samplers);
+
+    bool SetInputLayout(const void* layout);
+    bool SetVertexBuffer(unsigned int slot, const void* buffer, unsigned int stride, unsigned int offset);
+    bool SetIndexBuffer(const void* buffer, unsigned int format, unsigned int offset);
+    bool SetPrimitiveTopology(unsigned int topology);
+
+    bool SetRasterizerState(const void* state);
+    bool SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth);
+    bool SetDepthStencilState(const void* state, unsigned int stencilRef);
+    bool SetBlendState(const void* state, const float blendFactor[4], unsigned int sampleMask);
+
+    // Forgets bindings that were changed behind the tracker's back,
+    // like a ClearState() or a render target change unbinding SRVs
+    void Invalidate();
+    void InvalidateShaderResources();
+
+    // With filtering off every call is made, but still tracked
+    void SetFilteringEnabled(bool enabled) { filteringEnabled = enabled; }
+    bool IsFilteringEnabled() { return filteringEnabled; }
+
+    // Calls made and dropped since the last ResetStats()
+    unsigned int GetIssuedCount() { return issuedCount; }
+    unsigned int GetFilteredCount() { return filteredCount; }
+    void ResetStats();
+
+private:
+    // An object plus whatever extra values make up the binding
+    struct Binding
+    {
+        const void* Object;
+        unsigned int Values[6];
+        bool Known;
+    };
+
+    struct StageBindings
+    {
+        Binding Shader;
+        Binding ConstantBuffers[RENDER_STATE_CONSTANT_BUFFER_SLOTS];
+        Binding Resources[RENDER_STATE_RESOURCE_SLOTS];
+        Binding Samplers[RENDER_STATE_SAMPLER_SLOTS];
+    };
+
+    StageBindings stages[RENDER_STAGE_COUNT];
+    Binding inputLayout;
+    Binding vertexBuffers[RENDER_STATE_VERTEX_BUFFER_SLOTS];
+    Binding indexBuffer;
+    Binding topology;
+    Binding rasterizerState;
+    Binding viewport;
+    Binding depthStencilState;
+    Binding blendState;
+
+    bool filteringEnabled;
+    unsigned int issuedCount;
+    unsigned int filteredCount;
+
+    bool Set(Binding& binding, const void* object, const unsigned int* values, unsigned int valueCount);
+    bool SetUntracked();
+    bool SetRange(Binding* bindings, unsigned int slotCount, unsigned int& firstSlot, unsigned int& count, const void* const* objects);
+};
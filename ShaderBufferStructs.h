@@ -0,0 +1,139 @@
+// --------------------------------------------------------
+// Generated by ShaderStructGen from the compiled shaders'
+// reflection - don't edit, rerun the tool instead.
+//
+// One struct per constant buffer, laid out exactly like
+// the buffer so it can be uploaded with a single copy
+// (see SimpleShader's SetBufferStruct).
+// --------------------------------------------------------
+#pragma once
+#include <cstddef>
+#include <DirectXMath.h>
+
+// An array element or matrix column that doesn't fill its
+// register - HLSL starts the next one on a new register
+template<typename T> struct ShaderPadded
+{
+    T value;
+    char padding[16 - sizeof(T) % 16];
+};
+
+// PerFrame : register(b10), 64 bytes - shared by every shader
+struct PerFrameData
+{
+    static const char* GetBufferName() { return "PerFrame"; }
+
+    float totalTime;
+    DirectX::XMFLOAT3 ambient;
+    DirectX::XMFLOAT4 cascadeSplits;
+    DirectX::XMFLOAT2 clusterScreenScale;
+    float clusterDepthScale;
+    float clusterDepthBias;
+    unsigned int globalLightCount;
+    int cascadeCount;
+    DirectX::XMFLOAT2 perFramePadding;
+};
+static_assert(offsetof(PerFrameData, totalTime) == 0, "PerFrameData.totalTime doesn't match the shader");
+static_assert(offsetof(PerFrameData, ambient) == 4, "PerFrameData.ambient doesn't match the shader");
+static_assert(offsetof(PerFrameData, cascadeSplits) == 16, "PerFrameData.cascadeSplits doesn't match the shader");
+static_assert(offsetof(PerFrameData, clusterScreenScale) == 32, "PerFrameData.clusterScreenScale doesn't match the shader");
+static_assert(offsetof(PerFrameData, clusterDepthScale) == 40, "PerFrameData.clusterDepthScale doesn't match the shader");
+static_assert(offsetof(PerFrameData, clusterDepthBias) == 44, "PerFrameData.clusterDepthBias doesn't match the shader");
+static_assert(offsetof(PerFrameData, globalLightCount) == 48, "PerFrameData.globalLightCount doesn't match the shader");
+static_assert(offsetof(PerFrameData, cascadeCount) == 52, "PerFrameData.cascadeCount doesn't match the shader");
+static_assert(offsetof(PerFrameData, perFramePadding) == 56, "PerFrameData.perFramePadding doesn't match the shader");
+static_assert(sizeof(PerFrameData) == 64, "PerFrameData doesn't match the shader");
+
+// PerView : register(b11), 160 bytes - shared by every shader
+struct PerViewData
+{
+    static const char* GetBufferName() { return "PerView"; }
+
+    DirectX::XMFLOAT4X4 view;
+    DirectX::XMFLOAT4X4 projection;
+    DirectX::XMFLOAT3 cameraPos;
+    float perViewPadding0;
+    DirectX::XMFLOAT3 cameraForward;
+    float perViewPadding1;
+};
+static_assert(offsetof(PerViewData, view) == 0, "PerViewData.view doesn't match the shader");
+static_assert(offsetof(PerViewData, projection) == 64, "PerViewData.projection doesn't match the shader");
+static_assert(offsetof(PerViewData, cameraPos) == 128, "PerViewData.cameraPos doesn't match the shader");
+static_assert(offsetof(PerViewData, perViewPadding0) == 140, "PerViewData.perViewPadding0 doesn't match the shader");
+static_assert(offsetof(PerViewData, cameraForward) == 144, "PerViewData.cameraForward doesn't match the shader");
+static_assert(offsetof(PerViewData, perViewPadding1) == 156, "PerViewData.perViewPadding1 doesn't match the shader");
+static_assert(sizeof(PerViewData) == 160, "PerViewData doesn't match the shader");
+
+// PerMaterial : register(b12), 32 bytes - shared by every shader
+struct PerMaterialData
+{
+    static const char* GetBufferName() { return "PerMaterial"; }
+
+    DirectX::XMFLOAT4 colorTint;
+    DirectX::XMFLOAT2 uvScale;
+    DirectX::XMFLOAT2 uvOffset;
+};
+static_assert(offsetof(PerMaterialData, colorTint) == 0, "PerMaterialData.colorTint doesn't match the shader");
+static_assert(offsetof(PerMaterialData, uvScale) == 16, "PerMaterialData.uvScale doesn't match the shader");
+static_assert(offsetof(PerMaterialData, uvOffset) == 24, "PerMaterialData.uvOffset doesn't match the shader");
+static_assert(sizeof(PerMaterialData) == 32, "PerMaterialData doesn't match the shader");
+
+// PerObject : register(b13), 224 bytes - shared by every shader
+struct PerObjectData
+{
+    static const char* GetBufferName() { return "PerObject"; }
+
+    DirectX::XMFLOAT4X4 worldViewProjection;
+    DirectX::XMFLOAT4X4 world;
+    DirectX::XMFLOAT4X4 worldInvTranspose;
+    DirectX::XMFLOAT4 instanceColorTint;
+    DirectX::XMFLOAT2 instanceUvScale;
+    DirectX::XMFLOAT2 instanceUvOffset;
+};
+static_assert(offsetof(PerObjectData, worldViewProjection) == 0, "PerObjectData.worldViewProjection doesn't match the shader");
+static_assert(offsetof(PerObjectData, world) == 64, "PerObjectData.world doesn't match the shader");
+static_assert(offsetof(PerObjectData, worldInvTranspose) == 128, "PerObjectData.worldInvTranspose doesn't match the shader");
+static_assert(offsetof(PerObjectData, instanceColorTint) == 192, "PerObjectData.instanceColorTint doesn't match the shader");
+static_assert(offsetof(PerObjectData, instanceUvScale) == 208, "PerObjectData.instanceUvScale doesn't match the shader");
+static_assert(offsetof(PerObjectData, instanceUvOffset) == 216, "PerObjectData.instanceUvOffset doesn't match the shader");
+static_assert(sizeof(PerObjectData) == 224, "PerObjectData doesn't match the shader");
+
+// ExternalData : register(b0), 32 bytes - CustomPS only
+struct CustomPSExternalData
+{
+    static const char* GetBufferName() { return "ExternalData"; }
+
+    DirectX::XMFLOAT4 colorTint;
+    float totalTime;
+    float _pad0[3];
+};
+static_assert(offsetof(CustomPSExternalData, colorTint) == 0, "CustomPSExternalData.colorTint doesn't match the shader");
+static_assert(offsetof(CustomPSExternalData, totalTime) == 16, "CustomPSExternalData.totalTime doesn't match the shader");
+static_assert(sizeof(CustomPSExternalData) == 32, "CustomPSExternalData doesn't match the shader");
+
+// ExternalData : register(b0), 16 bytes - ShadowTileVS only
+struct ShadowTileVSExternalData
+{
+    static const char* GetBufferName() { return "ExternalData"; }
+
+    float depth;
+    float _pad0[3];
+};
+static_assert(offsetof(ShadowTileVSExternalData, depth) == 0, "ShadowTileVSExternalData.depth doesn't match the shader");
+static_assert(sizeof(ShadowTileVSExternalData) == 16, "ShadowTileVSExternalData doesn't match the shader");
+
+// ExternalData : register(b0), 256 bytes - VertexShader only
+struct VertexShaderExternalData
+{
+    static const char* GetBufferName() { return "ExternalData"; }
+
+    DirectX::XMFLOAT4X4 world;
+    DirectX::XMFLOAT4X4 worldInvTranspose;
+    DirectX::XMFLOAT4X4 view;
+    DirectX::XMFLOAT4X4 projection;
+};
+static_assert(offsetof(VertexShaderExternalData, world) == 0, "VertexShaderExternalData.world doesn't match the shader");
+static_assert(offsetof(VertexShaderExternalData, worldInvTranspose) == 64, "VertexShaderExternalData.worldInvTranspose doesn't match the shader");
+static_assert(offsetof(VertexShaderExternalData, view) == 128, "VertexShaderExternalData.view doesn't match the shader");
+static_assert(offsetof(VertexShaderExternalData, projection) == 192, "VertexShaderExternalData.projection doesn't match the shader");
+static_assert(sizeof(VertexShaderExternalData) == 256, "VertexShaderExternalData doesn't match the shader");
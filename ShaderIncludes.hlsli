@@ -39,7 +39,7 @@ struct VertexToPixel_NormalMapShadowMap
 	float3 normal			: NORMAL;
 	float3 worldPosition	: POSITION;
 	float3 tangent			: TANGENT;
-	float4 shadowMapPosition: LIGHT_POSITION;
+	nointerpolation float4 instanceTint : COLOR;	// Multiplied with the material's tint
 };
 
 struct VertexToPixel_Sky 
@@ -72,6 +72,55 @@ struct VertexShaderInput
 	float3 tangent			: TANGENT;		// tangent for this vertex
 };
 
+// A vertex plus the matrices of the instance it belongs to
+// - Anything with a _PER_INSTANCE semantic comes from the instance
+//   buffer in input slot 1 (see SimpleVertexShader::CreateShader())
+// - Laid out like PerInstanceData in C++, with the matrices one
+//   column per register - use InstanceMatrix() to put them together
+struct VertexShaderInstanceInput
+{
+	float3 localPosition	: POSITION;
+	float3 normal			: NORMAL;
+	float2 uv				: TEXCOORD;
+	float3 tangent			: TANGENT;
+	float4 world0			: WORLD_PER_INSTANCE0;
+	float4 world1			: WORLD_PER_INSTANCE1;
+	float4 world2			: WORLD_PER_INSTANCE2;
+	float4 world3			: WORLD_PER_INSTANCE3;
+	float4 worldInvTranspose0	: WORLDINVTRANSPOSE_PER_INSTANCE0;
+	float4 worldInvTranspose1	: WORLDINVTRANSPOSE_PER_INSTANCE1;
+	float4 worldInvTranspose2	: WORLDINVTRANSPOSE_PER_INSTANCE2;
+	float4 worldInvTranspose3	: WORLDINVTRANSPOSE_PER_INSTANCE3;
+	float4 colorTint		: COLOR_PER_INSTANCE;
+	float4 uvScaleOffset	: UVSCALEOFFSET_PER_INSTANCE;	// Scale in xy, offset in zw
+};
+
+// Just the position, for depth-only passes.  Shaders whose only
+// per-vertex input is the position are given the pool's packed
+// position stream instead of whole vertices (see GeometryPool),
+// so nothing else per-vertex can go in these.
+struct DepthOnlyVertexInput
+{
+	float3 localPosition	: POSITION;
+};
+
+// The same plus the instance's world matrix - the first thing in
+// the instance buffer, so the rest of it can be left out
+struct DepthOnlyInstanceInput
+{
+	float3 localPosition	: POSITION;
+	float4 world0			: WORLD_PER_INSTANCE0;
+	float4 world1			: WORLD_PER_INSTANCE1;
+	float4 world2			: WORLD_PER_INSTANCE2;
+	float4 world3			: WORLD_PER_INSTANCE3;
+};
+
+// Builds a matrix from the four columns it was stored as
+matrix InstanceMatrix(float4 c0, float4 c1, float4 c2, float4 c3)
+{
+	return transpose(matrix(c0, c1, c2, c3));
+}
+
 
 
 //
@@ -84,7 +133,13 @@ struct VertexShaderInput
 
 #define MAX_SPECULAR_EXPONENT		256.0f
 
-#define LIGHT_COUNT					5
+// Clustered lighting grid - must match LightClusters.h
+#define CLUSTER_COUNT_X				16
+#define CLUSTER_COUNT_Y				9
+#define CLUSTER_COUNT_Z				24
+
+// Cascaded shadow maps - must match ShadowCascades.h
+#define MAX_SHADOW_CASCADES			4
 
 //
 // LIGHTS STRUCT--------------------------------------------------------
@@ -100,7 +155,15 @@ struct Light
 	float3 Color;					// All need a color
 	float SpotFalloff;				// Spot needs value to restrict cone
 	int ShadowCasting;				// Whether the light is shadow casting
-	float2 Padding;					// Padding to hit 16-byte boundary
+	int ShadowIndex;				// First ShadowView in the atlas, -1 if none
+	float Padding;					// Padding to hit 16-byte boundary
+};
+
+struct ShadowView
+{
+	matrix ViewProjection;
+	float4 AtlasRect;				// UV offset (xy) and scale (zw) of the tile, zero if it has none
+	float4 AtlasBounds;				// Min (xy) and max (zw) UVs that keep filtering inside the tile
 };
 
 
@@ -197,33 +260,6 @@ float3 PointLight(
 	return lightResult * attenuation;
 }
 
-float3 LightingLoop(
-	Light lights[LIGHT_COUNT], 
-	float3 normal,
-	float3 worldPosition,
-	float3 cameraPos, 
-	float roughness, 
-	float3 surfaceColor, 
-	float specMapValue)
-{
-	// Loop through lights and calculate each light's result
-	float3 finalLightResult = 0.0f;
-	for (int i = 0; i < LIGHT_COUNT; i++)
-	{
-		int type = lights[i].Type;
-		if (type == LIGHT_TYPE_DIRECTIONAL)
-		{
-			finalLightResult += DirectionalLight(lights[i], normal, worldPosition, cameraPos, roughness, surfaceColor, specMapValue);
-		}
-		if (type == LIGHT_TYPE_POINT) 
-		{
-			finalLightResult += PointLight(lights[i], normal, worldPosition, cameraPos, roughness, surfaceColor, specMapValue);
-		}
-	}
-
-	return finalLightResult;
-}
-
 // Returns reflection coefficient based on Schlick approx.
 //
 // R0 - reflection factor for material when normal is straight on
@@ -418,4 +454,34 @@ float3 PointLightPBR(Light light, float3 n, float3 camPos, float3 worldPos, floa
 	return (balancedDiff * surfaceColor + spec) * atten * light.Intensity * light.Color;
 }
 
+// Calculates spot light result for a PBR object - a point light
+// restricted to a cone around the light's direction
+float3 SpotLightPBR(Light light, float3 n, float3 camPos, float3 worldPos, float roughness, float3 specColor, float metalness, float3 surfaceColor)
+{
+	float3 dirFromLight = normalize(worldPos - light.Position);
+	float penumbra = pow(saturate(dot(dirFromLight, normalize(light.Direction))), light.SpotFalloff);
+	return PointLightPBR(light, n, camPos, worldPos, roughness, specColor, metalness, surfaceColor) * penumbra;
+}
+
+
+
+//
+// CLUSTERED LIGHTING HELPERS-------------------------------------------
+//
+
+// Finds the index of the cluster this pixel belongs to
+//
+// screenPos - SV_POSITION of the pixel
+// viewDepth - distance along the camera's forward vector
+// clusterScreenScale - clusters per pixel in x and y
+// depthScale/depthBias - slice = log(viewDepth) * depthScale + depthBias
+//
+uint GetClusterIndex(float2 screenPos, float viewDepth, float2 clusterScreenScale, float depthScale, float depthBias)
+{
+	uint3 cluster;
+	cluster.xy = min(uint2(screenPos * clusterScreenScale), uint2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+	cluster.z = (uint)clamp(floor(log(viewDepth) * depthScale + depthBias), 0, CLUSTER_COUNT_Z - 1);
+	return cluster.x + cluster.y * CLUSTER_COUNT_X + cluster.z * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+}
+
 #endif
\ No newline at end of file
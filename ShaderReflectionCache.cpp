@@ -0,0 +1,248 @@
+#include "ShaderReflectionCache.h"
+#include <cstring>
+
+#define SHADER_CACHE_MAGIC  0x31435253  // "SRC1"
+
+// The block is the header followed by each table in turn, then the
+// strings. Every record is made of 32 bit values, so the tables stay
+// aligned without padding.
+template<typename T>
+static void Append(std::vector<unsigned char>& data, const T& value)
+{
+    size_t offset = data.size();
+    data.resize(offset + sizeof(T));
+    memcpy(&data[offset], &value, sizeof(T));
+}
+
+// Adds a string to the pool and returns its offset
+static unsigned int AddString(std::vector<char>& strings, const std::string& value)
+{
+    unsigned int offset = (unsigned int)strings.size();
+    strings.insert(strings.end(), value.begin(), value.end());
+    strings.push_back(0);
+    return offset;
+}
+
+static ShaderCacheParameter MakeParameter(const DxbcSignatureParameter& param, std::vector<char>& strings)
+{
+    ShaderCacheParameter p;
+    p.SemanticName = AddString(strings, param.SemanticName);
+    p.SemanticIndex = param.SemanticIndex;
+    p.SystemValueType = param.SystemValueType;
+    p.ComponentType = param.ComponentType;
+    p.Mask = param.Mask;
+    p.Stream = param.Stream;
+    return p;
+}
+
+ShaderReflectionCache::ShaderReflectionCache()
+{
+    Clear();
+}
+
+ShaderReflectionCache::~ShaderReflectionCache()
+{
+}
+
+void ShaderReflectionCache::Clear()
+{
+    data.clear();
+    header = 0;
+    resources = 0;
+    constantBuffers = 0;
+    variables = 0;
+    inputs = 0;
+    outputs = 0;
+    strings = 0;
+}
+
+bool ShaderReflectionCache::MakeKey(const void* bytecode, size_t size, ShaderReflectionKey& key)
+{
+    // Container header: "DXBC", then the 16 byte checksum
+    if (!bytecode || size < 20 || size > 0xFFFFFFFFu || memcmp(bytecode, "DXBC", 4) != 0)
+        return false;
+
+    memcpy(key.Checksum, (const unsigned char*)bytecode + 4, sizeof(key.Checksum));
+    key.Size = (unsigned int)size;
+    return true;
+}
+
+void ShaderReflectionCache::Build(DxbcReflection& reflection, const ShaderReflectionKey& key)
+{
+    Clear();
+
+    std::vector<char> pool;
+    std::vector<ShaderCacheResource> resourceTable;
+    std::vector<ShaderCacheConstantBuffer> bufferTable;
+    std::vector<ShaderCacheVariable> variableTable;
+    std::vector<ShaderCacheParameter> inputTable;
+    std::vector<ShaderCacheParameter> outputTable;
+
+    for (auto& binding : reflection.GetResourceBindings())
+    {
+        ShaderCacheResource r;
+        r.Name = AddString(pool, binding.Name);
+        r.Type = binding.Type;
+        r.BindPoint = binding.BindPoint;
+        r.BindCount = binding.BindCount;
+        resourceTable.push_back(r);
+    }
+
+    // Bind points are looked up now so loading doesn't have to
+    for (auto& buffer : reflection.GetConstantBuffers())
+    {
+        const DxbcResourceBinding* binding = reflection.FindResourceBinding(buffer.Name);
+
+        ShaderCacheConstantBuffer b;
+        b.Name = AddString(pool, buffer.Name);
+        b.Type = buffer.Type;
+        b.Size = buffer.Size;
+        b.BindPoint = binding ? binding->BindPoint : SHADER_CACHE_UNBOUND;
+        b.FirstVariable = (unsigned int)variableTable.size();
+        b.VariableCount = (unsigned int)buffer.Variables.size();
+        bufferTable.push_back(b);
+
+        for (auto& var : buffer.Variables)
+        {
+            ShaderCacheVariable v;
+            v.Name = AddString(pool, var.Name);
+            v.StartOffset = var.StartOffset;
+            v.Size = var.Size;
+            variableTable.push_back(v);
+        }
+    }
+
+    for (auto& param : reflection.GetInputParameters())
+        inputTable.push_back(MakeParameter(param, pool));
+    for (auto& param : reflection.GetOutputParameters())
+        outputTable.push_back(MakeParameter(param, pool));
+
+    Header h;
+    h.Magic = SHADER_CACHE_MAGIC;
+    h.Version = SHADER_REFLECTION_CACHE_VERSION;
+    h.Key = key;
+    h.ShaderType = reflection.GetShaderType();
+    reflection.GetThreadGroupSize(&h.ThreadGroupSize[0], &h.ThreadGroupSize[1], &h.ThreadGroupSize[2]);
+    h.ResourceCount = (unsigned int)resourceTable.size();
+    h.ConstantBufferCount = (unsigned int)bufferTable.size();
+    h.VariableCount = (unsigned int)variableTable.size();
+    h.InputCount = (unsigned int)inputTable.size();
+    h.OutputCount = (unsigned int)outputTable.size();
+    h.StringsSize = (unsigned int)pool.size();
+
+    Append(data, h);
+    for (auto& r : resourceTable) Append(data, r);
+    for (auto& b : bufferTable) Append(data, b);
+    for (auto& v : variableTable) Append(data, v);
+    for (auto& p : inputTable) Append(data, p);
+    for (auto& p : outputTable) Append(data, p);
+    data.insert(data.end(), pool.begin(), pool.end());
+
+    FixUp();
+}
+
+bool ShaderReflectionCache::Load(std::vector<unsigned char>&& cacheData, const ShaderReflectionKey& key)
+{
+    Clear();
+    if (cacheData.size() < sizeof(Header))
+        return false;
+
+    // Check it's for this exact shader code before using it
+    Header h;
+    memcpy(&h, cacheData.data(), sizeof(Header));
+    if (h.Magic != SHADER_CACHE_MAGIC ||
+        h.Version != SHADER_REFLECTION_CACHE_VERSION ||
+        memcmp(&h.Key, &key, sizeof(ShaderReflectionKey)) != 0)
+    {
+        return false;
+    }
+
+    data.swap(cacheData);
+    if (!FixUp())
+    {
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+unsigned int ShaderReflectionCache::GetThreadGroupSize(unsigned int* x, unsigned int* y, unsigned int* z)
+{
+    unsigned int size[3] = { 0, 0, 0 };
+    if (header)
+        memcpy(size, header->ThreadGroupSize, sizeof(size));
+
+    if (x) *x = size[0];
+    if (y) *y = size[1];
+    if (z) *z = size[2];
+    return size[0] * size[1] * size[2];
+}
+
+// Points at the tables inside the block, after checking the counts
+// add up to its size and every reference inside it is in range
+bool ShaderReflectionCache::FixUp()
+{
+    if (data.size() < sizeof(Header))
+        return false;
+
+    const Header* h = (const Header*)data.data();
+
+    // Counts are checked one at a time so the total can't overflow
+    size_t remaining = data.size() - sizeof(Header);
+    const unsigned int counts[] = { h->ResourceCount, h->ConstantBufferCount, h->VariableCount, h->InputCount, h->OutputCount };
+    const size_t sizes[] = { sizeof(ShaderCacheResource), sizeof(ShaderCacheConstantBuffer), sizeof(ShaderCacheVariable), sizeof(ShaderCacheParameter), sizeof(ShaderCacheParameter) };
+    for (int i = 0; i < 5; i++)
+    {
+        if (counts[i] > remaining / sizes[i])
+            return false;
+        remaining -= counts[i] * sizes[i];
+    }
+    if (remaining != h->StringsSize)
+        return false;
+
+    const unsigned char* p = data.data() + sizeof(Header);
+    const ShaderCacheResource* res = (const ShaderCacheResource*)p;
+    p += h->ResourceCount * sizeof(ShaderCacheResource);
+    const ShaderCacheConstantBuffer* cbs = (const ShaderCacheConstantBuffer*)p;
+    p += h->ConstantBufferCount * sizeof(ShaderCacheConstantBuffer);
+    const ShaderCacheVariable* vars = (const ShaderCacheVariable*)p;
+    p += h->VariableCount * sizeof(ShaderCacheVariable);
+    const ShaderCacheParameter* ins = (const ShaderCacheParameter*)p;
+    p += h->InputCount * sizeof(ShaderCacheParameter);
+    const ShaderCacheParameter* outs = (const ShaderCacheParameter*)p;
+    p += h->OutputCount * sizeof(ShaderCacheParameter);
+    const char* pool = (const char*)p;
+
+    // Every name must start inside the pool, and the pool must end
+    // in a terminator, so every name ends inside it too
+    if (h->StringsSize > 0 && pool[h->StringsSize - 1] != 0)
+        return false;
+    auto validName = [&](unsigned int offset) { return offset < h->StringsSize; };
+
+    for (unsigned int i = 0; i < h->ResourceCount; i++)
+        if (!validName(res[i].Name)) return false;
+    for (unsigned int i = 0; i < h->ConstantBufferCount; i++)
+    {
+        if (!validName(cbs[i].Name) ||
+            cbs[i].FirstVariable > h->VariableCount ||
+            cbs[i].VariableCount > h->VariableCount - cbs[i].FirstVariable)
+        {
+            return false;
+        }
+    }
+    for (unsigned int i = 0; i < h->VariableCount; i++)
+        if (!validName(vars[i].Name)) return false;
+    for (unsigned int i = 0; i < h->InputCount; i++)
+        if (!validName(ins[i].SemanticName)) return false;
+    for (unsigned int i = 0; i < h->OutputCount; i++)
+        if (!validName(outs[i].SemanticName)) return false;
+
+    header = h;
+    resources = res;
+    constantBuffers = cbs;
+    variables = vars;
+    inputs = ins;
+    outputs = outs;
+    strings = pool;
+    return true;
+}
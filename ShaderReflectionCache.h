@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "DxbcReflection.h"
+
+// Bump whenever the layout below changes, so old files are ignored
+#define SHADER_REFLECTION_CACHE_VERSION 1
+
+// Identifies the shader code a cache was made from: the checksum
+// from the DXBC container header plus the code's size
+struct ShaderReflectionKey
+{
+    unsigned int Checksum[4];
+    unsigned int Size;
+};
+
+// The records stored in a cache. Names are offsets into the string
+// pool at the end of the data - use GetString() to look them up.
+struct ShaderCacheResource
+{
+    unsigned int Name;
+    unsigned int Type;          // DXBC_INPUT_*
+    unsigned int BindPoint;
+    unsigned int BindCount;
+};
+
+struct ShaderCacheConstantBuffer
+{
+    unsigned int Name;
+    unsigned int Type;          // D3D_CBUFFER_TYPE
+    unsigned int Size;
+    unsigned int BindPoint;     // SHADER_CACHE_UNBOUND if it isn't bound
+    unsigned int FirstVariable;
+    unsigned int VariableCount;
+};
+
+struct ShaderCacheVariable
+{
+    unsigned int Name;
+    unsigned int StartOffset;
+    unsigned int Size;
+};
+
+struct ShaderCacheParameter
+{
+    unsigned int SemanticName;
+    unsigned int SemanticIndex;
+    unsigned int SystemValueType;
+    unsigned int ComponentType;
+    unsigned int Mask;
+    unsigned int Stream;
+};
+
+#define SHADER_CACHE_UNBOUND 0xFFFFFFFFu
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from a shader's reflection,
+// flattened into one block of memory that can be written to
+// a file next to the .cso and read back in a single go.
+//
+// Build() makes the block from reflected shader code, Load()
+// takes one from a file after checking it was made from the
+// same code. Either way the tables are then read in place -
+// the only work on load is checking the block and pointing
+// at the tables inside it.
+//
+// The block is in the machine's native (little endian) byte
+// order.
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+    ShaderReflectionCache();
+    ~ShaderReflectionCache();
+
+    // Reads the key out of shader code - false if it isn't DXBC
+    static bool MakeKey(const void* bytecode, size_t size, ShaderReflectionKey& key);
+
+    void Build(DxbcReflection& reflection, const ShaderReflectionKey& key);
+
+    // Takes over the contents of a cache file, or returns false and
+    // keeps nothing if it's broken or was made from other code
+    bool Load(std::vector<unsigned char>&& cacheData, const ShaderReflectionKey& key);
+
+    // The block to save, after Build() or Load()
+    const std::vector<unsigned char>& GetData() { return data; }
+
+    unsigned int GetShaderType() { return header ? header->ShaderType : (unsigned int)DXBC_SHADER_UNKNOWN; }
+    unsigned int GetThreadGroupSize(unsigned int* x, unsigned int* y, unsigned int* z);
+
+    unsigned int GetResourceCount() { return header ? header->ResourceCount : 0; }
+    unsigned int GetConstantBufferCount() { return header ? header->ConstantBufferCount : 0; }
+    unsigned int GetInputCount() { return header ? header->InputCount : 0; }
+    unsigned int GetOutputCount() { return header ? header->OutputCount : 0; }
+
+    const ShaderCacheResource* GetResources() { return resources; }
+    const ShaderCacheConstantBuffer* GetConstantBuffers() { return constantBuffers; }
+    const ShaderCacheVariable* GetVariables() { return variables; }
+    const ShaderCacheParameter* GetInputs() { return inputs; }
+    const ShaderCacheParameter* GetOutputs() { return outputs; }
+    const char* GetString(unsigned int offset) { return strings + offset; }
+
+private:
+    struct Header
+    {
+        unsigned int Magic;
+        unsigned int Version;
+        ShaderReflectionKey Key;
+        unsigned int ShaderType;
+        unsigned int ThreadGroupSize[3];
+        unsigned int ResourceCount;
+        unsigned int ConstantBufferCount;
+        unsigned int VariableCount;
+        unsigned int InputCount;
+        unsigned int OutputCount;
+        unsigned int StringsSize;
+    };
+
+    std::vector<unsigned char> data;
+
+    // Point into data once it's been checked
+    const Header* header;
+    const ShaderCacheResource* resources;
+    const ShaderCacheConstantBuffer* constantBuffers;
+    const ShaderCacheVariable* variables;
+    const ShaderCacheParameter* inputs;
+    const ShaderCacheParameter* outputs;
+    const char* strings;
+
+    void Clear();
+    bool FixUp();
+};
@@ -0,0 +1,117 @@
+#include "ShaderVariants.h"
+
+ShaderVariantKey MakeShaderVariantKey(unsigned int features, ShaderLightBucket lights)
+{
+    return (features & SHADER_FEATURE_MASK) | ((unsigned int)lights << SHADER_LIGHT_BUCKET_SHIFT);
+}
+
+unsigned int GetShaderVariantFeatures(ShaderVariantKey key)
+{
+    return key & SHADER_FEATURE_MASK;
+}
+
+ShaderLightBucket GetShaderVariantLights(ShaderVariantKey key)
+{
+    return (ShaderLightBucket)((key >> SHADER_LIGHT_BUCKET_SHIFT) & 0x3);
+}
+
+ShaderLightBucket GetShaderLightBucket(unsigned int lightCount)
+{
+    if (lightCount == 0) return SHADER_LIGHTS_NONE;
+    if (lightCount == 1) return SHADER_LIGHTS_ONE;
+    if (lightCount <= SHADER_LIGHTS_FEW_MAX) return SHADER_LIGHTS_FEW;
+    return SHADER_LIGHTS_ANY;
+}
+
+unsigned int GetShaderFeatureForTexture(const std::string& textureName)
+{
+    if (textureName == "NormalMap") return SHADER_FEATURE_NORMAL_MAP;
+    if (textureName == "SkyTexture") return SHADER_FEATURE_REFLECTION;
+    if (textureName == "ShadowMap") return SHADER_FEATURE_SHADOWS;
+    return 0;
+}
+
+std::string GetShaderVariantName(const std::string& baseName, ShaderVariantKey key)
+{
+    std::string features;
+    unsigned int bits = GetShaderVariantFeatures(key);
+    if (bits & SHADER_FEATURE_NORMAL_MAP) features += 'N';
+    if (bits & SHADER_FEATURE_REFLECTION) features += 'R';
+    if (bits & SHADER_FEATURE_SHADOWS) features += 'S';
+    if (bits & SHADER_FEATURE_INSTANCING) features += 'I';
+
+    std::string name = baseName;
+    if (!features.empty())
+        name += "_" + features;
+
+    ShaderLightBucket lights = GetShaderVariantLights(key);
+    if (lights != SHADER_LIGHTS_NONE)
+        name += "_L" + std::to_string((int)lights);
+
+    return name;
+}
+
+// Number of set bits - there are only four features
+static unsigned int CountFeatures(unsigned int features)
+{
+    unsigned int count = 0;
+    for (; features; features &= features - 1)
+        count++;
+    return count;
+}
+
+ShaderVariantSelector::ShaderVariantSelector()
+{
+}
+
+ShaderVariantSelector::~ShaderVariantSelector()
+{
+}
+
+unsigned int ShaderVariantSelector::Add(ShaderVariantKey key)
+{
+    variants.push_back(key);
+
+    // A new variant might be tighter than earlier answers
+    selections.clear();
+    return (unsigned int)variants.size() - 1;
+}
+
+bool ShaderVariantSelector::Covers(ShaderVariantKey variant, ShaderVariantKey request)
+{
+    unsigned int requested = GetShaderVariantFeatures(request);
+    unsigned int features = GetShaderVariantFeatures(variant);
+    return
+        (features & requested) == requested &&
+        ((features ^ requested) & SHADER_FEATURE_EXACT_MASK) == 0 &&
+        GetShaderVariantLights(variant) >= GetShaderVariantLights(request);
+}
+
+int ShaderVariantSelector::Select(ShaderVariantKey request)
+{
+    auto found = selections.find(request);
+    if (found != selections.end())
+        return found->second;
+
+    int best = -1;
+    unsigned int bestExtra = 0;
+    ShaderLightBucket bestLights = SHADER_LIGHTS_NONE;
+    for (unsigned int i = 0; i < variants.size(); i++)
+    {
+        if (!Covers(variants[i], request))
+            continue;
+
+        // Features the request didn't ask for are paid for by every pixel
+        unsigned int extra = CountFeatures(GetShaderVariantFeatures(variants[i]) & ~GetShaderVariantFeatures(request));
+        ShaderLightBucket lights = GetShaderVariantLights(variants[i]);
+        if (best < 0 || extra < bestExtra || (extra == bestExtra && lights < bestLights))
+        {
+            best = (int)i;
+            bestExtra = extra;
+            bestLights = lights;
+        }
+    }
+
+    selections[request] = best;
+    return best;
+}
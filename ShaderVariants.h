@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Feature keywords - each one matches a FEATURE_[X] define in the
+// uber shaders (LitPixelShader.hlsli and LitVertexShader.hlsli)
+#define SHADER_FEATURE_NORMAL_MAP   0x1
+#define SHADER_FEATURE_REFLECTION   0x2
+#define SHADER_FEATURE_SHADOWS      0x4
+#define SHADER_FEATURE_INSTANCING   0x8
+#define SHADER_FEATURE_MASK         0xF
+
+// Features a variant can only have if they're asked for. A normal
+// mapped variant samples a NormalMap the material doesn't have, and
+// an instanced vertex shader reads an instance stream that isn't bound.
+#define SHADER_FEATURE_EXACT_MASK   (SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_INSTANCING)
+
+// How many directional lights a variant has slots for. Matches
+// LIGHT_BUCKET in the shaders - the pixel shader loop is unrolled
+// for the bucket's capacity, except for ANY, which loops over
+// however many there are.
+enum ShaderLightBucket
+{
+    SHADER_LIGHTS_NONE,
+    SHADER_LIGHTS_ONE,
+    SHADER_LIGHTS_FEW,
+    SHADER_LIGHTS_ANY
+};
+
+// Capacity of SHADER_LIGHTS_FEW - must match LIGHT_BUCKET_FEW_MAX
+#define SHADER_LIGHTS_FEW_MAX       4
+
+// A variant key is the feature bits with the light bucket above them
+typedef unsigned int ShaderVariantKey;
+#define SHADER_LIGHT_BUCKET_SHIFT   4
+
+ShaderVariantKey MakeShaderVariantKey(unsigned int features, ShaderLightBucket lights);
+unsigned int GetShaderVariantFeatures(ShaderVariantKey key);
+ShaderLightBucket GetShaderVariantLights(ShaderVariantKey key);
+
+// The smallest bucket with room for this many lights
+ShaderLightBucket GetShaderLightBucket(unsigned int lightCount);
+
+// The feature a material texture turns on, by its name in the
+// shader, or 0 if it doesn't need one
+unsigned int GetShaderFeatureForTexture(const std::string& textureName);
+
+// The name a variant is compiled to, e.g. "LitPS_NRS_L2" for a base
+// of "LitPS" - feature letters (N, R, S, I) then the light bucket,
+// each left off when there's nothing to put in it
+std::string GetShaderVariantName(const std::string& baseName, ShaderVariantKey key);
+
+// --------------------------------------------------------
+// Picks which of the compiled variants of a shader to use.
+//
+// Only some combinations of features are compiled, so the
+// request is matched to the tightest variant that covers it:
+// every feature asked for, none of SHADER_FEATURE_EXACT_MASK
+// that wasn't, and room for at least as many lights. Of those,
+// the one with the fewest extra features wins, then the one
+// with the smallest light bucket. Answers are remembered,
+// since the same few keys are asked for over and over.
+// --------------------------------------------------------
+class ShaderVariantSelector
+{
+public:
+    ShaderVariantSelector();
+    ~ShaderVariantSelector();
+
+    // Adds an available variant - indices count up from 0
+    unsigned int Add(ShaderVariantKey key);
+
+    // Index of the variant to use, or -1 if none covers the request
+    int Select(ShaderVariantKey request);
+
+    // Whether a variant can stand in for the request
+    static bool Covers(ShaderVariantKey variant, ShaderVariantKey request);
+
+    unsigned int GetCount() { return (unsigned int)variants.size(); }
+    ShaderVariantKey GetKey(unsigned int index) { return variants[index]; }
+
+private:
+    std::vector<ShaderVariantKey> variants;
+    std::unordered_map<ShaderVariantKey, int> selections;
+};
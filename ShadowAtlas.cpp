@@ -0,0 +1,231 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+
+ShadowAtlas::ShadowAtlas(unsigned int atlasSize, unsigned int minTileSize) :
+    atlasSize(atlasSize),
+    minTileSize(std::min(minTileSize, atlasSize)),
+    levelCount(0),
+    frameNumber(0),
+    lastRepackCount(0)
+{
+    // One level per halving of the tile size
+    unsigned int nodeCount = 0;
+    unsigned int levelNodes = 1;
+    for (unsigned int size = atlasSize; size >= this->minTileSize; size /= 2)
+    {
+        nodeCount += levelNodes;
+        levelNodes *= 4;
+        levelCount++;
+    }
+
+    nodes.resize(nodeCount, NODE_FREE);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+}
+
+unsigned int ShadowAtlas::ClampTileSize(unsigned int size)
+{
+    // Round down to a power of two within the atlas' range
+    unsigned int tileSize = atlasSize;
+    while (tileSize > size && tileSize > minTileSize)
+        tileSize /= 2;
+
+    return tileSize;
+}
+
+int ShadowAtlas::GetLevel(unsigned int size)
+{
+    int level = 0;
+    for (unsigned int levelSize = atlasSize; levelSize > size && level < levelCount - 1; levelSize /= 2)
+        level++;
+
+    return level;
+}
+
+bool ShadowAtlas::Allocate(unsigned int size, ShadowAtlasTile& tile)
+{
+    int targetLevel = GetLevel(ClampTileSize(size));
+
+    // Prefer holes in already split nodes before splitting new ones
+    int node = FindNode(0, 0, 0, 0, targetLevel, false, tile);
+    if (node < 0)
+        node = FindNode(0, 0, 0, 0, targetLevel, true, tile);
+
+    return node >= 0;
+}
+
+int ShadowAtlas::FindNode(
+    int node,
+    int level,
+    unsigned int x,
+    unsigned int y,
+    int targetLevel,
+    bool allowSplit,
+    ShadowAtlasTile& tile)
+{
+    if (nodes[node] == NODE_USED)
+        return -1;
+
+    if (level == targetLevel)
+    {
+        if (nodes[node] != NODE_FREE)
+            return -1;
+
+        nodes[node] = NODE_USED;
+        tile.Node = node;
+        tile.X = x;
+        tile.Y = y;
+        tile.Size = atlasSize >> level;
+        return node;
+    }
+
+    if (nodes[node] == NODE_FREE)
+    {
+        if (!allowSplit)
+            return -1;
+
+        // Split it - the children are already marked free
+        nodes[node] = NODE_SPLIT;
+    }
+
+    unsigned int childSize = atlasSize >> (level + 1);
+    for (int c = 0; c < 4; c++)
+    {
+        int child = node * 4 + 1 + c;
+        int found = FindNode(
+            child,
+            level + 1,
+            x + (c % 2) * childSize,
+            y + (c / 2) * childSize,
+            targetLevel,
+            allowSplit,
+            tile);
+
+        if (found >= 0)
+            return found;
+    }
+
+    // Didn't end up using a node we just split, so merge it back
+    if (allowSplit &&
+        nodes[node * 4 + 1] == NODE_FREE &&
+        nodes[node * 4 + 2] == NODE_FREE &&
+        nodes[node * 4 + 3] == NODE_FREE &&
+        nodes[node * 4 + 4] == NODE_FREE)
+    {
+        nodes[node] = NODE_FREE;
+    }
+
+    return -1;
+}
+
+void ShadowAtlas::Free(const ShadowAtlasTile& tile)
+{
+    if (tile.Node < 0)
+        return;
+
+    // Free the node, then merge parents whose children are all free
+    int node = tile.Node;
+    nodes[node] = NODE_FREE;
+    while (node > 0)
+    {
+        int parent = (node - 1) / 4;
+        for (int c = 1; c <= 4; c++)
+        {
+            if (nodes[parent * 4 + c] != NODE_FREE)
+                return;
+        }
+
+        nodes[parent] = NODE_FREE;
+        node = parent;
+    }
+}
+
+void ShadowAtlas::AssignTiles(std::vector<ShadowTileRequest>& requests)
+{
+    frameNumber++;
+    lastRepackCount = 0;
+
+    // Mark which tiles are still wanted at the same size
+    for (auto& request : requests)
+    {
+        auto it = assignedTiles.find(request.Key);
+        if (it != assignedTiles.end() && it->second.DesiredSize == ClampTileSize(request.Size))
+            it->second.LastFrame = frameNumber;
+    }
+
+    // Release tiles of views that went away or changed size
+    bool spaceFreed = false;
+    for (auto it = assignedTiles.begin(); it != assignedTiles.end();)
+    {
+        if (it->second.LastFrame != frameNumber)
+        {
+            Free(it->second.Tile);
+            it = assignedTiles.erase(it);
+            spaceFreed = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Views that got a smaller tile than they wanted get another try
+    // when there's new room, otherwise they keep what they have
+    if (spaceFreed)
+    {
+        for (auto it = assignedTiles.begin(); it != assignedTiles.end();)
+        {
+            if (it->second.Tile.Size < it->second.DesiredSize)
+            {
+                Free(it->second.Tile);
+                it = assignedTiles.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // Serve the remaining requests, most important first
+    requestOrder.resize(requests.size());
+    for (unsigned int i = 0; i < requests.size(); i++)
+        requestOrder[i] = i;
+
+    std::stable_sort(requestOrder.begin(), requestOrder.end(),
+        [&](unsigned int a, unsigned int b) { return requests[a].Importance > requests[b].Importance; });
+
+    for (unsigned int i : requestOrder)
+    {
+        ShadowTileRequest& request = requests[i];
+        unsigned int desiredSize = ClampTileSize(request.Size);
+
+        auto it = assignedTiles.find(request.Key);
+        if (it != assignedTiles.end())
+        {
+            request.Tile = it->second.Tile;
+            request.Allocated = true;
+            continue;
+        }
+
+        // Fall back to smaller tiles until something fits
+        request.Allocated = false;
+        request.Tile = { -1, 0, 0, 0 };
+        for (unsigned int size = desiredSize; size >= minTileSize; size /= 2)
+        {
+            if (Allocate(size, request.Tile))
+            {
+                request.Allocated = true;
+                break;
+            }
+        }
+
+        if (request.Allocated)
+        {
+            assignedTiles[request.Key] = { request.Tile, desiredSize, frameNumber };
+            lastRepackCount++;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+// A square region of the atlas, in texels
+struct ShadowAtlasTile
+{
+    int Node;           // Quadtree node that owns the tile, -1 if none
+    unsigned int X;
+    unsigned int Y;
+    unsigned int Size;
+};
+
+// One shadow view asking for space in the atlas. Key must stay the same
+// from frame to frame for the view to keep its tile.
+struct ShadowTileRequest
+{
+    unsigned int Key;
+    unsigned int Size;      // Desired size, must be a power of two
+    float Importance;       // Higher is served first
+
+    // Filled in by ShadowAtlas::AssignTiles()
+    ShadowAtlasTile Tile;
+    bool Allocated;
+};
+
+// --------------------------------------------------------
+// Carves a single square shadow map into power-of-two tiles
+// using a quadtree (buddy) allocator.
+//
+// Tiles are kept between frames and only re-packed when the
+// view they belong to goes away or asks for a different size.
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+    ShadowAtlas(unsigned int atlasSize = 4096, unsigned int minTileSize = 128);
+    ~ShadowAtlas();
+
+    // Assigns a tile to every request, most important first. Requests that
+    // don't fit at their size fall back to smaller tiles, down to the
+    // minimum size, and are left unallocated after that.
+    void AssignTiles(std::vector<ShadowTileRequest>& requests);
+
+    // Raw allocation - returns false if there's no room
+    bool Allocate(unsigned int size, ShadowAtlasTile& tile);
+    void Free(const ShadowAtlasTile& tile);
+
+    // Rounds a size to a tile size this atlas can hand out
+    unsigned int ClampTileSize(unsigned int size);
+
+    unsigned int GetAtlasSize() { return atlasSize; }
+    unsigned int GetMinTileSize() { return minTileSize; }
+
+    // Number of tiles (re)allocated by the last AssignTiles() call
+    unsigned int GetLastRepackCount() { return lastRepackCount; }
+
+private:
+    enum NodeState : unsigned char
+    {
+        NODE_FREE,
+        NODE_SPLIT,
+        NODE_USED
+    };
+
+    unsigned int atlasSize;
+    unsigned int minTileSize;
+    int levelCount;
+
+    // Implicit quadtree: the children of node i are 4i+1 to 4i+4
+    std::vector<NodeState> nodes;
+
+    // Tiles handed out by AssignTiles(), by request key
+    struct AssignedTile
+    {
+        ShadowAtlasTile Tile;
+        unsigned int DesiredSize;   // May be bigger than the tile if it didn't fit
+        unsigned int LastFrame;     // Last AssignTiles() call that asked for it
+    };
+    std::unordered_map<unsigned int, AssignedTile> assignedTiles;
+    std::vector<unsigned int> requestOrder;
+    unsigned int frameNumber;
+    unsigned int lastRepackCount;
+
+    // Searches the subtree under node for a free tile on targetLevel.
+    // Only splits free nodes when allowSplit is true, so existing
+    // partially used nodes are filled up first.
+    int FindNode(
+        int node,
+        int level,
+        unsigned int x,
+        unsigned int y,
+        int targetLevel,
+        bool allowSplit,
+        ShadowAtlasTile& tile);
+    int GetLevel(unsigned int size);
+};
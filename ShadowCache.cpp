@@ -0,0 +1,122 @@
+#include "ShadowCache.h"
+#include <cstring>
+
+ShadowCache::ShadowCache() :
+    frameNumber(0),
+    skippedCount(0),
+    staticReuseCount(0),
+    fullRedrawCount(0)
+{
+}
+
+ShadowCache::~ShadowCache()
+{
+}
+
+void ShadowCache::BeginFrame()
+{
+    frameNumber++;
+    skippedCount = 0;
+    staticReuseCount = 0;
+    fullRedrawCount = 0;
+}
+
+ShadowCacheUpdate ShadowCache::Check(
+    unsigned int key,
+    const DirectX::XMFLOAT4X4& view,
+    const DirectX::XMFLOAT4X4& projection,
+    const ShadowAtlasTile& tile,
+    const ShadowCasterState* staticCasters,
+    size_t staticCasterCount,
+    bool hasDynamicCasters)
+{
+    auto it = views.find(key);
+    if (it == views.end())
+        return SHADOW_UPDATE_ALL;
+
+    CachedView& cached = it->second;
+    cached.LastFrame = frameNumber;
+
+    // Has the light, the projection or the tile moved?
+    bool viewChanged =
+        memcmp(&cached.View, &view, sizeof(view)) != 0 ||
+        memcmp(&cached.Projection, &projection, sizeof(projection)) != 0 ||
+        cached.Tile.Node != tile.Node;
+
+    // Has any static caster moved, appeared or disappeared?
+    bool staticChanged = viewChanged || cached.StaticCasters.size() != staticCasterCount;
+    for (size_t i = 0; i < staticCasterCount && !staticChanged; i++)
+    {
+        staticChanged =
+            cached.StaticCasters[i].Caster != staticCasters[i].Caster ||
+            cached.StaticCasters[i].Version != staticCasters[i].Version;
+    }
+
+    if (staticChanged)
+        return SHADOW_UPDATE_ALL;
+
+    // Moving casters need redrawing, and so does a tile that had
+    // moving casters last time so they don't leave a trail
+    if (hasDynamicCasters || cached.HadDynamicCasters)
+        return SHADOW_UPDATE_DYNAMIC;
+
+    skippedCount++;
+    return SHADOW_UPDATE_NONE;
+}
+
+void ShadowCache::MarkDrawn(
+    unsigned int key,
+    const DirectX::XMFLOAT4X4& view,
+    const DirectX::XMFLOAT4X4& projection,
+    const ShadowAtlasTile& tile,
+    const ShadowCasterState* staticCasters,
+    size_t staticCasterCount,
+    bool hasDynamicCasters,
+    ShadowCacheUpdate update)
+{
+    CachedView& cached = views[key];
+    cached.View = view;
+    cached.Projection = projection;
+    cached.Tile = tile;
+    cached.StaticCasters.assign(staticCasters, staticCasters + staticCasterCount);
+    cached.HadDynamicCasters = hasDynamicCasters;
+    cached.LastFrame = frameNumber;
+
+    if (update == SHADOW_UPDATE_ALL)
+        fullRedrawCount++;
+    else if (update == SHADOW_UPDATE_DYNAMIC)
+        staticReuseCount++;
+}
+
+bool ShadowCache::HasContents(unsigned int key, const ShadowAtlasTile& tile)
+{
+    auto it = views.find(key);
+    return it != views.end() && it->second.Tile.Node == tile.Node;
+}
+
+bool ShadowCache::GetDrawnMatrices(unsigned int key, DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& projection)
+{
+    auto it = views.find(key);
+    if (it == views.end())
+        return false;
+
+    view = it->second.View;
+    projection = it->second.Projection;
+    return true;
+}
+
+void ShadowCache::EndFrame()
+{
+    for (auto it = views.begin(); it != views.end();)
+    {
+        if (it->second.LastFrame != frameNumber)
+            it = views.erase(it);
+        else
+            ++it;
+    }
+}
+
+void ShadowCache::Invalidate()
+{
+    views.clear();
+}
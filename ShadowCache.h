@@ -0,0 +1,101 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_map>
+#include "ShadowAtlas.h"
+
+// How much of a shadow view has to be redrawn this frame
+enum ShadowCacheUpdate
+{
+    SHADOW_UPDATE_NONE,     // Atlas tile is still correct, skip the view entirely
+    SHADOW_UPDATE_DYNAMIC,  // Static layer is fine, re-composite it and redraw moving casters
+    SHADOW_UPDATE_ALL       // Static layer has to be redrawn too
+};
+
+// A caster as the cache sees it: identity plus transform version
+struct ShadowCasterState
+{
+    const void* Caster;
+    unsigned int Version;
+};
+
+// --------------------------------------------------------
+// Tracks what went into each shadow view last time it was
+// drawn, so views whose light, tile and casters haven't
+// changed can be reused instead of redrawn.
+//
+// Each view has two layers:
+//  - A static layer with the casters that aren't moving,
+//    only redrawn when the view or those casters change
+//  - The final tile, which is the static layer plus any
+//    moving casters drawn on top
+// --------------------------------------------------------
+class ShadowCache
+{
+public:
+    ShadowCache();
+    ~ShadowCache();
+
+    // Call before checking any views for the frame
+    void BeginFrame();
+
+    // Works out what has to be redrawn for the given view, without
+    // remembering anything. Static casters must be in a consistent
+    // order from frame to frame.
+    ShadowCacheUpdate Check(
+        unsigned int key,
+        const DirectX::XMFLOAT4X4& view,
+        const DirectX::XMFLOAT4X4& projection,
+        const ShadowAtlasTile& tile,
+        const ShadowCasterState* staticCasters,
+        size_t staticCasterCount,
+        bool hasDynamicCasters);
+
+    // Remembers the state a view was just drawn with. Views that were
+    // checked but not drawn keep their old (stale) contents.
+    void MarkDrawn(
+        unsigned int key,
+        const DirectX::XMFLOAT4X4& view,
+        const DirectX::XMFLOAT4X4& projection,
+        const ShadowAtlasTile& tile,
+        const ShadowCasterState* staticCasters,
+        size_t staticCasterCount,
+        bool hasDynamicCasters,
+        ShadowCacheUpdate update);
+
+    // True if the given tile holds something drawn for this view,
+    // even if it's out of date
+    bool HasContents(unsigned int key, const ShadowAtlasTile& tile);
+
+    // The matrices this view's contents were drawn with
+    bool GetDrawnMatrices(unsigned int key, DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& projection);
+
+    // Forgets views that weren't checked since BeginFrame()
+    void EndFrame();
+
+    // Forgets everything, forcing a full redraw of every view
+    void Invalidate();
+
+    // Per-frame counts from the last BeginFrame()/EndFrame() pair
+    unsigned int GetSkippedCount() { return skippedCount; }
+    unsigned int GetStaticReuseCount() { return staticReuseCount; }
+    unsigned int GetFullRedrawCount() { return fullRedrawCount; }
+
+private:
+    struct CachedView
+    {
+        DirectX::XMFLOAT4X4 View;
+        DirectX::XMFLOAT4X4 Projection;
+        ShadowAtlasTile Tile;
+        std::vector<ShadowCasterState> StaticCasters;
+        bool HadDynamicCasters;
+        unsigned int LastFrame;
+    };
+
+    std::unordered_map<unsigned int, CachedView> views;
+    unsigned int frameNumber;
+
+    unsigned int skippedCount;
+    unsigned int staticReuseCount;
+    unsigned int fullRedrawCount;
+};
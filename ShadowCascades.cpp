@@ -0,0 +1,175 @@
+#include "ShadowCascades.h"
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+ShadowCascades::ShadowCascades(
+    int cascadeCount,
+    unsigned int resolution,
+    float shadowDistance,
+    float splitLambda,
+    float casterDistance) :
+    resolution(resolution),
+    shadowDistance(shadowDistance),
+    splitLambda(splitLambda),
+    casterDistance(casterDistance)
+{
+    SetCascadeCount(cascadeCount);
+
+    // Start off with valid (if meaningless) data
+    for (auto& c : cascades)
+    {
+        c = {};
+        XMStoreFloat4x4(&c.View, XMMatrixIdentity());
+        XMStoreFloat4x4(&c.Projection, XMMatrixIdentity());
+        XMStoreFloat4x4(&c.ViewProjection, XMMatrixIdentity());
+    }
+}
+
+ShadowCascades::~ShadowCascades()
+{
+}
+
+void ShadowCascades::SetCascadeCount(int count)
+{
+    cascadeCount = std::min(std::max(count, 1), MAX_SHADOW_CASCADES);
+}
+
+void ShadowCascades::ComputeSplits(float nearClip, float farClip, int count, float lambda, float* splits)
+{
+    for (int i = 0; i <= count; i++)
+    {
+        float t = (float)i / count;
+        float logSplit = nearClip * std::pow(farClip / nearClip, t);
+        float uniformSplit = nearClip + (farClip - nearClip) * t;
+        splits[i] = lambda * logSplit + (1 - lambda) * uniformSplit;
+    }
+
+    // Avoid any floating point drift at the ends
+    splits[0] = nearClip;
+    splits[count] = farClip;
+}
+
+void ShadowCascades::Update(
+    const DirectX::XMFLOAT4X4& cameraView,
+    float fov,
+    float aspectRatio,
+    float nearClip,
+    float farClip,
+    DirectX::XMFLOAT3 lightDirection)
+{
+    float splits[MAX_SHADOW_CASCADES + 1];
+    ComputeSplits(nearClip, std::min(farClip, shadowDistance), cascadeCount, splitLambda, splits);
+
+    XMMATRIX cameraWorld = XMMatrixInverse(0, XMLoadFloat4x4(&cameraView));
+    XMVECTOR lightDir = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+    float tanHalfFovY = std::tan(fov / 2);
+    float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+    for (int i = 0; i < cascadeCount; i++)
+    {
+        cascades[i].SplitNear = splits[i];
+        cascades[i].SplitFar = splits[i + 1];
+        FitCascade(cascades[i], cameraWorld, tanHalfFovX, tanHalfFovY, lightDir);
+    }
+}
+
+void ShadowCascades::FitCascade(
+    ShadowCascade& cascade,
+    DirectX::FXMMATRIX cameraWorld,
+    float tanHalfFovX,
+    float tanHalfFovY,
+    DirectX::FXMVECTOR lightDirection)
+{
+    float n = cascade.SplitNear;
+    float f = cascade.SplitFar;
+
+    // The slice's corners are symmetric around the view axis, so the
+    // smallest enclosing sphere is centered on it. Its size depends only
+    // on the slice shape, which means it doesn't change as the camera
+    // rotates and the shadow map doesn't shimmer.
+    float cornerScaleSq = tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY;
+    float centerZ = std::min((n + f) * (1 + cornerScaleSq) / 2, f);
+    float nearDistSq = n * n * cornerScaleSq + (centerZ - n) * (centerZ - n);
+    float farDistSq = f * f * cornerScaleSq + (f - centerZ) * (f - centerZ);
+    float radius = std::sqrt(std::max(nearDistSq, farDistSq));
+
+    // Quantize the radius so tiny floating point changes don't rescale the map
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    XMVECTOR center = XMVector3Transform(XMVectorSet(0, 0, centerZ, 1), cameraWorld);
+    XMStoreFloat3(&cascade.Bounds.Center, center);
+    cascade.Bounds.Radius = radius;
+
+    // Light view is a pure rotation, so light-space positions
+    // only move when the light itself rotates
+    XMVECTOR up = XMVectorSet(0, 1, 0, 0);
+    if (std::fabs(XMVectorGetY(lightDirection)) > 0.99f)
+        up = XMVectorSet(1, 0, 0, 0);
+    XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), lightDirection, up);
+
+    XMStoreFloat4x4(&cascade.View, view);
+    XMStoreFloat3(&cascade.LightSpaceCenter, XMVector3Transform(center, view));
+    SnapToTexels(cascade, resolution);
+}
+
+void ShadowCascades::SetTileSize(int index, unsigned int tileSize)
+{
+    if (cascades[index].TileSize != tileSize)
+        SnapToTexels(cascades[index], tileSize);
+}
+
+void ShadowCascades::SnapToTexels(ShadowCascade& cascade, unsigned int tileSize)
+{
+    cascade.TileSize = tileSize;
+    float radius = cascade.Bounds.Radius;
+
+    // Snap the center to whole shadow map texels so the
+    // projection only ever moves in texel-sized steps
+    float texelSize = 2 * radius / tileSize;
+    float cx = std::floor(cascade.LightSpaceCenter.x / texelSize) * texelSize;
+    float cy = std::floor(cascade.LightSpaceCenter.y / texelSize) * texelSize;
+    float cz = cascade.LightSpaceCenter.z;
+
+    // Pull the near plane back towards the light so casters
+    // outside of the slice still land in the map
+    float nearZ = cz - radius - casterDistance;
+    float farZ = cz + radius;
+    XMMATRIX proj = XMMatrixOrthographicOffCenterLH(
+        cx - radius,
+        cx + radius,
+        cy - radius,
+        cy + radius,
+        nearZ,
+        farZ);
+
+    XMMATRIX view = XMLoadFloat4x4(&cascade.View);
+    XMStoreFloat4x4(&cascade.Projection, proj);
+    XMStoreFloat4x4(&cascade.ViewProjection, XMMatrixMultiply(view, proj));
+
+    // World-space volume of the projection for caster culling
+    BoundingOrientedBox lightSpaceVolume(
+        XMFLOAT3(cx, cy, (nearZ + farZ) / 2),
+        XMFLOAT3(radius, radius, (farZ - nearZ) / 2),
+        XMFLOAT4(0, 0, 0, 1));
+    lightSpaceVolume.Transform(cascade.Volume, XMMatrixInverse(0, view));
+}
+
+bool ShadowCascades::IsCasterVisible(int cascade, const DirectX::BoundingSphere& casterBounds)
+{
+    return cascades[cascade].Volume.Intersects(casterBounds);
+}
+
+DirectX::XMFLOAT4 ShadowCascades::GetSplitDistances()
+{
+    float splits[MAX_SHADOW_CASCADES] = {};
+    for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+    {
+        // Unused cascades get a split nothing can reach
+        splits[i] = i < cascadeCount ? cascades[i].SplitFar : FLT_MAX;
+    }
+
+    return XMFLOAT4(splits[0], splits[1], splits[2], splits[3]);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// Must match MAX_SHADOW_CASCADES in ShaderIncludes.hlsli
+#define MAX_SHADOW_CASCADES     4
+
+// --------------------------------------------------------
+// A single cascade: the slice of the camera frustum it
+// covers and the light-space ortho projection fit around it
+// --------------------------------------------------------
+struct ShadowCascade
+{
+    float SplitNear;
+    float SplitFar;
+
+    DirectX::XMFLOAT4X4 View;
+    DirectX::XMFLOAT4X4 Projection;
+    DirectX::XMFLOAT4X4 ViewProjection;
+
+    // World-space sphere around the frustum slice
+    DirectX::BoundingSphere Bounds;
+
+    // World-space box covered by the ortho projection, used for culling casters
+    DirectX::BoundingOrientedBox Volume;
+
+    // Shadow map size the projection is snapped to, in texels, and
+    // the unsnapped light-space center it was snapped from
+    unsigned int TileSize;
+    DirectX::XMFLOAT3 LightSpaceCenter;
+};
+
+// --------------------------------------------------------
+// Splits the camera frustum into cascades and fits a stable
+// orthographic shadow projection to each slice.
+//
+// This is pure math on top of DirectXMath - it never touches
+// Direct3D, so it can be run headless.
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+    ShadowCascades(
+        int cascadeCount = MAX_SHADOW_CASCADES,
+        unsigned int resolution = 1024,
+        float shadowDistance = 40.0f,
+        float splitLambda = 0.75f,
+        float casterDistance = 50.0f);
+    ~ShadowCascades();
+
+    // Recomputes splits and cascade matrices for the given camera and light
+    void Update(
+        const DirectX::XMFLOAT4X4& cameraView,
+        float fov,
+        float aspectRatio,
+        float nearClip,
+        float farClip,
+        DirectX::XMFLOAT3 lightDirection);
+
+    // Returns true if a caster with the given world bounds can
+    // cast a shadow into the given cascade
+    bool IsCasterVisible(int cascade, const DirectX::BoundingSphere& casterBounds);
+
+    // Getters and setters
+    int GetCascadeCount() { return cascadeCount; }
+    void SetCascadeCount(int count);
+    unsigned int GetResolution() { return resolution; }
+    const ShadowCascade& GetCascade(int index) { return cascades[index]; }
+
+    // Re-snaps a cascade's projection to the size of the tile it
+    // actually got, which can be smaller than the resolution asked
+    // for. Snapping to the wrong texel size brings the shimmer back.
+    void SetTileSize(int index, unsigned int tileSize);
+
+    // Far split distance of each cascade, packed for the shader
+    DirectX::XMFLOAT4 GetSplitDistances();
+
+    // Practical split scheme: a blend of logarithmic and uniform splits
+    //
+    // splits - receives count + 1 distances, from nearClip to farClip
+    // lambda - 0 is fully uniform, 1 is fully logarithmic
+    static void ComputeSplits(float nearClip, float farClip, int count, float lambda, float* splits);
+
+private:
+    int cascadeCount;
+    unsigned int resolution;
+    float shadowDistance;
+    float splitLambda;
+    float casterDistance;
+
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+
+    // Fits a single cascade around the given slice of the camera frustum
+    void FitCascade(
+        ShadowCascade& cascade,
+        DirectX::FXMMATRIX cameraWorld,
+        float tanHalfFovX,
+        float tanHalfFovY,
+        DirectX::FXMVECTOR lightDirection);
+
+    // Builds the cascade's projection around its light-space center,
+    // snapped to whole texels of a tileSize x tileSize map
+    void SnapToTexels(ShadowCascade& cascade, unsigned int tileSize);
+};
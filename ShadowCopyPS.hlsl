@@ -0,0 +1,8 @@
+// Static shadow layer - tiles line up with the main atlas,
+// so this pixel's atlas position is also its position here
+Texture2D StaticShadowMap : register(t0);
+
+float main(float4 position : SV_POSITION) : SV_DEPTH
+{
+	return StaticShadowMap.Load(int3(position.xy, 0)).r;
+}
\ No newline at end of file
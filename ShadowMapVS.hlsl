@@ -1,17 +1,11 @@
 #include "ShaderIncludes.hlsli"
+#include "ConstantBuffers.hlsli"
 
-cbuffer ExternalData : register(b0)
-{
-	matrix world;
-	matrix view;
-	matrix projection;
-};
-
-float4 main(VertexShaderInput input) : SV_POSITION
+float4 main(DepthOnlyVertexInput input) : SV_POSITION
 {
 	// Only need the screen position to get the depth buffer.
 	// There's not a pixel shader so no need for the output struct either.
-	matrix wvp = mul(projection, mul(view, world));
-	float4 screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	// Precise since the depth prepass has to match the lit shaders exactly
+	precise float4 screenPosition = mul(worldViewProjection, float4(input.localPosition, 1.0f));
 	return screenPosition;
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#include "ShaderIncludes.hlsli"
+#include "ConstantBuffers.hlsli"
+
+// Instanced version of ShadowMapVS, with each caster's world
+// matrix coming from the instance buffer
+float4 main(DepthOnlyInstanceInput input) : SV_POSITION
+{
+	// Precise since the depth prepass has to match the lit shaders exactly
+	matrix instanceWorld = InstanceMatrix(input.world0, input.world1, input.world2, input.world3);
+	precise float4 worldPosition = mul(instanceWorld, float4(input.localPosition, 1.0f));
+	precise float4 screenPosition = mul(projection, mul(view, worldPosition));
+	return screenPosition;
+}
\ No newline at end of file
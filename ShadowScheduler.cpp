@@ -0,0 +1,116 @@
+#include "ShadowScheduler.h"
+#include <algorithm>
+
+ShadowScheduler::ShadowScheduler() :
+    budgetMode(SHADOW_BUDGET_NONE),
+    budgetLimit(0),
+    maxStaleFrames(30),
+    msPerDrawCall(0.01),
+    frameNumber(0),
+    deferredCount(0)
+{
+}
+
+ShadowScheduler::~ShadowScheduler()
+{
+}
+
+void ShadowScheduler::SetBudget(ShadowBudgetMode mode, float limit)
+{
+    budgetMode = mode;
+    budgetLimit = limit;
+}
+
+void ShadowScheduler::ResetStats()
+{
+    updateCounts.clear();
+    deferredCount = 0;
+}
+
+float ShadowScheduler::GetCost(const ShadowViewCandidate& candidate)
+{
+    // Every view also costs a tile clear or copy
+    float draws = (float)(candidate.DrawCalls + 1);
+    return budgetMode == SHADOW_BUDGET_MILLISECONDS ? draws * (float)msPerDrawCall : draws;
+}
+
+void ShadowScheduler::ReportFrameCost(unsigned int drawCalls, double milliseconds)
+{
+    if (drawCalls == 0)
+        return;
+
+    // Smooth it out so a single slow frame doesn't starve the next few
+    msPerDrawCall = msPerDrawCall * 0.9 + (milliseconds / drawCalls) * 0.1;
+}
+
+void ShadowScheduler::Schedule(std::vector<ShadowViewCandidate>& candidates)
+{
+    frameNumber++;
+
+    priorities.resize(candidates.size());
+    order.resize(candidates.size());
+    for (unsigned int i = 0; i < candidates.size(); i++)
+    {
+        ShadowViewCandidate& candidate = candidates[i];
+
+        // A view that needed an update last frame and didn't get
+        // one keeps its original stale frame
+        StaleView& stale = staleViews[candidate.Key];
+        if (stale.LastSeenFrame != frameNumber - 1 || stale.StaleSinceFrame == 0)
+            stale.StaleSinceFrame = frameNumber;
+        stale.LastSeenFrame = frameNumber;
+
+        unsigned int staleFrames = frameNumber - stale.StaleSinceFrame;
+        if (staleFrames >= maxStaleFrames)
+            candidate.Required = true;
+
+        // Bigger, closer and moving views first, and anything
+        // that's been waiting gets more important every frame
+        float priority = (candidate.Coverage + 0.01f) / (1.0f + candidate.Distance * 0.1f);
+        if (candidate.Moving)
+            priority *= 2.0f;
+        priority *= 1.0f + staleFrames;
+
+        priorities[i] = priority;
+        order[i] = i;
+        candidate.Scheduled = false;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+    {
+        if (candidates[a].Required != candidates[b].Required)
+            return candidates[a].Required;
+        return priorities[a] > priorities[b];
+    });
+
+    // Required views always go, the rest fill whatever budget is left
+    float spent = 0;
+    for (unsigned int i : order)
+    {
+        ShadowViewCandidate& candidate = candidates[i];
+        float cost = GetCost(candidate);
+        candidate.Scheduled =
+            candidate.Required ||
+            budgetMode == SHADOW_BUDGET_NONE ||
+            spent + cost <= budgetLimit;
+
+        if (!candidate.Scheduled)
+        {
+            deferredCount++;
+            continue;
+        }
+
+        spent += cost;
+        updateCounts[candidate.Key]++;
+        staleViews.erase(candidate.Key);
+    }
+
+    // Views that didn't ask for an update are up to date again
+    for (auto it = staleViews.begin(); it != staleViews.end();)
+    {
+        if (it->second.LastSeenFrame != frameNumber)
+            it = staleViews.erase(it);
+        else
+            ++it;
+    }
+}
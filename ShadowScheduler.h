@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+// What the per-frame shadow budget is measured in
+enum ShadowBudgetMode
+{
+    SHADOW_BUDGET_NONE,         // Draw every view that needs it
+    SHADOW_BUDGET_DRAW_CALLS,
+    SHADOW_BUDGET_MILLISECONDS
+};
+
+// A shadow view that needs redrawing this frame
+struct ShadowViewCandidate
+{
+    unsigned int Key;
+    float Coverage;             // Rough fraction of the screen the view affects, 0 to 1
+    float Distance;             // From the camera to the light, 0 for directional lights
+    bool Moving;                // Casters in the view are moving
+    bool Required;              // The view has no usable contents and must be drawn
+    unsigned int DrawCalls;     // Casters that will be drawn
+
+    // Filled in by ShadowScheduler::Schedule()
+    bool Scheduled;
+};
+
+// --------------------------------------------------------
+// Spreads shadow view updates over several frames to keep
+// the cost of shadows within a per-frame budget.
+//
+// Views are prioritized by screen coverage, distance and
+// motion, and the priority grows the longer a view goes
+// without an update so every view gets its turn. Views that
+// have been stale for too long are drawn regardless of the
+// budget, as are views with nothing usable in their tile.
+// --------------------------------------------------------
+class ShadowScheduler
+{
+public:
+    ShadowScheduler();
+    ~ShadowScheduler();
+
+    // Picks which candidates get drawn this frame
+    void Schedule(std::vector<ShadowViewCandidate>& candidates);
+
+    // Feeds back what this frame's scheduled views actually cost,
+    // which is used to estimate the cost of a draw in millisecond mode
+    void ReportFrameCost(unsigned int drawCalls, double milliseconds);
+
+    // Budget settings
+    void SetBudget(ShadowBudgetMode mode, float limit);
+    ShadowBudgetMode GetBudgetMode() { return budgetMode; }
+    float GetBudgetLimit() { return budgetLimit; }
+    void SetMaxStaleFrames(unsigned int frames) { maxStaleFrames = frames; }
+
+    // Updates per view key, and views pushed to a later frame,
+    // since the last ResetStats()
+    const std::unordered_map<unsigned int, unsigned int>& GetUpdateCounts() { return updateCounts; }
+    unsigned int GetDeferredCount() { return deferredCount; }
+    void ResetStats();
+
+private:
+    ShadowBudgetMode budgetMode;
+    float budgetLimit;
+    unsigned int maxStaleFrames;
+    double msPerDrawCall;
+
+    // Frame each view first needed an update it hasn't had yet
+    struct StaleView
+    {
+        unsigned int StaleSinceFrame;
+        unsigned int LastSeenFrame;
+    };
+    std::unordered_map<unsigned int, StaleView> staleViews;
+    unsigned int frameNumber;
+
+    std::vector<float> priorities;
+    std::vector<unsigned int> order;
+
+    std::unordered_map<unsigned int, unsigned int> updateCounts;
+    unsigned int deferredCount;
+
+    float GetCost(const ShadowViewCandidate& candidate);
+};
@@ -0,0 +1,12 @@
+cbuffer ExternalData : register(b0)
+{
+	float depth;
+};
+
+// Covers the whole viewport (one shadow atlas tile) with a single
+// triangle at the given depth - no vertex buffer needed
+float4 main(uint vertexID : SV_VertexID) : SV_POSITION
+{
+	float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+	return float4(uv * float2(2, -2) + float2(-1, 1), depth, 1);
+}
\ No newline at end of file
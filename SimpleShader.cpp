@@ -1,9 +1,28 @@
 #include "SimpleShader.h"
+#include <algorithm>
+#include <fstream>
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// Default constant buffer tracking state
+bool ISimpleShader::CompareOnWrite = true;
+unsigned long long ISimpleShader::BytesUploaded = 0;
+unsigned long long ISimpleShader::BytesSkipped = 0;
+
+// No constant buffers are external by default
+unsigned int ISimpleShader::ExternalBufferSlotStart = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+
+// Bindings go straight to the context by default
+RenderStateCache* ISimpleShader::StateCache = 0;
+StateObjectCache* ISimpleShader::ObjectCache = 0;
+
+// Reflection tables are cached next to the shaders by default
+bool ISimpleShader::UseReflectionCache = true;
+unsigned int ISimpleShader::ReflectionCacheHits = 0;
+unsigned int ISimpleShader::ReflectionCacheMisses = 0;
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -29,6 +48,15 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+
+	// Partial constant buffer updates need Direct3D 11.1 and driver support,
+	// otherwise changed buffers are uploaded in full
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferPartialUpdate)
+	{
+		context.As(&deviceContext1);
+	}
 }
 
 // --------------------------------------------------------
@@ -64,6 +92,9 @@ void ISimpleShader::CleanUp()
 		delete samplerStates[i];
 
 	// Clean up tables
+	variables.clear();
+	shaderResourceViews.clear();
+	samplerStates.clear();
 	varTable.clear();
 	cbTable.clear();
 	samplerTable.clear();
@@ -94,6 +125,19 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get the reflection tables, from the cache if possible
+	if (!LoadReflection(shaderFile))
+	{
+		if (ReportErrors)
+		{
+			LogError("SimpleShader::LoadShaderFile() - Error reading reflection data from file '");
+			LogW(shaderFile);
+			LogError("'. Ensure this file is a compiled shader.\n");
+		}
+
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -109,55 +153,41 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+	// Create resource arrays - buffers owned elsewhere are skipped
+	// below, so the count goes up as buffers are set up
+	constantBufferCount = 0;
+	constantBuffers = new SimpleConstantBuffer[reflection.GetConstantBufferCount()];
 
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (unsigned int r = 0; r < reflection.GetResourceCount(); r++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ShaderCacheResource& resourceDesc = reflection.GetResources()[r];
+		const char* resourceName = reflection.GetString(resourceDesc.Name);
 
 		// Check the type
 		switch (resourceDesc.Type)
 		{
-		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
-		case D3D_SIT_TEXTURE: // A texture resource
+		case DXBC_INPUT_STRUCTURED: // Treat structured buffers as texture resources
+		case DXBC_INPUT_TEXTURE: // A texture resource
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
 			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			AddToTable(textureTable, resourceName, srv->Index);
 			shaderResourceViews.push_back(srv);
 		}
 		break;
 
-		case D3D_SIT_SAMPLER: // A sampler resource
+		case DXBC_INPUT_SAMPLER: // A sampler resource
 		{
 			// Create the sampler wrapper
 			SimpleSampler* samp = new SimpleSampler();
 			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			AddToTable(samplerTable, resourceName, samp->Index);
 			samplerStates.push_back(samp);
 		}
 		break;
@@ -165,28 +195,27 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int c = 0; c < reflection.GetConstantBufferCount(); c++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
+		// The bind point was looked up when the tables were made
+		const ShaderCacheConstantBuffer& bufferDesc = reflection.GetConstantBuffers()[c];
+		const char* bufferName = reflection.GetString(bufferDesc.Name);
+		if (bufferDesc.BindPoint == SHADER_CACHE_UNBOUND)
+			continue;
 
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
+		// Buffers in the external registers are created, filled
+		// and bound by the application, so leave them alone
+		if (bufferDesc.Type == D3D_CT_CBUFFER && bufferDesc.BindPoint >= ExternalBufferSlotStart)
+			continue;
 
 		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+		unsigned int b = constantBufferCount++;
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.Type;
 
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		constantBuffers[b].BindIndex = bufferDesc.BindPoint;
+		constantBuffers[b].Name = bufferName;
+		AddToTable(cbTable, bufferName, b);
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc = {};
@@ -203,16 +232,14 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
+		// The buffer was created without data, so the first upload has to be complete
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
+
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (unsigned int v = 0; v < bufferDesc.VariableCount; v++)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
+			const ShaderCacheVariable& varDesc = reflection.GetVariables()[bufferDesc.FirstVariable + v];
 
 			// Create the variable struct
 			SimpleShaderVariable varStruct = {};
@@ -220,19 +247,121 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			varStruct.ByteOffset = varDesc.StartOffset;
 			varStruct.Size = varDesc.Size;
 
-			// Get a string version
-			std::string varName(varDesc.Name);
-
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			AddToTable(varTable, reflection.GetString(varDesc.Name), (unsigned int)variables.size());
+			variables.push_back(varStruct);
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
+	// Sort the tables so lookups can binary search them
+	SortTable(cbTable);
+	SortTable(varTable);
+	SortTable(textureTable);
+	SortTable(samplerTable);
+
 	// All set
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets up the reflection tables for the loaded shader code.
+// The cache file next to the shader is used if it was made
+// from this exact code - otherwise the code is reflected and
+// a new cache file is written for next time.
+//
+// shaderFile - The compiled shader the code was loaded from
+// 
+// Returns false if the shader code couldn't be read
+// --------------------------------------------------------
+bool ISimpleShader::LoadReflection(LPCWSTR shaderFile)
+{
+	ShaderReflectionKey key;
+	if (!ShaderReflectionCache::MakeKey(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), key))
+		return false;
+
+	std::wstring cacheFile = std::wstring(shaderFile) + L".refl";
+	if (UseReflectionCache)
+	{
+		// Read the whole file in one go
+		std::ifstream in(cacheFile, std::ios::binary | std::ios::ate);
+		std::streamoff size = in ? (std::streamoff)in.tellg() : 0;
+		if (size > 0)
+		{
+			std::vector<unsigned char> cacheData((size_t)size);
+			in.seekg(0);
+			if (in.read((char*)cacheData.data(), size) &&
+				reflection.Load(std::move(cacheData), key))
+			{
+				ReflectionCacheHits++;
+				return true;
+			}
+		}
+	}
+
+	// Missing, stale or broken - reflect the shader code.  This
+	// goes through D3DReflect(), not DxbcReflection::Parse(), until
+	// the parser has been checked against a real build's shaders.
+	DxbcReflection dxbc;
+	if (!dxbc.Reflect(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize()))
+		return false;
+
+	reflection.Build(dxbc, key);
+	ReflectionCacheMisses++;
+
+	// Not being able to save it (a read only folder, say) is fine
+	if (UseReflectionCache)
+	{
+		const std::vector<unsigned char>& cacheData = reflection.GetData();
+		std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+		out.write((const char*)cacheData.data(), cacheData.size());
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Adds a name to one of the lookup tables.  The table
+// must be sorted with SortTable() before it's searched.
+// --------------------------------------------------------
+void ISimpleShader::AddToTable(std::vector<SimpleShaderTableEntry>& table, const char* name, unsigned int index)
+{
+	SimpleShaderTableEntry entry;
+	entry.Hash = SimpleShaderHash(name);
+	entry.Index = index;
+	entry.Name = name;
+	table.push_back(entry);
+}
+
+// --------------------------------------------------------
+// Sorts a lookup table by hash
+// --------------------------------------------------------
+void ISimpleShader::SortTable(std::vector<SimpleShaderTableEntry>& table)
+{
+	std::sort(table.begin(), table.end(),
+		[](const SimpleShaderTableEntry& a, const SimpleShaderTableEntry& b) { return a.Hash < b.Hash; });
+}
+
+// --------------------------------------------------------
+// Binary searches a sorted lookup table for the given name
+//
+// Returns the index stored with the name, or -1 if it isn't there
+// --------------------------------------------------------
+int ISimpleShader::FindInTable(const std::vector<SimpleShaderTableEntry>& table, const SimpleShaderName& name)
+{
+	auto it = std::lower_bound(table.begin(), table.end(), name.Hash,
+		[](const SimpleShaderTableEntry& entry, unsigned int hash) { return entry.Hash < hash; });
+
+	// Compare the actual names too, in case of a collision
+	for (; it != table.end() && it->Hash == name.Hash; ++it)
+	{
+		if (it->Name == name.Name)
+			return (int)it->Index;
+	}
+
+	return -1;
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -240,18 +369,17 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(SimpleShaderName name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+	int index = FindInTable(varTable, name);
 
 	// Did we find the key?
-	if (result == varTable.end())
+	if (index == -1)
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the variable it points to
+	SimpleShaderVariable* var = &variables[index];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -264,18 +392,17 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(SimpleShaderName name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+	int index = FindInTable(cbTable, name);
 
 	// Did we find the key?
-	if (result == cbTable.end())
+	if (index == -1)
 		return 0;
 
 	// Success
-	return result->second;
+	return &constantBuffers[index];
 }
 
 // --------------------------------------------------------
@@ -345,14 +472,9 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy whatever changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -380,9 +502,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(*cb);
 }
 
 // --------------------------------------------------------
@@ -392,7 +512,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(SimpleShaderName bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -402,9 +522,78 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(*cb);
+}
+
+// --------------------------------------------------------
+// Copies the changed part of a constant buffer's local data
+// to the GPU, or nothing at all if it hasn't changed
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer& cb)
+{
+	// Nothing changed since the last upload
+	if (cb.DirtyStart >= cb.DirtyEnd)
+	{
+		BytesSkipped += cb.Size;
+		return;
+	}
+
+	if (deviceContext1)
+	{
+		// Partial updates have to cover whole 16-byte constants
+		D3D11_BOX box = {};
+		box.left = cb.DirtyStart & ~15u;
+		box.right = min((cb.DirtyEnd + 15) & ~15u, cb.Size);
+		box.bottom = 1;
+		box.back = 1;
+
+		deviceContext1->UpdateSubresource1(
+			cb.ConstantBuffer.Get(), 0, &box,
+			cb.LocalDataBuffer + box.left, 0, 0, 0);
+
+		BytesUploaded += box.right - box.left;
+		BytesSkipped += cb.Size - (box.right - box.left);
+	}
+	else
+	{
+		// Copy the entire local data buffer
+		deviceContext->UpdateSubresource(
+			cb.ConstantBuffer.Get(), 0, 0,
+			cb.LocalDataBuffer, 0, 0);
+
+		BytesUploaded += cb.Size;
+	}
+
+	cb.DirtyStart = 0;
+	cb.DirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Writes data to a constant buffer's local data buffer and
+// marks the bytes it changed as dirty
+// --------------------------------------------------------
+void ISimpleShader::WriteData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer& cb = constantBuffers[bufferIndex];
+	unsigned char* dest = cb.LocalDataBuffer + byteOffset;
+
+	// Setting a variable to the value it already has doesn't need an upload
+	if (CompareOnWrite && memcmp(dest, data, size) == 0)
+		return;
+
+	memcpy(dest, data, size);
+
+	// Grow the dirty range to cover this write
+	if (cb.DirtyStart >= cb.DirtyEnd)
+	{
+		cb.DirtyStart = byteOffset;
+		cb.DirtyEnd = byteOffset + size;
+	}
+	else
+	{
+		cb.DirtyStart = min(cb.DirtyStart, byteOffset);
+		cb.DirtyEnd = max(cb.DirtyEnd, byteOffset + size);
+	}
 }
 
 
@@ -417,7 +606,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(SimpleShaderName name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -426,7 +615,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
 		}
 		return false;
@@ -439,17 +628,59 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' is smaller than the size of the data being set. Ensure the variable is large enough for the specified data.\n");
 		}
 		return false;
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteData(var->ConstantBufferIndex, var->ByteOffset, data, size);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets an entire constant buffer at once
+//
+// bufferName - The name of the constant buffer
+// data       - The data for the whole buffer
+// size       - The size of the data (this must match the buffer's size)
+//
+// Returns true if data is copied, false if the buffer doesn't
+// exist or is a different size
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(SimpleShaderName bufferName, const void* data, unsigned int size)
+{
+	// Look for the buffer and verify
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetBufferData() - Constant buffer '");
+			Log(bufferName.Name);
+			LogWarning("' not found. Ensure the name is spelled correctly and that the shader uses the buffer.\n");
+		}
+		return false;
+	}
+
+	// A different size means the data was laid out for some other
+	// version of the buffer - copying it would scramble every variable
+	if (size != cb->Size)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetBufferData() - Constant buffer '");
+			Log(bufferName.Name);
+			LogWarning("' is a different size than the data being set. Ensure the struct is regenerated from the current shader.\n");
+		}
+		return false;
+	}
+
+	// Set the data in the local data buffer
+	WriteData((unsigned int)(cb - constantBuffers), 0, data, size);
 
 	// Success
 	return true;
@@ -458,7 +689,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(SimpleShaderName name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +697,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(SimpleShaderName name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +705,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(SimpleShaderName name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +713,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(SimpleShaderName name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +721,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(SimpleShaderName name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +729,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(SimpleShaderName name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +737,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(SimpleShaderName name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +745,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(SimpleShaderName name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +753,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(SimpleShaderName name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,16 +761,159 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(SimpleShaderName name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Looks up a variable once, returning a handle that can be
+// used to set it without any further lookups
+//
+// Returns an invalid handle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleShaderVariableHandle ISimpleShader::GetVariableHandle(SimpleShaderName name)
+{
+	SimpleShaderVariableHandle handle;
+
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::GetVariableHandle() - Shader variable '");
+			Log(name.Name);
+			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
+		}
+		return handle;
+	}
+
+	handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	handle.ByteOffset = var->ByteOffset;
+	handle.Size = var->Size;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Looks up an SRV once, returning a handle that can be
+// used to set it without any further lookups
+// --------------------------------------------------------
+SimpleShaderResourceHandle ISimpleShader::GetShaderResourceViewHandle(SimpleShaderName name)
+{
+	SimpleShaderResourceHandle handle;
+
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo)
+		handle.BindIndex = srvInfo->BindIndex;
+
+	return handle;
+}
+
+// --------------------------------------------------------
+// Looks up a sampler once, returning a handle that can be
+// used to set it without any further lookups
+// --------------------------------------------------------
+SimpleShaderResourceHandle ISimpleShader::GetSamplerHandle(SimpleShaderName name)
+{
+	SimpleShaderResourceHandle handle;
+
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo)
+		handle.BindIndex = sampInfo->BindIndex;
+
+	return handle;
+}
+
+// --------------------------------------------------------
+// Sets a variable through a handle with arbitrary data of 
+// the specified size
+//
+// handle - A handle from this shader's GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const SimpleShaderVariableHandle& handle, const void* data, unsigned int size)
+{
+	// Invalid handles were already reported when they were looked up
+	if (!handle.IsValid() || size > handle.Size)
+		return false;
+
+	// Set the data in the local data buffer
+	WriteData(handle.ConstantBufferIndex, handle.ByteOffset, data, size);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Handle versions of the typed setters
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(const SimpleShaderVariableHandle& handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const SimpleShaderVariableHandle& handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view through a handle in this
+// shader's stage
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(const SimpleShaderResourceHandle& handle, ID3D11ShaderResourceView* srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	BindShaderResourceView(handle.BindIndex, srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state through a handle in this shader's stage
+//
+// Returns true if the handle is valid, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetSamplerState(const SimpleShaderResourceHandle& handle, ID3D11SamplerState* samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	BindSamplerState(handle.BindIndex, samplerState);
+	return true;
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(SimpleShaderName name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -547,7 +921,7 @@ bool ISimpleShader::HasVariable(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified SRV
 // --------------------------------------------------------
-bool ISimpleShader::HasShaderResourceView(std::string name)
+bool ISimpleShader::HasShaderResourceView(SimpleShaderName name)
 {
 	return GetShaderResourceViewInfo(name) != 0;
 }
@@ -555,7 +929,7 @@ bool ISimpleShader::HasShaderResourceView(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified sampler
 // --------------------------------------------------------
-bool ISimpleShader::HasSamplerState(std::string name)
+bool ISimpleShader::HasSamplerState(SimpleShaderName name)
 {
 	return GetSamplerInfo(name) != 0;
 }
@@ -563,7 +937,7 @@ bool ISimpleShader::HasSamplerState(std::string name)
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(SimpleShaderName name)
 {
 	return FindVariable(name, -1);
 }
@@ -573,18 +947,17 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(SimpleShaderName name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	int index = FindInTable(textureTable, name);
 
 	// Did we find the key?
-	if (result == textureTable.end())
+	if (index == -1)
 		return 0;
 
 	// Success
-	return result->second;
+	return shaderResourceViews[index];
 }
 
 
@@ -608,18 +981,17 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(SimpleShaderName name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	int index = FindInTable(samplerTable, name);
 
 	// Did we find the key?
-	if (result == samplerTable.end())
+	if (index == -1)
 		return 0;
 
 	// Success
-	return result->second;
+	return samplerStates[index];
 }
 
 // --------------------------------------------------------
@@ -661,7 +1033,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer* ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer* ISimpleShader::GetBufferInfo(SimpleShaderName name)
 {
 	return FindConstantBuffer(name);
 }
@@ -697,6 +1069,7 @@ SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> devi
 	// Ensure we set to zero to successfully trigger
 	// the Input Layout creation during LoadShaderFile()
 	this->perInstanceCompatible = false;
+	this->positionOnly = false;
 
 	// Load the actual compiled shader file
 	this->LoadShaderFile(shaderFile);
@@ -716,6 +1089,7 @@ SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> devi
 
 	// Unable to determine from an input layout, require user to tell us
 	this->perInstanceCompatible = perInstanceCompatible;
+	this->positionOnly = false;
 
 	// Load the actual compiled shader file
 	this->LoadShaderFile(shaderFile);
@@ -771,28 +1145,21 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from the reflection data
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	for (unsigned int i = 0; i < reflection.GetInputCount(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const ShaderCacheParameter& paramDesc = reflection.GetInputs()[i];
+		const char* semanticName = reflection.GetString(paramDesc.SemanticName);
+
+		// System values (like SV_VertexID) are generated by the
+		// pipeline and aren't part of the input layout
+		if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
 
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		std::string sem = semanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance =
 			lenDiff >= 0 &&
@@ -800,7 +1167,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = semanticName;
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -847,6 +1214,38 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
+	// Does the shader only read a float3 position from each vertex?
+	// Those can be fed the position-only stream in depth passes
+	unsigned int perVertexElements = 0;
+	bool perVertexPosition = false;
+	for (const D3D11_INPUT_ELEMENT_DESC& element : inputLayoutDesc)
+	{
+		if (element.InputSlotClass != D3D11_INPUT_PER_VERTEX_DATA)
+			continue;
+
+		perVertexElements++;
+		perVertexPosition =
+			strcmp(element.SemanticName, "POSITION") == 0 &&
+			element.SemanticIndex == 0 &&
+			element.Format == DXGI_FORMAT_R32G32B32_FLOAT;
+	}
+	positionOnly = perVertexElements == 1 && perVertexPosition;
+
+	// Shaders that only use system values don't need a layout
+	if (inputLayoutDesc.empty())
+		return true;
+
+	// Shaders with the same inputs share a layout
+	if (ObjectCache)
+	{
+		inputLayout = ObjectCache->GetInputLayout(
+			&inputLayoutDesc[0],
+			(unsigned int)inputLayoutDesc.size(),
+			shaderBlob->GetBufferPointer(),
+			shaderBlob->GetBufferSize());
+		return true;
+	}
+
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
 		&inputLayoutDesc[0],
@@ -869,8 +1268,14 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->IASetInputLayout(inputLayout.Get());
+	else
+		deviceContext->IASetInputLayout(inputLayout.Get());
+	if (StateCache)
+		StateCache->VSSetShader(shader.Get());
+	else
+		deviceContext->VSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -880,13 +1285,35 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_VERTEX, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->VSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the vertex stage
+// --------------------------------------------------------
+void SimpleVertexShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_VERTEX, bindIndex, srv);
+	else
+		deviceContext->VSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimpleVertexShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_VERTEX, bindIndex, samplerState);
+	else
+		deviceContext->VSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the vertex shader stage
 //
@@ -895,7 +1322,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -904,14 +1331,14 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -925,7 +1352,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -934,14 +1361,14 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1012,7 +1439,10 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->PSSetShader(shader.Get());
+	else
+		deviceContext->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1022,13 +1452,35 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_PIXEL, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->PSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the pixel stage
+// --------------------------------------------------------
+void SimplePixelShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_PIXEL, bindIndex, srv);
+	else
+		deviceContext->PSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimplePixelShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_PIXEL, bindIndex, samplerState);
+	else
+		deviceContext->PSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the pixel shader stage
 //
@@ -1037,7 +1489,7 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1046,14 +1498,14 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1067,7 +1519,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1076,14 +1528,14 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1156,7 +1608,10 @@ void SimpleDomainShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->DSSetShader(shader.Get());
+	else
+		deviceContext->DSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1166,13 +1621,35 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_DOMAIN, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->DSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the domain stage
+// --------------------------------------------------------
+void SimpleDomainShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_DOMAIN, bindIndex, srv);
+	else
+		deviceContext->DSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimpleDomainShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_DOMAIN, bindIndex, samplerState);
+	else
+		deviceContext->DSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the domain shader stage
 //
@@ -1181,7 +1658,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1190,14 +1667,14 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1211,7 +1688,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1220,14 +1697,14 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1299,7 +1776,10 @@ void SimpleHullShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->HSSetShader(shader.Get());
+	else
+		deviceContext->HSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1309,13 +1789,35 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_HULL, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->HSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the hull stage
+// --------------------------------------------------------
+void SimpleHullShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_HULL, bindIndex, srv);
+	else
+		deviceContext->HSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimpleHullShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_HULL, bindIndex, samplerState);
+	else
+		deviceContext->HSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the hull shader stage
 //
@@ -1324,7 +1826,7 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1333,14 +1835,14 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1354,7 +1856,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1363,14 +1865,14 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1455,31 +1957,17 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (unsigned int i = 0; i < reflection.GetOutputCount(); i++)
 	{
-		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
+		const ShaderCacheParameter& paramDesc = reflection.GetOutputs()[i];
 
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry = {};
 		entry.SemanticIndex = paramDesc.SemanticIndex;
-		entry.SemanticName = paramDesc.SemanticName;
+		entry.SemanticName = reflection.GetString(paramDesc.SemanticName);
 		entry.Stream = paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot = 0; // Assume the first output slot
@@ -1573,7 +2061,10 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->GSSetShader(shader.Get());
+	else
+		deviceContext->GSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1583,13 +2074,35 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_GEOMETRY, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->GSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the geometry stage
+// --------------------------------------------------------
+void SimpleGeometryShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_GEOMETRY, bindIndex, srv);
+	else
+		deviceContext->GSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimpleGeometryShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_GEOMETRY, bindIndex, samplerState);
+	else
+		deviceContext->GSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the Geometry shader stage
 //
@@ -1598,7 +2111,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1607,14 +2120,14 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1628,7 +2141,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1637,14 +2150,14 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1703,6 +2216,7 @@ void SimpleComputeShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
 
+	uavBindIndices.clear();
 	uavTable.clear();
 }
 
@@ -1730,44 +2244,31 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
+	threadsTotal = reflection.GetThreadGroupSize(
 		&threadsX,
 		&threadsY,
 		&threadsZ);
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (unsigned int r = 0; r < reflection.GetResourceCount(); r++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		const ShaderCacheResource& resourceDesc = reflection.GetResources()[r];
 
 		// Check the type, looking for any kind of UAV
 		switch (resourceDesc.Type)
 		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
+		case DXBC_INPUT_UAV_APPEND_STRUCTURED:
+		case DXBC_INPUT_UAV_CONSUME_STRUCTURED:
+		case DXBC_INPUT_UAV_RWBYTEADDRESS:
+		case DXBC_INPUT_UAV_RWSTRUCTURED:
+		case DXBC_INPUT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case DXBC_INPUT_UAV_RWTYPED:
+			AddToTable(uavTable, reflection.GetString(resourceDesc.Name), (unsigned int)uavBindIndices.size());
+			uavBindIndices.push_back(resourceDesc.BindPoint);
 		}
 	}
+	SortTable(uavTable);
 
 	// All set
 	return true;
@@ -1783,7 +2284,10 @@ void SimpleComputeShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader.Get(), 0, 0);
+	if (StateCache)
+		StateCache->CSSetShader(shader.Get());
+	else
+		deviceContext->CSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1793,10 +2297,13 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		if (StateCache)
+			StateCache->SetConstantBuffer(RENDER_STAGE_COMPUTE, constantBuffers[i].BindIndex, constantBuffers[i].ConstantBuffer.Get());
+		else
+			deviceContext->CSSetConstantBuffers(
+				constantBuffers[i].BindIndex,
+				1,
+				constantBuffers[i].ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1856,11 +2363,30 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 // Determines if this shader has the specified UAV
 // --------------------------------------------------------
-bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
+bool SimpleComputeShader::HasUnorderedAccessView(SimpleShaderName name)
 {
 	return GetUnorderedAccessViewIndex(name) != -1;
 }
 
+// --------------------------------------------------------
+// Binds an SRV and a sampler to a register in the compute stage
+// --------------------------------------------------------
+void SimpleComputeShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	if (StateCache)
+		StateCache->SetShaderResource(RENDER_STAGE_COMPUTE, bindIndex, srv);
+	else
+		deviceContext->CSSetShaderResources(bindIndex, 1, &srv);
+}
+
+void SimpleComputeShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	if (StateCache)
+		StateCache->SetSampler(RENDER_STAGE_COMPUTE, bindIndex, samplerState);
+	else
+		deviceContext->CSSetSamplers(bindIndex, 1, &samplerState);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the Compute shader stage
 //
@@ -1869,7 +2395,7 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1878,14 +2404,14 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	BindShaderResourceView(srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1899,7 +2425,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1908,14 +2434,14 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	BindSamplerState(sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
@@ -1930,7 +2456,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1939,7 +2465,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetUnorderedAccessView() - UAV named '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1948,6 +2474,10 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 	// Set the shader resource view
 	deviceContext->CSSetUnorderedAccessViews(bindIndex, 1, uav.GetAddressOf(), &appendConsumeOffset);
 
+	// Binding a UAV unbinds its resource from any SRV slots
+	if (StateCache)
+		StateCache->InvalidateShaderResources();
+
 	// Success
 	return true;
 }
@@ -1955,16 +2485,15 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(SimpleShaderName name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+	int index = FindInTable(uavTable, name);
 
 	// Did we find the key?
-	if (result == uavTable.end())
+	if (index == -1)
 		return -1;
 
 	// Success
-	return result->second;
+	return uavBindIndices[index];
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
@@ -11,6 +12,68 @@
 #include <vector>
 #include <string>
 
+#include "RenderStateCache.h"
+#include "StateObjectCache.h"
+#include "ShaderReflectionCache.h"
+
+
+// --------------------------------------------------------
+// FNV-1a hash of a name in a shader.  Usable at compile
+// time, so names given as literals can be hashed by the
+// compiler instead of on every call - see SHADER_NAME.
+// --------------------------------------------------------
+constexpr unsigned int SimpleShaderHash(const char* str)
+{
+	unsigned int hash = 2166136261u;
+	while (*str)
+	{
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// A name to look up in a shader, along with its hash.
+// Built implicitly from string literals and std::strings,
+// so existing name-based calls work as they always have.
+// Those hash the name on every call, though - the compiler
+// is free to fold a literal's hash but doesn't have to,
+// and Debug builds never do.
+// --------------------------------------------------------
+struct SimpleShaderName
+{
+	const char* Name;
+	unsigned int Hash;
+
+	constexpr SimpleShaderName(const char* name) : Name(name), Hash(SimpleShaderHash(name)) {}
+	constexpr SimpleShaderName(const char* name, unsigned int hash) : Name(name), Hash(hash) {}
+	SimpleShaderName(const std::string& name) : Name(name.c_str()), Hash(SimpleShaderHash(name.c_str())) {}
+};
+
+// --------------------------------------------------------
+// A literal name with its hash worked out by the compiler,
+// whatever the build - the hash is a template argument, so
+// it has to be a constant.  Use it wherever a name is
+// written out in full:
+//
+//   shader->SetShaderResourceView(SHADER_NAME("SkyTexture"), srv);
+// --------------------------------------------------------
+template<unsigned int Hash>
+constexpr SimpleShaderName SimpleShaderLiteral(const char* name) { return SimpleShaderName(name, Hash); }
+
+#define SHADER_NAME(literal) SimpleShaderLiteral<SimpleShaderHash(literal)>(literal)
+
+// --------------------------------------------------------
+// One entry in a shader's name lookup tables, which are
+// flat arrays sorted by hash
+// --------------------------------------------------------
+struct SimpleShaderTableEntry
+{
+	unsigned int Hash;
+	unsigned int Index;		// Into the array the table is for
+	std::string Name;
+};
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -23,6 +86,31 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A constant buffer variable looked up ahead of time, so
+// setting it skips the name lookup entirely.  Only valid
+// for the shader it was retrieved from.
+// --------------------------------------------------------
+struct SimpleShaderVariableHandle
+{
+	unsigned int ConstantBufferIndex = (unsigned int)-1;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+
+	bool IsValid() const { return ConstantBufferIndex != (unsigned int)-1; }
+};
+
+// --------------------------------------------------------
+// An SRV or sampler looked up ahead of time.  Only valid
+// for the shader it was retrieved from.
+// --------------------------------------------------------
+struct SimpleShaderResourceHandle
+{
+	unsigned int BindIndex = (unsigned int)-1;
+
+	bool IsValid() const { return BindIndex != (unsigned int)-1; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -37,6 +125,11 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes of the local data buffer changed since the last
+	// upload - nothing is dirty when DirtyStart >= DirtyEnd
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
 };
 
 // --------------------------------------------------------
@@ -73,46 +166,74 @@ public:
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(SimpleShaderName bufferName);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(SimpleShaderName name, const void* data, unsigned int size);
+
+	bool SetInt(SimpleShaderName name, int data);
+	bool SetFloat(SimpleShaderName name, float data);
+	bool SetFloat2(SimpleShaderName name, const float data[2]);
+	bool SetFloat2(SimpleShaderName name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(SimpleShaderName name, const float data[3]);
+	bool SetFloat3(SimpleShaderName name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(SimpleShaderName name, const float data[4]);
+	bool SetFloat4(SimpleShaderName name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(SimpleShaderName name, const float data[16]);
+	bool SetMatrix4x4(SimpleShaderName name, const DirectX::XMFLOAT4X4 data);
+
+	// Sets a whole constant buffer in one copy - the data must be
+	// exactly the buffer's size
+	bool SetBufferData(SimpleShaderName bufferName, const void* data, unsigned int size);
+
+	// Same, from one of the structs in ShaderBufferStructs.h, which
+	// know which buffer they're for and match its layout
+	template<typename T> bool SetBufferStruct(const T& data)
+	{
+		return SetBufferData(T::GetBufferName(), &data, sizeof(T));
+	}
+
+	// Looking up handles once, for data set every frame
+	SimpleShaderVariableHandle GetVariableHandle(SimpleShaderName name);
+	SimpleShaderResourceHandle GetShaderResourceViewHandle(SimpleShaderName name);
+	SimpleShaderResourceHandle GetSamplerHandle(SimpleShaderName name);
+
+	// Sets shader data through a handle
+	bool SetData(const SimpleShaderVariableHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const SimpleShaderVariableHandle& handle, int data);
+	bool SetFloat(const SimpleShaderVariableHandle& handle, float data);
+	bool SetFloat2(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderVariableHandle& handle, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
-	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
+	virtual bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	bool SetShaderResourceView(const SimpleShaderResourceHandle& handle, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const SimpleShaderResourceHandle& handle, ID3D11SamplerState* samplerState);
 
 	// Simple resource checking
-	bool HasVariable(std::string name);
-	bool HasShaderResourceView(std::string name);
-	bool HasSamplerState(std::string name);
+	bool HasVariable(SimpleShaderName name);
+	bool HasShaderResourceView(SimpleShaderName name);
+	bool HasSamplerState(SimpleShaderName name);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(SimpleShaderName name);
 
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(SimpleShaderName name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	size_t GetShaderResourceViewCount() { return textureTable.size(); }
 
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(SimpleShaderName name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	size_t GetSamplerCount() { return samplerTable.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(SimpleShaderName name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 
 	// Misc getters
@@ -122,37 +243,87 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Compare data against what's already in a buffer before writing it,
+	// so setting a variable to its current value doesn't dirty the buffer
+	static bool CompareOnWrite;
+
+	// Constant buffer bytes sent to the GPU and skipped because they hadn't
+	// changed, across all shaders.  Reset these whenever it's convenient.
+	static unsigned long long BytesUploaded;
+	static unsigned long long BytesSkipped;
+
+	// Constant buffers bound at or above this register are shared between
+	// shaders and managed by the application - SimpleShader doesn't create,
+	// fill or bind them.  Set this before loading any shaders.
+	static unsigned int ExternalBufferSlotStart;
+
+	// When set, shaders, constant buffers, SRVs, samplers and input
+	// layouts are bound through this so redundant calls are dropped
+	static RenderStateCache* StateCache;
+
+	// When set, vertex shaders get their input layouts from here, so
+	// shaders with the same inputs share one
+	static StateObjectCache* ObjectCache;
+
+	// Reflection tables are saved next to each .cso (as ".cso.refl")
+	// and read back on later runs instead of walking the shader code.
+	// Hits and misses count shaders loaded each way.
+	static bool UseReflectionCache;
+	static unsigned int ReflectionCacheHits;
+	static unsigned int ReflectionCacheMisses;
+
 protected:
 
 	bool shaderValid;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+
+	// Set up by LoadShaderFile() - from the reflection cache or straight
+	// from the shader code - before CreateShader() is called, so child
+	// classes can use it too
+	ShaderReflectionCache reflection;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1; // Only set if partial constant buffer updates are supported
 
 	// Resource counts
 	unsigned int constantBufferCount;
 
-	// Maps for variables and buffers
+	// Arrays of variables and buffers
 	SimpleConstantBuffer* constantBuffers; // For index-based lookup
+	std::vector<SimpleShaderVariable> variables;
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+
+	// Name lookup tables into the arrays above, sorted by hash
+	std::vector<SimpleShaderTableEntry> cbTable;
+	std::vector<SimpleShaderTableEntry> varTable;
+	std::vector<SimpleShaderTableEntry> textureTable;
+	std::vector<SimpleShaderTableEntry> samplerTable;
 
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadReflection(LPCWSTR shaderFile);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
 
+	// Binds resources to this shader's stage
+	virtual void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv) = 0;
+	virtual void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState) = 0;
+
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(SimpleShaderName name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(SimpleShaderName name);
+	static void AddToTable(std::vector<SimpleShaderTableEntry>& table, const char* name, unsigned int index);
+	static void SortTable(std::vector<SimpleShaderTableEntry>& table);
+	static int FindInTable(const std::vector<SimpleShaderTableEntry>& table, const SimpleShaderName& name);
+
+	// Helpers for tracking and uploading changed data
+	void WriteData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size);
+	void UploadBuffer(SimpleConstantBuffer& cb);
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -178,15 +349,24 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	// True when the only per-vertex input is a float3 POSITION, so
+	// the position-only stream can be bound instead of whole vertices
+	bool GetPositionOnly() { return positionOnly; }
+
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	bool perInstanceCompatible;
+	bool positionOnly;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -201,13 +381,17 @@ public:
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -221,13 +405,17 @@ public:
 	~SimpleDomainShader();
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -241,13 +429,17 @@ public:
 	~SimpleHullShader();
 	Microsoft::WRL::ComPtr<ID3D11HullShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -261,8 +453,10 @@ public:
 	~SimpleGeometryShader();
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -280,6 +474,8 @@ protected:
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 
 	// Helpers
@@ -300,17 +496,20 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool HasUnorderedAccessView(std::string name);
+	bool HasUnorderedAccessView(SimpleShaderName name);
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
-	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	using ISimpleShader::SetShaderResourceView;
+	using ISimpleShader::SetSamplerState;
+	bool SetUnorderedAccessView(SimpleShaderName name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(SimpleShaderName name);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
+	std::vector<unsigned int> uavBindIndices;
+	std::vector<SimpleShaderTableEntry> uavTable;
 
 	unsigned int threadsX;
 	unsigned int threadsY;
@@ -319,5 +518,7 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "RenderStateCache.h"
+#include "StateObjectCache.h"
 
 class Sky
 {
@@ -14,11 +16,12 @@ public:
         std::shared_ptr<SimplePixelShader> pixelShader,
         std::shared_ptr<SimpleVertexShader> vertexShader,
         Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState,
-        Microsoft::WRL::ComPtr<ID3D11Device> device);
+        StateObjectCache& stateObjects);
 
     ~Sky();
 
-    void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera);
+    // Draws the sky with the camera in the shared per-view buffer
+    void Draw(RenderStateCache& state);
 
 private:
     Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
@@ -0,0 +1,173 @@
+#include "StateObjectCache.h"
+#include "DxbcReflection.h"
+#include <cstring>
+#include <stdio.h>
+
+using namespace Microsoft::WRL;
+
+// Keys are built a field at a time rather than copying whole descs,
+// since the padding in some of them isn't guaranteed to be zeroed
+template<typename T> static void AppendKey(std::string& key, const T& value)
+{
+    key.append((const char*)&value, sizeof(T));
+}
+
+static void AppendKey(std::string& key, const D3D11_DEPTH_STENCILOP_DESC& op)
+{
+    AppendKey(key, op.StencilFailOp);
+    AppendKey(key, op.StencilDepthFailOp);
+    AppendKey(key, op.StencilPassOp);
+    AppendKey(key, op.StencilFunc);
+}
+
+StateObjectCache::StateObjectCache(ComPtr<ID3D11Device> device) :
+    device(device)
+{
+}
+
+StateObjectCache::~StateObjectCache()
+{
+}
+
+template<typename T, typename Create> ComPtr<T> StateObjectCache::Find(Table<T>& table, const std::string& key, Create create)
+{
+    auto found = table.Objects.find(key);
+    if (found != table.Objects.end())
+    {
+        table.Hits++;
+        return found->second;
+    }
+
+    // Failures aren't remembered, so they're reported every time
+    ComPtr<T> object;
+    if (FAILED(create(object.GetAddressOf())))
+        return nullptr;
+
+    table.Misses++;
+    table.Objects[key] = object;
+    return object;
+}
+
+ComPtr<ID3D11InputLayout> StateObjectCache::GetInputLayout(
+    const D3D11_INPUT_ELEMENT_DESC* elements,
+    unsigned int elementCount,
+    const void* shaderBytecode,
+    size_t bytecodeSize)
+{
+    std::string key;
+    for (unsigned int i = 0; i < elementCount; i++)
+    {
+        const D3D11_INPUT_ELEMENT_DESC& element = elements[i];
+        key.append(element.SemanticName, strlen(element.SemanticName) + 1);
+        AppendKey(key, element.SemanticIndex);
+        AppendKey(key, element.Format);
+        AppendKey(key, element.InputSlot);
+        AppendKey(key, element.AlignedByteOffset);
+        AppendKey(key, element.InputSlotClass);
+        AppendKey(key, element.InstanceDataStepRate);
+    }
+
+    // Without a signature to compare, the whole shader has to match
+    const unsigned char* signature = 0;
+    unsigned int signatureSize = 0;
+    if (DxbcReflection::GetInputSignature(shaderBytecode, bytecodeSize, &signature, &signatureSize))
+        key.append((const char*)signature, signatureSize);
+    else
+        key.append((const char*)shaderBytecode, bytecodeSize);
+
+    return Find(inputLayouts, key, [&](ID3D11InputLayout** layout)
+    {
+        return device->CreateInputLayout(elements, elementCount, shaderBytecode, bytecodeSize, layout);
+    });
+}
+
+ComPtr<ID3D11RasterizerState> StateObjectCache::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+{
+    std::string key;
+    AppendKey(key, desc.FillMode);
+    AppendKey(key, desc.CullMode);
+    AppendKey(key, desc.FrontCounterClockwise);
+    AppendKey(key, desc.DepthBias);
+    AppendKey(key, desc.DepthBiasClamp);
+    AppendKey(key, desc.SlopeScaledDepthBias);
+    AppendKey(key, desc.DepthClipEnable);
+    AppendKey(key, desc.ScissorEnable);
+    AppendKey(key, desc.MultisampleEnable);
+    AppendKey(key, desc.AntialiasedLineEnable);
+
+    return Find(rasterizerStates, key, [&](ID3D11RasterizerState** state)
+    {
+        return device->CreateRasterizerState(&desc, state);
+    });
+}
+
+ComPtr<ID3D11DepthStencilState> StateObjectCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+    std::string key;
+    AppendKey(key, desc.DepthEnable);
+    AppendKey(key, desc.DepthWriteMask);
+    AppendKey(key, desc.DepthFunc);
+    AppendKey(key, desc.StencilEnable);
+    AppendKey(key, desc.StencilReadMask);
+    AppendKey(key, desc.StencilWriteMask);
+    AppendKey(key, desc.FrontFace);
+    AppendKey(key, desc.BackFace);
+
+    return Find(depthStencilStates, key, [&](ID3D11DepthStencilState** state)
+    {
+        return device->CreateDepthStencilState(&desc, state);
+    });
+}
+
+ComPtr<ID3D11BlendState> StateObjectCache::GetBlendState(const D3D11_BLEND_DESC& desc)
+{
+    std::string key;
+    AppendKey(key, desc.AlphaToCoverageEnable);
+    AppendKey(key, desc.IndependentBlendEnable);
+    for (const D3D11_RENDER_TARGET_BLEND_DESC& target : desc.RenderTarget)
+    {
+        AppendKey(key, target.BlendEnable);
+        AppendKey(key, target.SrcBlend);
+        AppendKey(key, target.DestBlend);
+        AppendKey(key, target.BlendOp);
+        AppendKey(key, target.SrcBlendAlpha);
+        AppendKey(key, target.DestBlendAlpha);
+        AppendKey(key, target.BlendOpAlpha);
+        AppendKey(key, target.RenderTargetWriteMask);
+    }
+
+    return Find(blendStates, key, [&](ID3D11BlendState** state)
+    {
+        return device->CreateBlendState(&desc, state);
+    });
+}
+
+ComPtr<ID3D11SamplerState> StateObjectCache::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+{
+    std::string key;
+    AppendKey(key, desc.Filter);
+    AppendKey(key, desc.AddressU);
+    AppendKey(key, desc.AddressV);
+    AppendKey(key, desc.AddressW);
+    AppendKey(key, desc.MipLODBias);
+    AppendKey(key, desc.MaxAnisotropy);
+    AppendKey(key, desc.ComparisonFunc);
+    AppendKey(key, desc.BorderColor);
+    AppendKey(key, desc.MinLOD);
+    AppendKey(key, desc.MaxLOD);
+
+    return Find(samplerStates, key, [&](ID3D11SamplerState** state)
+    {
+        return device->CreateSamplerState(&desc, state);
+    });
+}
+
+void StateObjectCache::PrintStats()
+{
+    printf("State objects (shared / created):\n");
+    printf("  Input layouts:        %u / %u\n", inputLayouts.Hits, inputLayouts.Misses);
+    printf("  Rasterizer states:    %u / %u\n", rasterizerStates.Hits, rasterizerStates.Misses);
+    printf("  Depth-stencil states: %u / %u\n", depthStencilStates.Hits, depthStencilStates.Misses);
+    printf("  Blend states:         %u / %u\n", blendStates.Hits, blendStates.Misses);
+    printf("  Sampler states:       %u / %u\n", samplerStates.Hits, samplerStates.Misses);
+}
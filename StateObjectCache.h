@@ -0,0 +1,60 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Hands out one shared, immutable object per distinct
+// description - input layouts, rasterizer, depth-stencil,
+// blend and sampler states.
+//
+// Everything asking for the same description gets the same
+// pointer back, so RenderStateCache sees identical objects
+// and drops the rebind. Input layouts are keyed by their
+// elements plus the shader's input signature, which is all
+// Direct3D checks a layout against, so shaders that take the
+// same vertices share a layout.
+//
+// Objects live as long as the cache does.
+// --------------------------------------------------------
+class StateObjectCache
+{
+public:
+    StateObjectCache(Microsoft::WRL::ComPtr<ID3D11Device> device);
+    ~StateObjectCache();
+
+    // Null if the elements don't match the shader
+    Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout(
+        const D3D11_INPUT_ELEMENT_DESC* elements,
+        unsigned int elementCount,
+        const void* shaderBytecode,
+        size_t bytecodeSize);
+
+    Microsoft::WRL::ComPtr<ID3D11RasterizerState> GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilState> GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+    Microsoft::WRL::ComPtr<ID3D11BlendState> GetBlendState(const D3D11_BLEND_DESC& desc);
+    Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+    // Requests answered with an existing object, and objects created,
+    // for each kind
+    void PrintStats();
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+
+    template<typename T> struct Table
+    {
+        std::unordered_map<std::string, Microsoft::WRL::ComPtr<T>> Objects;
+        unsigned int Hits = 0;
+        unsigned int Misses = 0;
+    };
+    Table<ID3D11InputLayout> inputLayouts;
+    Table<ID3D11RasterizerState> rasterizerStates;
+    Table<ID3D11DepthStencilState> depthStencilStates;
+    Table<ID3D11BlendState> blendStates;
+    Table<ID3D11SamplerState> samplerStates;
+
+    // Looks up the key, creating the object on a miss
+    template<typename T, typename Create> Microsoft::WRL::ComPtr<T> Find(Table<T>& table, const std::string& key, Create create);
+};
@@ -0,0 +1,218 @@
+#include "StaticBatcher.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+using namespace DirectX;
+
+template<typename T> static void AppendKey(std::string& key, const T& value)
+{
+    key.append((const char*)&value, sizeof(T));
+}
+
+StaticBatcher::StaticBatcher(std::shared_ptr<GeometryPool> pool) :
+    pool(pool),
+    sourceList(0),
+    rebuilds(0)
+{
+}
+
+StaticBatcher::~StaticBatcher()
+{
+}
+
+void StaticBatcher::Build(std::vector<Entity>& entities)
+{
+    // The old batches' entities are kept for the new ones (see spareEntities)
+    for (Batch& batch : batches)
+    {
+        if (!batch.Drawn)
+            continue;
+        batch.Drawn->SetMesh(0);
+        spareEntities.push_back(std::move(batch.Drawn));
+    }
+
+    sources.clear();
+    batches.clear();
+    batchLookup.clear();
+    sourceList = &entities;
+
+    for (Entity& e : entities)
+    {
+        if (!e.IsStaticGeometry())
+            continue;
+
+        for (unsigned int submesh = 0; submesh < e.GetMesh()->GetSubmeshCount(); submesh++)
+        {
+            unsigned int batch = FindBatch(e, submesh);
+            batches[batch].Sources.push_back((unsigned int)sources.size());
+            sources.push_back({ &e, submesh, e.GetVersion(), batch });
+        }
+    }
+
+    for (Batch& batch : batches)
+        Rebuild(batch);
+}
+
+void StaticBatcher::Update()
+{
+    for (unsigned int i = 0; i < sources.size(); i++)
+    {
+        Source& source = sources[i];
+        unsigned int version = source.Object->GetVersion();
+        if (version == source.Version)
+            continue;
+
+        // Moving or retinting can put it in a different batch
+        source.Version = version;
+        unsigned int batch = FindBatch(*source.Object, source.Submesh);
+        if (batch != source.Batch)
+        {
+            std::vector<unsigned int>& oldSources = batches[source.Batch].Sources;
+            oldSources.erase(std::find(oldSources.begin(), oldSources.end(), i));
+            batches[source.Batch].Dirty = true;
+
+            batches[batch].Sources.push_back(i);
+            source.Batch = batch;
+        }
+        batches[batch].Dirty = true;
+    }
+
+    for (Batch& batch : batches)
+    {
+        if (batch.Dirty)
+            Rebuild(batch);
+    }
+}
+
+void StaticBatcher::GetBatchEntities(std::vector<Entity*>& entities)
+{
+    for (Batch& batch : batches)
+    {
+        if (!batch.Sources.empty())
+            entities.push_back(batch.Drawn.get());
+    }
+}
+
+unsigned int StaticBatcher::GetBatchCount()
+{
+    unsigned int count = 0;
+    for (Batch& batch : batches)
+    {
+        if (!batch.Sources.empty())
+            count++;
+    }
+    return count;
+}
+
+unsigned int StaticBatcher::FindBatch(Entity& e, unsigned int submesh)
+{
+    BoundingSphere bounds = e.GetWorldBounds();
+    int chunkX = (int)std::floor(bounds.Center.x / STATIC_BATCH_CHUNK_SIZE);
+    int chunkZ = (int)std::floor(bounds.Center.z / STATIC_BATCH_CHUNK_SIZE);
+
+    const InstanceParams& params = e.GetInstanceParams();
+    std::string key;
+    AppendKey(key, e.GetMaterial(submesh));
+    AppendKey(key, params.colorTint);
+    AppendKey(key, params.uvScale);
+    AppendKey(key, params.uvOffset);
+    AppendKey(key, chunkX);
+    AppendKey(key, chunkZ);
+
+    auto found = batchLookup.find(key);
+    if (found != batchLookup.end())
+        return found->second;
+
+    unsigned int index = (unsigned int)batches.size();
+    batches.push_back({});
+    batchLookup[key] = index;
+    return index;
+}
+
+void StaticBatcher::Rebuild(Batch& batch)
+{
+    batch.Dirty = false;
+    rebuilds++;
+
+    // Nothing to draw, but the entity stays (see Batch)
+    if (batch.Sources.empty())
+    {
+        if (batch.Drawn)
+            batch.Drawn->SetMesh(0);
+        return;
+    }
+
+    vertices.clear();
+    indices.clear();
+    for (unsigned int index : batch.Sources)
+    {
+        Entity* e = sources[index].Object;
+        Mesh* mesh = e->GetMesh();
+        const MeshSubmesh& submesh = mesh->GetSubmesh(sources[index].Submesh);
+        XMFLOAT4X4 worldFloat = e->GetTransform()->GetWorldMatrix();
+        XMFLOAT4X4 worldInvTransposeFloat = e->GetTransform()->GetWorldInverseTransposeMatrix();
+        XMMATRIX world = XMLoadFloat4x4(&worldFloat);
+        XMMATRIX worldInvTranspose = XMLoadFloat4x4(&worldInvTransposeFloat);
+
+        // Only the vertices the submesh uses are copied, each once. Positions
+        // and normals go to world space like the vertex shader would do them.
+        // Tangents are worked out again by the new mesh.
+        const std::vector<Vertex>& meshVertices = mesh->GetVertices();
+        const std::vector<unsigned int>& meshIndices = mesh->GetIndices();
+        vertexRemap.assign(meshVertices.size(), UINT_MAX);
+        auto batchVertex = [&](unsigned int meshVertex)
+        {
+            if (vertexRemap[meshVertex] == UINT_MAX)
+            {
+                const Vertex& v = meshVertices[meshVertex];
+                Vertex transformed = v;
+                XMStoreFloat3(&transformed.Position, XMVector3TransformCoord(XMLoadFloat3(&v.Position), world));
+                XMStoreFloat3(&transformed.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.Normal), worldInvTranspose)));
+                vertexRemap[meshVertex] = (unsigned int)vertices.size();
+                vertices.push_back(transformed);
+            }
+            return vertexRemap[meshVertex];
+        };
+
+        // A mirroring transform turns triangles inside out, which the
+        // rasterizer would otherwise have undone for us
+        bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0;
+        unsigned int end = submesh.StartIndex + submesh.IndexCount;
+        for (unsigned int i = submesh.StartIndex; i + 2 < end; i += 3)
+        {
+            indices.push_back(batchVertex(meshIndices[i]));
+            indices.push_back(batchVertex(meshIndices[mirrored ? i + 2 : i + 1]));
+            indices.push_back(batchVertex(meshIndices[mirrored ? i + 1 : i + 2]));
+        }
+    }
+
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(
+        vertices.data(), (int)vertices.size(),
+        indices.data(), (int)indices.size(),
+        pool);
+
+    // The first source gives the batch its material and instance
+    // parameters - everything else in it shares those
+    if (!batch.Drawn)
+    {
+        const Source& first = sources[batch.Sources[0]];
+        std::shared_ptr<Material> material = first.Object->GetSubmeshMaterial(first.Submesh);
+        if (spareEntities.empty())
+        {
+            batch.Drawn = std::make_unique<Entity>(mesh, material);
+        }
+        else
+        {
+            batch.Drawn = std::move(spareEntities.back());
+            spareEntities.pop_back();
+            batch.Drawn->SetMaterial(material);
+            batch.Drawn->SetMesh(mesh);
+        }
+        batch.Drawn->SetInstanceParams(first.Object->GetInstanceParams());
+    }
+    else
+    {
+        batch.Drawn->SetMesh(mesh);
+    }
+}
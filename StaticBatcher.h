@@ -0,0 +1,95 @@
+#pragma once
+#include "Entity.h"
+#include "GeometryPool.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Width of the square chunks of the XZ plane static geometry is
+// batched in, in world units. Batches never span chunks, so
+// shadow views can still cull most of them.
+#define STATIC_BATCH_CHUNK_SIZE 32.0f
+
+// --------------------------------------------------------
+// Merges entities flagged as static geometry into a few big
+// meshes that are already in world space, so each batch is
+// one draw with an identity world matrix rather than a draw
+// and a matrix upload per entity.
+//
+// Each submesh of an entity is batched on its own, grouped
+// by material and instance parameters, since neither can
+// change within a draw, and by the chunk the entity's bounds
+// are centered in.
+//
+// Entities that change after being batched are moved to the
+// batch they now belong in, and only the batches they left
+// or joined are rebuilt.
+// --------------------------------------------------------
+class StaticBatcher
+{
+public:
+    StaticBatcher(std::shared_ptr<GeometryPool> pool);
+    ~StaticBatcher();
+
+    // Batches every static geometry entity in the list, replacing
+    // whatever was batched before. The list can't be resized while
+    // it's batched, since the batcher keeps pointers into it.
+    void Build(std::vector<Entity>& entities);
+    const std::vector<Entity>* GetSourceList() { return sourceList; }
+
+    // Rebuilds the batches of any entity that changed since it
+    // was batched - call once per frame
+    void Update();
+
+    // Adds one entity per non-empty batch to the list
+    void GetBatchEntities(std::vector<Entity*>& entities);
+
+    // Submeshes batched, non-empty batches, and batches rebuilt
+    // since the last ResetStats()
+    unsigned int GetSourceCount() { return (unsigned int)sources.size(); }
+    unsigned int GetBatchCount();
+    unsigned int GetRebuildCount() { return rebuilds; }
+    void ResetStats() { rebuilds = 0; }
+
+private:
+    std::shared_ptr<GeometryPool> pool;
+    const std::vector<Entity>* sourceList;
+    unsigned int rebuilds;
+
+    struct Source
+    {
+        Entity* Object;
+        unsigned int Submesh;
+        unsigned int Version;
+        unsigned int Batch;
+    };
+    std::vector<Source> sources;
+
+    // The entity drawn for a batch is made when it's first built and
+    // kept even if the batch empties out, so it's never mistaken for
+    // a different entity at the same address
+    struct Batch
+    {
+        std::vector<unsigned int> Sources;
+        std::unique_ptr<Entity> Drawn;
+        bool Dirty;
+    };
+    std::vector<Batch> batches;
+
+    // Drawn entities of batches a Build() threw away. They're given
+    // to the new batches rather than destroyed, for the same reason -
+    // taking a new mesh moves them on to a version they've never had.
+    std::vector<std::unique_ptr<Entity>> spareEntities;
+
+    // Material, instance parameters and chunk -> batch index
+    std::unordered_map<std::string, unsigned int> batchLookup;
+
+    unsigned int FindBatch(Entity& e, unsigned int submesh);
+    void Rebuild(Batch& batch);
+
+    // Kept between rebuilds so they don't allocate
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> vertexRemap;
+};
@@ -0,0 +1,46 @@
+#include "SubmeshGrouper.h"
+#include <algorithm>
+
+SubmeshGrouper::SubmeshGrouper() :
+    groupNames(1),
+    currentGroup(0)
+{
+}
+
+SubmeshGrouper::~SubmeshGrouper()
+{
+}
+
+void SubmeshGrouper::UseMaterial(const std::string& name)
+{
+    currentGroup = (unsigned int)(std::find(groupNames.begin(), groupNames.end(), name) - groupNames.begin());
+    if (currentGroup == groupNames.size())
+        groupNames.push_back(name);
+}
+
+void SubmeshGrouper::AddTriangle()
+{
+    triangleGroups.push_back(currentGroup);
+}
+
+void SubmeshGrouper::Group(std::vector<unsigned int>& indices, std::vector<MeshSubmesh>& submeshes)
+{
+    submeshes.clear();
+
+    std::vector<unsigned int> groupedIndices;
+    groupedIndices.reserve(indices.size());
+    for (unsigned int group = 0; group < groupNames.size(); group++)
+    {
+        unsigned int start = (unsigned int)groupedIndices.size();
+        for (size_t t = 0; t < triangleGroups.size() && t * 3 + 2 < indices.size(); t++)
+        {
+            if (triangleGroups[t] == group)
+                groupedIndices.insert(groupedIndices.end(), &indices[t * 3], &indices[t * 3] + 3);
+        }
+
+        unsigned int count = (unsigned int)groupedIndices.size() - start;
+        if (count > 0)
+            submeshes.push_back({ groupNames[group], start, count });
+    }
+    indices.swap(groupedIndices);
+}
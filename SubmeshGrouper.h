@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// A range of a mesh's indices drawn with one material, named by
+// the OBJ's usemtl line ("" for faces that come before any)
+struct MeshSubmesh
+{
+    std::string MaterialName;
+    unsigned int StartIndex;    // Relative to the mesh's own indices
+    unsigned int IndexCount;
+};
+
+// --------------------------------------------------------
+// Sorts the triangles of an OBJ into one submesh per material
+// while it's read. Call UseMaterial() for each usemtl line and
+// AddTriangle() for each triangle, then Group() once the file
+// is done.
+//
+// Groups using the same material end up in one submesh, so
+// every submesh is a single range of the mesh's indices.
+// --------------------------------------------------------
+class SubmeshGrouper
+{
+public:
+    SubmeshGrouper();
+    ~SubmeshGrouper();
+
+    // Triangles added from now on use the named material
+    void UseMaterial(const std::string& name);
+    void AddTriangle();
+
+    // Reorders the indices (three per triangle, in the order they were
+    // added) so each material's triangles are together, keeping their
+    // order within it. Materials come in the order they were first
+    // used, and those without triangles get no submesh.
+    void Group(std::vector<unsigned int>& indices, std::vector<MeshSubmesh>& submeshes);
+
+private:
+    std::vector<std::string> groupNames;        // In order of first use
+    std::vector<unsigned int> triangleGroups;   // Which of those each triangle uses
+    unsigned int currentGroup;                  // Faces before any usemtl get the unnamed group
+};
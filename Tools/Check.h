@@ -0,0 +1,29 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Bare-bones checks shared by the test tools. A failed check
+// prints where it failed and carries on, so one run shows
+// every failure; main() returns CheckResult() at the end.
+// --------------------------------------------------------
+
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { checkFailures++; printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); } } while (0)
+
+#define CHECK_NEAR(a, b, epsilon) \
+    do { double checkA = (a), checkB = (b); if (!(std::fabs(checkA - checkB) <= (epsilon))) { checkFailures++; \
+        printf("%s(%d): CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); } } while (0)
+
+static int CheckResult()
+{
+    if (checkFailures > 0)
+    {
+        printf("%d check(s) failed\n", checkFailures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
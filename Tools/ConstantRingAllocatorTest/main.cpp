@@ -0,0 +1,199 @@
+#include <cstdlib>
+#include <vector>
+#include "../Check.h"
+#include "../../ConstantRingAllocator.h"
+
+// --------------------------------------------------------
+// Headless checks of the constant ring's bookkeeping:
+//
+//   ConstantRingAllocatorTest
+//
+// Covers alignment, wrapping around the end of the ring,
+// fence handling and, over a long random run, that no bytes
+// are handed out again before their frame's fence completes.
+// --------------------------------------------------------
+
+static void TestAlignment()
+{
+    ConstantRingAllocator ring(4096, 256);
+    unsigned int offset = 0;
+
+    CHECK(ring.Allocate(1, offset));
+    CHECK(offset == 0);
+    CHECK(ring.Allocate(100, offset));
+    CHECK(offset == 256);
+    CHECK(ring.Allocate(257, offset));
+    CHECK(offset == 512);
+    CHECK(ring.Allocate(256, offset));
+    CHECK(offset == 1024);
+    CHECK(ring.GetUsedBytes() == 1280);
+
+    // Nothing at all, or more than fits, can't be had
+    CHECK(!ring.Allocate(0, offset));
+    CHECK(!ring.Allocate(4097, offset));
+}
+
+static void TestFences()
+{
+    ConstantRingAllocator ring(1024, 256);
+    unsigned int offset = 0;
+    CHECK(ring.GetFramesInFlight() == 0);
+    CHECK(ring.GetOldestPendingFence() == 1);
+
+    CHECK(ring.Allocate(256, offset));
+    CHECK(ring.EndFrame() == 1);
+    CHECK(ring.EndFrame() == 2);
+    CHECK(ring.EndFrame() == 3);
+    CHECK(ring.GetFramesInFlight() == 3);
+    CHECK(ring.GetOldestPendingFence() == 1);
+
+    ring.Retire(2);
+    CHECK(ring.GetFramesInFlight() == 1);
+    CHECK(ring.GetOldestPendingFence() == 3);
+    CHECK(ring.GetUsedBytes() == 0);
+
+    // Old fences reported again change nothing, and fences that
+    // haven't been handed out yet can't complete
+    ring.Retire(1);
+    CHECK(ring.GetOldestPendingFence() == 3);
+    ring.Retire(10);
+    CHECK(ring.GetFramesInFlight() == 0);
+    CHECK(ring.EndFrame() == 4);
+    CHECK(ring.GetFramesInFlight() == 1);
+
+    // Replacing the memory forgets allocations but not fences
+    CHECK(ring.Allocate(256, offset));
+    ring.Reset();
+    CHECK(ring.GetUsedBytes() == 0);
+    CHECK(ring.GetFramesInFlight() == 1);
+    CHECK(ring.EndFrame() == 5);
+}
+
+static void TestNoReuseBeforeFence()
+{
+    ConstantRingAllocator ring(1024, 256);
+    unsigned int offset = 0;
+    for (int i = 0; i < 4; i++)
+        CHECK(ring.Allocate(256, offset));
+    unsigned long long fence = ring.EndFrame();
+
+    // Full until the GPU is done with the frame
+    CHECK(!ring.Allocate(16, offset));
+    ring.Retire(fence - 1);
+    CHECK(!ring.Allocate(16, offset));
+
+    ring.Retire(fence);
+    CHECK(ring.Allocate(16, offset));
+    CHECK(offset == 0);
+}
+
+static void TestWrapAround()
+{
+    ConstantRingAllocator ring(1024, 256);
+    unsigned int offset = 0;
+
+    CHECK(ring.Allocate(512, offset));
+    CHECK(offset == 0);
+    unsigned long long first = ring.EndFrame();
+
+    CHECK(ring.Allocate(256, offset));
+    CHECK(offset == 512);
+    unsigned long long second = ring.EndFrame();
+
+    // 512 bytes don't fit in the last 256, so the end is skipped and
+    // the allocation wraps to the start the first frame freed up
+    ring.Retire(first);
+    CHECK(ring.Allocate(512, offset));
+    CHECK(offset == 0);
+    CHECK(ring.GetUsedBytes() == 1024);
+    CHECK(!ring.Allocate(16, offset));
+    unsigned long long third = ring.EndFrame();
+
+    // The second frame's space comes back with its fence. The skipped
+    // end was counted against the third frame, which is still in use.
+    ring.Retire(second);
+    CHECK(ring.GetUsedBytes() == 768);
+    CHECK(!ring.Allocate(512, offset));
+    CHECK(ring.Allocate(256, offset));
+    CHECK(offset == 512);
+    CHECK(!ring.Allocate(16, offset));
+    ring.EndFrame();
+
+    ring.Retire(third);
+    CHECK(ring.GetUsedBytes() == 256);
+}
+
+// Random sizes, frames and GPU lag, checking every allocation
+// against all the ones whose fence hasn't completed
+static void TestRandomFrames()
+{
+    struct Live
+    {
+        unsigned int Offset;
+        unsigned int Size;
+        unsigned long long Fence;
+    };
+
+    srand(1);
+    for (int trial = 0; trial < 200; trial++)
+    {
+        unsigned int capacity = 256 * (1 + rand() % 40);
+        ConstantRingAllocator ring(capacity, 256);
+        std::vector<Live> live;
+        unsigned long long completed = 0;
+
+        for (int frame = 0; frame < 300; frame++)
+        {
+            int count = rand() % 8;
+            for (int i = 0; i < count; i++)
+            {
+                unsigned int size = 1 + rand() % 600;
+                unsigned int alignedSize = (size + 255) / 256 * 256;
+                if (alignedSize > capacity)
+                    continue;
+
+                // Full - the ring gets fresh memory, like a DISCARD map
+                unsigned int offset = 0;
+                if (!ring.Allocate(size, offset))
+                {
+                    ring.Reset();
+                    live.clear();
+                    CHECK(ring.Allocate(size, offset));
+                }
+
+                CHECK(offset % 256 == 0);
+                CHECK(offset + alignedSize <= capacity);
+                for (const Live& other : live)
+                    CHECK(offset + alignedSize <= other.Offset || other.Offset + other.Size <= offset);
+                live.push_back({ offset, alignedSize, ring.GetOldestPendingFence() + ring.GetFramesInFlight() });
+            }
+
+            // The GPU is up to three frames behind
+            unsigned long long fence = ring.EndFrame();
+            unsigned long long done = fence > 3 ? fence - rand() % 4 : 0;
+            if (done > completed)
+                completed = done;
+            ring.Retire(completed);
+            CHECK(ring.GetFramesInFlight() == fence - completed);
+            CHECK(ring.GetUsedBytes() <= capacity);
+
+            std::vector<Live> stillLive;
+            for (const Live& allocation : live)
+            {
+                if (allocation.Fence > completed)
+                    stillLive.push_back(allocation);
+            }
+            live.swap(stillLive);
+        }
+    }
+}
+
+int main()
+{
+    TestAlignment();
+    TestFences();
+    TestNoReuseBeforeFence();
+    TestWrapAround();
+    TestRandomFrames();
+    return CheckResult();
+}
@@ -0,0 +1,335 @@
+#pragma once
+#include <vector>
+#include "../../DxbcReflection.h"
+
+// --------------------------------------------------------
+// What each of the project's shaders should reflect as,
+// worked out from its HLSL by hand, and checked against
+// D3DReflect by DxbcReflectionTest on Windows. Only what fxc keeps is
+// listed - resources and constant buffers a shader never
+// uses are compiled out, but every variable of a buffer it
+// does use is kept.
+// --------------------------------------------------------
+
+// D3D_SHADER_VARIABLE_CLASS
+#define EXPECTED_CLASS_SCALAR           0
+#define EXPECTED_CLASS_VECTOR           1
+#define EXPECTED_CLASS_MATRIX_COLUMNS   3
+#define EXPECTED_CLASS_STRUCT           5
+
+// D3D_SHADER_VARIABLE_TYPE
+#define EXPECTED_TYPE_VOID              0
+#define EXPECTED_TYPE_INT               2
+#define EXPECTED_TYPE_FLOAT             3
+#define EXPECTED_TYPE_UINT              19
+
+// D3D_CBUFFER_TYPE - structured buffers get a buffer of their
+// own, holding a single $Element variable of the element type
+#define EXPECTED_CBUFFER                0
+#define EXPECTED_RESOURCE_BIND_INFO     3
+
+// D3D_NAME - SV_Target and SV_Depth are stored as undefined, and
+// filled in from the semantic name the way D3DReflect does
+#define EXPECTED_NAME_UNDEFINED         0
+#define EXPECTED_NAME_POSITION          1
+#define EXPECTED_NAME_VERTEX_ID         6
+#define EXPECTED_NAME_TARGET            64
+#define EXPECTED_NAME_DEPTH             65
+
+// D3D_REGISTER_COMPONENT_TYPE
+#define EXPECTED_COMPONENT_UINT32       1
+#define EXPECTED_COMPONENT_FLOAT32      3
+
+// oDepth isn't a numbered register
+#define EXPECTED_REGISTER_NONE          0xFFFFFFFF
+
+struct ExpectedVariable
+{
+    const char* Name;
+    unsigned int Offset;
+    unsigned int Size;
+    unsigned int Class;
+    unsigned int Type;
+    unsigned int Rows;
+    unsigned int Columns;
+};
+
+struct ExpectedBuffer
+{
+    const char* Name;
+    unsigned int Type;
+    unsigned int Size;
+    std::vector<ExpectedVariable> Variables;
+};
+
+struct ExpectedBinding
+{
+    const char* Name;
+    unsigned int Type;          // DXBC_INPUT_*
+    unsigned int BindPoint;
+    unsigned int BindCount;
+};
+
+struct ExpectedParameter
+{
+    const char* SemanticName;
+    unsigned int SemanticIndex;
+    unsigned int Register;
+    unsigned int SystemValueType;
+    unsigned int ComponentType;
+    unsigned char Mask;
+};
+
+struct ExpectedShader
+{
+    const char* Name;           // The .cso file, without the extension
+    DxbcShaderType Type;
+    std::vector<ExpectedBinding> Bindings;
+    std::vector<ExpectedBuffer> Buffers;
+    std::vector<ExpectedParameter> Inputs;
+    std::vector<ExpectedParameter> Outputs;
+};
+
+// --------------------------------------------------------
+// The shared buffers, from ConstantBuffers.hlsli
+// --------------------------------------------------------
+static const ExpectedBuffer perFrameBuffer = { "PerFrame", EXPECTED_CBUFFER, 64, {
+    { "totalTime", 0, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 },
+    { "ambient", 4, 12, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 3 },
+    { "cascadeSplits", 16, 16, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 4 },
+    { "clusterScreenScale", 32, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 },
+    { "clusterDepthScale", 40, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 },
+    { "clusterDepthBias", 44, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 },
+    { "globalLightCount", 48, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_UINT, 1, 1 },
+    { "cascadeCount", 52, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_INT, 1, 1 },
+    { "perFramePadding", 56, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 } } };
+
+static const ExpectedBuffer perViewBuffer = { "PerView", EXPECTED_CBUFFER, 160, {
+    { "view", 0, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+    { "projection", 64, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+    { "cameraPos", 128, 12, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 3 },
+    { "perViewPadding0", 140, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 },
+    { "cameraForward", 144, 12, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 3 },
+    { "perViewPadding1", 156, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 } } };
+
+static const ExpectedBuffer perMaterialBuffer = { "PerMaterial", EXPECTED_CBUFFER, 32, {
+    { "colorTint", 0, 16, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 4 },
+    { "uvScale", 16, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 },
+    { "uvOffset", 24, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 } } };
+
+static const ExpectedBuffer perObjectBuffer = { "PerObject", EXPECTED_CBUFFER, 224, {
+    { "worldViewProjection", 0, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+    { "world", 64, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+    { "worldInvTranspose", 128, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+    { "instanceColorTint", 192, 16, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 4 },
+    { "instanceUvScale", 208, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 },
+    { "instanceUvOffset", 216, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 2 } } };
+
+// --------------------------------------------------------
+// Signatures, from ShaderIncludes.hlsli. Vertex inputs get
+// a register each; float2s are only packed with a following
+// member when it fits in the same register, and nothing in
+// these structs does.
+// --------------------------------------------------------
+static const ExpectedParameter positionParameter = { "SV_POSITION", 0, 0, EXPECTED_NAME_POSITION, EXPECTED_COMPONENT_FLOAT32, 0xF };
+static const ExpectedParameter targetParameter = { "SV_TARGET", 0, 0, EXPECTED_NAME_TARGET, EXPECTED_COMPONENT_FLOAT32, 0xF };
+
+// VertexShaderInput
+static const std::vector<ExpectedParameter> vertexInputs = {
+    { "POSITION", 0, 0, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "NORMAL", 0, 1, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "TEXCOORD", 0, 2, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x3 },
+    { "TANGENT", 0, 3, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 } };
+
+// VertexToPixel
+static const std::vector<ExpectedParameter> vertexToPixel = {
+    positionParameter,
+    { "TEXCOORD", 0, 1, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x3 },
+    { "NORMAL", 0, 2, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "POSITION", 0, 3, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 } };
+
+// VertexToPixel_NormalMapShadowMap
+static const std::vector<ExpectedParameter> litVertexToPixel = {
+    positionParameter,
+    { "TEXCOORD", 0, 1, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x3 },
+    { "NORMAL", 0, 2, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "POSITION", 0, 3, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "TANGENT", 0, 4, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 },
+    { "COLOR", 0, 5, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0xF } };
+
+// VertexToPixel_Sky
+static const std::vector<ExpectedParameter> skyVertexToPixel = {
+    positionParameter,
+    { "DIRECTION", 0, 1, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 } };
+
+// Four float4 registers starting at firstRegister, one per matrix column
+static void AddMatrixInputs(std::vector<ExpectedParameter>& inputs, const char* semanticName, unsigned int firstRegister)
+{
+    for (unsigned int i = 0; i < 4; i++)
+        inputs.push_back({ semanticName, i, firstRegister + i, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0xF });
+}
+
+// --------------------------------------------------------
+// The lit pixel shaders, with the same keywords as the
+// LitPS_[X].hlsl files
+// --------------------------------------------------------
+static ExpectedShader LitPixelShader(const char* name, bool normalMap, bool reflection, bool shadows)
+{
+    ExpectedShader shader = { name, DXBC_SHADER_PIXEL, {}, {}, {}, {} };
+
+    // Samplers, then textures and buffers, then constant buffers
+    shader.Bindings.push_back({ "BasicSampler", DXBC_INPUT_SAMPLER, 0, 1 });
+    if (shadows)
+        shader.Bindings.push_back({ "ShadowSampler", DXBC_INPUT_SAMPLER, 1, 1 });
+    shader.Bindings.push_back({ "Albedo", DXBC_INPUT_TEXTURE, 0, 1 });
+    if (normalMap)
+        shader.Bindings.push_back({ "NormalMap", DXBC_INPUT_TEXTURE, 1, 1 });
+    shader.Bindings.push_back({ "RoughnessMap", DXBC_INPUT_TEXTURE, 2, 1 });
+    shader.Bindings.push_back({ "MetalnessMap", DXBC_INPUT_TEXTURE, 3, 1 });
+    if (reflection)
+        shader.Bindings.push_back({ "SkyTexture", DXBC_INPUT_TEXTURE, 4, 1 });
+    if (shadows)
+        shader.Bindings.push_back({ "ShadowMap", DXBC_INPUT_TEXTURE, 5, 1 });
+    shader.Bindings.push_back({ "Lights", DXBC_INPUT_STRUCTURED, 6, 1 });
+    shader.Bindings.push_back({ "LightClusters", DXBC_INPUT_STRUCTURED, 7, 1 });
+    shader.Bindings.push_back({ "LightIndices", DXBC_INPUT_STRUCTURED, 8, 1 });
+    if (shadows)
+        shader.Bindings.push_back({ "ShadowViews", DXBC_INPUT_STRUCTURED, 9, 1 });
+    shader.Bindings.push_back({ "PerFrame", DXBC_INPUT_CBUFFER, 10, 1 });
+    shader.Bindings.push_back({ "PerView", DXBC_INPUT_CBUFFER, 11, 1 });
+    shader.Bindings.push_back({ "PerMaterial", DXBC_INPUT_CBUFFER, 12, 1 });
+
+    shader.Buffers.push_back(perFrameBuffer);
+    shader.Buffers.push_back(perViewBuffer);
+    shader.Buffers.push_back(perMaterialBuffer);
+
+    // Light is 16 floats and ints, ShadowView a matrix and two float4s
+    shader.Buffers.push_back({ "Lights", EXPECTED_RESOURCE_BIND_INFO, 64, {
+        { "$Element", 0, 64, EXPECTED_CLASS_STRUCT, EXPECTED_TYPE_VOID, 1, 16 } } });
+    shader.Buffers.push_back({ "LightClusters", EXPECTED_RESOURCE_BIND_INFO, 8, {
+        { "$Element", 0, 8, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_UINT, 1, 2 } } });
+    shader.Buffers.push_back({ "LightIndices", EXPECTED_RESOURCE_BIND_INFO, 4, {
+        { "$Element", 0, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_UINT, 1, 1 } } });
+    if (shadows)
+    {
+        shader.Buffers.push_back({ "ShadowViews", EXPECTED_RESOURCE_BIND_INFO, 96, {
+            { "$Element", 0, 96, EXPECTED_CLASS_STRUCT, EXPECTED_TYPE_VOID, 1, 24 } } });
+    }
+
+    shader.Inputs = litVertexToPixel;
+    shader.Outputs.push_back(targetParameter);
+    return shader;
+}
+
+static ExpectedShader LitVertexShader(const char* name, bool instancing)
+{
+    ExpectedShader shader = { name, DXBC_SHADER_VERTEX, {}, {}, {}, {} };
+    shader.Inputs = vertexInputs;
+    if (instancing)
+    {
+        // Matrices come from the instance buffer, but the view doesn't
+        shader.Bindings.push_back({ "PerView", DXBC_INPUT_CBUFFER, 11, 1 });
+        shader.Buffers.push_back(perViewBuffer);
+
+        AddMatrixInputs(shader.Inputs, "WORLD_PER_INSTANCE", 4);
+        AddMatrixInputs(shader.Inputs, "WORLDINVTRANSPOSE_PER_INSTANCE", 8);
+        shader.Inputs.push_back({ "COLOR_PER_INSTANCE", 0, 12, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0xF });
+        shader.Inputs.push_back({ "UVSCALEOFFSET_PER_INSTANCE", 0, 13, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0xF });
+    }
+    else
+    {
+        shader.Bindings.push_back({ "PerObject", DXBC_INPUT_CBUFFER, 13, 1 });
+        shader.Buffers.push_back(perObjectBuffer);
+    }
+    shader.Outputs = litVertexToPixel;
+    return shader;
+}
+
+// --------------------------------------------------------
+// Every shader the project compiles
+// --------------------------------------------------------
+static std::vector<ExpectedShader> GetExpectedShaders()
+{
+    std::vector<ExpectedShader> shaders;
+
+    shaders.push_back(LitPixelShader("LitPS_L2", false, false, false));
+    shaders.push_back(LitPixelShader("LitPS_N_L2", true, false, false));
+    shaders.push_back(LitPixelShader("LitPS_R_L2", false, true, false));
+    shaders.push_back(LitPixelShader("LitPS_S_L2", false, false, true));
+    shaders.push_back(LitPixelShader("LitPS_NR_L2", true, true, false));
+    shaders.push_back(LitPixelShader("LitPS_NS_L2", true, false, true));
+    shaders.push_back(LitPixelShader("LitPS_RS_L2", false, true, true));
+    shaders.push_back(LitPixelShader("LitPS_NRS_L2", true, true, true));
+    shaders.push_back(LitPixelShader("LitPS_RS_L3", false, true, true));
+    shaders.push_back(LitPixelShader("LitPS_NRS_L3", true, true, true));
+    shaders.push_back(LitVertexShader("LitVS", false));
+    shaders.push_back(LitVertexShader("LitVS_I", true));
+
+    ExpectedShader customPS = { "CustomPS", DXBC_SHADER_PIXEL,
+        { { "ExternalData", DXBC_INPUT_CBUFFER, 0, 1 } },
+        { { "ExternalData", EXPECTED_CBUFFER, 32, {
+            { "colorTint", 0, 16, EXPECTED_CLASS_VECTOR, EXPECTED_TYPE_FLOAT, 1, 4 },
+            { "totalTime", 16, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 } } } },
+        vertexToPixel,
+        { targetParameter } };
+    shaders.push_back(customPS);
+
+    ExpectedShader vertexShader = { "VertexShader", DXBC_SHADER_VERTEX,
+        { { "ExternalData", DXBC_INPUT_CBUFFER, 0, 1 } },
+        { { "ExternalData", EXPECTED_CBUFFER, 256, {
+            { "world", 0, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+            { "worldInvTranspose", 64, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+            { "view", 128, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 },
+            { "projection", 192, 64, EXPECTED_CLASS_MATRIX_COLUMNS, EXPECTED_TYPE_FLOAT, 4, 4 } } } },
+        vertexInputs,
+        vertexToPixel };
+    shaders.push_back(vertexShader);
+
+    ExpectedShader skyPS = { "PixelShaderSky", DXBC_SHADER_PIXEL,
+        { { "BasicSampler", DXBC_INPUT_SAMPLER, 0, 1 },
+          { "SkyTexture", DXBC_INPUT_TEXTURE, 0, 1 } },
+        {},
+        skyVertexToPixel,
+        { targetParameter } };
+    shaders.push_back(skyPS);
+
+    ExpectedShader skyVS = { "VertexShaderSky", DXBC_SHADER_VERTEX,
+        { { "PerView", DXBC_INPUT_CBUFFER, 11, 1 } },
+        { perViewBuffer },
+        vertexInputs,
+        skyVertexToPixel };
+    shaders.push_back(skyVS);
+
+    // Depth only, so just the position goes in
+    ExpectedShader shadowMapVS = { "ShadowMapVS", DXBC_SHADER_VERTEX,
+        { { "PerObject", DXBC_INPUT_CBUFFER, 13, 1 } },
+        { perObjectBuffer },
+        { { "POSITION", 0, 0, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 } },
+        { positionParameter } };
+    shaders.push_back(shadowMapVS);
+
+    ExpectedShader shadowMapVSInstanced = { "ShadowMapVSInstanced", DXBC_SHADER_VERTEX,
+        { { "PerView", DXBC_INPUT_CBUFFER, 11, 1 } },
+        { perViewBuffer },
+        { { "POSITION", 0, 0, EXPECTED_NAME_UNDEFINED, EXPECTED_COMPONENT_FLOAT32, 0x7 } },
+        { positionParameter } };
+    AddMatrixInputs(shadowMapVSInstanced.Inputs, "WORLD_PER_INSTANCE", 1);
+    shaders.push_back(shadowMapVSInstanced);
+
+    ExpectedShader shadowTileVS = { "ShadowTileVS", DXBC_SHADER_VERTEX,
+        { { "ExternalData", DXBC_INPUT_CBUFFER, 0, 1 } },
+        { { "ExternalData", EXPECTED_CBUFFER, 16, {
+            { "depth", 0, 4, EXPECTED_CLASS_SCALAR, EXPECTED_TYPE_FLOAT, 1, 1 } } } },
+        { { "SV_VertexID", 0, 0, EXPECTED_NAME_VERTEX_ID, EXPECTED_COMPONENT_UINT32, 0x1 } },
+        { positionParameter } };
+    shaders.push_back(shadowTileVS);
+
+    ExpectedShader shadowCopyPS = { "ShadowCopyPS", DXBC_SHADER_PIXEL,
+        { { "StaticShadowMap", DXBC_INPUT_TEXTURE, 0, 1 } },
+        {},
+        { positionParameter },
+        { { "SV_DEPTH", 0, EXPECTED_REGISTER_NONE, EXPECTED_NAME_DEPTH, EXPECTED_COMPONENT_FLOAT32, 0x1 } } };
+    shaders.push_back(shadowCopyPS);
+
+    return shaders;
+}
@@ -0,0 +1,273 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../Check.h"
+#include "ExpectedShaders.h"
+
+// --------------------------------------------------------
+// Checks the DXBC parser against the shaders fxc compiled
+// for a build - the directory the .cso files are written to:
+//
+//   DxbcReflectionTest <build output dir>
+//
+// Each shader is compared with ExpectedShaders.h, which lists
+// what its HLSL says should be there. On Windows each one is
+// also run through D3DReflect, and the parser has to agree
+// with it on everything, as does ExpectedShaders.h - that's
+// what keeps the table honest when a shader changes.
+// --------------------------------------------------------
+
+static bool ReadFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// The order D3DReflect returns bindings and buffers in isn't
+// something anything relies on, so these are found by name
+static const DxbcConstantBuffer* FindBuffer(DxbcReflection& reflection, const char* name)
+{
+    for (const DxbcConstantBuffer& buffer : reflection.GetConstantBuffers())
+    {
+        if (buffer.Name == name)
+            return &buffer;
+    }
+    return 0;
+}
+
+static void CheckBindings(DxbcReflection& reflection, const ExpectedShader& expected)
+{
+    CHECK(reflection.GetResourceBindings().size() == expected.Bindings.size());
+    for (const ExpectedBinding& expectedBinding : expected.Bindings)
+    {
+        const DxbcResourceBinding* binding = reflection.FindResourceBinding(expectedBinding.Name);
+        CHECK(binding != 0);
+        if (!binding)
+            continue;
+
+        CHECK(binding->Type == expectedBinding.Type);
+        CHECK(binding->BindPoint == expectedBinding.BindPoint);
+        CHECK(binding->BindCount == expectedBinding.BindCount);
+    }
+}
+
+static void CheckBuffers(DxbcReflection& reflection, const ExpectedShader& expected)
+{
+    CHECK(reflection.GetConstantBuffers().size() == expected.Buffers.size());
+    for (const ExpectedBuffer& expectedBuffer : expected.Buffers)
+    {
+        const DxbcConstantBuffer* buffer = FindBuffer(reflection, expectedBuffer.Name);
+        CHECK(buffer != 0);
+        if (!buffer)
+            continue;
+
+        CHECK(buffer->Type == expectedBuffer.Type);
+        CHECK(buffer->Size == expectedBuffer.Size);
+        CHECK(buffer->Variables.size() == expectedBuffer.Variables.size());
+        if (buffer->Variables.size() != expectedBuffer.Variables.size())
+            continue;
+
+        // Variables are always in declaration order
+        for (size_t v = 0; v < buffer->Variables.size(); v++)
+        {
+            const DxbcVariable& variable = buffer->Variables[v];
+            const ExpectedVariable& expectedVariable = expectedBuffer.Variables[v];
+            CHECK(variable.Name == expectedVariable.Name);
+            CHECK(variable.StartOffset == expectedVariable.Offset);
+            CHECK(variable.Size == expectedVariable.Size);
+            CHECK(variable.Type.Class == expectedVariable.Class);
+            CHECK(variable.Type.Type == expectedVariable.Type);
+            CHECK(variable.Type.Rows == expectedVariable.Rows);
+            CHECK(variable.Type.Columns == expectedVariable.Columns);
+            CHECK(variable.Type.Elements == 0);
+        }
+    }
+}
+
+static void CheckSignature(const std::vector<DxbcSignatureParameter>& parameters, const std::vector<ExpectedParameter>& expected)
+{
+    CHECK(parameters.size() == expected.size());
+    if (parameters.size() != expected.size())
+        return;
+
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        const DxbcSignatureParameter& parameter = parameters[i];
+        CHECK(parameter.SemanticName == expected[i].SemanticName);
+        CHECK(parameter.SemanticIndex == expected[i].SemanticIndex);
+        CHECK(parameter.Register == expected[i].Register);
+        CHECK(parameter.SystemValueType == expected[i].SystemValueType);
+        CHECK(parameter.ComponentType == expected[i].ComponentType);
+        CHECK(parameter.Mask == expected[i].Mask);
+        CHECK(parameter.Stream == 0);
+    }
+}
+
+static void CheckReflection(DxbcReflection& reflection, const ExpectedShader& expected)
+{
+    CHECK(reflection.GetShaderType() == expected.Type);
+    CHECK(reflection.GetMajorVersion() == 5);
+    CHECK(reflection.GetMinorVersion() == 0);
+    CHECK(reflection.GetThreadGroupSize(0, 0, 0) == 0);
+    CheckBindings(reflection, expected);
+    CheckBuffers(reflection, expected);
+    CheckSignature(reflection.GetInputParameters(), expected.Inputs);
+    CheckSignature(reflection.GetOutputParameters(), expected.Outputs);
+}
+
+#ifdef _WIN32
+static void CheckSameType(const DxbcType& parsed, const DxbcType& reflected)
+{
+    CHECK(parsed.Class == reflected.Class);
+    CHECK(parsed.Type == reflected.Type);
+    CHECK(parsed.Rows == reflected.Rows);
+    CHECK(parsed.Columns == reflected.Columns);
+    CHECK(parsed.Elements == reflected.Elements);
+    CHECK(parsed.Name == reflected.Name);
+    CHECK(parsed.Members.size() == reflected.Members.size());
+    for (size_t m = 0; m < parsed.Members.size() && m < reflected.Members.size(); m++)
+    {
+        CHECK(parsed.Members[m].Name == reflected.Members[m].Name);
+        CHECK(parsed.Members[m].Offset == reflected.Members[m].Offset);
+        CheckSameType(parsed.Members[m].Type, reflected.Members[m].Type);
+    }
+}
+
+static void CheckSameSignature(const std::vector<DxbcSignatureParameter>& parsed, const std::vector<DxbcSignatureParameter>& reflected)
+{
+    CHECK(parsed.size() == reflected.size());
+    for (size_t i = 0; i < parsed.size() && i < reflected.size(); i++)
+    {
+        CHECK(parsed[i].SemanticName == reflected[i].SemanticName);
+        CHECK(parsed[i].SemanticIndex == reflected[i].SemanticIndex);
+        CHECK(parsed[i].Register == reflected[i].Register);
+        CHECK(parsed[i].SystemValueType == reflected[i].SystemValueType);
+        CHECK(parsed[i].ComponentType == reflected[i].ComponentType);
+        CHECK(parsed[i].Mask == reflected[i].Mask);
+        CHECK(parsed[i].ReadWriteMask == reflected[i].ReadWriteMask);
+        CHECK(parsed[i].Stream == reflected[i].Stream);
+    }
+}
+
+// Everything the parser read has to match D3DReflect, in the same order
+static void CheckSameAsD3DReflect(DxbcReflection& parsed, DxbcReflection& reflected)
+{
+    CHECK(parsed.GetShaderType() == reflected.GetShaderType());
+    CHECK(parsed.GetMajorVersion() == reflected.GetMajorVersion());
+    CHECK(parsed.GetMinorVersion() == reflected.GetMinorVersion());
+    CHECK(parsed.GetThreadGroupSize(0, 0, 0) == reflected.GetThreadGroupSize(0, 0, 0));
+
+    const std::vector<DxbcResourceBinding>& parsedBindings = parsed.GetResourceBindings();
+    const std::vector<DxbcResourceBinding>& reflectedBindings = reflected.GetResourceBindings();
+    CHECK(parsedBindings.size() == reflectedBindings.size());
+    for (size_t r = 0; r < parsedBindings.size() && r < reflectedBindings.size(); r++)
+    {
+        CHECK(parsedBindings[r].Name == reflectedBindings[r].Name);
+        CHECK(parsedBindings[r].Type == reflectedBindings[r].Type);
+        CHECK(parsedBindings[r].ReturnType == reflectedBindings[r].ReturnType);
+        CHECK(parsedBindings[r].Dimension == reflectedBindings[r].Dimension);
+        CHECK(parsedBindings[r].NumSamples == reflectedBindings[r].NumSamples);
+        CHECK(parsedBindings[r].BindPoint == reflectedBindings[r].BindPoint);
+        CHECK(parsedBindings[r].BindCount == reflectedBindings[r].BindCount);
+        CHECK(parsedBindings[r].Flags == reflectedBindings[r].Flags);
+    }
+
+    const std::vector<DxbcConstantBuffer>& parsedBuffers = parsed.GetConstantBuffers();
+    const std::vector<DxbcConstantBuffer>& reflectedBuffers = reflected.GetConstantBuffers();
+    CHECK(parsedBuffers.size() == reflectedBuffers.size());
+    for (size_t b = 0; b < parsedBuffers.size() && b < reflectedBuffers.size(); b++)
+    {
+        const DxbcConstantBuffer& parsedBuffer = parsedBuffers[b];
+        const DxbcConstantBuffer& reflectedBuffer = reflectedBuffers[b];
+        CHECK(parsedBuffer.Name == reflectedBuffer.Name);
+        CHECK(parsedBuffer.Type == reflectedBuffer.Type);
+        CHECK(parsedBuffer.Size == reflectedBuffer.Size);
+        CHECK(parsedBuffer.Flags == reflectedBuffer.Flags);
+        CHECK(parsedBuffer.Variables.size() == reflectedBuffer.Variables.size());
+        for (size_t v = 0; v < parsedBuffer.Variables.size() && v < reflectedBuffer.Variables.size(); v++)
+        {
+            CHECK(parsedBuffer.Variables[v].Name == reflectedBuffer.Variables[v].Name);
+            CHECK(parsedBuffer.Variables[v].StartOffset == reflectedBuffer.Variables[v].StartOffset);
+            CHECK(parsedBuffer.Variables[v].Size == reflectedBuffer.Variables[v].Size);
+            CHECK(parsedBuffer.Variables[v].Flags == reflectedBuffer.Variables[v].Flags);
+            CheckSameType(parsedBuffer.Variables[v].Type, reflectedBuffer.Variables[v].Type);
+        }
+    }
+
+    CheckSameSignature(parsed.GetInputParameters(), reflected.GetInputParameters());
+    CheckSameSignature(parsed.GetOutputParameters(), reflected.GetOutputParameters());
+}
+#endif
+
+static void CheckShader(const std::string& directory, const ExpectedShader& expected)
+{
+    int failuresBefore = checkFailures;
+
+    std::string code;
+    DxbcReflection reflection;
+    std::string path = directory + "/" + expected.Name + ".cso";
+    CHECK(ReadFile(path, code));
+    CHECK(reflection.Parse(code.data(), code.size()));
+    CheckReflection(reflection, expected);
+
+#ifdef _WIN32
+    // The table has to describe what D3DReflect sees too, or it's
+    // only checking the parser against itself
+    DxbcReflection reflected;
+    CHECK(reflected.Reflect(code.data(), code.size()));
+    CheckReflection(reflected, expected);
+    CheckSameAsD3DReflect(reflection, reflected);
+#endif
+
+    if (checkFailures > failuresBefore)
+        printf("  in %s\n", path.c_str());
+}
+
+// A container cut short, with its total size fixed up to match so
+// the chunks themselves are what runs off the end. Either it still
+// parses or it fails cleanly, leaving nothing behind.
+static void CheckTruncated(const std::string& directory)
+{
+    std::string code;
+    DxbcReflection reflection;
+    CHECK(ReadFile(directory + "/LitPS_NRS_L3.cso", code));
+
+    unsigned int broken = 0;
+    for (size_t size = 32; size < code.size(); size++)
+    {
+        std::string truncated = code.substr(0, size);
+        for (int i = 0; i < 4; i++)
+            truncated[24 + i] = (char)((size >> (8 * i)) & 0xFF);
+
+        bool parsed = reflection.Parse(truncated.data(), truncated.size());
+        if (!parsed && (!reflection.GetResourceBindings().empty() || !reflection.GetConstantBuffers().empty() ||
+            !reflection.GetInputParameters().empty() || reflection.GetShaderType() != DXBC_SHADER_UNKNOWN))
+        {
+            broken++;
+        }
+    }
+    CHECK(broken == 0);
+
+    // The whole thing minus its last byte can't parse
+    std::string shortByOne = code.substr(0, code.size() - 1);
+    CHECK(!reflection.Parse(shortByOne.data(), shortByOne.size()));
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        printf("Usage: DxbcReflectionTest <build output dir>\n");
+        return 1;
+    }
+
+    std::string directory = argv[1];
+    for (const ExpectedShader& expected : GetExpectedShaders())
+        CheckShader(directory, expected);
+    CheckTruncated(directory);
+
+    return CheckResult();
+}
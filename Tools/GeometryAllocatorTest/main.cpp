@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "../Check.h"
+#include "../../GeometryAllocator.h"
+
+// --------------------------------------------------------
+// Headless checks of the geometry pool's range allocator:
+//
+//   GeometryAllocatorTest
+//
+// Covers best fit and its ties, freed ranges merging with
+// their neighbours, empty allocations, id reuse, growing,
+// and that defragmenting keeps the order and lists moves
+// that really do pack a buffer when copied in order.
+// --------------------------------------------------------
+
+static void TestBestFit()
+{
+    // Two 12 element holes with a 74 element range after them
+    GeometryAllocator allocator(100);
+    unsigned int first = allocator.Allocate(12);
+    unsigned int gap0 = allocator.Allocate(1);
+    unsigned int second = allocator.Allocate(12);
+    unsigned int gap1 = allocator.Allocate(1);
+    CHECK(allocator.GetOffset(first) == 0 && allocator.GetOffset(gap0) == 12);
+    CHECK(allocator.GetOffset(second) == 13 && allocator.GetOffset(gap1) == 25);
+    allocator.Free(first);
+    allocator.Free(second);
+    CHECK(allocator.GetFreeRangeCount() == 3);
+
+    // Tied holes go to the one in front
+    unsigned int a = allocator.Allocate(5);
+    CHECK(allocator.GetOffset(a) == 0);
+
+    // The 7 left over is now the tightest fit, and an exact one
+    unsigned int b = allocator.Allocate(7);
+    CHECK(allocator.GetOffset(b) == 5);
+    CHECK(allocator.GetFreeRangeCount() == 2);
+
+    // Then the other hole, before the big range
+    unsigned int c = allocator.Allocate(10);
+    CHECK(allocator.GetOffset(c) == 13);
+
+    // Only the big range is big enough
+    unsigned int d = allocator.Allocate(20);
+    CHECK(allocator.GetOffset(d) == 26);
+
+    // More than the largest range isn't to be had, even with
+    // enough free space in total
+    CHECK(allocator.GetLargestFreeRange() == 54);
+    CHECK(allocator.Allocate(55) == GEOMETRY_ALLOCATION_NONE);
+    CHECK(allocator.GetUsed() == 1 + 1 + 5 + 7 + 10 + 20);
+}
+
+static void TestMerging()
+{
+    GeometryAllocator allocator(40);
+    unsigned int ids[4];
+    for (unsigned int i = 0; i < 4; i++)
+        ids[i] = allocator.Allocate(10);
+    CHECK(allocator.GetFreeRangeCount() == 0);
+
+    // Neighbours that aren't free stay separate
+    allocator.Free(ids[0]);
+    allocator.Free(ids[2]);
+    CHECK(allocator.GetFreeRangeCount() == 2);
+
+    // Freeing the middle merges with the ranges on both sides
+    allocator.Free(ids[1]);
+    CHECK(allocator.GetFreeRangeCount() == 1);
+    CHECK(allocator.GetLargestFreeRange() == 30);
+
+    // And the last one makes the whole thing one range again
+    allocator.Free(ids[3]);
+    CHECK(allocator.GetFreeRangeCount() == 1);
+    CHECK(allocator.GetLargestFreeRange() == 40);
+    CHECK(allocator.GetUsed() == 0);
+
+    // Merging with just the range after, then just the one before
+    GeometryAllocator sides(30);
+    unsigned int left = sides.Allocate(10);
+    unsigned int middle = sides.Allocate(10);
+    unsigned int right = sides.Allocate(10);
+    sides.Free(right);
+    sides.Free(middle);
+    CHECK(sides.GetFreeRangeCount() == 1 && sides.GetLargestFreeRange() == 20);
+    unsigned int again = sides.Allocate(10);
+    CHECK(sides.GetOffset(again) == 10);
+    sides.Free(left);
+    sides.Free(again);
+    CHECK(sides.GetFreeRangeCount() == 1 && sides.GetLargestFreeRange() == 30);
+}
+
+static void TestEmpty()
+{
+    // Nothing to allocate always works, even with no room at all
+    GeometryAllocator full(10);
+    unsigned int all = full.Allocate(10);
+    unsigned int empty = full.Allocate(0);
+    CHECK(all != GEOMETRY_ALLOCATION_NONE);
+    CHECK(empty != GEOMETRY_ALLOCATION_NONE && empty != all);
+    CHECK(full.GetCount(empty) == 0);
+    CHECK(full.GetUsed() == 10);
+
+    GeometryAllocator none(0);
+    unsigned int nothing = none.Allocate(0);
+    CHECK(nothing != GEOMETRY_ALLOCATION_NONE);
+    CHECK(none.Allocate(1) == GEOMETRY_ALLOCATION_NONE);
+
+    // Freeing it doesn't make a range out of nothing
+    full.Free(all);
+    full.Free(empty);
+    CHECK(full.GetFreeRangeCount() == 1 && full.GetLargestFreeRange() == 10);
+
+    // And defragmenting has nothing to move for it
+    GeometryAllocator mixed(20);
+    mixed.Allocate(5);
+    unsigned int zero = mixed.Allocate(0);
+    mixed.Allocate(5);
+    std::vector<GeometryAllocator::Move> moves;
+    mixed.Defragment(moves);
+    CHECK(moves.size() == 2);
+    for (const GeometryAllocator::Move& move : moves)
+        CHECK(move.Allocation != zero);
+}
+
+static void TestIdReuse()
+{
+    GeometryAllocator allocator(100);
+    unsigned int a = allocator.Allocate(10);
+    unsigned int b = allocator.Allocate(10);
+    CHECK(a == 0 && b == 1);
+
+    // A freed id is handed out again, with the new allocation's range
+    allocator.Free(a);
+    unsigned int c = allocator.Allocate(30);
+    CHECK(c == a);
+    CHECK(allocator.GetCount(c) == 30);
+    CHECK(allocator.GetOffset(c) == 20);
+
+    // Freeing twice, or an id that was never handed out, does nothing
+    allocator.Free(b);
+    allocator.Free(b);
+    allocator.Free(57);
+    CHECK(allocator.GetUsed() == 30);
+    CHECK(allocator.Allocate(5) == b);
+    CHECK(allocator.Allocate(5) == 2);
+}
+
+// Fills a buffer with each allocation's id, so copying it around
+// shows whether the data ended up where the allocator says
+static void Fill(std::vector<unsigned int>& buffer, GeometryAllocator& allocator, const std::vector<unsigned int>& live)
+{
+    std::fill(buffer.begin(), buffer.end(), 0xFFFFFFFF);
+    for (unsigned int id : live)
+    {
+        for (unsigned int i = 0; i < allocator.GetCount(id); i++)
+            buffer[allocator.GetOffset(id) + i] = id;
+    }
+}
+
+static void TestDefragment()
+{
+    std::mt19937 rng(42);
+    GeometryAllocator allocator(1000);
+    std::vector<unsigned int> live;
+
+    for (int round = 0; round < 50; round++)
+    {
+        // Churn until the free space is in pieces
+        for (int i = 0; i < 20; i++)
+        {
+            if (!live.empty() && rng() % 3 == 0)
+            {
+                size_t index = rng() % live.size();
+                allocator.Free(live[index]);
+                live.erase(live.begin() + index);
+            }
+            else
+            {
+                unsigned int id = allocator.Allocate(rng() % 40);
+                if (id != GEOMETRY_ALLOCATION_NONE)
+                    live.push_back(id);
+            }
+        }
+
+        std::vector<unsigned int> buffer(allocator.GetCapacity());
+        Fill(buffer, allocator, live);
+
+        // The order things were in before packing
+        std::vector<unsigned int> order;
+        for (unsigned int id : live)
+        {
+            if (allocator.GetCount(id) > 0)
+                order.push_back(id);
+        }
+        std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return allocator.GetOffset(a) < allocator.GetOffset(b); });
+
+        std::vector<GeometryAllocator::Move> moves;
+        allocator.Defragment(moves);
+
+        // Every non-empty allocation is listed once, in the same order
+        // as before, packed from the front
+        CHECK(moves.size() == order.size());
+        unsigned int offset = 0;
+        for (size_t m = 0; m < moves.size() && m < order.size(); m++)
+        {
+            const GeometryAllocator::Move& move = moves[m];
+            CHECK(move.Allocation == order[m]);
+            CHECK(move.To == offset);
+            CHECK(move.To <= move.From);
+            CHECK(move.Count == allocator.GetCount(move.Allocation));
+            CHECK(allocator.GetOffset(move.Allocation) == move.To);
+            offset += move.Count;
+        }
+        CHECK(offset == allocator.GetUsed());
+
+        // All the free space is one range at the end
+        CHECK(allocator.GetFreeRangeCount() == (allocator.GetUsed() < allocator.GetCapacity() ? 1u : 0u));
+        CHECK(allocator.GetLargestFreeRange() == allocator.GetCapacity() - allocator.GetUsed());
+
+        // Copying in the order given packs the buffer in place
+        for (const GeometryAllocator::Move& move : moves)
+            memmove(&buffer[move.To], &buffer[move.From], move.Count * sizeof(unsigned int));
+
+        unsigned int misplaced = 0;
+        for (unsigned int id : live)
+        {
+            for (unsigned int i = 0; i < allocator.GetCount(id); i++)
+            {
+                if (buffer[allocator.GetOffset(id) + i] != id)
+                    misplaced++;
+            }
+        }
+        CHECK(misplaced == 0);
+    }
+}
+
+static void TestGrow()
+{
+    // Free space at the end gets merged with the new space
+    GeometryAllocator allocator(100);
+    unsigned int a = allocator.Allocate(60);
+    CHECK(allocator.GetFreeRangeCount() == 1);
+    allocator.Grow(150);
+    CHECK(allocator.GetCapacity() == 150);
+    CHECK(allocator.GetFreeRangeCount() == 1);
+    CHECK(allocator.GetLargestFreeRange() == 90);
+    unsigned int b = allocator.Allocate(90);
+    CHECK(b != GEOMETRY_ALLOCATION_NONE && allocator.GetOffset(b) == 60);
+
+    // Without any, the new space is a range of its own
+    allocator.Free(a);
+    allocator.Grow(200);
+    CHECK(allocator.GetFreeRangeCount() == 2);
+    CHECK(allocator.GetLargestFreeRange() == 60);
+
+    // Never shrinks
+    allocator.Grow(10);
+    CHECK(allocator.GetCapacity() == 200);
+    CHECK(allocator.GetUsed() == 90);
+}
+
+int main()
+{
+    TestBestFit();
+    TestMerging();
+    TestEmpty();
+    TestIdReuse();
+    TestDefragment();
+    TestGrow();
+    return CheckResult();
+}
@@ -0,0 +1,425 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../Check.h"
+#include "../../LightClusters.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Headless checks of the light binning, against a brute-force
+// sphere vs. froxel reference:
+//
+//   LightClustersTest
+//
+// Covers lights inside one cluster and across cluster edges,
+// spot lights, lights behind the near plane, the directional
+// lights at the front of the index list, the offset/count
+// table, and the time it takes to bin 1000 lights. Build it
+// optimized - the timing check is against the 0.5ms target.
+// --------------------------------------------------------
+
+// Same camera as Game's
+static const float fov = XM_PIDIV4;
+static const float aspectRatio = 16.0f / 9.0f;
+static const float nearClip = 0.01f;
+static const float farClip = 100.0f;
+
+static const unsigned int clusterCount = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+static XMFLOAT4X4 MakeView(XMFLOAT3 position, float yaw)
+{
+    XMFLOAT4X4 view;
+    XMVECTOR forward = XMVectorSet(std::sin(yaw), 0, std::cos(yaw), 0);
+    XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&position), forward, XMVectorSet(0, 1, 0, 0)));
+    return view;
+}
+
+static XMFLOAT4X4 Identity()
+{
+    XMFLOAT4X4 view;
+    XMStoreFloat4x4(&view, XMMatrixIdentity());
+    return view;
+}
+
+// Depth of the near plane of a slice, in double precision
+static double SliceDepth(double slice)
+{
+    return nearClip * std::pow((double)farClip / nearClip, slice / CLUSTER_COUNT_Z);
+}
+
+// A view-space point on a froxel boundary, from NDC and depth
+static XMFLOAT3 ViewPoint(double ndcX, double ndcY, double depth)
+{
+    double tanHalfFovY = std::tan(fov / 2.0);
+    return XMFLOAT3(
+        (float)(ndcX * depth * tanHalfFovY * aspectRatio),
+        (float)(ndcY * depth * tanHalfFovY),
+        (float)depth);
+}
+
+// Which froxel a view-space point falls in, or false if it's outside
+// the frustum or too close to an edge to say for certain
+static bool FindFroxel(double x, double y, double z, unsigned int& cluster)
+{
+    double tanHalfFovY = std::tan(fov / 2.0);
+    double tanHalfFovX = tanHalfFovY * aspectRatio;
+    if (z <= nearClip || z >= farClip)
+        return false;
+
+    double fx = (x / (z * tanHalfFovX) + 1) * 0.5 * CLUSTER_COUNT_X;
+    double fy = (1 - y / (z * tanHalfFovY)) * 0.5 * CLUSTER_COUNT_Y;
+    double fz = std::log(z / nearClip) / std::log((double)farClip / nearClip) * CLUSTER_COUNT_Z;
+    if (fx <= 0 || fx >= CLUSTER_COUNT_X || fy <= 0 || fy >= CLUSTER_COUNT_Y)
+        return false;
+
+    double edge = 1e-4;
+    if (fx - std::floor(fx) < edge || fy - std::floor(fy) < edge || fz - std::floor(fz) < edge)
+        return false;
+
+    cluster = LightClusterGrid::GetClusterIndex((unsigned int)fx, (unsigned int)fy, (unsigned int)fz);
+    return true;
+}
+
+// Distance from a view-space point to the box around a froxel's
+// eight corners
+static double FroxelDistance(unsigned int cluster, double x, double y, double z)
+{
+    unsigned int cx = cluster % CLUSTER_COUNT_X;
+    unsigned int cy = cluster / CLUSTER_COUNT_X % CLUSTER_COUNT_Y;
+    unsigned int cz = cluster / (CLUSTER_COUNT_X * CLUSTER_COUNT_Y);
+
+    double boxMin[3] = { 1e30, 1e30, 1e30 };
+    double boxMax[3] = { -1e30, -1e30, -1e30 };
+    for (int corner = 0; corner < 8; corner++)
+    {
+        double ndcX = -1.0 + 2.0 * (cx + (corner & 1)) / CLUSTER_COUNT_X;
+        double ndcY = 1.0 - 2.0 * (cy + ((corner >> 1) & 1)) / CLUSTER_COUNT_Y;
+        XMFLOAT3 p = ViewPoint(ndcX, ndcY, SliceDepth(cz + ((corner >> 2) & 1)));
+        double point[3] = { p.x, p.y, p.z };
+        for (int i = 0; i < 3; i++)
+        {
+            boxMin[i] = std::fmin(boxMin[i], point[i]);
+            boxMax[i] = std::fmax(boxMax[i], point[i]);
+        }
+    }
+
+    double center[3] = { x, y, z };
+    double distanceSq = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        double closest = std::fmin(std::fmax(center[i], boxMin[i]), boxMax[i]);
+        distanceSq += (center[i] - closest) * (center[i] - closest);
+    }
+    return std::sqrt(distanceSq);
+}
+
+// Every light's clusters, from the grid's index list
+static std::vector<std::vector<bool>> GetLightClusters(LightClusterGrid& grid, unsigned int lightCount)
+{
+    std::vector<std::vector<bool>> clusters(lightCount, std::vector<bool>(clusterCount, false));
+    const std::vector<ClusterRange>& ranges = grid.GetClusterRanges();
+    const std::vector<unsigned int>& indices = grid.GetLightIndices();
+    for (unsigned int c = 0; c < clusterCount; c++)
+    {
+        for (unsigned int i = 0; i < ranges[c].Count; i++)
+            clusters[indices[ranges[c].Offset + i]][c] = true;
+    }
+    return clusters;
+}
+
+static std::vector<unsigned int> ListClusters(const std::vector<bool>& clusters)
+{
+    std::vector<unsigned int> list;
+    for (unsigned int c = 0; c < clusterCount; c++)
+    {
+        if (clusters[c])
+            list.push_back(c);
+    }
+    return list;
+}
+
+// Checks every light against the reference: each froxel a point of
+// its sphere falls in must list it, and each froxel that lists it
+// must be within its range
+static void CheckAgainstReference(LightClusterGrid& grid, const std::vector<Light>& lights, const XMFLOAT4X4& view)
+{
+    std::vector<std::vector<bool>> clusters = GetLightClusters(grid, (unsigned int)lights.size());
+    XMMATRIX viewMat = XMLoadFloat4x4(&view);
+
+    unsigned int missed = 0;
+    unsigned int tooFar = 0;
+    for (size_t l = 0; l < lights.size(); l++)
+    {
+        const Light& light = lights[l];
+        if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+            continue;
+
+        XMFLOAT3 center;
+        XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&light.Position), viewMat));
+        double radius = light.Range;
+
+        const int steps = 12;
+        for (int i = 0; i <= steps; i++)
+        {
+            for (int j = 0; j <= steps; j++)
+            {
+                for (int k = 0; k <= steps; k++)
+                {
+                    double x = -1.0 + 2.0 * i / steps;
+                    double y = -1.0 + 2.0 * j / steps;
+                    double z = -1.0 + 2.0 * k / steps;
+                    if (x * x + y * y + z * z > 1)
+                        continue;
+
+                    unsigned int cluster = 0;
+                    if (FindFroxel(center.x + x * radius, center.y + y * radius, center.z + z * radius, cluster) &&
+                        !clusters[l][cluster])
+                    {
+                        missed++;
+                    }
+                }
+            }
+        }
+
+        for (unsigned int cluster : ListClusters(clusters[l]))
+        {
+            if (FroxelDistance(cluster, center.x, center.y, center.z) > radius * (1 + 1e-4))
+                tooFar++;
+        }
+    }
+    CHECK(missed == 0);
+    CHECK(tooFar == 0);
+}
+
+// Offsets run back to back after the global lights, and each
+// cluster lists every light once, in the order they were given
+static void CheckTable(LightClusterGrid& grid)
+{
+    const std::vector<ClusterRange>& ranges = grid.GetClusterRanges();
+    const std::vector<unsigned int>& indices = grid.GetLightIndices();
+    CHECK(ranges.size() == clusterCount);
+
+    unsigned int offset = grid.GetGlobalLightCount();
+    unsigned int unordered = 0;
+    for (const ClusterRange& range : ranges)
+    {
+        CHECK(range.Offset == offset);
+        for (unsigned int i = 1; i < range.Count; i++)
+        {
+            if (indices[range.Offset + i - 1] >= indices[range.Offset + i])
+                unordered++;
+        }
+        offset += range.Count;
+    }
+    CHECK(offset == indices.size());
+    CHECK(unordered == 0);
+}
+
+static void TestSingleCluster()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // A small light in the middle of a cluster near the center of
+    // the screen, where no neighbour's box reaches it
+    unsigned int x = 8, y = 4, z = 10;
+    double depth = SliceDepth(z + 0.5);
+    XMFLOAT3 center = ViewPoint(
+        -1.0 + 2.0 * (x + 0.5) / CLUSTER_COUNT_X,
+        1.0 - 2.0 * (y + 0.5) / CLUSTER_COUNT_Y,
+        depth);
+    std::vector<Light> lights = { Light(center, XMFLOAT3(1, 1, 1), (float)(depth * 0.001), 1.0f) };
+
+    grid.AssignLights(&lights[0], 1, Identity());
+    std::vector<unsigned int> clusters = ListClusters(GetLightClusters(grid, 1)[0]);
+    CHECK(clusters.size() == 1);
+    CHECK(clusters.size() == 1 && clusters[0] == LightClusterGrid::GetClusterIndex(x, y, z));
+    CHECK(grid.GetDepthSlice((float)depth) == (int)z);
+    CHECK(grid.GetGlobalLightCount() == 0);
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, Identity());
+}
+
+static void TestStraddlingCluster()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // Centered on the corner eight clusters share
+    unsigned int x = 8, y = 4, z = 12;
+    double depth = SliceDepth(z);
+    XMFLOAT3 center = ViewPoint(
+        -1.0 + 2.0 * x / CLUSTER_COUNT_X,
+        1.0 - 2.0 * y / CLUSTER_COUNT_Y,
+        depth);
+    std::vector<Light> lights = { Light(center, XMFLOAT3(1, 1, 1), (float)(depth * 0.001), 1.0f) };
+
+    grid.AssignLights(&lights[0], 1, Identity());
+    std::vector<bool> clusters = GetLightClusters(grid, 1)[0];
+    CHECK(ListClusters(clusters).size() == 8);
+    for (unsigned int i = 0; i < 8; i++)
+        CHECK(clusters[LightClusterGrid::GetClusterIndex(x - 1 + (i & 1), y - 1 + ((i >> 1) & 1), z - 1 + ((i >> 2) & 1))]);
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, Identity());
+
+    // A bigger one spans a block of them
+    lights[0].Range = (float)(depth * 0.2);
+    grid.AssignLights(&lights[0], 1, Identity());
+    CHECK(ListClusters(GetLightClusters(grid, 1)[0]).size() > 8);
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, Identity());
+}
+
+static void TestSpotLight()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // A spot light is binned by the sphere of its range, the same as
+    // a point light there
+    XMFLOAT3 position(1.5f, -0.5f, 6.0f);
+    std::vector<Light> lights = {
+        Light(position, XMFLOAT3(0, 0, 1), XMFLOAT3(1, 1, 1), 2.0f, 1.0f, 20.0f),
+        Light(position, XMFLOAT3(1, 1, 1), 2.0f, 1.0f) };
+    CHECK(lights[0].Type == LIGHT_TYPE_SPOT);
+
+    XMFLOAT4X4 view = MakeView(XMFLOAT3(0.5f, 0.2f, -1.0f), 0.3f);
+    grid.AssignLights(&lights[0], 2, view);
+    std::vector<std::vector<bool>> clusters = GetLightClusters(grid, 2);
+    CHECK(!ListClusters(clusters[0]).empty());
+    CHECK(clusters[0] == clusters[1]);
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, view);
+}
+
+static void TestBehindNearPlane()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // One entirely behind the camera, one whose sphere only just
+    // pokes through the near plane, and one past the far plane
+    std::vector<Light> lights = {
+        Light(XMFLOAT3(0, 0, -5.0f), XMFLOAT3(1, 1, 1), 1.0f, 1.0f),
+        Light(XMFLOAT3(0.01f, 0, -0.5f), XMFLOAT3(1, 1, 1), 0.52f, 1.0f),
+        Light(XMFLOAT3(0, 0, farClip + 2), XMFLOAT3(1, 1, 1), 1.0f, 1.0f) };
+
+    grid.AssignLights(&lights[0], 3, Identity());
+    std::vector<std::vector<bool>> clusters = GetLightClusters(grid, 3);
+    CHECK(ListClusters(clusters[0]).empty());
+    CHECK(ListClusters(clusters[2]).empty());
+
+    // Only the slices it reaches past the near plane
+    std::vector<unsigned int> poking = ListClusters(clusters[1]);
+    CHECK(!poking.empty());
+    for (unsigned int cluster : poking)
+        CHECK(cluster / (CLUSTER_COUNT_X * CLUSTER_COUNT_Y) <= (unsigned int)grid.GetDepthSlice(0.02f));
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, Identity());
+}
+
+static void TestGlobalLights()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // Directional lights mixed in with the rest come out first, in
+    // order, and never in a cluster
+    std::vector<Light> lights = {
+        Light(XMFLOAT3(0, 0, 4), XMFLOAT3(1, 1, 1), 3.0f, 1.0f),
+        Light(XMFLOAT3(1, -1, 0), XMFLOAT3(1, 1, 1), 1.0f),
+        Light(XMFLOAT3(1, 0, 6), XMFLOAT3(1, 1, 1), 3.0f, 1.0f),
+        Light(XMFLOAT3(0, -1, 1), XMFLOAT3(1, 1, 1), 1.0f),
+        Light(XMFLOAT3(-1, -1, 0), XMFLOAT3(1, 1, 1), 1.0f) };
+
+    grid.AssignLights(&lights[0], (unsigned int)lights.size(), Identity());
+    const std::vector<unsigned int>& indices = grid.GetLightIndices();
+    CHECK(grid.GetGlobalLightCount() == 3);
+    CHECK(indices.size() >= 3);
+    if (indices.size() >= 3)
+        CHECK(indices[0] == 1 && indices[1] == 3 && indices[2] == 4);
+
+    std::vector<std::vector<bool>> clusters = GetLightClusters(grid, (unsigned int)lights.size());
+    CHECK(ListClusters(clusters[1]).empty() && ListClusters(clusters[3]).empty() && ListClusters(clusters[4]).empty());
+    CHECK(!ListClusters(clusters[0]).empty() && !ListClusters(clusters[2]).empty());
+    CheckTable(grid);
+    CheckAgainstReference(grid, lights, Identity());
+
+    // Nothing at all leaves an empty table
+    grid.AssignLights(0, 0, Identity());
+    CHECK(grid.GetGlobalLightCount() == 0);
+    CHECK(grid.GetLightIndices().empty());
+    CheckTable(grid);
+}
+
+// The same lights as Game::CreateManyLights
+static std::vector<Light> MakeManyLights(int count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> height(-1.4f, 2.0f);
+    std::uniform_real_distribution<float> range(0.5f, 1.5f);
+
+    std::vector<Light> lights;
+    for (int i = 0; i < count; i++)
+    {
+        float x = position(rng);
+        float y = height(rng);
+        float z = position(rng);
+        lights.push_back(Light(XMFLOAT3(x, y, z), XMFLOAT3(1, 1, 1), range(rng), 1.0f));
+    }
+    return lights;
+}
+
+static void TestManyLights()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+
+    // From Game's starting spot, and from inside the lights
+    std::vector<Light> lights = MakeManyLights(300);
+    XMFLOAT4X4 views[] = {
+        MakeView(XMFLOAT3(0, 0, -20), 0),
+        MakeView(XMFLOAT3(1, 0.5f, -2), 0.8f) };
+    for (const XMFLOAT4X4& view : views)
+    {
+        grid.AssignLights(&lights[0], (unsigned int)lights.size(), view);
+        CheckTable(grid);
+        CheckAgainstReference(grid, lights, view);
+    }
+}
+
+static void TestTiming()
+{
+    LightClusterGrid grid;
+    grid.UpdateFrustum(fov, aspectRatio, nearClip, farClip);
+    std::vector<Light> lights = MakeManyLights(1000);
+    XMFLOAT4X4 view = MakeView(XMFLOAT3(0, 0, -20), 0);
+
+    // Once to size the scratch lists, the way every frame after the first runs
+    grid.AssignLights(&lights[0], (unsigned int)lights.size(), view);
+
+    const int runs = 200;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < runs; i++)
+        grid.AssignLights(&lights[0], (unsigned int)lights.size(), view);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / runs;
+    printf("Binning %zu lights: %.3fms (%zu indices)\n", lights.size(), ms, grid.GetLightIndices().size());
+    CHECK(ms < 0.5);
+}
+
+int main()
+{
+    TestSingleCluster();
+    TestStraddlingCluster();
+    TestSpotLight();
+    TestBehindNearPlane();
+    TestGlobalLights();
+    TestManyLights();
+    TestTiming();
+    return CheckResult();
+}
@@ -0,0 +1,247 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../Check.h"
+#include "../../MaterialLibrary.h"
+#include "../../SubmeshGrouper.h"
+
+// --------------------------------------------------------
+// Headless checks of reading an OBJ's materials, from the
+// small OBJ and MTL below:
+//
+//   MaterialLibraryTest
+//
+// Covers the MTL parser, grouping the OBJ's faces into one
+// submesh per usemtl material the way Mesh does, and that
+// every group finds its material in the library.
+// --------------------------------------------------------
+
+static const char* mtlFile = "MaterialLibraryTest.mtl";
+
+static const char* mtl =
+    "# Written by hand\n"
+    "Kd 0 0 0\n"                                // Before any newmtl, so it's ignored
+    "\n"
+    "newmtl Painted\n"
+    "Ns 250.0\n"
+    "Kd 0.8 0.2 0.1\n"
+    "d 0.5\n"
+    "illum 2\n"
+    "map_Kd -bm 1.0 -s 2 2 1 paint_albedo.png\n"
+    "map_Bump -bm 0.5 paint_normals.png\n"
+    "map_Pm paint_metal.png\n"
+    "map_Pr paint_roughness.png\n"
+    "\n"
+    "newmtl Glass\n"
+    "  Kd 0.1 0.2 0.3\n"
+    "Tr 0.75\n"
+    "\n"
+    "newmtl Bumpy\n"
+    "bump bumpy_normals.png\n"
+    "map_Kd\n";                                 // No file, so no map
+
+// Two groups use Painted, one uses a material the library doesn't
+// have, and one usemtl has no faces after it at all
+static const char* obj =
+    "mtllib MaterialLibraryTest.mtl\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "f 1 2 3\n"
+    "usemtl Painted\n"
+    "f 1 2 3 4\n"
+    "usemtl Glass\n"
+    "f 1 2 3\n"
+    "usemtl Unused\n"
+    "usemtl Painted\n"
+    "f 2 3 4\n"
+    "usemtl Missing\n"
+    "f 1 3 4\n"
+    "usemtl Glass\n"
+    "f 1 2 4\n";
+
+// Reads the faces and usemtl lines like Mesh does, giving each
+// triangle three new indices in the order it was read
+static void ReadObj(const char* text, SubmeshGrouper& groups, std::vector<unsigned int>& indices)
+{
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (keyword == "usemtl")
+        {
+            std::string name;
+            tokens >> name;
+            groups.UseMaterial(name);
+        }
+        else if (keyword == "f")
+        {
+            // A quad is two triangles
+            int corners = 0;
+            std::string corner;
+            while (tokens >> corner)
+                corners++;
+            for (int t = 0; t + 2 < corners; t++)
+            {
+                for (int i = 0; i < 3; i++)
+                    indices.push_back((unsigned int)indices.size());
+                groups.AddTriangle();
+            }
+        }
+    }
+}
+
+static void TestLibrary()
+{
+    {
+        std::ofstream file(std::string("./") + mtlFile);
+        file << mtl;
+    }
+
+    MaterialLibrary library;
+    CHECK(library.Load(std::string("./") + mtlFile));
+    CHECK(library.GetEntries().size() == 3);
+
+    const MaterialLibraryEntry* painted = library.Find("Painted");
+    CHECK(painted != 0);
+    if (painted)
+    {
+        CHECK_NEAR(painted->DiffuseColor.x, 0.8, 1e-6);
+        CHECK_NEAR(painted->DiffuseColor.y, 0.2, 1e-6);
+        CHECK_NEAR(painted->DiffuseColor.z, 0.1, 1e-6);
+        CHECK_NEAR(painted->DiffuseColor.w, 0.5, 1e-6);
+
+        // Options in front of the file are skipped, and the file
+        // is joined to the library's directory
+        CHECK(painted->AlbedoMap == "./paint_albedo.png");
+        CHECK(painted->NormalMap == "./paint_normals.png");
+        CHECK(painted->MetalnessMap == "./paint_metal.png");
+        CHECK(painted->RoughnessMap == "./paint_roughness.png");
+    }
+
+    // Just a color - Game gives these a white albedo map
+    const MaterialLibraryEntry* glass = library.Find("Glass");
+    CHECK(glass != 0);
+    if (glass)
+    {
+        CHECK_NEAR(glass->DiffuseColor.x, 0.1, 1e-6);
+        CHECK_NEAR(glass->DiffuseColor.z, 0.3, 1e-6);
+        CHECK_NEAR(glass->DiffuseColor.w, 0.25, 1e-6);
+        CHECK(glass->AlbedoMap.empty());
+        CHECK(glass->NormalMap.empty());
+        CHECK(glass->MetalnessMap.empty());
+        CHECK(glass->RoughnessMap.empty());
+    }
+
+    const MaterialLibraryEntry* bumpy = library.Find("Bumpy");
+    CHECK(bumpy != 0);
+    if (bumpy)
+    {
+        CHECK(bumpy->DiffuseColor.x == 1 && bumpy->DiffuseColor.w == 1);
+        CHECK(bumpy->NormalMap == "./bumpy_normals.png");
+        CHECK(bumpy->AlbedoMap.empty());
+    }
+
+    CHECK(library.Find("Missing") == 0);
+
+    // Without a directory the names are used as they are
+    CHECK(library.Load(mtlFile));
+    CHECK(library.Find("Painted") && library.Find("Painted")->AlbedoMap == "paint_albedo.png");
+
+    // A library that isn't there has nothing in it
+    CHECK(!library.Load("NotThere.mtl"));
+    CHECK(library.GetEntries().empty());
+    CHECK(library.Find("Painted") == 0);
+
+    std::remove(mtlFile);
+}
+
+static void TestGrouping()
+{
+    SubmeshGrouper groups;
+    std::vector<unsigned int> indices;
+    ReadObj(obj, groups, indices);
+    CHECK(indices.size() == 7 * 3);
+
+    std::vector<unsigned int> original = indices;
+    std::vector<MeshSubmesh> submeshes;
+    groups.Group(indices, submeshes);
+
+    // In order of first use, with the faces before any usemtl first
+    // and nothing for the material without faces
+    CHECK(submeshes.size() == 4);
+    if (submeshes.size() != 4)
+        return;
+    const char* names[] = { "", "Painted", "Glass", "Missing" };
+    unsigned int triangles[][3] = { { 0 }, { 1, 2, 4 }, { 3, 6 }, { 5 } };
+    unsigned int counts[] = { 1, 3, 2, 1 };
+
+    unsigned int start = 0;
+    for (unsigned int s = 0; s < 4; s++)
+    {
+        // Every submesh starts where the last one ended, and its
+        // triangles keep the order they were read in
+        CHECK(submeshes[s].MaterialName == names[s]);
+        CHECK(submeshes[s].StartIndex == start);
+        CHECK(submeshes[s].IndexCount == counts[s] * 3);
+        for (unsigned int t = 0; t < counts[s] && start + t * 3 + 2 < indices.size(); t++)
+        {
+            for (unsigned int i = 0; i < 3; i++)
+                CHECK(indices[start + t * 3 + i] == original[triangles[s][t] * 3 + i]);
+        }
+        start += submeshes[s].IndexCount;
+    }
+    CHECK(start == indices.size());
+
+    // An OBJ without usemtl is a single unnamed submesh
+    SubmeshGrouper plain;
+    std::vector<unsigned int> plainIndices;
+    ReadObj("f 1 2 3\nf 1 2 3 4\n", plain, plainIndices);
+    plain.Group(plainIndices, submeshes);
+    CHECK(submeshes.size() == 1);
+    CHECK(submeshes.size() == 1 && submeshes[0].MaterialName.empty() && submeshes[0].IndexCount == 9);
+}
+
+// What Game::AssignLibraryMaterials does - each named group looks
+// its material up, and the ones the library doesn't have keep the
+// entity's own
+static void TestAssignment()
+{
+    {
+        std::ofstream file(mtlFile);
+        file << mtl;
+    }
+
+    MaterialLibrary library;
+    CHECK(library.Load(mtlFile));
+
+    SubmeshGrouper groups;
+    std::vector<unsigned int> indices;
+    std::vector<MeshSubmesh> submeshes;
+    ReadObj(obj, groups, indices);
+    groups.Group(indices, submeshes);
+
+    unsigned int found = 0;
+    for (const MeshSubmesh& submesh : submeshes)
+    {
+        if (library.Find(submesh.MaterialName))
+            found++;
+    }
+    CHECK(found == 2);
+
+    std::remove(mtlFile);
+}
+
+int main()
+{
+    TestLibrary();
+    TestGrouping();
+    TestAssignment();
+    return CheckResult();
+}
@@ -0,0 +1,129 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "../Check.h"
+#include "../../ObjectMatrixStage.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Headless check of the per-object matrix stage against the
+// same math done directly:
+//
+//   ObjectMatrixStageTest
+//
+// Runs a batch below OBJECT_MATRIX_PARALLEL_THRESHOLD and one
+// above it, so the split across threads is covered too.
+// --------------------------------------------------------
+
+static float Random(float min, float max)
+{
+    return min + (max - min) * (float)rand() / RAND_MAX;
+}
+
+// Matrices are compared relative to their size, since world-view-
+// projection entries can be large for objects far from the camera
+static bool MatricesMatch(const XMFLOAT4X4& a, FXMMATRIX b)
+{
+    XMFLOAT4X4 expected;
+    XMStoreFloat4x4(&expected, b);
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            float difference = std::fabs(a.m[row][column] - expected.m[row][column]);
+            if (difference > 1e-4f * std::fmax(1.0f, std::fabs(expected.m[row][column])))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void TestRun(ObjectMatrixStage& stage, unsigned int count)
+{
+    struct Parameters
+    {
+        XMFLOAT3 Position;
+        XMFLOAT3 Rotation;
+        XMFLOAT3 Scale;
+    };
+    std::vector<Parameters> parameters(count);
+    std::vector<Transform> transforms(count);
+    std::vector<Transform*> transformPointers(count);
+    std::vector<InstanceParams> instanceParams(count);
+    std::vector<const InstanceParams*> instanceParamPointers(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Parameters& p = parameters[i];
+        p.Position = XMFLOAT3(Random(-100, 100), Random(-10, 10), Random(-100, 100));
+        p.Rotation = XMFLOAT3(Random(-XM_PI, XM_PI), Random(-XM_PI, XM_PI), Random(-XM_PI, XM_PI));
+        p.Scale = XMFLOAT3(Random(0.1f, 4), Random(0.1f, 4), Random(0.1f, 4));
+
+        transforms[i].SetPosition(p.Position.x, p.Position.y, p.Position.z);
+        transforms[i].SetPitchYawRoll(p.Rotation.x, p.Rotation.y, p.Rotation.z);
+        transforms[i].SetScale(p.Scale.x, p.Scale.y, p.Scale.z);
+        transformPointers[i] = &transforms[i];
+
+        instanceParams[i].colorTint = XMFLOAT4(Random(0, 1), Random(0, 1), Random(0, 1), 1);
+        instanceParams[i].uvScale = XMFLOAT2(Random(0.5f, 2), Random(0.5f, 2));
+        instanceParams[i].uvOffset = XMFLOAT2(Random(0, 1), Random(0, 1));
+        instanceParamPointers[i] = &instanceParams[i];
+    }
+
+    XMFLOAT4X4 view;
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(3, 8, -20, 1), XMVectorSet(0.2f, -0.3f, 1, 0), XMVectorSet(0, 1, 0, 0)));
+    XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 500.0f));
+
+    stage.Run(view, projection, transformPointers.data(), instanceParamPointers.data(), count);
+    CHECK(stage.GetCount() == count);
+
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const Parameters& p = parameters[i];
+        XMMATRIX world =
+            XMMatrixScaling(p.Scale.x, p.Scale.y, p.Scale.z) *
+            XMMatrixRotationRollPitchYaw(p.Rotation.x, p.Rotation.y, p.Rotation.z) *
+            XMMatrixTranslation(p.Position.x, p.Position.y, p.Position.z);
+        XMMATRIX worldInvTranspose = XMMatrixInverse(0, XMMatrixTranspose(world));
+        XMMATRIX worldViewProjection = XMMatrixMultiply(XMMatrixMultiply(world, XMLoadFloat4x4(&view)), XMLoadFloat4x4(&projection));
+
+        const PerObjectData& object = stage.Get(i);
+        bool match =
+            MatricesMatch(object.worldViewProjection, worldViewProjection) &&
+            MatricesMatch(object.world, world) &&
+            MatricesMatch(object.worldInvTranspose, worldInvTranspose) &&
+            memcmp(&object.instanceColorTint, &instanceParams[i].colorTint, sizeof(XMFLOAT4)) == 0 &&
+            memcmp(&object.instanceUvScale, &instanceParams[i].uvScale, sizeof(XMFLOAT2)) == 0 &&
+            memcmp(&object.instanceUvOffset, &instanceParams[i].uvOffset, sizeof(XMFLOAT2)) == 0;
+        if (!match)
+            mismatches++;
+    }
+
+    // One check per batch, or a broken stage prints thousands of lines
+    if (mismatches > 0)
+        printf("%u of %u objects don't match\n", mismatches, count);
+    CHECK(mismatches == 0);
+}
+
+int main()
+{
+    srand(1);
+
+    ObjectMatrixStage stage;
+    TestRun(stage, 100);
+
+    // Several threads even on a single core machine, with a
+    // count that doesn't split evenly between them
+    stage.SetThreadCount(4);
+    TestRun(stage, OBJECT_MATRIX_PARALLEL_THRESHOLD * 2 + 3);
+
+    // Smaller again after a bigger run
+    TestRun(stage, 7);
+    CHECK(stage.GetProcessedCount() == 100 + OBJECT_MATRIX_PARALLEL_THRESHOLD * 2 + 3 + 7);
+
+    return CheckResult();
+}
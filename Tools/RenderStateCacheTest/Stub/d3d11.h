@@ -0,0 +1,126 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Stand-in for the parts of d3d11.h RenderStateCache uses,
+// so it can be built and run without Direct3D. The device
+// context does nothing but record the calls that reach it.
+// --------------------------------------------------------
+
+typedef unsigned int UINT;
+typedef float FLOAT;
+typedef long HRESULT;
+
+enum DXGI_FORMAT
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R16_UINT = 57,
+    DXGI_FORMAT_R32_UINT = 42
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+    D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+    D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+};
+
+struct D3D11_VIEWPORT
+{
+    FLOAT TopLeftX;
+    FLOAT TopLeftY;
+    FLOAT Width;
+    FLOAT Height;
+    FLOAT MinDepth;
+    FLOAT MaxDepth;
+};
+
+// Objects are only ever compared by address
+struct ID3D11Buffer {};
+struct ID3D11ShaderResourceView {};
+struct ID3D11SamplerState {};
+struct ID3D11InputLayout {};
+struct ID3D11RasterizerState {};
+struct ID3D11DepthStencilState {};
+struct ID3D11BlendState {};
+struct ID3D11RenderTargetView {};
+struct ID3D11DepthStencilView {};
+struct ID3D11ClassInstance {};
+struct ID3D11VertexShader {};
+struct ID3D11HullShader {};
+struct ID3D11DomainShader {};
+struct ID3D11GeometryShader {};
+struct ID3D11PixelShader {};
+struct ID3D11ComputeShader {};
+
+// One call that reached the context
+struct RecordedCall
+{
+    std::string Method;
+    UINT Slot;
+    UINT Count;
+    std::vector<const void*> Objects;
+    UINT FirstConstant;
+    UINT ConstantCount;
+};
+
+class ID3D11DeviceContext
+{
+public:
+    virtual ~ID3D11DeviceContext() {}
+
+    std::vector<RecordedCall> Calls;
+
+    void Record(const char* method, UINT slot, UINT count, const void* const* objects, UINT firstConstant = 0, UINT constantCount = 0)
+    {
+        RecordedCall call = { method, slot, count, std::vector<const void*>(), firstConstant, constantCount };
+        if (objects)
+            call.Objects.assign(objects, objects + count);
+        Calls.push_back(call);
+    }
+
+    template<typename T> void RecordOne(const char* method, T* object)
+    {
+        const void* objects[] = { object };
+        Record(method, 0, 1, objects);
+    }
+
+#define STUB_STAGE_METHODS(Prefix, Shader) \
+    void Prefix##SetShader(Shader* shader, ID3D11ClassInstance* const*, UINT) { RecordOne(#Prefix "SetShader", shader); } \
+    void Prefix##SetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers) { Record(#Prefix "SetConstantBuffers", slot, count, (const void* const*)buffers); } \
+    void Prefix##SetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* srvs) { Record(#Prefix "SetShaderResources", slot, count, (const void* const*)srvs); } \
+    void Prefix##SetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers) { Record(#Prefix "SetSamplers", slot, count, (const void* const*)samplers); }
+
+    STUB_STAGE_METHODS(VS, ID3D11VertexShader)
+    STUB_STAGE_METHODS(HS, ID3D11HullShader)
+    STUB_STAGE_METHODS(DS, ID3D11DomainShader)
+    STUB_STAGE_METHODS(GS, ID3D11GeometryShader)
+    STUB_STAGE_METHODS(PS, ID3D11PixelShader)
+    STUB_STAGE_METHODS(CS, ID3D11ComputeShader)
+#undef STUB_STAGE_METHODS
+
+    void IASetInputLayout(ID3D11InputLayout* layout) { RecordOne("IASetInputLayout", layout); }
+    void IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT*, const UINT* offsets)
+    {
+        Record("IASetVertexBuffers", slot, count, (const void* const*)buffers, offsets[0]);
+    }
+    void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT, UINT offset)
+    {
+        const void* objects[] = { buffer };
+        Record("IASetIndexBuffer", 0, 1, objects, offset);
+    }
+    void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) { Record("IASetPrimitiveTopology", topology, 0, 0); }
+
+    void RSSetState(ID3D11RasterizerState* state) { RecordOne("RSSetState", state); }
+    void RSSetViewports(UINT count, const D3D11_VIEWPORT*) { Record("RSSetViewports", count, 0, 0); }
+    void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+    {
+        const void* objects[] = { state };
+        Record("OMSetDepthStencilState", stencilRef, 1, objects);
+    }
+    void OMSetBlendState(ID3D11BlendState* state, const FLOAT*, UINT) { RecordOne("OMSetBlendState", state); }
+    void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* rtvs, ID3D11DepthStencilView*)
+    {
+        Record("OMSetRenderTargets", 0, count, (const void* const*)rtvs);
+    }
+};
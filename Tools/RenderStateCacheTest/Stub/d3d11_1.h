@@ -0,0 +1,22 @@
+#pragma once
+#include "d3d11.h"
+
+// --------------------------------------------------------
+// Stand-in for the Direct3D 11.1 context - a recording
+// context that can also bind ranges of constant buffers
+// --------------------------------------------------------
+class ID3D11DeviceContext1 : public ID3D11DeviceContext
+{
+public:
+#define STUB_STAGE_METHODS(Prefix) \
+    void Prefix##SetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) \
+    { Record(#Prefix "SetConstantBuffers1", slot, count, (const void* const*)buffers, firstConstants[0], constantCounts[0]); }
+
+    STUB_STAGE_METHODS(VS)
+    STUB_STAGE_METHODS(HS)
+    STUB_STAGE_METHODS(DS)
+    STUB_STAGE_METHODS(GS)
+    STUB_STAGE_METHODS(PS)
+    STUB_STAGE_METHODS(CS)
+#undef STUB_STAGE_METHODS
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stand-in for ComPtr that doesn't count references - the
+// test owns every object and outlives everything using them
+// --------------------------------------------------------
+namespace Microsoft
+{
+    namespace WRL
+    {
+        template<typename T> class ComPtr
+        {
+        public:
+            ComPtr() : pointer(0) {}
+            ComPtr(T* pointer) : pointer(pointer) {}
+
+            T* Get() const { return pointer; }
+            T* operator->() const { return pointer; }
+            explicit operator bool() const { return pointer != 0; }
+
+            // Stands in for QueryInterface
+            template<typename U> long As(ComPtr<U>* other) const
+            {
+                other->pointer = dynamic_cast<U*>(pointer);
+                return other->pointer ? 0 : -1;
+            }
+
+        private:
+            template<typename U> friend class ComPtr;
+            T* pointer;
+        };
+    }
+}
@@ -0,0 +1,235 @@
+#include <d3d11_1.h>
+#include "../Check.h"
+#include "../../RenderStateCache.h"
+
+// --------------------------------------------------------
+// Checks the render state cache against a recording stand-in
+// for the device context (see Stub/), so it runs anywhere:
+//
+//   RenderStateCacheTest
+//
+// Covers dropping redundant calls, forgetting bindings when
+// told to, narrowing ranged binds to the slots that changed,
+// the issued and filtered counts, and ranged constant buffers
+// with and without Direct3D 11.1.
+// --------------------------------------------------------
+
+static void TestRedundantCalls()
+{
+    ID3D11DeviceContext1 context;
+    RenderStateCache cache(&context);
+    RenderStateTracker& tracker = cache.GetTracker();
+    ID3D11VertexShader vs;
+    ID3D11PixelShader ps;
+    ID3D11RasterizerState rasterizer;
+
+    cache.VSSetShader(&vs);
+    cache.VSSetShader(&vs);
+    cache.PSSetShader(&ps);
+    cache.PSSetShader(&ps);
+    cache.RSSetState(&rasterizer);
+    cache.RSSetState(&rasterizer);
+    cache.RSSetState(0);
+    CHECK(context.Calls.size() == 4);
+    CHECK(context.Calls[0].Method == "VSSetShader");
+    CHECK(context.Calls[1].Method == "PSSetShader");
+    CHECK(context.Calls[3].Method == "RSSetState" && context.Calls[3].Objects[0] == 0);
+    CHECK(tracker.GetIssuedCount() == 4);
+    CHECK(tracker.GetFilteredCount() == 3);
+
+    // Extra values are part of the binding
+    ID3D11Buffer vertexBuffer;
+    cache.IASetVertexBuffer(0, &vertexBuffer, 32, 0);
+    cache.IASetVertexBuffer(0, &vertexBuffer, 32, 0);
+    cache.IASetVertexBuffer(0, &vertexBuffer, 32, 64);
+    cache.IASetVertexBuffer(1, &vertexBuffer, 32, 64);
+    ID3D11DepthStencilState depth;
+    cache.OMSetDepthStencilState(&depth, 0);
+    cache.OMSetDepthStencilState(&depth, 1);
+    cache.OMSetDepthStencilState(&depth, 1);
+    D3D11_VIEWPORT viewport = { 0, 0, 1280, 720, 0, 1 };
+    cache.RSSetViewport(viewport);
+    cache.RSSetViewport(viewport);
+    viewport.Height = 360;
+    cache.RSSetViewport(viewport);
+    CHECK(context.Calls.size() == 11);
+    CHECK(context.Calls[5].Method == "IASetVertexBuffers" && context.Calls[5].FirstConstant == 64);
+    CHECK(context.Calls[6].Slot == 1);
+    CHECK(tracker.GetIssuedCount() == 11);
+    CHECK(tracker.GetFilteredCount() == 6);
+
+    tracker.ResetStats();
+    CHECK(tracker.GetIssuedCount() == 0);
+    CHECK(tracker.GetFilteredCount() == 0);
+}
+
+static void TestInvalidate()
+{
+    ID3D11DeviceContext1 context;
+    RenderStateCache cache(&context);
+    ID3D11VertexShader vs;
+    ID3D11ShaderResourceView srv;
+    ID3D11SamplerState sampler;
+    ID3D11RenderTargetView rtv;
+
+    cache.VSSetShader(&vs);
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 0, &srv);
+    cache.SetSampler(RENDER_STAGE_PIXEL, 0, &sampler);
+    CHECK(context.Calls.size() == 3);
+
+    // Changing render targets can unbind SRVs behind the cache's back,
+    // so they have to be bound again - but nothing else does
+    ID3D11RenderTargetView* rtvs[] = { &rtv };
+    cache.OMSetRenderTargets(1, rtvs, 0);
+    cache.VSSetShader(&vs);
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 0, &srv);
+    cache.SetSampler(RENDER_STAGE_PIXEL, 0, &sampler);
+    CHECK(context.Calls.size() == 5);
+    CHECK(context.Calls[3].Method == "OMSetRenderTargets");
+    CHECK(context.Calls[4].Method == "PSSetShaderResources");
+
+    // After a full invalidate everything is bound again, once
+    cache.Invalidate();
+    cache.VSSetShader(&vs);
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 0, &srv);
+    cache.SetSampler(RENDER_STAGE_PIXEL, 0, &sampler);
+    cache.VSSetShader(&vs);
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 0, &srv);
+    cache.SetSampler(RENDER_STAGE_PIXEL, 0, &sampler);
+    CHECK(context.Calls.size() == 8);
+    CHECK(context.Calls[5].Method == "VSSetShader");
+    CHECK(context.Calls[6].Method == "PSSetShaderResources");
+    CHECK(context.Calls[7].Method == "PSSetSamplers");
+}
+
+static void TestRanges()
+{
+    ID3D11DeviceContext1 context;
+    RenderStateCache cache(&context);
+    RenderStateTracker& tracker = cache.GetTracker();
+    ID3D11ShaderResourceView a, b, c, d, x, y;
+
+    ID3D11ShaderResourceView* first[] = { &a, &b, &c, &d };
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, 2, 4, first);
+    CHECK(context.Calls.size() == 1);
+    CHECK(context.Calls[0].Slot == 2 && context.Calls[0].Count == 4);
+
+    // Only the middle two changed
+    ID3D11ShaderResourceView* second[] = { &a, &x, &y, &d };
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, 2, 4, second);
+    CHECK(context.Calls.size() == 2);
+    CHECK(context.Calls[1].Slot == 3 && context.Calls[1].Count == 2);
+    CHECK(context.Calls[1].Objects[0] == &x && context.Calls[1].Objects[1] == &y);
+
+    // A gap in the middle still goes out as one call
+    ID3D11ShaderResourceView* third[] = { &b, &x, &y, &c };
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, 2, 4, third);
+    CHECK(context.Calls.size() == 3);
+    CHECK(context.Calls[2].Slot == 2 && context.Calls[2].Count == 4);
+
+    // Nothing changed at all
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, 2, 4, third);
+    CHECK(context.Calls.size() == 3);
+
+    // Other stages are tracked on their own
+    cache.SetShaderResources(RENDER_STAGE_VERTEX, 2, 4, third);
+    CHECK(context.Calls.size() == 4);
+    CHECK(context.Calls[3].Method == "VSSetShaderResources");
+
+    // A single slot bind sees what the range bound
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 5, &c);
+    cache.SetShaderResource(RENDER_STAGE_PIXEL, 5, &d);
+    CHECK(context.Calls.size() == 5);
+    CHECK(context.Calls[4].Slot == 5 && context.Calls[4].Objects[0] == &d);
+
+    ID3D11SamplerState s0, s1;
+    ID3D11SamplerState* samplers[] = { &s0, &s1 };
+    cache.SetSamplers(RENDER_STAGE_PIXEL, 0, 2, samplers);
+    samplers[0] = &s1;
+    cache.SetSamplers(RENDER_STAGE_PIXEL, 0, 2, samplers);
+    CHECK(context.Calls.size() == 7);
+    CHECK(context.Calls[6].Slot == 0 && context.Calls[6].Count == 1);
+
+    // A ranged call counts once, however many slots it covers
+    CHECK(tracker.GetIssuedCount() == 7);
+    CHECK(tracker.GetFilteredCount() == 2);
+
+    // Slots beyond what's tracked are passed straight through
+    ID3D11ShaderResourceView* past[] = { &a, &b };
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, RENDER_STATE_RESOURCE_SLOTS - 1, 2, past);
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, RENDER_STATE_RESOURCE_SLOTS - 1, 2, past);
+    CHECK(context.Calls.size() == 9);
+}
+
+static void TestFilteringDisabled()
+{
+    ID3D11DeviceContext1 context;
+    RenderStateCache cache(&context);
+    RenderStateTracker& tracker = cache.GetTracker();
+    ID3D11PixelShader ps;
+    ID3D11ShaderResourceView a, b;
+
+    tracker.SetFilteringEnabled(false);
+    ID3D11ShaderResourceView* srvs[] = { &a, &b };
+    for (int i = 0; i < 3; i++)
+    {
+        cache.PSSetShader(&ps);
+        cache.SetShaderResources(RENDER_STAGE_PIXEL, 0, 2, srvs);
+    }
+    CHECK(context.Calls.size() == 6);
+    CHECK(context.Calls[5].Slot == 0 && context.Calls[5].Count == 2);
+    CHECK(tracker.GetIssuedCount() == 6);
+    CHECK(tracker.GetFilteredCount() == 0);
+
+    // Still tracked, so turning it back on filters straight away
+    tracker.SetFilteringEnabled(true);
+    cache.PSSetShader(&ps);
+    cache.SetShaderResources(RENDER_STAGE_PIXEL, 0, 2, srvs);
+    CHECK(context.Calls.size() == 6);
+    CHECK(tracker.GetFilteredCount() == 2);
+}
+
+static void TestConstantBuffers()
+{
+    ID3D11DeviceContext1 context;
+    RenderStateCache cache(&context);
+    ID3D11Buffer ring, plain;
+
+    // The same buffer at a different offset is a different binding
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring, 0, 16);
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring, 16, 16);
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring, 16, 16);
+    cache.SetConstantBuffer(RENDER_STAGE_PIXEL, 3, &ring, 16, 16);
+    CHECK(context.Calls.size() == 3);
+    CHECK(context.Calls[1].Method == "VSSetConstantBuffers1");
+    CHECK(context.Calls[1].FirstConstant == 16 && context.Calls[1].ConstantCount == 16);
+    CHECK(context.Calls[2].Method == "PSSetConstantBuffers1");
+
+    // And so is the whole buffer
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring);
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 4, &plain);
+    cache.SetConstantBuffer(RENDER_STAGE_VERTEX, 4, &plain);
+    CHECK(context.Calls.size() == 5);
+    CHECK(context.Calls[3].Method == "VSSetConstantBuffers");
+
+    // Without Direct3D 11.1 a range at offset 0 binds the whole buffer
+    ID3D11DeviceContext oldContext;
+    RenderStateCache oldCache(&oldContext);
+    oldCache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring, 0, 16);
+    oldCache.SetConstantBuffer(RENDER_STAGE_VERTEX, 3, &ring, 0, 16);
+    oldCache.SetConstantBuffer(RENDER_STAGE_PIXEL, 3, &ring, 0, 16);
+    CHECK(oldContext.Calls.size() == 2);
+    CHECK(oldContext.Calls[0].Method == "VSSetConstantBuffers");
+    CHECK(oldContext.Calls[0].Slot == 3 && oldContext.Calls[0].Objects[0] == &ring);
+    CHECK(oldContext.Calls[1].Method == "PSSetConstantBuffers");
+}
+
+int main()
+{
+    TestRedundantCalls();
+    TestInvalidate();
+    TestRanges();
+    TestFilteringDisabled();
+    TestConstantBuffers();
+    return CheckResult();
+}
@@ -0,0 +1,372 @@
+#include "ShaderStructGenerator.h"
+#include <algorithm>
+#include <cctype>
+
+// D3D_SHADER_VARIABLE_CLASS
+#define CLASS_SCALAR            0
+#define CLASS_VECTOR            1
+#define CLASS_MATRIX_ROWS       2
+#define CLASS_MATRIX_COLUMNS    3
+#define CLASS_STRUCT            5
+
+// D3D_SHADER_VARIABLE_TYPE
+#define TYPE_BOOL               1
+#define TYPE_INT                2
+#define TYPE_FLOAT              3
+#define TYPE_UINT               19
+#define TYPE_DOUBLE             39
+
+// D3D_CBUFFER_TYPE
+#define CBUFFER_TYPE_CBUFFER    0
+
+#define REGISTER_SIZE           16
+
+static unsigned int RoundToRegister(unsigned int size)
+{
+    return (size + REGISTER_SIZE - 1) / REGISTER_SIZE * REGISTER_SIZE;
+}
+
+ShaderStructGenerator::ShaderStructGenerator()
+{
+}
+
+ShaderStructGenerator::~ShaderStructGenerator()
+{
+}
+
+void ShaderStructGenerator::AddShader(const std::string& shaderName, DxbcReflection& reflection)
+{
+    for (const DxbcConstantBuffer& buffer : reflection.GetConstantBuffers())
+    {
+        if (buffer.Type != CBUFFER_TYPE_CBUFFER)
+            continue;
+
+        const DxbcResourceBinding* binding = reflection.FindResourceBinding(buffer.Name);
+        AddConstantBuffer(shaderName, buffer, binding ? binding->BindPoint : 0);
+    }
+}
+
+void ShaderStructGenerator::AddConstantBuffer(const std::string& shaderName, const DxbcConstantBuffer& buffer, unsigned int bindPoint)
+{
+    Buffer added;
+    added.ShaderName = shaderName;
+    added.BindPoint = bindPoint;
+    added.Shared = bindPoint >= SHADER_STRUCT_FIRST_SHARED_SLOT;
+    added.Desc = buffer;
+    added.StructName = added.Shared ?
+        MakeIdentifier(buffer.Name) + "Data" :
+        MakeIdentifier(shaderName) + MakeIdentifier(buffer.Name);
+
+    for (const Buffer& existing : buffers)
+    {
+        if (existing.StructName != added.StructName)
+            continue;
+
+        // Shared buffers turn up in most shaders - they only need
+        // writing once, but must be the same everywhere
+        if (!SameLayout(existing.Desc, added.Desc) || existing.BindPoint != added.BindPoint)
+        {
+            errors.push_back(added.StructName + ": " + buffer.Name + " in " + shaderName +
+                " doesn't match the one in " + existing.ShaderName);
+        }
+        return;
+    }
+
+    buffers.push_back(added);
+}
+
+bool ShaderStructGenerator::Generate(std::string& header)
+{
+    // Shared buffers first, by register, then everything else by name,
+    // so the output only changes when the shaders do
+    std::vector<const Buffer*> sorted;
+    for (const Buffer& buffer : buffers)
+        sorted.push_back(&buffer);
+    std::sort(sorted.begin(), sorted.end(), [](const Buffer* a, const Buffer* b)
+    {
+        if (a->Shared != b->Shared) return a->Shared;
+        if (a->Shared && a->BindPoint != b->BindPoint) return a->BindPoint < b->BindPoint;
+        return a->StructName < b->StructName;
+    });
+
+    header =
+        "// --------------------------------------------------------\n"
+        "// Generated by ShaderStructGen from the compiled shaders'\n"
+        "// reflection - don't edit, rerun the tool instead.\n"
+        "//\n"
+        "// One struct per constant buffer, laid out exactly like\n"
+        "// the buffer so it can be uploaded with a single copy\n"
+        "// (see SimpleShader's SetBufferStruct).\n"
+        "// --------------------------------------------------------\n"
+        "#pragma once\n"
+        "#include <cstddef>\n"
+        "#include <DirectXMath.h>\n"
+        "\n"
+        "// An array element or matrix column that doesn't fill its\n"
+        "// register - HLSL starts the next one on a new register\n"
+        "template<typename T> struct ShaderPadded\n"
+        "{\n"
+        "    T value;\n"
+        "    char padding[16 - sizeof(T) % 16];\n"
+        "};\n";
+
+    bool succeeded = errors.empty();
+    for (const Buffer* buffer : sorted)
+    {
+        std::vector<Member> members;
+        for (const DxbcVariable& variable : buffer->Desc.Variables)
+            members.push_back({ variable.Name, variable.StartOffset, &variable.Type });
+
+        std::string text;
+        std::string asserts;
+        text += "\n// " + buffer->Desc.Name + " : register(b" + std::to_string(buffer->BindPoint) + "), " +
+            std::to_string(buffer->Desc.Size) + " bytes" +
+            (buffer->Shared ? " - shared by every shader\n" : " - " + buffer->ShaderName + " only\n");
+
+        std::string body = "    static const char* GetBufferName() { return \"" + buffer->Desc.Name + "\"; }\n\n";
+        if (!WriteStruct(body, buffer->StructName, members, buffer->Desc.Size, "    ", asserts))
+        {
+            succeeded = false;
+            continue;
+        }
+
+        text += "struct " + buffer->StructName + "\n{\n" + body + "};\n";
+        text += asserts;
+        text += "static_assert(sizeof(" + buffer->StructName + ") == " + std::to_string(buffer->Desc.Size) +
+            ", \"" + buffer->StructName + " doesn't match the shader\");\n";
+        header += text;
+    }
+
+    return succeeded;
+}
+
+bool ShaderStructGenerator::WriteStruct(std::string& out, const std::string& qualifiedName, const std::vector<Member>& members, unsigned int size, const std::string& indent, std::string& asserts)
+{
+    unsigned int cursor = 0;
+    unsigned int paddingCount = 0;
+    auto pad = [&](unsigned int to)
+    {
+        unsigned int floats = (to - cursor) / 4;
+        out += indent + "float _pad" + std::to_string(paddingCount++);
+        out += floats > 1 ? "[" + std::to_string(floats) + "];\n" : ";\n";
+        cursor = to;
+    };
+
+    for (const Member& member : members)
+    {
+        if (member.Offset < cursor)
+        {
+            errors.push_back(qualifiedName + "." + member.Name + " is packed into the end of the previous member's " +
+                "last register, which C++ can't lay out - pad that member to a whole register");
+            return false;
+        }
+        if ((member.Offset - cursor) % 4 != 0)
+        {
+            errors.push_back(qualifiedName + "." + member.Name + " isn't 4 byte aligned");
+            return false;
+        }
+        if (member.Offset > cursor)
+            pad(member.Offset);
+
+        std::string declaration;
+        unsigned int cppSize = 0;
+        if (!GetCppType(*member.Type, member.Name, qualifiedName, declaration, out, indent, asserts, cppSize))
+            return false;
+
+        out += indent + declaration + ";\n";
+        asserts += "static_assert(offsetof(" + qualifiedName + ", " + member.Name + ") == " + std::to_string(member.Offset) +
+            ", \"" + qualifiedName + "." + member.Name + " doesn't match the shader\");\n";
+        cursor = member.Offset + cppSize;
+    }
+
+    if (cursor > size)
+    {
+        errors.push_back(qualifiedName + " ends in a partly filled register, which C++ can't lay out");
+        return false;
+    }
+    if (size > cursor)
+        pad(size);
+
+    return true;
+}
+
+bool ShaderStructGenerator::GetCppType(const DxbcType& type, const std::string& memberName, const std::string& owner, std::string& out, std::string& declarations, const std::string& indent, std::string& asserts, unsigned int& cppSize)
+{
+    std::string element;
+    std::string dimensions;
+    unsigned int elementSize = GetElementSize(type);
+    unsigned int elementCppSize = elementSize;
+
+    const char* scalar = 0;
+    const char* vector = 0;
+    switch (type.Type)
+    {
+    case TYPE_FLOAT: scalar = "float"; vector = "DirectX::XMFLOAT"; break;
+    case TYPE_INT: scalar = "int"; vector = "DirectX::XMINT"; break;
+    case TYPE_UINT: scalar = "unsigned int"; vector = "DirectX::XMUINT"; break;
+    case TYPE_BOOL: scalar = "int"; vector = "DirectX::XMINT"; break;  // HLSL bools are 4 bytes
+    case TYPE_DOUBLE: scalar = "double"; break;
+    }
+
+    switch (type.Class)
+    {
+    case CLASS_SCALAR:
+    case CLASS_VECTOR:
+        if (!scalar || (type.Columns > 1 && !vector) || type.Columns < 1 || type.Columns > 4)
+        {
+            errors.push_back(owner + "." + memberName + " has a type with no C++ equivalent");
+            return false;
+        }
+        element = type.Columns == 1 ? scalar : vector + std::to_string(type.Columns);
+        break;
+
+    case CLASS_MATRIX_ROWS:
+    case CLASS_MATRIX_COLUMNS:
+    {
+        // Each row (or column, for column_major) gets its own register
+        unsigned int registers = type.Class == CLASS_MATRIX_ROWS ? type.Rows : type.Columns;
+        unsigned int packed = type.Class == CLASS_MATRIX_ROWS ? type.Columns : type.Rows;
+        if (!vector || packed < 1 || packed > 4)
+        {
+            errors.push_back(owner + "." + memberName + " has a type with no C++ equivalent");
+            return false;
+        }
+
+        std::string row = packed == 1 ? scalar : vector + std::to_string(packed);
+        if (type.Type == TYPE_FLOAT && registers == 4 && packed == 4)
+        {
+            element = "DirectX::XMFLOAT4X4";
+        }
+        else
+        {
+            element = packed == 4 ? row : "ShaderPadded<" + row + ">";
+            dimensions = "[" + std::to_string(registers) + "]";
+        }
+        elementCppSize = registers * REGISTER_SIZE;
+        break;
+    }
+
+    case CLASS_STRUCT:
+    {
+        element = type.Name.empty() ? MakeIdentifier(memberName) + "Type" : MakeIdentifier(type.Name);
+
+        std::vector<Member> members;
+        for (const DxbcType::Member& member : type.Members)
+            members.push_back({ member.Name, member.Offset, &member.Type });
+
+        std::string qualified = owner + "::" + element;
+        std::string body;
+        std::string nestedAsserts;
+        if (!WriteStruct(body, qualified, members, elementSize, indent + "    ", nestedAsserts))
+            return false;
+
+        declarations += indent + "struct " + element + "\n" + indent + "{\n" + body + indent + "};\n";
+        asserts += nestedAsserts;
+        asserts += "static_assert(sizeof(" + qualified + ") == " + std::to_string(elementSize) +
+            ", \"" + qualified + " doesn't match the shader\");\n";
+        break;
+    }
+
+    default:
+        errors.push_back(owner + "." + memberName + " has a type with no C++ equivalent");
+        return false;
+    }
+
+    cppSize = elementCppSize;
+    if (type.Elements > 0)
+    {
+        // Array elements each start on a new register
+        unsigned int stride = RoundToRegister(elementCppSize);
+        if (stride != elementCppSize)
+        {
+            if (!dimensions.empty())
+            {
+                errors.push_back(owner + "." + memberName + " is an array C++ can't lay out");
+                return false;
+            }
+            element = "ShaderPadded<" + element + ">";
+        }
+        dimensions = "[" + std::to_string(type.Elements) + "]" + dimensions;
+        cppSize = stride * type.Elements;
+    }
+
+    out = element + " " + memberName + dimensions;
+    return true;
+}
+
+unsigned int ShaderStructGenerator::GetPackedSize(const DxbcType& type)
+{
+    unsigned int element = GetElementSize(type);
+    if (type.Elements == 0)
+        return element;
+    return RoundToRegister(element) * (type.Elements - 1) + element;
+}
+
+unsigned int ShaderStructGenerator::GetElementSize(const DxbcType& type)
+{
+    unsigned int component = type.Type == TYPE_DOUBLE ? 8 : 4;
+    switch (type.Class)
+    {
+    case CLASS_SCALAR:
+    case CLASS_VECTOR:
+        return type.Columns * component;
+
+    case CLASS_MATRIX_ROWS:
+        return (type.Rows - 1) * REGISTER_SIZE + type.Columns * component;
+
+    case CLASS_MATRIX_COLUMNS:
+        return (type.Columns - 1) * REGISTER_SIZE + type.Rows * component;
+
+    case CLASS_STRUCT:
+    {
+        unsigned int end = 0;
+        for (const DxbcType::Member& member : type.Members)
+            end = std::max(end, member.Offset + GetPackedSize(member.Type));
+        return end;
+    }
+    }
+    return 0;
+}
+
+bool ShaderStructGenerator::SameLayout(const DxbcType& a, const DxbcType& b)
+{
+    if (a.Class != b.Class || a.Type != b.Type || a.Rows != b.Rows || a.Columns != b.Columns ||
+        a.Elements != b.Elements || a.Members.size() != b.Members.size())
+        return false;
+
+    for (size_t i = 0; i < a.Members.size(); i++)
+    {
+        if (a.Members[i].Name != b.Members[i].Name || a.Members[i].Offset != b.Members[i].Offset ||
+            !SameLayout(a.Members[i].Type, b.Members[i].Type))
+            return false;
+    }
+    return true;
+}
+
+bool ShaderStructGenerator::SameLayout(const DxbcConstantBuffer& a, const DxbcConstantBuffer& b)
+{
+    if (a.Size != b.Size || a.Variables.size() != b.Variables.size())
+        return false;
+
+    for (size_t i = 0; i < a.Variables.size(); i++)
+    {
+        if (a.Variables[i].Name != b.Variables[i].Name || a.Variables[i].StartOffset != b.Variables[i].StartOffset ||
+            !SameLayout(a.Variables[i].Type, b.Variables[i].Type))
+            return false;
+    }
+    return true;
+}
+
+std::string ShaderStructGenerator::MakeIdentifier(const std::string& name)
+{
+    // Drops anything that can't go in a C++ name, like the $ in $Globals
+    std::string identifier;
+    for (char c : name)
+    {
+        if (isalnum((unsigned char)c) || c == '_')
+            identifier += c;
+    }
+    if (identifier.empty() || isdigit((unsigned char)identifier[0]))
+        identifier = "_" + identifier;
+    return identifier;
+}
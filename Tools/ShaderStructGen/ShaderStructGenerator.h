@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../../DxbcReflection.h"
+
+// Registers from here up hold the buffers every shader shares -
+// must match CB_SLOT_FIRST_SHARED in BufferStructs.h
+#define SHADER_STRUCT_FIRST_SHARED_SLOT 10
+
+// --------------------------------------------------------
+// Turns the constant buffers in shader reflection into C++
+// structs that can be copied into the buffer in one go.
+//
+// Members are placed with HLSL's packing rules - nothing
+// straddles a 16 byte register, and arrays, structs and
+// matrices start on a new one - and any gaps become explicit
+// padding. Every member's offset and the struct's size are
+// checked with static_asserts, which only catches the header
+// being edited by hand. Drift from the shaders themselves is
+// caught by DX11Starter's post-build step, which runs the
+// tool with --check on the .cso files it just compiled.
+//
+// Buffers bound at or above the first shared slot are the
+// shared ones (PerFrame and friends), named [Buffer]Data and
+// required to match in every shader. The rest belong to one
+// shader and are named [Shader][Buffer].
+// --------------------------------------------------------
+class ShaderStructGenerator
+{
+public:
+    ShaderStructGenerator();
+    ~ShaderStructGenerator();
+
+    // Collects every constant buffer in a compiled shader
+    void AddShader(const std::string& shaderName, DxbcReflection& reflection);
+    void AddConstantBuffer(const std::string& shaderName, const DxbcConstantBuffer& buffer, unsigned int bindPoint);
+
+    // Writes the header - returns false if anything couldn't be
+    // laid out, with the reasons in GetErrors()
+    bool Generate(std::string& header);
+
+    const std::vector<std::string>& GetErrors() { return errors; }
+
+private:
+    struct Buffer
+    {
+        std::string StructName;
+        std::string ShaderName;     // First shader it was found in
+        unsigned int BindPoint;
+        bool Shared;
+        DxbcConstantBuffer Desc;
+    };
+    std::vector<Buffer> buffers;
+    std::vector<std::string> errors;
+
+    // Members of a struct or buffer, ready to be written out
+    struct Member
+    {
+        std::string Name;
+        unsigned int Offset;
+        const DxbcType* Type;
+    };
+
+    bool WriteStruct(std::string& out, const std::string& qualifiedName, const std::vector<Member>& members, unsigned int size, const std::string& indent, std::string& asserts);
+    bool GetCppType(const DxbcType& type, const std::string& memberName, const std::string& owner, std::string& out, std::string& declarations, const std::string& indent, std::string& asserts, unsigned int& cppSize);
+
+    static unsigned int GetPackedSize(const DxbcType& type);
+    static unsigned int GetElementSize(const DxbcType& type);
+    static bool SameLayout(const DxbcType& a, const DxbcType& b);
+    static bool SameLayout(const DxbcConstantBuffer& a, const DxbcConstantBuffer& b);
+    static std::string MakeIdentifier(const std::string& name);
+};
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "ShaderStructGenerator.h"
+
+// --------------------------------------------------------
+// Offline tool that writes ShaderBufferStructs.h from the
+// compiled shaders:
+//
+//   ShaderStructGen [--check] <output.h> <shader.cso>...
+//
+// The header is only rewritten when it changes, so it doesn't
+// trigger rebuilds for nothing. With --check nothing is written
+// and the tool fails if the header is out of date instead -
+// DX11Starter runs it that way after every build.
+//
+// On Windows the shaders are reflected through D3DReflect,
+// elsewhere they're parsed by DxbcReflection.
+// --------------------------------------------------------
+
+static bool ReadFile(const char* path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// "C:/Shaders/LitVS.cso" -> "LitVS"
+static std::string GetShaderName(const char* path)
+{
+    std::string name = path;
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string::npos)
+        name = name.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos)
+        name = name.substr(0, dot);
+    return name;
+}
+
+int main(int argc, char* argv[])
+{
+    int first = 1;
+    bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    if (check)
+        first++;
+
+    if (argc - first < 2)
+    {
+        printf("Usage: ShaderStructGen [--check] <output.h> <shader.cso>...\n");
+        return 1;
+    }
+
+    const char* outputPath = argv[first];
+    ShaderStructGenerator generator;
+    for (int i = first + 1; i < argc; i++)
+    {
+        std::string code;
+        DxbcReflection reflection;
+#ifdef _WIN32
+        bool reflected = ReadFile(argv[i], code) && reflection.Reflect(code.data(), code.size());
+#else
+        bool reflected = ReadFile(argv[i], code) && reflection.Parse(code.data(), code.size());
+#endif
+        if (!reflected)
+        {
+            printf("%s: not a compiled shader\n", argv[i]);
+            return 1;
+        }
+        generator.AddShader(GetShaderName(argv[i]), reflection);
+    }
+
+    std::string header;
+    if (!generator.Generate(header))
+    {
+        for (const std::string& error : generator.GetErrors())
+            printf("error: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::string existing;
+    if (ReadFile(outputPath, existing) && existing == header)
+        return 0;
+
+    if (check)
+    {
+        printf("%s is out of date - rerun ShaderStructGen\n", outputPath);
+        return 1;
+    }
+
+    std::ofstream output(outputPath, std::ios::binary);
+    output << header;
+    if (!output)
+    {
+        printf("%s: couldn't write\n", outputPath);
+        return 1;
+    }
+    printf("Wrote %s\n", outputPath);
+    return 0;
+}
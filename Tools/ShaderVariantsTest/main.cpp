@@ -0,0 +1,171 @@
+#include "../Check.h"
+#include "../../ShaderVariants.h"
+#include "../../LitShaderVariants.h"
+
+// --------------------------------------------------------
+// Headless checks of the shader variant keys and selection:
+//
+//   ShaderVariantsTest
+//
+// Covers keys surviving a round trip, variant names, which
+// variants cover a request, the tie-breaks between them, and
+// that Game's lit variant tables have an answer for every
+// material at every light count.
+// --------------------------------------------------------
+
+static const ShaderLightBucket buckets[] = { SHADER_LIGHTS_NONE, SHADER_LIGHTS_ONE, SHADER_LIGHTS_FEW, SHADER_LIGHTS_ANY };
+
+static void TestKeys()
+{
+    for (unsigned int features = 0; features <= SHADER_FEATURE_MASK; features++)
+    {
+        for (ShaderLightBucket lights : buckets)
+        {
+            ShaderVariantKey key = MakeShaderVariantKey(features, lights);
+            CHECK(GetShaderVariantFeatures(key) == features);
+            CHECK(GetShaderVariantLights(key) == lights);
+        }
+    }
+
+    // Bits outside the features don't leak into the bucket
+    CHECK(GetShaderVariantLights(MakeShaderVariantKey(0xFF, SHADER_LIGHTS_ONE)) == SHADER_LIGHTS_ONE);
+
+    CHECK(GetShaderLightBucket(0) == SHADER_LIGHTS_NONE);
+    CHECK(GetShaderLightBucket(1) == SHADER_LIGHTS_ONE);
+    CHECK(GetShaderLightBucket(2) == SHADER_LIGHTS_FEW);
+    CHECK(GetShaderLightBucket(SHADER_LIGHTS_FEW_MAX) == SHADER_LIGHTS_FEW);
+    CHECK(GetShaderLightBucket(SHADER_LIGHTS_FEW_MAX + 1) == SHADER_LIGHTS_ANY);
+
+    CHECK(GetShaderFeatureForTexture("NormalMap") == SHADER_FEATURE_NORMAL_MAP);
+    CHECK(GetShaderFeatureForTexture("SkyTexture") == SHADER_FEATURE_REFLECTION);
+    CHECK(GetShaderFeatureForTexture("ShadowMap") == SHADER_FEATURE_SHADOWS);
+    CHECK(GetShaderFeatureForTexture("Albedo") == 0);
+}
+
+static void TestNames()
+{
+    unsigned int all = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS;
+    CHECK(GetShaderVariantName("LitPS", MakeShaderVariantKey(all, SHADER_LIGHTS_FEW)) == "LitPS_NRS_L2");
+    CHECK(GetShaderVariantName("LitPS", MakeShaderVariantKey(all, SHADER_LIGHTS_ANY)) == "LitPS_NRS_L3");
+    CHECK(GetShaderVariantName("LitPS", MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ONE)) == "LitPS_S_L1");
+    CHECK(GetShaderVariantName("LitPS", MakeShaderVariantKey(0, SHADER_LIGHTS_FEW)) == "LitPS_L2");
+    CHECK(GetShaderVariantName("LitVS", MakeShaderVariantKey(SHADER_FEATURE_INSTANCING, SHADER_LIGHTS_NONE)) == "LitVS_I");
+    CHECK(GetShaderVariantName("LitVS", MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)) == "LitVS");
+}
+
+static void TestCovers()
+{
+    ShaderVariantKey rs = MakeShaderVariantKey(SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW);
+
+    // Extra reflections and shadows are fine, fewer lights aren't
+    CHECK(ShaderVariantSelector::Covers(rs, rs));
+    CHECK(ShaderVariantSelector::Covers(rs, MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ONE)));
+    CHECK(ShaderVariantSelector::Covers(rs, MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)));
+    CHECK(!ShaderVariantSelector::Covers(rs, MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY)));
+    CHECK(!ShaderVariantSelector::Covers(rs, MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_FEW)));
+
+    // A normal mapped variant can't stand in for a material without a
+    // normal map - it would sample a NormalMap that isn't bound - and
+    // an instanced vertex shader can't draw a single object
+    ShaderVariantKey nrs = MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY);
+    CHECK(ShaderVariantSelector::Covers(nrs, MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_ANY)));
+    CHECK(!ShaderVariantSelector::Covers(nrs, MakeShaderVariantKey(SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_ANY)));
+    CHECK(!ShaderVariantSelector::Covers(nrs, MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)));
+    CHECK(!ShaderVariantSelector::Covers(
+        MakeShaderVariantKey(SHADER_FEATURE_INSTANCING, SHADER_LIGHTS_NONE),
+        MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)));
+}
+
+static void TestSelect()
+{
+    ShaderVariantSelector selector;
+    CHECK(selector.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)) == -1);
+
+    unsigned int nr = selector.Add(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_FEW));
+    unsigned int nAny = selector.Add(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_ANY));
+    unsigned int nrsAny = selector.Add(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY));
+    CHECK(nr == 0 && nAny == 1 && nrsAny == 2);
+    CHECK(selector.GetCount() == 3);
+
+    // Fewest extra features wins over a smaller light bucket
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_ONE)) == (int)nAny);
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_ONE)) == (int)nr);
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_FEW)) == (int)nrsAny);
+
+    // Nothing has room for any number of lights with reflections but
+    // no shadows, nor can anything here go without a normal map
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_ANY)) == (int)nrsAny);
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_REFLECTION, SHADER_LIGHTS_FEW)) == -1);
+    CHECK(selector.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)) == -1);
+
+    // With the same extras, the smaller bucket wins - and adding a
+    // variant forgets earlier answers, so it's picked up
+    unsigned int nFew = selector.Add(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_FEW));
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_ONE)) == (int)nFew);
+    CHECK(selector.Select(MakeShaderVariantKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_ANY)) == (int)nAny);
+
+    unsigned int plain = selector.Add(MakeShaderVariantKey(0, SHADER_LIGHTS_ANY));
+    CHECK(selector.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_NONE)) == (int)plain);
+
+    // A full tie goes to whichever was added first
+    unsigned int plainAgain = selector.Add(MakeShaderVariantKey(0, SHADER_LIGHTS_ANY));
+    CHECK(plainAgain == plain + 1);
+    CHECK(selector.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_ONE)) == (int)plain);
+    CHECK(selector.GetKey(plainAgain) == MakeShaderVariantKey(0, SHADER_LIGHTS_ANY));
+}
+
+// Every material a lit shader can get - any mix of normal map,
+// reflections and shadows - has a variant at every light count,
+// with normal mapping exactly when it has a normal map
+static void TestLitTables()
+{
+    ShaderVariantSelector pixel;
+    for (ShaderVariantKey key : litPixelShaderKeys)
+        pixel.Add(key);
+
+    unsigned int all = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_SHADOWS;
+    for (unsigned int features = 0; features <= all; features++)
+    {
+        for (ShaderLightBucket lights : buckets)
+        {
+            ShaderVariantKey request = MakeShaderVariantKey(features, lights);
+            int selected = pixel.Select(request);
+            CHECK(selected >= 0);
+            if (selected < 0)
+            {
+                printf("  nothing for %s\n", GetShaderVariantName("LitPS", request).c_str());
+                continue;
+            }
+
+            ShaderVariantKey key = pixel.GetKey(selected);
+            CHECK((GetShaderVariantFeatures(key) & features) == features);
+            CHECK((GetShaderVariantFeatures(key) & SHADER_FEATURE_NORMAL_MAP) == (features & SHADER_FEATURE_NORMAL_MAP));
+            CHECK(GetShaderVariantLights(key) >= lights);
+        }
+    }
+
+    // Plenty of lights and no normal map gets the variant without one
+    int anyLights = pixel.Select(MakeShaderVariantKey(SHADER_FEATURE_SHADOWS, SHADER_LIGHTS_ANY));
+    CHECK(anyLights >= 0 && GetShaderVariantName("LitPS", pixel.GetKey(anyLights)) == "LitPS_RS_L3");
+
+    // New materials start on the last one, which has to have everything
+    CHECK(pixel.GetKey(pixel.GetCount() - 1) == MakeShaderVariantKey(all, SHADER_LIGHTS_ANY));
+
+    ShaderVariantSelector vertex;
+    for (ShaderVariantKey key : litVertexShaderKeys)
+        vertex.Add(key);
+    int single = vertex.Select(MakeShaderVariantKey(0, SHADER_LIGHTS_NONE));
+    int instanced = vertex.Select(MakeShaderVariantKey(SHADER_FEATURE_INSTANCING, SHADER_LIGHTS_NONE));
+    CHECK(single >= 0 && GetShaderVariantFeatures(vertex.GetKey(single)) == 0);
+    CHECK(instanced >= 0 && GetShaderVariantFeatures(vertex.GetKey(instanced)) == SHADER_FEATURE_INSTANCING);
+}
+
+int main()
+{
+    TestKeys();
+    TestNames();
+    TestCovers();
+    TestSelect();
+    TestLitTables();
+    return CheckResult();
+}
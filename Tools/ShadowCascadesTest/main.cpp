@@ -0,0 +1,177 @@
+#include <cmath>
+#include "../Check.h"
+#include "../../ShadowCascades.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Headless checks of the cascade fitting math:
+//
+//   ShadowCascadesTest
+//
+// Covers the split scheme at both ends of lambda, that each
+// cascade's sphere holds its slice of the frustum, and that
+// texel snapping keeps the shadow map from sliding around
+// under small camera moves, at whatever tile size it gets.
+// --------------------------------------------------------
+
+static const float fov = XM_PIDIV4;
+static const float aspectRatio = 16.0f / 9.0f;
+static const float nearClip = 0.1f;
+static const float farClip = 100.0f;
+static const XMFLOAT3 lightDirection(0.3f, -1.0f, 0.6f);
+
+static XMFLOAT4X4 MakeView(XMFLOAT3 position, float pitch, float yaw)
+{
+    XMVECTOR forward = XMVectorSet(
+        std::sin(yaw) * std::cos(pitch),
+        -std::sin(pitch),
+        std::cos(yaw) * std::cos(pitch),
+        0);
+    XMFLOAT4X4 view;
+    XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&position), forward, XMVectorSet(0, 1, 0, 0)));
+    return view;
+}
+
+static void TestSplits()
+{
+    const int count = 4;
+    float splits[count + 1];
+
+    // Lambda 0 is the uniform scheme
+    ShadowCascades::ComputeSplits(nearClip, farClip, count, 0.0f, splits);
+    for (int i = 0; i <= count; i++)
+        CHECK_NEAR(splits[i], nearClip + (farClip - nearClip) * i / count, 1e-4);
+
+    // Lambda 1 is the logarithmic scheme
+    ShadowCascades::ComputeSplits(nearClip, farClip, count, 1.0f, splits);
+    for (int i = 0; i <= count; i++)
+        CHECK_NEAR(splits[i], nearClip * std::pow(farClip / nearClip, (float)i / count), 1e-3);
+
+    // Anything in between stays ordered and pinned to the clip planes
+    ShadowCascades::ComputeSplits(nearClip, farClip, count, 0.75f, splits);
+    CHECK(splits[0] == nearClip);
+    CHECK(splits[count] == farClip);
+    for (int i = 0; i < count; i++)
+        CHECK(splits[i] < splits[i + 1]);
+}
+
+static void TestBoundsHoldSlices()
+{
+    ShadowCascades cascades;
+    float tanHalfFovY = std::tan(fov / 2);
+    float tanHalfFovX = tanHalfFovY * aspectRatio;
+
+    XMFLOAT3 positions[] = { XMFLOAT3(0, 2, -10), XMFLOAT3(13.5f, 4, 7.25f) };
+    for (const XMFLOAT3& position : positions)
+    {
+        for (float yaw = 0; yaw < XM_2PI; yaw += 0.7f)
+        {
+            XMFLOAT4X4 view = MakeView(position, 0.3f, yaw);
+            cascades.Update(view, fov, aspectRatio, nearClip, farClip, lightDirection);
+            XMMATRIX cameraWorld = XMMatrixInverse(0, XMLoadFloat4x4(&view));
+
+            for (int c = 0; c < cascades.GetCascadeCount(); c++)
+            {
+                const ShadowCascade& cascade = cascades.GetCascade(c);
+                XMVECTOR center = XMLoadFloat3(&cascade.Bounds.Center);
+                float depths[] = { cascade.SplitNear, cascade.SplitFar };
+                for (float z : depths)
+                {
+                    for (int corner = 0; corner < 4; corner++)
+                    {
+                        float x = (corner & 1 ? 1 : -1) * z * tanHalfFovX;
+                        float y = (corner & 2 ? 1 : -1) * z * tanHalfFovY;
+                        XMVECTOR point = XMVector3Transform(XMVectorSet(x, y, z, 1), cameraWorld);
+                        float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(point, center)));
+                        CHECK(distance <= cascade.Bounds.Radius + 1e-3f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Where a fixed world point lands in a cascade's shadow map, in texels
+static XMFLOAT2 GetTexel(const ShadowCascade& cascade, unsigned int resolution, XMVECTOR worldPoint)
+{
+    XMVECTOR clip = XMVector3TransformCoord(worldPoint, XMLoadFloat4x4(&cascade.ViewProjection));
+    return XMFLOAT2(
+        (XMVectorGetX(clip) * 0.5f + 0.5f) * resolution,
+        (XMVectorGetY(clip) * 0.5f + 0.5f) * resolution);
+}
+
+// How far apart two positions are within their texels, wrapping around
+static float TexelOffset(float a, float b)
+{
+    float offset = std::fabs((a - std::floor(a)) - (b - std::floor(b)));
+    return std::fmin(offset, 1 - offset);
+}
+
+static void TestSnapping(unsigned int tileSize)
+{
+    ShadowCascades cascades;
+    unsigned int resolution = tileSize;
+
+    XMFLOAT3 start(2.0f, 3.0f, -8.0f);
+    XMVECTOR worldPoint = XMVectorSet(1.25f, 0.5f, 4.75f, 1);
+
+    float radius[MAX_SHADOW_CASCADES];
+    float originX[MAX_SHADOW_CASCADES];
+    float originY[MAX_SHADOW_CASCADES];
+    XMFLOAT2 firstTexel[MAX_SHADOW_CASCADES];
+
+    // Creep the camera along in steps much smaller than a texel
+    for (int step = 0; step < 200; step++)
+    {
+        XMFLOAT3 position(start.x + step * 0.0013f, start.y, start.z + step * 0.0007f);
+        cascades.Update(MakeView(position, 0.2f, 0.4f), fov, aspectRatio, nearClip, farClip, lightDirection);
+
+        for (int c = 0; c < cascades.GetCascadeCount(); c++)
+        {
+            // Same as the atlas handing out a smaller tile than was asked for
+            cascades.SetTileSize(c, tileSize);
+            const ShadowCascade& cascade = cascades.GetCascade(c);
+            CHECK(cascade.TileSize == tileSize);
+            float texelSize = 2 * cascade.Bounds.Radius / resolution;
+
+            // Ortho origin in light space, from the off-center projection
+            float x = -cascade.Projection._41 / cascade.Projection._11;
+            float y = -cascade.Projection._42 / cascade.Projection._22;
+
+            // It only ever sits on whole texels
+            CHECK_NEAR(x / texelSize, std::round(x / texelSize), 1e-2);
+            CHECK_NEAR(y / texelSize, std::round(y / texelSize), 1e-2);
+
+            XMFLOAT2 texel = GetTexel(cascade, resolution, worldPoint);
+            if (step == 0)
+            {
+                radius[c] = cascade.Bounds.Radius;
+                originX[c] = x;
+                originY[c] = y;
+                firstTexel[c] = texel;
+                continue;
+            }
+
+            // The map's scale never changes, its origin moves by whole
+            // texels at most, and so a fixed point in the world always
+            // lands on the same spot within its texel
+            CHECK(cascade.Bounds.Radius == radius[c]);
+            CHECK_NEAR(std::fabs(x - originX[c]) / texelSize, std::round(std::fabs(x - originX[c]) / texelSize), 1e-2);
+            CHECK_NEAR(std::fabs(y - originY[c]) / texelSize, std::round(std::fabs(y - originY[c]) / texelSize), 1e-2);
+            CHECK_NEAR(TexelOffset(texel.x, firstTexel[c].x), 0.0, 2e-2);
+            CHECK_NEAR(TexelOffset(texel.y, firstTexel[c].y), 0.0, 2e-2);
+            originX[c] = x;
+            originY[c] = y;
+        }
+    }
+}
+
+int main()
+{
+    TestSplits();
+    TestBoundsHoldSlices();
+    TestSnapping(ShadowCascades().GetResolution());
+    TestSnapping(256);
+    return CheckResult();
+}
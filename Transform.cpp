@@ -12,6 +12,7 @@ Transform::Transform()
     XMStoreFloat4x4(&worldInverseTransposeMatrix, ident);
 
     matricesDirty = false;
+    version = 0;
 }
 
 Transform::~Transform()
@@ -81,11 +82,17 @@ DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
     return worldInverseTransposeMatrix;
 }
 
+unsigned int Transform::GetVersion()
+{
+    return version;
+}
+
 void Transform::SetPosition(float x, float y, float z)
 {
     position = XMFLOAT3(x, y, z);
 
     matricesDirty = true;
+    version++;
 }
 
 void Transform::SetPitchYawRoll(float pitch, float yaw, float roll)
@@ -93,6 +100,7 @@ void Transform::SetPitchYawRoll(float pitch, float yaw, float roll)
     pitchYawRoll = XMFLOAT3(pitch, yaw, roll);
 
     matricesDirty = true;
+    version++;
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -100,6 +108,7 @@ void Transform::SetScale(float x, float y, float z)
     scale = XMFLOAT3(x, y, z);
 
     matricesDirty = true;
+    version++;
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
@@ -109,6 +118,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
     position.z += z;
 
     matricesDirty = true;
+    version++;
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -121,6 +131,9 @@ void Transform::MoveRelative(float x, float y, float z)
     XMStoreFloat3(
         &position,
         XMLoadFloat3(&position) + rotatedVector);
+
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
@@ -129,7 +142,8 @@ void Transform::Rotate(float pitch, float yaw, float roll)
     pitchYawRoll.y += yaw;
     pitchYawRoll.z += roll;
 
-     matricesDirty = true;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -139,6 +153,7 @@ void Transform::Scale(float x, float y, float z)
     scale.z *= z;
 
     matricesDirty = true;
+    version++;
 }
 
 void Transform::UpdateMatrices()
@@ -19,6 +19,10 @@ public:
     DirectX::XMFLOAT4X4 GetWorldMatrix();
     DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
+    // Goes up every time the transform changes, so other systems
+    // can tell whether anything moved since they last looked
+    unsigned int GetVersion();
+
     // Setters
     void SetPosition(float x, float y, float z);
     void SetPitchYawRoll(float pitch, float yaw, float roll);
@@ -38,6 +42,7 @@ private:
 
     // Matrices
     bool matricesDirty;
+    unsigned int version;
     DirectX::XMFLOAT4X4 worldMatrix;
     DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
 
@@ -1,10 +1,5 @@
 #include "ShaderIncludes.hlsli"
-
-cbuffer ExternalData : register(b0)
-{
-    matrix view;
-    matrix projection;
-};
+#include "ConstantBuffers.hlsli"
 
 VertexToPixel_Sky main(VertexShaderInput input)
 {